@@ -1,60 +1,382 @@
 #include "Api.hpp"
 
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
 #include <boost/log/attributes/named_scope.hpp>
 #include <boost/log/trivial.hpp>
 #include <drogon/HttpResponse.h>
 #include <drogon/HttpTypes.h>
+#include <json/value.h>
 #include <opencv2/imgcodecs.hpp>
-#include <sstream>
+
+#include "ErrorWithContext.hpp"
+#include "TimelineReader.hpp"
+#include "ffmpeg_adapters/JpegEncoder.hpp"
+#include "ffmpeg_adapters/RecordingInfo.hpp"
 
 namespace vehlwn::api {
 
 namespace {
-drogon::HttpResponsePtr create_encoded_image_resp(const cv::Mat& image)
+drogon::HttpResponsePtr create_text_resp(
+    const drogon::HttpStatusCode code,
+    std::string&& msg)
+{
+    auto ret = drogon::HttpResponse::newHttpResponse();
+    ret->setStatusCode(code);
+    ret->setContentTypeCode(drogon::CT_TEXT_PLAIN);
+    ret->setBody(std::move(msg));
+    return ret;
+}
+
+std::optional<std::uint64_t> parse_uint(const std::string_view s)
+{
+    std::uint64_t ret = 0;
+    const auto* const end = s.data() + s.size();
+    const auto [ptr, ec] = std::from_chars(s.data(), end, ret);
+    if(ec != std::errc() || ptr != end) {
+        return std::nullopt;
+    }
+    return ret;
+}
+
+// Parses ?q=, ?w= and ?crop=x,y,width,height of image endpoints. Ranges are
+// checked by JpegEncoder.
+ffmpeg::JpegOptions parse_jpeg_options(const drogon::HttpRequestPtr& req)
+{
+    constexpr auto max_int
+        = static_cast<std::uint64_t>(std::numeric_limits<int>::max());
+    const auto parse_int = [](const std::string_view value, const char* const name) {
+        const auto tmp = parse_uint(value);
+        if(!tmp || *tmp > max_int) {
+            throw std::invalid_argument(
+                std::string("Invalid '") + name + "' parameter");
+        }
+        return static_cast<int>(*tmp);
+    };
+    auto ret = ffmpeg::JpegOptions();
+    if(const auto& value = req->getParameter("q"); !value.empty()) {
+        ret.quality = parse_int(value, "q");
+    }
+    if(const auto& value = req->getParameter("w"); !value.empty()) {
+        ret.width = parse_int(value, "w");
+    }
+    if(const auto& value = req->getParameter("crop"); !value.empty()) {
+        auto rect = std::array<int, 4>();
+        auto rest = std::string_view(value);
+        for(std::size_t i = 0; i < rect.size(); i++) {
+            const auto comma = rest.find(',');
+            if((comma == std::string_view::npos) != (i + 1 == rect.size())) {
+                throw std::invalid_argument("crop must be x,y,width,height");
+            }
+            rect[i] = parse_int(rest.substr(0, comma), "crop");
+            rest = rest.substr(comma + 1);
+        }
+        ret.crop = cv::Rect(rect[0], rect[1], rect[2], rect[3]);
+    }
+    return ret;
+}
+
+drogon::HttpResponsePtr create_encoded_image_resp(
+    ffmpeg::JpegEncoderPool& encoders,
+    const cv::Mat& image,
+    const ffmpeg::JpegOptions& options)
+{
+    BOOST_LOG_FUNCTION();
+    auto body = std::string();
+    try {
+        encoders.acquire()->encode(image, options, body);
+    } catch(const std::invalid_argument& ex) {
+        return create_text_resp(drogon::k400BadRequest, ex.what());
+    } catch(const std::exception& ex) {
+        auto error_msg
+            = std::string("Exception converting image to .jpg format: ") + ex.what();
+        BOOST_LOG_TRIVIAL(warning) << error_msg;
+        return create_text_resp(
+            drogon::k500InternalServerError,
+            std::move(error_msg));
+    }
+    BOOST_LOG_TRIVIAL(debug) << "Encoded .jpg file, size = " << body.size();
+    auto ret = drogon::HttpResponse::newHttpResponse();
+    ret->setContentTypeCode(drogon::CT_IMAGE_JPG);
+    // The body is moved, newFileResponse would copy it
+    ret->setBody(std::move(body));
+    return ret;
+}
+
+// Encodes 0/255 mask as a 1 bit per pixel PNG
+drogon::HttpResponsePtr create_bilevel_png_resp(const cv::Mat& mask)
 {
     BOOST_LOG_FUNCTION();
-    constexpr auto format = ".jpg";
-    auto ret = drogon::HttpResponsePtr();
+    auto buf = std::vector<unsigned char>();
     try {
-        auto buf = std::vector<unsigned char>();
-        const bool result = cv::imencode(format, image, buf);
-        if(result) {
-            BOOST_LOG_TRIVIAL(debug)
-                << "Saved " << format << "file, buf.size =" << buf.size();
-            ret = drogon::HttpResponse::newFileResponse(
+        const auto params = std::vector<int>{cv::IMWRITE_PNG_BILEVEL, 1};
+        if(cv::imencode(".png", mask, buf, params)) {
+            return drogon::HttpResponse::newFileResponse(
                 buf.data(),
                 buf.size(),
                 "",
-                drogon::CT_IMAGE_JPG);
-        } else {
-            std::ostringstream os;
-            os << "Can't save " << format << " file.";
-            auto error_msg = os.str();
-            BOOST_LOG_TRIVIAL(warning) << error_msg;
-            ret = drogon::HttpResponse::newHttpResponse();
-            ret->setStatusCode(drogon::HttpStatusCode::k500InternalServerError);
-            ret->setContentTypeCode(drogon::CT_TEXT_PLAIN);
-            ret->setBody(std::move(error_msg));
+                drogon::CT_IMAGE_PNG);
         }
+        BOOST_LOG_TRIVIAL(warning) << "Can't save .png file.";
     } catch(const cv::Exception& ex) {
-        std::ostringstream os;
-        os << "Exception converting image to " << format << " format: " << ex.what();
-        auto error_msg = os.str();
-        BOOST_LOG_TRIVIAL(warning) << error_msg;
-        ret = drogon::HttpResponse::newHttpResponse();
-        ret->setStatusCode(drogon::HttpStatusCode::k500InternalServerError);
-        ret->setContentTypeCode(drogon::CT_TEXT_PLAIN);
-        ret->setBody(std::move(error_msg));
+        BOOST_LOG_TRIVIAL(warning)
+            << "Exception converting image to .png format: " << ex.what();
+    }
+    auto ret = drogon::HttpResponse::newHttpResponse();
+    ret->setStatusCode(drogon::HttpStatusCode::k500InternalServerError);
+    ret->setContentTypeCode(drogon::CT_TEXT_PLAIN);
+    ret->setBody("Failed to encode motion mask");
+    return ret;
+}
+
+// Returns Unix time in seconds from a query parameter or default_value
+std::chrono::system_clock::time_point parse_time_parameter(
+    const drogon::HttpRequestPtr& req,
+    const std::string& name,
+    const std::chrono::system_clock::time_point default_value)
+{
+    const auto& value = req->getParameter(name);
+    if(value.empty()) {
+        return default_value;
+    }
+    const auto seconds = invoke_with_error_context_str(
+        [&] { return std::stod(value); },
+        "Invalid '" + name + "' parameter");
+    // Converting a value outside of the clock range to an integer duration is
+    // undefined, and stod accepts inf and nan
+    const auto max_seconds
+        = std::chrono::duration<double>(std::chrono::system_clock::duration::max())
+              .count();
+    if(!std::isfinite(seconds) || std::abs(seconds) >= max_seconds) {
+        throw std::out_of_range("'" + name + "' parameter is out of range");
+    }
+    return std::chrono::system_clock::time_point(
+        std::chrono::duration_cast<std::chrono::system_clock::duration>(
+            std::chrono::duration<double>(seconds)));
+}
+
+double to_unix_seconds(const std::chrono::system_clock::time_point t)
+{
+    return std::chrono::duration<double>(t.time_since_epoch()).count();
+}
+
+struct ByteRange {
+    std::uint64_t offset;
+    std::uint64_t length;
+};
+
+struct RangeNotSatisfiable {};
+
+// Parses a single range of the Range header. Returns std::nullopt when the whole
+// file should be sent: the header is absent, invalid or has several ranges.
+std::optional<ByteRange>
+    parse_range_header(const std::string_view header, const std::uint64_t size)
+{
+    constexpr std::string_view unit = "bytes=";
+    if(!header.starts_with(unit) || header.find(',') != std::string_view::npos) {
+        return std::nullopt;
+    }
+    const auto spec = header.substr(unit.size());
+    const auto dash = spec.find('-');
+    if(dash == std::string_view::npos) {
+        return std::nullopt;
+    }
+    const auto first = spec.substr(0, dash);
+    const auto last = spec.substr(dash + 1);
+    if(first.empty()) {
+        // Suffix range: last N bytes
+        const auto suffix = parse_uint(last);
+        if(!suffix) {
+            return std::nullopt;
+        }
+        if(*suffix == 0 || size == 0) {
+            throw RangeNotSatisfiable();
+        }
+        const auto length = std::min(*suffix, size);
+        return ByteRange{size - length, length};
+    }
+    const auto start = parse_uint(first);
+    if(!start) {
+        return std::nullopt;
+    }
+    auto end = size == 0 ? 0 : size - 1;
+    if(!last.empty()) {
+        const auto tmp = parse_uint(last);
+        if(!tmp || *tmp < *start) {
+            return std::nullopt;
+        }
+        end = std::min(end, *tmp);
+    }
+    if(*start >= size) {
+        throw RangeNotSatisfiable();
+    }
+    return ByteRange{*start, end - *start + 1};
+}
+
+Json::Value to_json(const Blob& blob)
+{
+    auto ret = Json::Value(Json::objectValue);
+    ret["x"] = blob.bbox.x;
+    ret["y"] = blob.bbox.y;
+    ret["width"] = blob.bbox.width;
+    ret["height"] = blob.bbox.height;
+    ret["area"] = blob.area;
+    ret["centroid_x"] = blob.centroid.x;
+    ret["centroid_y"] = blob.centroid.y;
+    return ret;
+}
+
+std::string to_hex(const ffmpeg::MotionHeatmap& heatmap)
+{
+    constexpr std::string_view digits = "0123456789abcdef";
+    auto ret = std::string();
+    ret.reserve(heatmap.size() * 2);
+    for(const auto x : heatmap) {
+        ret.push_back(digits[x >> 4U]);
+        ret.push_back(digits[x & 0xFU]);
+    }
+    return ret;
+}
+
+// Merges consecutive records into at most max_points buckets. A bucket keeps the
+// time of its first record, the maximum of counters and of every heatmap cell.
+Json::Value to_json(const TimelineReader& timeline, const std::uint64_t max_points)
+{
+    const auto& header = timeline.header();
+    const auto records = timeline.records();
+    const auto bucket_size = std::max<std::uint64_t>(
+        1,
+        (records.size() + max_points - 1) / max_points);
+    auto samples = Json::Value(Json::arrayValue);
+    for(std::size_t i = 0; i < records.size(); i += bucket_size) {
+        const auto end = std::min<std::size_t>(records.size(), i + bucket_size);
+        auto merged = records[i];
+        for(auto j = i + 1; j < end; j++) {
+            const auto& r = records[j];
+            merged.moving_area = std::max(merged.moving_area, r.moving_area);
+            merged.blob_count = std::max(merged.blob_count, r.blob_count);
+            std::transform(
+                merged.heatmap.begin(),
+                merged.heatmap.end(),
+                r.heatmap.begin(),
+                merged.heatmap.begin(),
+                [](auto a, auto b) { return std::max(a, b); });
+        }
+        auto sample = Json::Value(Json::objectValue);
+        sample["t"] = merged.pts_ms / 1000.;
+        sample["moving_area"] = merged.moving_area;
+        sample["blob_count"] = merged.blob_count;
+        sample["heatmap"] = to_hex(merged.heatmap);
+        samples.append(std::move(sample));
+    }
+    auto ret = Json::Value(Json::objectValue);
+    ret["start_time"] = static_cast<double>(header.start_time_us) / 1e6;
+    ret["grid_cols"] = header.grid_cols;
+    ret["grid_rows"] = header.grid_rows;
+    ret["samples"] = std::move(samples);
+    return ret;
+}
+
+Json::Value to_json(const RecordingIndex::Entry& entry)
+{
+    auto ret = Json::Value(Json::objectValue);
+    ret["id"] = Json::UInt64(entry.id);
+    ret["path"] = entry.path;
+    ret["start_time"] = to_unix_seconds(entry.start_time);
+    ret["end_time"] = to_unix_seconds(entry.end_time);
+    ret["duration"]
+        = std::chrono::duration<double>(entry.end_time - entry.start_time).count();
+    ret["size"] = Json::UInt64(entry.size);
+    ret["peak_moving_area"] = entry.peak_moving_area;
+    ret["thumbnail_offset"]
+        = std::chrono::duration<double>(entry.thumbnail_offset).count();
+    ret["has_thumbnail"] = entry.has_thumbnail;
+    if(const auto& sprite = entry.sprite) {
+        auto sprite_json = Json::Value(Json::objectValue);
+        sprite_json["tile_width"] = sprite->tile_width;
+        sprite_json["tile_height"] = sprite->tile_height;
+        sprite_json["columns"] = sprite->columns;
+        sprite_json["count"] = sprite->count;
+        sprite_json["interval"]
+            = std::chrono::duration<double>(sprite->interval).count();
+        ret["sprite"] = sprite_json;
     }
     return ret;
 }
+
+// Images of a recording never change, so clients may cache them
+drogon::HttpResponsePtr create_recording_image_resp(
+    std::filesystem::path path,
+    const char* const extension)
+{
+    path += extension;
+    auto ec = std::error_code();
+    if(!std::filesystem::is_regular_file(path, ec)) {
+        return create_text_resp(drogon::k404NotFound, "Recording image is gone");
+    }
+    auto resp = drogon::HttpResponse::newFileResponse(
+        path.string(),
+        "",
+        drogon::CT_IMAGE_JPG);
+    resp->addHeader("Cache-Control", "max-age=31536000, immutable");
+    return resp;
+}
 } // namespace
 
 Controller::Controller(
-    std::shared_ptr<vehlwn::MotionDataWorker>&& motion_data_worker)
+    std::shared_ptr<vehlwn::MotionDataWorker>&& motion_data_worker,
+    std::shared_ptr<const vehlwn::RecordingIndex>&& recording_index,
+    std::shared_ptr<vehlwn::ConfigReloader>&& config_reloader,
+    std::shared_ptr<vehlwn::WorkQueue>&& image_workers,
+    std::shared_ptr<vehlwn::ffmpeg::JpegEncoderPool>&& jpeg_encoders)
     : m_motion_data_worker(std::move(motion_data_worker))
+    , m_recording_index(std::move(recording_index))
+    , m_config_reloader(std::move(config_reloader))
+    , m_image_workers(std::move(image_workers))
+    , m_jpeg_encoders(std::move(jpeg_encoders))
 {}
 
+void Controller::respond_from_worker(
+    RespCb&& callback,
+    std::function<drogon::HttpResponsePtr()>&& make_resp) const
+{
+    // The callback is copied so that it can still answer a rejected request
+    auto task = [callback, make_resp = std::move(make_resp)] {
+        try {
+            callback(make_resp());
+        } catch(const std::exception& ex) {
+            BOOST_LOG_TRIVIAL(error) << "Worker request failed: " << ex.what();
+            callback(create_text_resp(
+                drogon::k500InternalServerError,
+                "Request failed"));
+        }
+    };
+    if(!m_image_workers->try_submit(std::move(task))) {
+        BOOST_LOG_TRIVIAL(debug) << "Workers are busy, rejected = "
+                                 << m_image_workers->rejected();
+        auto resp = create_text_resp(
+            drogon::k503ServiceUnavailable,
+            "Too many requests");
+        resp->addHeader("Retry-After", "1");
+        callback(resp);
+    }
+}
+
 void Controller::healthy(const drogon::HttpRequestPtr& /*req*/, RespCb&& callback)
 {
     auto resp = drogon::HttpResponse::newHttpResponse();
@@ -64,27 +386,73 @@ void Controller::healthy(const drogon::HttpRequestPtr& /*req*/, RespCb&& callbac
 }
 
 void Controller::current_frame(
-    const drogon::HttpRequestPtr& /*req*/,
+    const drogon::HttpRequestPtr& req,
     RespCb&& callback) const
 {
+    auto options = ffmpeg::JpegOptions();
+    try {
+        options = parse_jpeg_options(req);
+    } catch(const std::exception& ex) {
+        callback(create_text_resp(drogon::k400BadRequest, ex.what()));
+        return;
+    }
     cv::Mat frame;
+    auto arrival_time = std::optional<std::chrono::steady_clock::time_point>();
     {
         const auto lock = m_motion_data_worker->get_motion_data()->read();
-        frame = lock->frame().get().clone();
+        // Not cloned: the published frame is replaced, never modified, so the
+        // reference keeps its pixels intact
+        frame = lock->frame().get();
+        arrival_time = lock->arrival_time();
     }
-    callback(create_encoded_image_resp(frame));
+    auto age = std::optional<std::string>();
+    if(arrival_time) {
+        // Time since the frame was read from the input, encoding excluded
+        const auto age_ms = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - *arrival_time);
+        age = std::to_string(age_ms.count());
+    }
+    respond_from_worker(
+        std::move(callback),
+        [encoders = m_jpeg_encoders,
+         frame = std::move(frame),
+         options,
+         age = std::move(age)] {
+            auto resp = create_encoded_image_resp(*encoders, frame, options);
+            if(age) {
+                resp->addHeader("X-Frame-Age-Ms", *age);
+            }
+            return resp;
+        });
 }
 
 void Controller::motion_mask(
-    const drogon::HttpRequestPtr& /*req*/,
+    const drogon::HttpRequestPtr& req,
     RespCb&& callback) const
 {
-    cv::Mat mask;
+    BOOST_LOG_FUNCTION();
+    auto mask = RleMask();
     {
         const auto lock = m_motion_data_worker->get_motion_data()->read();
-        mask = lock->fgmask().get().clone();
+        mask = lock->fgmask();
+    }
+    const auto& format = req->getParameter("format");
+    if(format.empty() || format == "png") {
+        respond_from_worker(std::move(callback), [mask = std::move(mask)] {
+            return create_bilevel_png_resp(mask.to_mat());
+        });
+    } else if(format == "rle") {
+        const auto buf = mask.serialize();
+        callback(drogon::HttpResponse::newFileResponse(
+            buf.data(),
+            buf.size(),
+            "",
+            drogon::CT_APPLICATION_OCTET_STREAM));
+    } else {
+        callback(create_text_resp(
+            drogon::k400BadRequest,
+            "format must be one of {png, rle}"));
     }
-    callback(create_encoded_image_resp(mask));
 }
 
 void Controller::fps(const drogon::HttpRequestPtr& /*req*/, RespCb&& callback) const
@@ -113,6 +481,24 @@ void Controller::moving_area(
     callback(resp);
 }
 
+void Controller::blobs(const drogon::HttpRequestPtr& /*req*/, RespCb&& callback)
+    const
+{
+    auto ret = Json::Value(Json::objectValue);
+    auto blobs = Json::Value(Json::arrayValue);
+    {
+        const auto lock = m_motion_data_worker->get_motion_data()->read();
+        // Blob coordinates are relative to the motion mask
+        ret["mask_width"] = lock->fgmask().width();
+        ret["mask_height"] = lock->fgmask().height();
+        for(const auto& blob : lock->blobs()) {
+            blobs.append(to_json(blob));
+        }
+    }
+    ret["blobs"] = std::move(blobs);
+    callback(drogon::HttpResponse::newHttpJsonResponse(ret));
+}
+
 void Controller::is_recording(
     const drogon::HttpRequestPtr& /*req*/,
     RespCb&& callback) const
@@ -124,4 +510,305 @@ void Controller::is_recording(
     resp->setBody(std::move(msg));
     callback(resp);
 }
+
+void Controller::start_latency(
+    const drogon::HttpRequestPtr& /*req*/,
+    RespCb&& callback) const
+{
+    auto resp = drogon::HttpResponse::newHttpResponse();
+    resp->setContentTypeCode(drogon::CT_TEXT_PLAIN);
+    if(const auto ret = m_motion_data_worker->get_start_latency()) {
+        resp->setBody(std::to_string(*ret));
+    } else {
+        resp->setStatusCode(drogon::HttpStatusCode::k404NotFound);
+        resp->setBody("No recordings yet");
+    }
+    callback(resp);
+}
+
+void Controller::write_stats(
+    const drogon::HttpRequestPtr& /*req*/,
+    RespCb&& callback) const
+{
+    auto resp = drogon::HttpResponse::newHttpResponse();
+    resp->setContentTypeCode(drogon::CT_TEXT_PLAIN);
+    if(const auto ret = m_motion_data_worker->get_write_stats()) {
+        std::ostringstream os;
+        os << *ret;
+        resp->setBody(os.str());
+    } else {
+        resp->setStatusCode(drogon::HttpStatusCode::k404NotFound);
+        resp->setBody("Not recording or write_behind is disabled");
+    }
+    callback(resp);
+}
+
+void Controller::pipeline_stats(
+    const drogon::HttpRequestPtr& /*req*/,
+    RespCb&& callback) const
+{
+    auto resp = drogon::HttpResponse::newHttpResponse();
+    resp->setContentTypeCode(drogon::CT_TEXT_PLAIN);
+    const auto stats = m_motion_data_worker->get_pipeline_stats();
+    if(!stats.empty()) {
+        std::ostringstream os;
+        for(const auto& stage : stats) {
+            os << stage << '\n';
+        }
+        resp->setBody(os.str());
+    } else {
+        resp->setStatusCode(drogon::HttpStatusCode::k404NotFound);
+        resp->setBody("Pipeline is not started");
+    }
+    callback(resp);
+}
+
+void Controller::latency(
+    const drogon::HttpRequestPtr& /*req*/,
+    RespCb&& callback) const
+{
+    const auto tracer = m_motion_data_worker->get_latency_tracer();
+    std::ostringstream os;
+    os << "glass_to_publish: " << tracer->glass_to_publish() << '\n'
+       << "glass_to_disk: " << tracer->glass_to_disk() << '\n';
+    callback(create_text_resp(drogon::k200OK, os.str()));
+}
+
+void Controller::trace(const drogon::HttpRequestPtr& /*req*/, RespCb&& callback)
+    const
+{
+    const auto tracer = m_motion_data_worker->get_latency_tracer();
+    if(!tracer->tracing_enabled()) {
+        callback(create_text_resp(
+            drogon::k404NotFound,
+            "Tracing is disabled, see the tracing section of the config"));
+        return;
+    }
+    std::ostringstream os;
+    tracer->write_chrome_trace(os);
+    auto resp = drogon::HttpResponse::newHttpResponse();
+    resp->setContentTypeCode(drogon::CT_APPLICATION_JSON);
+    resp->setBody(os.str());
+    callback(resp);
+}
+
+void Controller::reload_config(
+    const drogon::HttpRequestPtr& /*req*/,
+    RespCb&& callback) const
+{
+    BOOST_LOG_FUNCTION();
+    try {
+        const auto result = m_config_reloader->reload();
+        std::ostringstream os;
+        os << result << '\n';
+        callback(create_text_resp(drogon::k200OK, os.str()));
+    } catch(const std::exception& ex) {
+        BOOST_LOG_TRIVIAL(error) << "Config reload failed: " << ex.what();
+        callback(create_text_resp(
+            drogon::k500InternalServerError,
+            std::string("Config reload failed, running settings are kept: ")
+                + ex.what()));
+    }
+}
+
+void Controller::recordings(const drogon::HttpRequestPtr& req, RespCb&& callback)
+    const
+{
+    BOOST_LOG_FUNCTION();
+    constexpr std::uint64_t default_limit = 1000;
+    constexpr std::uint64_t max_limit = 10000;
+    auto entries = std::vector<RecordingIndex::Entry>();
+    try {
+        const auto from = parse_time_parameter(
+            req,
+            "from",
+            std::chrono::system_clock::time_point::min());
+        const auto to = parse_time_parameter(
+            req,
+            "to",
+            std::chrono::system_clock::time_point::max());
+        const auto limit = [&] {
+            const auto& value = req->getParameter("limit");
+            if(value.empty()) {
+                return default_limit;
+            }
+            const auto tmp = parse_uint(value);
+            if(!tmp || *tmp == 0 || *tmp > max_limit) {
+                throw std::runtime_error(
+                    "limit must be in [1, " + std::to_string(max_limit) + "]");
+            }
+            return *tmp;
+        }();
+        entries = m_recording_index->find(from, to, limit);
+    } catch(const std::exception& ex) {
+        callback(create_text_resp(drogon::k400BadRequest, ex.what()));
+        return;
+    }
+    auto ret = Json::Value(Json::arrayValue);
+    for(const auto& entry : entries) {
+        ret.append(to_json(entry));
+    }
+    callback(drogon::HttpResponse::newHttpJsonResponse(ret));
+}
+
+void Controller::download_recording(
+    const drogon::HttpRequestPtr& req,
+    RespCb&& callback,
+    const std::uint64_t id) const
+{
+    BOOST_LOG_FUNCTION();
+    const auto entry = m_recording_index->get(id);
+    if(!entry) {
+        callback(create_text_resp(drogon::k404NotFound, "Unknown recording id"));
+        return;
+    }
+    auto path = m_recording_index->absolute_path(*entry);
+    const auto& rendition = req->getParameter("rendition");
+    if(rendition == "preview") {
+        path += ffmpeg::PREVIEW_EXTENSION;
+    } else if(!rendition.empty() && rendition != "full") {
+        callback(create_text_resp(
+            drogon::k400BadRequest,
+            "rendition must be 'full' or 'preview'"));
+        return;
+    }
+    auto ec = std::error_code();
+    const auto size = std::filesystem::file_size(path, ec);
+    if(ec) {
+        callback(create_text_resp(
+            drogon::k404NotFound,
+            rendition == "preview" ? "Recording has no preview"
+                                   : "Recording file is gone"));
+        return;
+    }
+    const auto attachment_name = path.filename().string();
+    auto resp = drogon::HttpResponsePtr();
+    try {
+        if(const auto range = parse_range_header(req->getHeader("range"), size)) {
+            // drogon sends file responses with sendfile()
+            resp = drogon::HttpResponse::newFileResponse(
+                path.string(),
+                range->offset,
+                range->length,
+                true,
+                attachment_name);
+        } else {
+            resp = drogon::HttpResponse::newFileResponse(
+                path.string(),
+                attachment_name);
+        }
+    } catch(const RangeNotSatisfiable&) {
+        resp = create_text_resp(
+            drogon::k416RequestedRangeNotSatisfiable,
+            "Range not satisfiable");
+        resp->addHeader("Content-Range", "bytes */" + std::to_string(size));
+    }
+    resp->addHeader("Accept-Ranges", "bytes");
+    callback(resp);
+}
+
+void Controller::recording_thumbnail(
+    const drogon::HttpRequestPtr& /*req*/,
+    RespCb&& callback,
+    const std::uint64_t id) const
+{
+    BOOST_LOG_FUNCTION();
+    const auto entry = m_recording_index->get(id);
+    if(!entry) {
+        callback(create_text_resp(drogon::k404NotFound, "Unknown recording id"));
+        return;
+    }
+    if(!entry->has_thumbnail) {
+        callback(
+            create_text_resp(drogon::k404NotFound, "Recording has no thumbnail"));
+        return;
+    }
+    callback(create_recording_image_resp(
+        m_recording_index->absolute_path(*entry),
+        ffmpeg::THUMBNAIL_EXTENSION));
+}
+
+void Controller::recording_sprite(
+    const drogon::HttpRequestPtr& /*req*/,
+    RespCb&& callback,
+    const std::uint64_t id) const
+{
+    BOOST_LOG_FUNCTION();
+    const auto entry = m_recording_index->get(id);
+    if(!entry) {
+        callback(create_text_resp(drogon::k404NotFound, "Unknown recording id"));
+        return;
+    }
+    if(!entry->sprite) {
+        callback(create_text_resp(
+            drogon::k404NotFound,
+            "Recording has no sprite sheet"));
+        return;
+    }
+    callback(create_recording_image_resp(
+        m_recording_index->absolute_path(*entry),
+        ffmpeg::SPRITE_EXTENSION));
+}
+
+void Controller::recording_timeline(
+    const drogon::HttpRequestPtr& req,
+    RespCb&& callback,
+    const std::uint64_t id) const
+{
+    BOOST_LOG_FUNCTION();
+    constexpr std::uint64_t default_points = 1000;
+    const auto entry = m_recording_index->get(id);
+    if(!entry) {
+        callback(create_text_resp(drogon::k404NotFound, "Unknown recording id"));
+        return;
+    }
+    auto path = m_recording_index->absolute_path(*entry);
+    path += ffmpeg::TIMELINE_EXTENSION;
+    auto ec = std::error_code();
+    if(!std::filesystem::is_regular_file(path, ec)) {
+        callback(
+            create_text_resp(drogon::k404NotFound, "Recording has no timeline"));
+        return;
+    }
+    const auto& format = req->getParameter("format");
+    if(format == "binary") {
+        callback(drogon::HttpResponse::newFileResponse(
+            path.string(),
+            "",
+            drogon::CT_APPLICATION_OCTET_STREAM));
+        return;
+    }
+    if(!format.empty() && format != "json") {
+        callback(create_text_resp(
+            drogon::k400BadRequest,
+            "format must be 'json' or 'binary'"));
+        return;
+    }
+    auto max_points = default_points;
+    if(const auto& value = req->getParameter("points"); !value.empty()) {
+        const auto tmp = parse_uint(value);
+        if(!tmp || *tmp == 0) {
+            callback(create_text_resp(
+                drogon::k400BadRequest,
+                "points must be a positive integer"));
+            return;
+        }
+        max_points = *tmp;
+    }
+    // Long timelines take a while to map and convert
+    respond_from_worker(
+        std::move(callback),
+        [path = std::move(path), max_points]() -> drogon::HttpResponsePtr {
+            try {
+                const auto timeline = TimelineReader(path);
+                return drogon::HttpResponse::newHttpJsonResponse(
+                    to_json(timeline, max_points));
+            } catch(const std::exception& ex) {
+                BOOST_LOG_TRIVIAL(warning) << ex.what();
+                return create_text_resp(
+                    drogon::k500InternalServerError,
+                    "Can't read timeline");
+            }
+        });
+}
 } // namespace vehlwn::api
@@ -2,15 +2,30 @@
 
 #include <drogon/HttpController.h>
 
+#include "ConfigReloader.hpp"
 #include "MotionDataWorker.hpp"
+#include "RecordingIndex.hpp"
+#include "WorkQueue.hpp"
+#include "ffmpeg_adapters/JpegEncoder.hpp"
 
 namespace vehlwn::api {
 class Controller : public drogon::HttpController<Controller, false> {
     std::shared_ptr<vehlwn::MotionDataWorker> m_motion_data_worker;
+    std::shared_ptr<const vehlwn::RecordingIndex> m_recording_index;
+    std::shared_ptr<vehlwn::ConfigReloader> m_config_reloader;
+    // Encode images and convert timelines so that event loop threads keep
+    // serving other requests
+    std::shared_ptr<vehlwn::WorkQueue> m_image_workers;
+    // Shared with recording images
+    std::shared_ptr<vehlwn::ffmpeg::JpegEncoderPool> m_jpeg_encoders;
 
 public:
-    explicit Controller(
-        std::shared_ptr<vehlwn::MotionDataWorker>&& motion_data_worker);
+    Controller(
+        std::shared_ptr<vehlwn::MotionDataWorker>&& motion_data_worker,
+        std::shared_ptr<const vehlwn::RecordingIndex>&& recording_index,
+        std::shared_ptr<vehlwn::ConfigReloader>&& config_reloader,
+        std::shared_ptr<vehlwn::WorkQueue>&& image_workers,
+        std::shared_ptr<vehlwn::ffmpeg::JpegEncoderPool>&& jpeg_encoders);
 
     METHOD_LIST_BEGIN
     ADD_METHOD_TO(Controller::healthy, "/api/healthy", drogon::Get);
@@ -18,16 +33,71 @@ public:
     ADD_METHOD_TO(Controller::motion_mask, "/api/motion_mask", drogon::Get);
     ADD_METHOD_TO(Controller::fps, "/api/fps", drogon::Get);
     ADD_METHOD_TO(Controller::moving_area, "/api/moving_area", drogon::Get);
+    ADD_METHOD_TO(Controller::blobs, "/api/blobs", drogon::Get);
     ADD_METHOD_TO(Controller::is_recording, "/api/is_recording", drogon::Get);
+    ADD_METHOD_TO(Controller::start_latency, "/api/start_latency", drogon::Get);
+    ADD_METHOD_TO(Controller::write_stats, "/api/write_stats", drogon::Get);
+    ADD_METHOD_TO(Controller::pipeline_stats, "/api/pipeline_stats", drogon::Get);
+    ADD_METHOD_TO(Controller::latency, "/api/latency", drogon::Get);
+    ADD_METHOD_TO(Controller::trace, "/api/trace", drogon::Get);
+    ADD_METHOD_TO(Controller::reload_config, "/api/config/reload", drogon::Post);
+    ADD_METHOD_TO(Controller::recordings, "/api/recordings", drogon::Get);
+    ADD_METHOD_TO(
+        Controller::download_recording,
+        "/api/recordings/{1}/download",
+        drogon::Get);
+    ADD_METHOD_TO(
+        Controller::recording_timeline,
+        "/api/recordings/{1}/timeline",
+        drogon::Get);
+    ADD_METHOD_TO(
+        Controller::recording_thumbnail,
+        "/api/recordings/{1}/thumbnail",
+        drogon::Get);
+    ADD_METHOD_TO(
+        Controller::recording_sprite,
+        "/api/recordings/{1}/sprite",
+        drogon::Get);
     METHOD_LIST_END
 
 private:
     using RespCb = std::function<void(const drogon::HttpResponsePtr&)>;
+    // Calls callback with the result of make_resp on a worker thread, or with
+    // 503 right away if the workers are busy and their queue is full
+    void respond_from_worker(
+        RespCb&& callback,
+        std::function<drogon::HttpResponsePtr()>&& make_resp) const;
     static void healthy(const drogon::HttpRequestPtr& req, RespCb&& callback);
     void current_frame(const drogon::HttpRequestPtr& req, RespCb&& callback) const;
     void motion_mask(const drogon::HttpRequestPtr& req, RespCb&& callback) const;
     void fps(const drogon::HttpRequestPtr& req, RespCb&& callback) const;
     void moving_area(const drogon::HttpRequestPtr& req, RespCb&& callback) const;
+    void blobs(const drogon::HttpRequestPtr& req, RespCb&& callback) const;
     void is_recording(const drogon::HttpRequestPtr& req, RespCb&& callback) const;
+    void start_latency(const drogon::HttpRequestPtr& req, RespCb&& callback) const;
+    void write_stats(const drogon::HttpRequestPtr& req, RespCb&& callback) const;
+    void pipeline_stats(const drogon::HttpRequestPtr& req, RespCb&& callback)
+        const;
+    void latency(const drogon::HttpRequestPtr& req, RespCb&& callback) const;
+    void trace(const drogon::HttpRequestPtr& req, RespCb&& callback) const;
+    void reload_config(const drogon::HttpRequestPtr& req, RespCb&& callback)
+        const;
+    void recordings(const drogon::HttpRequestPtr& req, RespCb&& callback) const;
+    void download_recording(
+        const drogon::HttpRequestPtr& req,
+        RespCb&& callback,
+        std::uint64_t id) const;
+    void recording_timeline(
+        const drogon::HttpRequestPtr& req,
+        RespCb&& callback,
+        std::uint64_t id) const;
+    void recording_thumbnail(
+        const drogon::HttpRequestPtr& req,
+        RespCb&& callback,
+        std::uint64_t id) const;
+    void recording_sprite(
+        const drogon::HttpRequestPtr& req,
+        RespCb&& callback,
+        std::uint64_t id) const;
 };
 } // namespace vehlwn::api
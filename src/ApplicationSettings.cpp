@@ -3,17 +3,20 @@
 #include <cstdlib>
 #include <exception>
 #include <fstream>
+#include <map>
 #include <optional>
 #include <sstream>
 #include <stdexcept>
 #include <string>
 #include <string_view>
+#include <utility>
 
 #include <boost/log/attributes/named_scope.hpp>
 #include <boost/log/trivial.hpp>
 
 #include "Config.hpp"
 #include "ErrorWithContext.hpp"
+#include "filters/ConstantTimeMedianFilter.hpp"
 #include "ini/src/Parser.hpp"
 
 namespace {
@@ -133,6 +136,26 @@ vehlwn::ApplicationSettings::Segmentation::BackgroundSubtractor
         throw std::runtime_error(
             "Unknown background_subtractor algorithm: '" + algorithm_name + "'");
     }
+    if(const auto path = back_subtr_obj.get("snapshot_path")) {
+        auto snapshot = vehlwn::ApplicationSettings::Segmentation::
+            BackgroundSubtractor::Snapshot();
+        snapshot.path = std::string(path->get_string_view());
+        snapshot.interval = vehlwn::invoke_with_error_context_str(
+            [&] {
+                if(const auto it = back_subtr_obj.get("snapshot_interval")) {
+                    const auto tmp = it->get_number<double>();
+                    if(tmp <= 0) {
+                        throw std::runtime_error(
+                            "background_subtractor.snapshot_interval must be "
+                            "positive double");
+                    }
+                    return tmp;
+                }
+                return 60.0;
+            },
+            "Failed to parse background_subtractor.snapshot_interval");
+        ret.snapshot = std::move(snapshot);
+    }
     return ret;
 }
 
@@ -208,6 +231,31 @@ vehlwn::ApplicationSettings::Preprocess::Smoothing::Median
     return ret;
 }
 
+vehlwn::ApplicationSettings::Preprocess::Smoothing::ConstantTimeMedian
+    parse_constant_time_median_filter(const vehlwn::ini::Section& smooth_obj)
+{
+    using vehlwn::ConstantTimeMedianFilter;
+    auto ret
+        = vehlwn::ApplicationSettings::Preprocess::Smoothing::ConstantTimeMedian();
+    ret.kernel_size = vehlwn::invoke_with_error_context_str(
+        [&] {
+            if(const auto it = smooth_obj.get("kernel_size")) {
+                const auto tmp = it->get_number<int>();
+                if(tmp <= 0 || tmp % 2 == 0
+                   || tmp > ConstantTimeMedianFilter::MAX_KERNEL_SIZE) {
+                    throw std::runtime_error(
+                        "kernel_size must be odd and in [1, "
+                        + std::to_string(ConstantTimeMedianFilter::MAX_KERNEL_SIZE)
+                        + "]");
+                }
+                return tmp;
+            }
+            throw std::runtime_error("kernel_size key not found");
+        },
+        "Failed to parse kernel_size");
+    return ret;
+}
+
 vehlwn::ApplicationSettings::Preprocess::Smoothing
     parse_smoothing(const vehlwn::ini::Section& smooth_obj)
 {
@@ -233,9 +281,247 @@ vehlwn::ApplicationSettings::Preprocess::Smoothing
         auto algorithm = parse_median_filter(smooth_obj);
         return {algorithm};
     }
+    if(algorithm_name == "median_ct") {
+        auto algorithm = vehlwn::invoke_with_error_context_str(
+            [&] { return parse_constant_time_median_filter(smooth_obj); },
+            "Failed to parse median_ct parameters");
+        return {algorithm};
+    }
     throw std::runtime_error("Unknown smmothing algorithm: " + algorithm_name);
 }
 
+vehlwn::ApplicationSettings::OutputFiles::WriteBehind
+    parse_write_behind(const vehlwn::ini::Section& write_behind_obj)
+{
+    using WriteBehind = vehlwn::ApplicationSettings::OutputFiles::WriteBehind;
+    auto ret = WriteBehind();
+    ret.buffer_size = vehlwn::invoke_with_error_context_str(
+        [&]() -> std::size_t {
+            if(const auto it = write_behind_obj.get("buffer_size")) {
+                const auto tmp = it->get_number<long long>();
+                if(tmp <= 0) {
+                    throw std::runtime_error("buffer_size must be positive");
+                }
+                return static_cast<std::size_t>(tmp);
+            }
+            return 16 * 1024 * 1024;
+        },
+        "Failed to parse write_behind.buffer_size");
+    ret.fsync = [&] {
+        if(const auto it = write_behind_obj.get("fsync")) {
+            const auto tmp = it->get_string_view();
+            if(tmp == "never") {
+                return WriteBehind::Fsync::Never;
+            }
+            if(tmp == "close") {
+                return WriteBehind::Fsync::OnClose;
+            }
+            if(tmp == "always") {
+                return WriteBehind::Fsync::Always;
+            }
+            throw std::runtime_error(
+                "Unknown write_behind.fsync value: '" + std::string(tmp) + "'");
+        }
+        return WriteBehind::Fsync::OnClose;
+    }();
+    return ret;
+}
+
+vehlwn::ApplicationSettings::OutputFiles::Preview
+    parse_preview(const vehlwn::ini::Section& preview_obj)
+{
+    auto ret = vehlwn::ApplicationSettings::OutputFiles::Preview();
+    ret.width = vehlwn::invoke_with_error_context_str(
+        [&] {
+            if(const auto it = preview_obj.get("width")) {
+                const auto tmp = it->get_number<int>();
+                // yuv420p needs even dimensions
+                if(tmp <= 0 || tmp % 2 != 0) {
+                    throw std::runtime_error("width must be positive even int");
+                }
+                return tmp;
+            }
+            return 640;
+        },
+        "Failed to parse preview.width");
+    if(const auto it = preview_obj.get("video_bitrate")) {
+        ret.video_bitrate = std::string(it->get_string_view());
+    }
+    ret.codec_name = "libx264";
+    if(const auto it = preview_obj.get("codec_name")) {
+        ret.codec_name = it->get_string_view();
+    }
+    return ret;
+}
+
+vehlwn::ApplicationSettings::OutputFiles::Thumbnails
+    parse_thumbnails(const vehlwn::ini::Section& thumbnails_obj)
+{
+    const auto parse_int = [&](const char* const key,
+                               const int default_value,
+                               const int min_value) {
+        return vehlwn::invoke_with_error_context_str(
+            [&] {
+                if(const auto it = thumbnails_obj.get(key)) {
+                    const auto tmp = it->get_number<int>();
+                    if(tmp < min_value) {
+                        throw std::runtime_error(
+                            std::string(key) + " must be at least "
+                            + std::to_string(min_value));
+                    }
+                    return tmp;
+                }
+                return default_value;
+            },
+            "Failed to parse thumbnails." + std::string(key));
+    };
+    auto ret = vehlwn::ApplicationSettings::OutputFiles::Thumbnails();
+    ret.width = parse_int("width", 320, 16);
+    ret.sprite_tile_width = parse_int("sprite_tile_width", 160, 16);
+    ret.sprite_columns = parse_int("sprite_columns", 10, 1);
+    ret.sprite_max_tiles = parse_int("sprite_max_tiles", 100, 2);
+    ret.sprite_interval = vehlwn::invoke_with_error_context_str(
+        [&] {
+            if(const auto it = thumbnails_obj.get("sprite_interval")) {
+                const auto tmp = it->get_number<double>();
+                if(tmp <= 0) {
+                    throw std::runtime_error(
+                        "sprite_interval must be positive double");
+                }
+                return tmp;
+            }
+            return 10.0;
+        },
+        "Failed to parse thumbnails.sprite_interval");
+    ret.jpeg_quality = parse_int("jpeg_quality", 80, 1);
+    if(ret.jpeg_quality > 100) {
+        throw std::runtime_error("thumbnails.jpeg_quality must be at most 100");
+    }
+    return ret;
+}
+
+// Single threshold without smoothing
+vehlwn::ApplicationSettings::Segmentation::Trigger
+    default_trigger(const int min_moving_area)
+{
+    auto ret = vehlwn::ApplicationSettings::Segmentation::Trigger();
+    ret.stop_moving_area = min_moving_area;
+    ret.smoothing_factor = 1.;
+    ret.start_frames = 1;
+    ret.window_frames = 1;
+    ret.min_clip_duration = 0.;
+    return ret;
+}
+
+vehlwn::ApplicationSettings::Segmentation::Trigger
+    parse_trigger(const vehlwn::ini::Section& trigger_obj, const int min_moving_area)
+{
+    auto ret = default_trigger(min_moving_area);
+    if(const auto it = trigger_obj.get("stop_moving_area")) {
+        ret.stop_moving_area = vehlwn::invoke_with_error_context_str(
+            [&] {
+                const auto tmp = it->get_number<int>();
+                if(tmp < 0 || tmp > min_moving_area) {
+                    throw std::runtime_error(
+                        "stop_moving_area must be in [0, min_moving_area]");
+                }
+                return tmp;
+            },
+            "Failed to parse stop_moving_area");
+    }
+    if(const auto it = trigger_obj.get("smoothing_factor")) {
+        ret.smoothing_factor = vehlwn::invoke_with_error_context_str(
+            [&] {
+                const auto tmp = it->get_number<double>();
+                if(tmp <= 0. || tmp > 1.) {
+                    throw std::runtime_error("smoothing_factor must be in (0, 1]");
+                }
+                return tmp;
+            },
+            "Failed to parse smoothing_factor");
+    }
+    if(const auto it = trigger_obj.get("start_frames")) {
+        ret.start_frames = vehlwn::invoke_with_error_context_str(
+            [&] {
+                const auto tmp = it->get_number<int>();
+                if(tmp <= 0) {
+                    throw std::runtime_error("start_frames must be positive");
+                }
+                return tmp;
+            },
+            "Failed to parse start_frames");
+    }
+    ret.window_frames = ret.start_frames;
+    if(const auto it = trigger_obj.get("window_frames")) {
+        ret.window_frames = vehlwn::invoke_with_error_context_str(
+            [&] {
+                const auto tmp = it->get_number<int>();
+                if(tmp < ret.start_frames) {
+                    throw std::runtime_error(
+                        "window_frames cannot be less than start_frames");
+                }
+                return tmp;
+            },
+            "Failed to parse window_frames");
+    }
+    if(const auto it = trigger_obj.get("min_clip_duration")) {
+        ret.min_clip_duration = vehlwn::invoke_with_error_context_str(
+            [&] {
+                const auto tmp = it->get_number<double>();
+                if(tmp < 0.) {
+                    throw std::runtime_error("min_clip_duration cannot be negative");
+                }
+                return tmp;
+            },
+            "Failed to parse min_clip_duration");
+    }
+    return ret;
+}
+
+vehlwn::ApplicationSettings::Segmentation::Blobs
+    parse_blobs(const vehlwn::ini::Section& blobs_obj)
+{
+    auto ret = vehlwn::ApplicationSettings::Segmentation::Blobs();
+    ret.scale = 0.25;
+    ret.morphology_kernel_size = 3;
+    ret.min_blob_area = 0;
+    if(const auto it = blobs_obj.get("scale")) {
+        ret.scale = vehlwn::invoke_with_error_context_str(
+            [&] {
+                const auto tmp = it->get_number<double>();
+                if(tmp <= 0. || tmp > 1.) {
+                    throw std::runtime_error("scale must be in (0, 1]");
+                }
+                return tmp;
+            },
+            "Failed to parse scale");
+    }
+    if(const auto it = blobs_obj.get("morphology_kernel_size")) {
+        ret.morphology_kernel_size = vehlwn::invoke_with_error_context_str(
+            [&] {
+                const auto tmp = it->get_number<int>();
+                if(tmp < 0) {
+                    throw std::runtime_error(
+                        "morphology_kernel_size cannot be negative");
+                }
+                return tmp;
+            },
+            "Failed to parse morphology_kernel_size");
+    }
+    if(const auto it = blobs_obj.get("min_blob_area")) {
+        ret.min_blob_area = vehlwn::invoke_with_error_context_str(
+            [&] {
+                const auto tmp = it->get_number<int>();
+                if(tmp < 0) {
+                    throw std::runtime_error("min_blob_area cannot be negative");
+                }
+                return tmp;
+            },
+            "Failed to parse min_blob_area");
+    }
+    return ret;
+}
+
 vehlwn::ApplicationSettings::VideoCapture::VideoDecoder
     parse_video_decoder(const vehlwn::ini::Section& video_decoder_obj)
 {
@@ -276,6 +562,9 @@ public:
             }
             return std::nullopt;
         }();
+        if(auto opt = video_cap_obj.get("probe_cache_dir")) {
+            ret.probe_cache_dir = std::string(opt->get_string_view());
+        }
 
         if(const auto demuxer_opts_obj
            = m_config.section("video_capture.demuxer_options")) {
@@ -326,6 +615,38 @@ public:
             }
             return std::nullopt;
         }();
+        auto segment_seconds = vehlwn::invoke_with_error_context_str(
+            [&]() -> std::optional<double> {
+                if(auto tmp = out_file_obj.get("segment_seconds")) {
+                    const auto ret = tmp->get_number<double>();
+                    if(ret <= 0) {
+                        throw std::runtime_error(
+                            "segment_seconds must be positive double");
+                    }
+                    return ret;
+                }
+                return std::nullopt;
+            },
+            "Failed to parse output_files.segment_seconds");
+        auto muxer_options = std::map<std::string, std::string>();
+        if(const auto muxer_opts_obj
+           = m_config.section("output_files.muxer_options")) {
+            muxer_options = muxer_opts_obj->get_all_values();
+        }
+        auto write_behind
+            = std::optional<vehlwn::ApplicationSettings::OutputFiles::WriteBehind>();
+        if(const auto write_behind_obj
+           = m_config.section("output_files.write_behind")) {
+            write_behind = parse_write_behind(*write_behind_obj);
+            // faststart reopens the file by name while writing the trailer
+            const auto movflags = muxer_options.find("movflags");
+            if(movflags != muxer_options.end()
+               && movflags->second.find("faststart") != std::string::npos) {
+                throw std::runtime_error(
+                    "output_files.write_behind cannot be used with "
+                    "movflags=faststart");
+            }
+        }
 
         using VideoEncoderSection
             = vehlwn::ApplicationSettings::OutputFiles::VideoEncoder;
@@ -343,12 +664,27 @@ public:
                 video_encoder.private_options = private_options->get_all_values();
             }
         }
+        auto preview
+            = std::optional<vehlwn::ApplicationSettings::OutputFiles::Preview>();
+        if(const auto preview_obj = m_config.section("output_files.preview")) {
+            preview = parse_preview(*preview_obj);
+        }
+        auto thumbnails
+            = std::optional<vehlwn::ApplicationSettings::OutputFiles::Thumbnails>();
+        if(const auto thumbnails_obj = m_config.section("output_files.thumbnails")) {
+            thumbnails = parse_thumbnails(*thumbnails_obj);
+        }
         return {
             std::move(prefix),
             std::move(extension),
             std::move(video_bitrate),
             std::move(audio_bitrate),
-            std::move(video_encoder)};
+            segment_seconds,
+            std::move(muxer_options),
+            write_behind,
+            std::move(video_encoder),
+            std::move(preview),
+            thumbnails};
     }
 
     [[nodiscard]] vehlwn::ApplicationSettings::Logging parse_logging() const
@@ -357,6 +693,8 @@ public:
         ret.app_level = "info";
         ret.ffmpeg_level = "warning";
         ret.show_timestamp = true;
+        ret.async = true;
+        ret.overflow = vehlwn::ApplicationSettings::Logging::Overflow::Block;
 
         if(const auto logging_obj = m_config.section("logging")) {
             if(const auto tmp = logging_obj->get("app_level")) {
@@ -370,6 +708,24 @@ public:
                     [&] { return tmp->get_bool(); },
                     "Failed to parse logging.show_timestamp");
             }
+            if(const auto tmp = logging_obj->get("async")) {
+                ret.async = vehlwn::invoke_with_error_context_str(
+                    [&] { return tmp->get_bool(); },
+                    "Failed to parse logging.async");
+            }
+            if(const auto tmp = logging_obj->get("overflow")) {
+                using Overflow = vehlwn::ApplicationSettings::Logging::Overflow;
+                const auto value = tmp->get_string_view();
+                if(value == "block") {
+                    ret.overflow = Overflow::Block;
+                } else if(value == "drop") {
+                    ret.overflow = Overflow::Drop;
+                } else {
+                    throw std::runtime_error(
+                        "Unknown logging.overflow value: '" + std::string(value)
+                        + "'");
+                }
+            }
         }
         return ret;
     }
@@ -420,6 +776,17 @@ public:
                     "Failed to parse segmentation.delta_without_motion");
             }
         }
+        ret.trigger = default_trigger(ret.min_moving_area);
+        if(const auto trigger_obj = m_config.section("segmentation.trigger")) {
+            ret.trigger = vehlwn::invoke_with_error_context_str(
+                [&] { return parse_trigger(*trigger_obj, ret.min_moving_area); },
+                "Failed to parse segmentation.trigger");
+        }
+        if(const auto blobs_obj = m_config.section("segmentation.blobs")) {
+            ret.blobs = vehlwn::invoke_with_error_context_str(
+                [&] { return parse_blobs(*blobs_obj); },
+                "Failed to parse segmentation.blobs");
+        }
         return ret;
     }
 
@@ -449,6 +816,19 @@ public:
                     return std::nullopt;
                 },
                 "Failed to parse preprocess.resize_factor");
+            ret.threads = vehlwn::invoke_with_error_context_str(
+                [&] {
+                    if(const auto it = preprocess_obj->get("threads")) {
+                        const auto tmp = it->get_number<int>();
+                        if(tmp <= 0) {
+                            throw std::runtime_error(
+                                "preprocess.threads must be positive int");
+                        }
+                        return tmp;
+                    }
+                    return 1;
+                },
+                "Failed to parse preprocess.threads");
         }
         if(const auto smooth_obj = m_config.section("preprocess.smoothing")) {
             ret.smoothing = vehlwn::invoke_with_error_context_str(
@@ -457,6 +837,129 @@ public:
         }
         return ret;
     }
+
+    [[nodiscard]] std::optional<vehlwn::ApplicationSettings::Retention>
+        parse_retention() const
+    {
+        const auto retention_obj = m_config.section("retention");
+        if(!retention_obj) {
+            return std::nullopt;
+        }
+        auto ret = vehlwn::ApplicationSettings::Retention();
+        ret.max_bytes = vehlwn::invoke_with_error_context_str(
+            [&]() -> std::optional<std::uint64_t> {
+                if(const auto it = retention_obj->get("max_bytes")) {
+                    const auto tmp = it->get_number<long long>();
+                    if(tmp <= 0) {
+                        throw std::runtime_error("max_bytes must be positive");
+                    }
+                    return static_cast<std::uint64_t>(tmp);
+                }
+                return std::nullopt;
+            },
+            "Failed to parse retention.max_bytes");
+        ret.max_age_days = vehlwn::invoke_with_error_context_str(
+            [&]() -> std::optional<double> {
+                if(const auto it = retention_obj->get("max_age_days")) {
+                    const auto tmp = it->get_number<double>();
+                    if(tmp <= 0) {
+                        throw std::runtime_error("max_age_days must be positive");
+                    }
+                    return tmp;
+                }
+                return std::nullopt;
+            },
+            "Failed to parse retention.max_age_days");
+        ret.reserve_bytes = vehlwn::invoke_with_error_context_str(
+            [&]() -> std::uint64_t {
+                if(const auto it = retention_obj->get("reserve_bytes")) {
+                    const auto tmp = it->get_number<long long>();
+                    if(tmp < 0) {
+                        throw std::runtime_error(
+                            "reserve_bytes cannot be negative");
+                    }
+                    return static_cast<std::uint64_t>(tmp);
+                }
+                return 1024 * 1024 * 1024;
+            },
+            "Failed to parse retention.reserve_bytes");
+        ret.check_interval = vehlwn::invoke_with_error_context_str(
+            [&] {
+                if(const auto it = retention_obj->get("check_interval")) {
+                    const auto tmp = it->get_number<double>();
+                    if(tmp <= 0) {
+                        throw std::runtime_error(
+                            "check_interval must be positive");
+                    }
+                    return tmp;
+                }
+                return 60.0;
+            },
+            "Failed to parse retention.check_interval");
+        if(ret.max_bytes && ret.reserve_bytes >= *ret.max_bytes) {
+            throw std::runtime_error(
+                "retention.reserve_bytes must be less than max_bytes");
+        }
+        return ret;
+    }
+
+    [[nodiscard]] std::optional<vehlwn::ApplicationSettings::Tracing>
+        parse_tracing() const
+    {
+        const auto tracing_obj = m_config.section("tracing");
+        if(!tracing_obj) {
+            return std::nullopt;
+        }
+        auto ret = vehlwn::ApplicationSettings::Tracing();
+        ret.window_seconds = vehlwn::invoke_with_error_context_str(
+            [&] {
+                if(const auto it = tracing_obj->get("window_seconds")) {
+                    const auto tmp = it->get_number<double>();
+                    if(tmp <= 0 || tmp > 600) {
+                        throw std::runtime_error(
+                            "window_seconds must be in (0, 600]");
+                    }
+                    return tmp;
+                }
+                return 10.0;
+            },
+            "Failed to parse tracing.window_seconds");
+        return ret;
+    }
+
+    [[nodiscard]] vehlwn::ApplicationSettings::Api parse_api() const
+    {
+        auto ret = vehlwn::ApplicationSettings::Api{2, 16};
+        const auto api_obj = m_config.section("api");
+        if(!api_obj) {
+            return ret;
+        }
+        ret.workers = vehlwn::invoke_with_error_context_str(
+            [&] {
+                if(const auto it = api_obj->get("workers")) {
+                    const auto tmp = it->get_number<int>();
+                    if(tmp <= 0) {
+                        throw std::runtime_error("workers must be positive int");
+                    }
+                    return tmp;
+                }
+                return ret.workers;
+            },
+            "Failed to parse api.workers");
+        ret.queue_size = vehlwn::invoke_with_error_context_str(
+            [&] {
+                if(const auto it = api_obj->get("queue_size")) {
+                    const auto tmp = it->get_number<long long>();
+                    if(tmp <= 0) {
+                        throw std::runtime_error("queue_size must be positive int");
+                    }
+                    return static_cast<std::size_t>(tmp);
+                }
+                return ret.queue_size;
+            },
+            "Failed to parse api.queue_size");
+        return ret;
+    }
 };
 
 } // namespace
@@ -466,8 +969,8 @@ namespace {
 constexpr std::string_view CONFIG_FILE_NAME = "app.ini";
 }
 
-ApplicationSettings read_settings() noexcept
-try {
+ApplicationSettings load_settings()
+{
     BOOST_LOG_FUNCTION();
     const auto config_path
         = std::string(CONFIG_DIR) + "/" + std::string(CONFIG_FILE_NAME);
@@ -491,12 +994,23 @@ try {
     auto logging = p.parse_logging();
     auto segmentation = p.parse_segmentation();
     auto preprocess = p.parse_preprocess();
+    auto retention = p.parse_retention();
+    auto tracing = p.parse_tracing();
+    auto api = p.parse_api();
     return {
         std::move(video_capture),
         std::move(output_files),
         std::move(logging),
         segmentation,
-        preprocess};
+        preprocess,
+        retention,
+        tracing,
+        api};
+}
+
+ApplicationSettings read_settings() noexcept
+try {
+    return load_settings();
 } catch(const std::exception& ex) {
     BOOST_LOG_TRIVIAL(fatal) << "Unexpected error in read_settings: " << ex.what();
     std::exit(1);
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <map>
 #include <optional>
 #include <string>
@@ -11,11 +13,15 @@ struct ApplicationSettings {
         std::string filename;
         std::optional<std::string> file_format;
         std::map<std::string, std::string> demuxer_options;
+        // Directory of cached stream parameters of inputs
+        std::optional<std::string> probe_cache_dir;
 
         struct VideoDecoder {
             std::optional<std::string> hw_type;
+            bool operator==(const VideoDecoder&) const = default;
         };
         std::optional<VideoDecoder> video_decoder;
+        bool operator==(const VideoCapture&) const = default;
     } video_capture;
 
     struct OutputFiles {
@@ -23,19 +29,62 @@ struct ApplicationSettings {
         std::string extension;
         std::optional<std::string> video_bitrate;
         std::optional<std::string> audio_bitrate;
+        std::optional<double> segment_seconds;
+        std::map<std::string, std::string> muxer_options;
+
+        struct WriteBehind {
+            enum class Fsync { Never, OnClose, Always };
+            std::size_t buffer_size;
+            Fsync fsync;
+            bool operator==(const WriteBehind&) const = default;
+        };
+        std::optional<WriteBehind> write_behind;
 
         struct VideoEncoder {
             std::string codec_name;
             std::optional<std::string> hw_type;
             std::map<std::string, std::string> private_options;
+            bool operator==(const VideoEncoder&) const = default;
         };
         VideoEncoder video_encoder;
+
+        // Low resolution rendition encoded next to every recording
+        struct Preview {
+            // Height keeps the aspect ratio
+            int width;
+            std::optional<std::string> video_bitrate;
+            std::string codec_name;
+            bool operator==(const Preview&) const = default;
+        };
+        std::optional<Preview> preview;
+
+        // JPEG images written next to every recording
+        struct Thumbnails {
+            // Of the frame with the largest moving area
+            int width;
+            // Sprite sheet of frames taken every sprite_interval seconds. The
+            // interval doubles when there are more than sprite_max_tiles frames.
+            int sprite_tile_width;
+            int sprite_columns;
+            int sprite_max_tiles;
+            double sprite_interval;
+            int jpeg_quality;
+            bool operator==(const Thumbnails&) const = default;
+        };
+        std::optional<Thumbnails> thumbnails;
+        bool operator==(const OutputFiles&) const = default;
     } output_files;
 
     struct Logging {
         std::string app_level;
         std::string ffmpeg_level;
         bool show_timestamp;
+        // Format and write records in a separate thread
+        bool async;
+        // What to do with new records when the async queue is full
+        enum class Overflow { Block, Drop };
+        Overflow overflow;
+        bool operator==(const Logging&) const = default;
     } logging;
 
     struct Segmentation {
@@ -44,37 +93,111 @@ struct ApplicationSettings {
                 int history;
                 double dist_2_threshold;
                 bool detect_shadows;
+                bool operator==(const Knn&) const = default;
             };
             struct Mog2 {
                 int history;
                 double var_threshold;
                 bool detect_shadows;
+                bool operator==(const Mog2&) const = default;
             };
             std::variant<Knn, Mog2> algorithm;
+            // Background image saved to warm start the model after restart
+            struct Snapshot {
+                std::string path;
+                // Seconds between snapshots, the last one is saved on stop
+                double interval;
+                bool operator==(const Snapshot&) const = default;
+            };
+            std::optional<Snapshot> snapshot;
+            bool operator==(const BackgroundSubtractor&) const = default;
         } background_subtractor;
+        // Moving area which starts a recording
         int min_moving_area{};
         double delta_without_motion{};
+
+        struct Trigger {
+            // Moving area which keeps a recording going, <= min_moving_area
+            int stop_moving_area;
+            // Weight of the current frame in the exponential moving average of
+            // moving area, 1 disables smoothing
+            double smoothing_factor;
+            // Recording starts when start_frames of the last window_frames frames
+            // are above min_moving_area
+            int start_frames;
+            int window_frames;
+            double min_clip_duration;
+            bool operator==(const Trigger&) const = default;
+        } trigger{};
+
+        struct Blobs {
+            double scale;
+            int morphology_kernel_size;
+            int min_blob_area;
+            bool operator==(const Blobs&) const = default;
+        };
+        std::optional<Blobs> blobs;
+        bool operator==(const Segmentation&) const = default;
     } segmentation;
 
     struct Preprocess {
         bool convert_to_gray{};
         std::optional<double> resize_factor;
+        // Number of threads processing row bands of a frame, 1 disables the pool
+        int threads = 1;
         struct Smoothing {
             struct NormalizedBox {
                 int kernel_size;
+                bool operator==(const NormalizedBox&) const = default;
             };
             struct Gaussian {
                 int kernel_size;
                 double sigma;
+                bool operator==(const Gaussian&) const = default;
             };
             struct Median {
                 int kernel_size;
+                bool operator==(const Median&) const = default;
+            };
+            struct ConstantTimeMedian {
+                int kernel_size;
+                bool operator==(const ConstantTimeMedian&) const = default;
             };
-            std::variant<NormalizedBox, Gaussian, Median> algorithm;
+            std::variant<NormalizedBox, Gaussian, Median, ConstantTimeMedian>
+                algorithm;
+            bool operator==(const Smoothing&) const = default;
         };
         std::optional<Smoothing> smoothing;
+        bool operator==(const Preprocess&) const = default;
     } preprocess;
+
+    struct Retention {
+        std::optional<std::uint64_t> max_bytes;
+        std::optional<double> max_age_days;
+        std::uint64_t reserve_bytes{};
+        double check_interval{};
+        bool operator==(const Retention&) const = default;
+    };
+    std::optional<Retention> retention;
+
+    struct Tracing {
+        double window_seconds{};
+        bool operator==(const Tracing&) const = default;
+    };
+    std::optional<Tracing> tracing;
+
+    struct Api {
+        // Threads encoding images outside of the HTTP event loop threads
+        int workers{};
+        // Image requests waiting for a worker, more are answered with 503
+        std::size_t queue_size{};
+        bool operator==(const Api&) const = default;
+    } api;
+    bool operator==(const ApplicationSettings&) const = default;
 };
 
+// Reads and validates app.ini. Throws on errors.
+ApplicationSettings load_settings();
+// Same as load_settings() but exits the process on errors
 ApplicationSettings read_settings() noexcept;
 } // namespace vehlwn
@@ -0,0 +1,65 @@
+#include "BackgroundModelSnapshot.hpp"
+
+#include <fstream>
+#include <ios>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include <opencv2/imgcodecs.hpp>
+
+namespace vehlwn {
+BackgroundModelSnapshot::BackgroundModelSnapshot(std::filesystem::path path)
+    : m_path(std::move(path))
+{}
+
+std::optional<cv::Mat> BackgroundModelSnapshot::load() const
+{
+    auto file = std::ifstream(m_path, std::ios::binary);
+    if(!file) {
+        if(!std::filesystem::exists(m_path)) {
+            return std::nullopt;
+        }
+        throw std::runtime_error("Failed to open " + m_path.string());
+    }
+    const auto buf = std::vector<char>(
+        std::istreambuf_iterator<char>(file),
+        std::istreambuf_iterator<char>());
+    auto ret = cv::imdecode(buf, cv::IMREAD_UNCHANGED);
+    if(ret.empty()) {
+        throw std::runtime_error("Failed to decode " + m_path.string());
+    }
+    return ret;
+}
+
+void BackgroundModelSnapshot::save(const cv::Mat& background) const
+{
+    auto buf = std::vector<unsigned char>();
+    if(background.empty() || !cv::imencode(".png", background, buf)) {
+        throw std::runtime_error("Failed to encode background image");
+    }
+    if(m_path.has_parent_path()) {
+        std::filesystem::create_directories(m_path.parent_path());
+    }
+    auto tmp_path = m_path;
+    tmp_path += ".tmp";
+    {
+        auto file = std::ofstream(tmp_path, std::ios::binary | std::ios::trunc);
+        file.write(
+            reinterpret_cast<const char*>(buf.data()),
+            static_cast<std::streamsize>(buf.size()));
+        file.close();
+        if(!file) {
+            std::filesystem::remove(tmp_path);
+            throw std::runtime_error("Failed to write " + tmp_path.string());
+        }
+    }
+    std::filesystem::rename(tmp_path, m_path);
+}
+
+const std::filesystem::path& BackgroundModelSnapshot::path() const
+{
+    return m_path;
+}
+} // namespace vehlwn
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <filesystem>
+#include <optional>
+
+#include <opencv2/core/mat.hpp>
+
+namespace vehlwn {
+// Background image of a subtractor stored as a lossless PNG file. A new
+// background model is warm started from it instead of learning the scene from
+// scratch after restart.
+class BackgroundModelSnapshot {
+public:
+    explicit BackgroundModelSnapshot(std::filesystem::path path);
+
+    // Empty if the file does not exist. Throws if it cannot be read or decoded.
+    [[nodiscard]] std::optional<cv::Mat> load() const;
+    // Replaces the file atomically, a crash keeps the previous snapshot
+    void save(const cv::Mat& background) const;
+    [[nodiscard]] const std::filesystem::path& path() const;
+
+private:
+    std::filesystem::path m_path;
+};
+} // namespace vehlwn
@@ -1,26 +1,155 @@
 #include "BackgroundSubtractorFactory.hpp"
 
+#include <chrono>
+#include <exception>
+#include <future>
+#include <optional>
+#include <utility>
+
 #include <boost/log/attributes/named_scope.hpp>
 #include <boost/log/trivial.hpp>
 #include <opencv2/video/background_segm.hpp>
 
+#include "BackgroundModelSnapshot.hpp"
+
 namespace vehlwn {
 namespace {
+// Frames of the saved background image applied with learning rate 1 to a new
+// model. One is enough for MOG2, KNN replaces a random sample of every pixel per
+// frame and needs more to fill its sample sets.
+constexpr int WARM_START_FRAMES = 32;
+
 class OpencvBackgroundSubtractorAdapter : public IBackgroundSubtractor {
 public:
-    explicit OpencvBackgroundSubtractorAdapter(
-        cv::Ptr<cv::BackgroundSubtractor>&& impl)
+    using Snapshot
+        = ApplicationSettings::Segmentation::BackgroundSubtractor::Snapshot;
+    using Clock = std::chrono::steady_clock;
+
+    OpencvBackgroundSubtractorAdapter(
+        cv::Ptr<cv::BackgroundSubtractor>&& impl,
+        const std::optional<Snapshot>& snapshot)
         : m_impl(std::move(impl))
-    {}
+    {
+        if(!snapshot) {
+            return;
+        }
+        m_snapshot.emplace(snapshot->path);
+        m_snapshot_interval = std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(snapshot->interval));
+        m_next_snapshot_time = Clock::now() + m_snapshot_interval;
+        try {
+            m_warm_start_image = m_snapshot->load();
+        } catch(const std::exception& ex) {
+            BOOST_LOG_TRIVIAL(warning)
+                << "Ignoring background snapshot: " << ex.what();
+        }
+    }
+    OpencvBackgroundSubtractorAdapter(const OpencvBackgroundSubtractorAdapter&)
+        = delete;
+    OpencvBackgroundSubtractorAdapter(OpencvBackgroundSubtractorAdapter&&)
+        = delete;
+    ~OpencvBackgroundSubtractorAdapter() override
+    {
+        finish_pending_save();
+    }
+    OpencvBackgroundSubtractorAdapter&
+        operator=(const OpencvBackgroundSubtractorAdapter&)
+        = delete;
+    OpencvBackgroundSubtractorAdapter&
+        operator=(OpencvBackgroundSubtractorAdapter&&)
+        = delete;
+
     CvMatRaiiAdapter apply(CvMatRaiiAdapter&& image) override
     {
+        if(m_warm_start_image) {
+            warm_start(image.get());
+        }
         CvMatRaiiAdapter fgmask;
         m_impl->apply(image.get(), fgmask.get());
+        m_has_frames = true;
+        if(m_snapshot && Clock::now() >= m_next_snapshot_time) {
+            save_snapshot_async();
+        }
         return fgmask;
     }
 
+    void save_snapshot() override
+    {
+        if(!m_snapshot || !m_has_frames) {
+            return;
+        }
+        finish_pending_save();
+        m_snapshot->save(background_image());
+        BOOST_LOG_TRIVIAL(info)
+            << "Saved background snapshot " << m_snapshot->path();
+    }
+
 private:
     cv::Ptr<cv::BackgroundSubtractor> m_impl;
+    std::optional<BackgroundModelSnapshot> m_snapshot;
+    Clock::duration m_snapshot_interval{};
+    Clock::time_point m_next_snapshot_time;
+    // Loaded snapshot waiting for the first frame to check its size and type
+    std::optional<cv::Mat> m_warm_start_image;
+    // The model cannot produce a background image before the first frame
+    bool m_has_frames = false;
+    // Encoding and writing are done off the segmentation thread
+    std::future<void> m_pending_save;
+
+    void warm_start(const cv::Mat& frame)
+    {
+        const auto background = *std::exchange(m_warm_start_image, std::nullopt);
+        if(background.size() != frame.size() || background.type() != frame.type()) {
+            BOOST_LOG_TRIVIAL(info)
+                << "Background snapshot " << m_snapshot->path()
+                << " does not match preprocessed frames, learning from scratch";
+            return;
+        }
+        auto fgmask = cv::Mat();
+        for(int i = 0; i < WARM_START_FRAMES; i++) {
+            m_impl->apply(background, fgmask, 1.0);
+        }
+        BOOST_LOG_TRIVIAL(info)
+            << "Warm started background model from " << m_snapshot->path();
+    }
+
+    cv::Mat background_image() const
+    {
+        auto ret = cv::Mat();
+        m_impl->getBackgroundImage(ret);
+        return ret;
+    }
+
+    void save_snapshot_async()
+    {
+        m_next_snapshot_time = Clock::now() + m_snapshot_interval;
+        if(m_pending_save.valid()) {
+            // Skip this snapshot if the disk is too slow for the interval
+            if(m_pending_save.wait_for(std::chrono::seconds(0))
+               != std::future_status::ready) {
+                return;
+            }
+            finish_pending_save();
+        }
+        m_pending_save = std::async(
+            std::launch::async,
+            [snapshot = *m_snapshot, background = background_image()] {
+                snapshot.save(background);
+            });
+    }
+
+    void finish_pending_save()
+    {
+        if(!m_pending_save.valid()) {
+            return;
+        }
+        try {
+            m_pending_save.get();
+        } catch(const std::exception& ex) {
+            BOOST_LOG_TRIVIAL(warning)
+                << "Failed to save background snapshot: " << ex.what();
+        }
+    }
 };
 } // namespace
 
@@ -40,7 +169,8 @@ std::shared_ptr<IBackgroundSubtractor> BackgroundSubtractorFactory::create()
             cv::createBackgroundSubtractorKNN(
                 knn->history,
                 knn->dist_2_threshold,
-                knn->detect_shadows));
+                knn->detect_shadows),
+            m_config.snapshot);
     }
     if(const auto mog2
        = std::get_if<BackgroundSubtractor::Mog2>(&m_config.algorithm)) {
@@ -48,7 +178,8 @@ std::shared_ptr<IBackgroundSubtractor> BackgroundSubtractorFactory::create()
             cv::createBackgroundSubtractorMOG2(
                 mog2->history,
                 mog2->var_threshold,
-                mog2->detect_shadows));
+                mog2->detect_shadows),
+            m_config.snapshot);
     }
     BOOST_LOG_TRIVIAL(fatal) << "Unreachable!";
     std::exit(1);
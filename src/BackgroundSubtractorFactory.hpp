@@ -13,6 +13,6 @@ public:
     std::shared_ptr<IBackgroundSubtractor> create();
 
 private:
-    const ApplicationSettings::Segmentation::BackgroundSubtractor& m_config;
+    ApplicationSettings::Segmentation::BackgroundSubtractor m_config;
 };
 } // namespace vehlwn
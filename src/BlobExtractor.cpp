@@ -0,0 +1,158 @@
+#include "BlobExtractor.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
+
+#include <opencv2/imgproc.hpp>
+
+namespace vehlwn {
+namespace {
+struct BlobAccumulator {
+    std::int64_t area = 0;
+    std::int64_t sum_x = 0;
+    std::int64_t sum_y = 0;
+    int left = 0;
+    int top = 0;
+    int right = 0;
+    int bottom = 0;
+};
+} // namespace
+
+BlobExtractor::BlobExtractor(const ApplicationSettings::Segmentation::Blobs& config)
+    : m_scale(config.scale)
+{
+    const int k = config.morphology_kernel_size;
+    if(k > 0) {
+        m_kernel = cv::getStructuringElement(cv::MORPH_ELLIPSE, cv::Size(k, k));
+    }
+}
+
+std::vector<Blob> BlobExtractor::apply(const cv::Mat& fgmask)
+{
+    if(fgmask.empty()) {
+        return {};
+    }
+    if(m_scale < 1.) {
+        const auto size = cv::Size(
+            std::max(1, cvRound(fgmask.cols * m_scale)),
+            std::max(1, cvRound(fgmask.rows * m_scale)));
+        cv::resize(fgmask, m_small, size, 0., 0., cv::INTER_AREA);
+    } else {
+        fgmask.copyTo(m_small);
+    }
+    // A downscaled pixel is foreground if most of its source pixels are. Shadows
+    // marked with 127 by background subtractors are dropped here too.
+    cv::threshold(m_small, m_small, 127., 255., cv::THRESH_BINARY);
+    if(!m_kernel.empty()) {
+        // Opening removes specks, closing fills holes inside objects
+        cv::morphologyEx(m_small, m_small, cv::MORPH_OPEN, m_kernel);
+        cv::morphologyEx(m_small, m_small, cv::MORPH_CLOSE, m_kernel);
+    }
+    m_small_rle.assign(m_small);
+    const double fx = static_cast<double>(fgmask.cols) / m_small.cols;
+    const double fy = static_cast<double>(fgmask.rows) / m_small.rows;
+    return label(m_small_rle, fx, fy);
+}
+
+std::size_t BlobExtractor::find_root(std::size_t i)
+{
+    while(m_parents[i] != i) {
+        // Path halving
+        m_parents[i] = m_parents[m_parents[i]];
+        i = m_parents[i];
+    }
+    return i;
+}
+
+std::vector<Blob>
+    BlobExtractor::label(const RleMask& mask, const double fx, const double fy)
+{
+    const auto n = mask.run_count();
+    m_parents.resize(n);
+    std::iota(m_parents.begin(), m_parents.end(), std::size_t{0});
+    const auto unite = [&](const std::size_t a, const std::size_t b) {
+        const auto ra = find_root(a);
+        const auto rb = find_root(b);
+        if(ra < rb) {
+            m_parents[rb] = ra;
+        } else if(rb < ra) {
+            m_parents[ra] = rb;
+        }
+    };
+
+    // Runs are numbered in row order. Every run is merged with the runs of the
+    // previous row which touch it including diagonal neighbours.
+    auto prev_base = std::size_t{0};
+    auto base = std::size_t{0};
+    auto prev = boost::span<const RleMask::Run>();
+    for(int y = 0; y < mask.height(); y++) {
+        // Does not overwrite runs of the previous row
+        const auto cur = mask.row(y, m_row_runs[static_cast<std::size_t>(y % 2)]);
+        if(y > 0) {
+            auto j = std::size_t{0};
+            for(std::size_t k = 0; k < cur.size(); k++) {
+                while(j < prev.size() && prev[j].end < cur[k].begin) {
+                    j++;
+                }
+                for(auto p = j; p < prev.size() && prev[p].begin <= cur[k].end;
+                    p++) {
+                    unite(prev_base + p, base + k);
+                }
+            }
+        }
+        prev = cur;
+        prev_base = base;
+        base += cur.size();
+    }
+
+    auto accumulators = std::vector<BlobAccumulator>();
+    auto root_to_blob = std::vector<std::size_t>(n, n);
+    auto i = std::size_t{0};
+    for(int y = 0; y < mask.height(); y++) {
+        for(const auto& run : mask.row(y, m_row_runs.front())) {
+            const auto root = find_root(i++);
+            if(root_to_blob[root] == n) {
+                root_to_blob[root] = accumulators.size();
+                accumulators.push_back(
+                    BlobAccumulator{0, 0, 0, run.begin, y, run.end, y + 1});
+            }
+            auto& acc = accumulators[root_to_blob[root]];
+            const std::int64_t length = run.end - run.begin;
+            acc.area += length;
+            // Sum of x over [begin, end)
+            acc.sum_x += (std::int64_t{run.begin} + run.end - 1) * length / 2;
+            acc.sum_y += std::int64_t{y} * length;
+            acc.left = std::min<int>(acc.left, run.begin);
+            acc.right = std::max<int>(acc.right, run.end);
+            acc.bottom = y + 1;
+        }
+    }
+
+    auto ret = std::vector<Blob>();
+    ret.reserve(accumulators.size());
+    for(const auto& acc : accumulators) {
+        auto blob = Blob();
+        const int left = static_cast<int>(std::floor(acc.left * fx));
+        const int top = static_cast<int>(std::floor(acc.top * fy));
+        blob.bbox = cv::Rect(
+            left,
+            top,
+            static_cast<int>(std::ceil(acc.right * fx)) - left,
+            static_cast<int>(std::ceil(acc.bottom * fy)) - top);
+        const auto area = static_cast<double>(acc.area);
+        blob.area = static_cast<int>(std::lround(area * fx * fy));
+        // Centers of downscaled pixels mapped to mask pixel coordinates
+        blob.centroid = cv::Point2d(
+            (static_cast<double>(acc.sum_x) / area + 0.5) * fx - 0.5,
+            (static_cast<double>(acc.sum_y) / area + 0.5) * fy - 0.5);
+        ret.push_back(blob);
+    }
+    std::ranges::sort(ret, [](const Blob& a, const Blob& b) {
+        return a.area > b.area;
+    });
+    return ret;
+}
+} // namespace vehlwn
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+#include <opencv2/core/mat.hpp>
+#include <opencv2/core/types.hpp>
+
+#include "ApplicationSettings.hpp"
+#include "RleMask.hpp"
+
+namespace vehlwn {
+// Connected region of a foreground mask. All values are in mask coordinates.
+struct Blob {
+    cv::Rect bbox;
+    int area = 0;
+    cv::Point2d centroid;
+};
+
+// Splits a foreground mask into blobs. The mask is downscaled and cleaned with
+// morphological opening and closing, then 8-connected components are labeled by
+// merging RleMask runs of adjacent rows.
+class BlobExtractor {
+public:
+    explicit BlobExtractor(const ApplicationSettings::Segmentation::Blobs& config);
+
+    // Returns blobs sorted by area in descending order
+    [[nodiscard]] std::vector<Blob> apply(const cv::Mat& fgmask);
+
+    // Labels an already clean mask. Coordinates are multiplied by fx and fy.
+    [[nodiscard]] std::vector<Blob>
+        label(const RleMask& mask, double fx = 1., double fy = 1.);
+
+private:
+    double m_scale;
+    cv::Mat m_kernel;
+    // Buffers reused between frames
+    cv::Mat m_small;
+    RleMask m_small_rle;
+    std::vector<std::size_t> m_parents;
+    // Decoded runs of two adjacent rows of a bit-packed mask
+    std::array<std::vector<RleMask::Run>, 2> m_row_runs;
+
+    std::size_t find_root(std::size_t i);
+};
+} // namespace vehlwn
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+
+namespace vehlwn {
+// FIFO queue of a fixed capacity for passing items between threads. A producer
+// waits for free space, so a slow consumer slows the producer down instead of
+// accumulating items.
+template<class T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(const std::size_t capacity)
+        : m_capacity{capacity}
+    {
+        if(capacity == 0) {
+            throw std::invalid_argument("BoundedQueue: capacity must be positive");
+        }
+    }
+
+    // Waits while the queue is full. Returns false if the queue is closed, the
+    // value is dropped then.
+    bool push(T&& value)
+    {
+        auto lock = std::unique_lock(m_mutex);
+        m_not_full.wait(lock, [&] {
+            return m_closed || m_items.size() < m_capacity;
+        });
+        if(m_closed) {
+            return false;
+        }
+        m_items.push_back(std::move(value));
+        lock.unlock();
+        m_not_empty.notify_one();
+        return true;
+    }
+
+    // Does not wait. Returns false if the queue is full or closed, the value is
+    // dropped then.
+    bool try_push(T&& value)
+    {
+        {
+            const auto lock = std::lock_guard(m_mutex);
+            if(m_closed || m_items.size() >= m_capacity) {
+                return false;
+            }
+            m_items.push_back(std::move(value));
+        }
+        m_not_empty.notify_one();
+        return true;
+    }
+
+    // Waits while the queue is empty. Returns std::nullopt if the queue is
+    // closed, remaining items are not returned.
+    std::optional<T> pop()
+    {
+        auto lock = std::unique_lock(m_mutex);
+        m_not_empty.wait(lock, [&] { return m_closed || !m_items.empty(); });
+        if(m_closed) {
+            return std::nullopt;
+        }
+        auto ret = std::optional<T>(std::move(m_items.front()));
+        m_items.pop_front();
+        lock.unlock();
+        m_not_full.notify_one();
+        return ret;
+    }
+
+    // Wakes up all waiting threads, further push() and pop() fail
+    void close()
+    {
+        {
+            const auto lock = std::lock_guard(m_mutex);
+            m_closed = true;
+            m_items.clear();
+        }
+        m_not_full.notify_all();
+        m_not_empty.notify_all();
+    }
+
+    [[nodiscard]] std::size_t size() const
+    {
+        const auto lock = std::lock_guard(m_mutex);
+        return m_items.size();
+    }
+
+    [[nodiscard]] std::size_t capacity() const
+    {
+        return m_capacity;
+    }
+
+private:
+    const std::size_t m_capacity;
+    mutable std::mutex m_mutex;
+    std::condition_variable m_not_full;
+    std::condition_variable m_not_empty;
+    std::deque<T> m_items;
+    bool m_closed = false;
+};
+} // namespace vehlwn
@@ -0,0 +1,81 @@
+#include "ConfigReloader.hpp"
+
+#include <csignal>
+#include <exception>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+
+#include <pthread.h>
+
+#include <boost/log/attributes/named_scope.hpp>
+#include <boost/log/trivial.hpp>
+
+namespace vehlwn {
+namespace {
+sigset_t reload_signals()
+{
+    sigset_t ret;
+    sigemptyset(&ret);
+    sigaddset(&ret, SIGHUP);
+    return ret;
+}
+} // namespace
+
+void ConfigReloader::block_signals()
+{
+    const auto signals = reload_signals();
+    if(const int err = pthread_sigmask(SIG_BLOCK, &signals, nullptr); err != 0) {
+        throw std::system_error(err, std::generic_category(), "pthread_sigmask");
+    }
+}
+
+ConfigReloader::ConfigReloader(std::shared_ptr<MotionDataWorker> worker)
+    : m_worker(std::move(worker))
+    , m_signal_thread(&ConfigReloader::wait_signals, this)
+{}
+
+ConfigReloader::~ConfigReloader()
+{
+    m_stopped = true;
+    // Wakes up sigwait() which receives signals sent to the thread too
+    pthread_kill(m_signal_thread.native_handle(), SIGHUP);
+    m_signal_thread.join();
+}
+
+SettingsReload ConfigReloader::reload()
+{
+    BOOST_LOG_FUNCTION();
+    const auto lock = std::lock_guard(m_reload_mutex);
+    auto ret = merge_reloaded_settings(*m_worker->get_settings(), load_settings());
+    if(!ret.applied.empty()) {
+        m_worker->reload_settings(
+            std::make_shared<const ApplicationSettings>(ret.settings));
+    }
+    BOOST_LOG_TRIVIAL(info) << "Reloaded config: " << ret;
+    return ret;
+}
+
+void ConfigReloader::wait_signals()
+{
+    BOOST_LOG_FUNCTION();
+    const auto signals = reload_signals();
+    while(true) {
+        int signal = 0;
+        if(const int err = sigwait(&signals, &signal); err != 0) {
+            BOOST_LOG_TRIVIAL(error) << "sigwait failed: " << err;
+            return;
+        }
+        if(m_stopped) {
+            return;
+        }
+        BOOST_LOG_TRIVIAL(info) << "Received SIGHUP, reloading config";
+        try {
+            reload();
+        } catch(const std::exception& ex) {
+            BOOST_LOG_TRIVIAL(error)
+                << "Config reload failed, keeping running settings: " << ex.what();
+        }
+    }
+}
+} // namespace vehlwn
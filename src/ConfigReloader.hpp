@@ -0,0 +1,41 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "MotionDataWorker.hpp"
+#include "SettingsReload.hpp"
+
+namespace vehlwn {
+// Reloads app.ini on SIGHUP and on request without reopening the input. Changed
+// settings which need a restart are logged and keep running values.
+class ConfigReloader {
+public:
+    // Blocks SIGHUP in the calling thread and threads created by it later. Must
+    // be called before any thread is started, otherwise SIGHUP may terminate
+    // the process.
+    static void block_signals();
+
+    explicit ConfigReloader(std::shared_ptr<MotionDataWorker> worker);
+    ConfigReloader(const ConfigReloader&) = delete;
+    ConfigReloader(ConfigReloader&&) = delete;
+    ~ConfigReloader();
+    ConfigReloader& operator=(const ConfigReloader&) = delete;
+    ConfigReloader& operator=(ConfigReloader&&) = delete;
+
+    // Throws if app.ini cannot be read or is invalid, running settings are
+    // kept then
+    SettingsReload reload();
+
+private:
+    std::shared_ptr<MotionDataWorker> m_worker;
+    // Serializes reloads from the signal thread and the API
+    std::mutex m_reload_mutex;
+    std::atomic_bool m_stopped{false};
+    std::thread m_signal_thread;
+
+    void wait_signals();
+};
+} // namespace vehlwn
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <boost/log/attributes/named_scope.hpp>
+#include <boost/log/trivial.hpp>
+
+// Logging for functions called for every packet or frame. Unless the project is
+// configured with -Dhot_path_logging=true named scopes are not pushed and trace
+// messages are not formatted at all. Arguments of HOT_PATH_LOG_TRACE are still
+// compiled so they do not rot.
+
+#ifndef HOT_PATH_LOGGING
+#define HOT_PATH_LOGGING 0
+#endif
+
+#if HOT_PATH_LOGGING
+#define HOT_PATH_LOG_FUNCTION() BOOST_LOG_FUNCTION()
+#define HOT_PATH_LOG_TRACE() BOOST_LOG_TRIVIAL(trace)
+#else
+#define HOT_PATH_LOG_FUNCTION() static_cast<void>(0)
+#define HOT_PATH_LOG_TRACE()                                                        \
+    while(false)                                                                    \
+    BOOST_LOG_TRIVIAL(trace)
+#endif
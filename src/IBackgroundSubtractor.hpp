@@ -3,5 +3,10 @@
 #include "filters/IImageFilter.hpp"
 
 namespace vehlwn {
-class IBackgroundSubtractor : public IImageFilter {};
+class IBackgroundSubtractor : public IImageFilter {
+public:
+    // Saves the background model if snapshots are enabled. Must not be called
+    // concurrently with apply().
+    virtual void save_snapshot() = 0;
+};
 } // namespace vehlwn
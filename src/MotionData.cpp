@@ -2,8 +2,6 @@
 
 #include <utility>
 
-#include <opencv2/core.hpp>
-
 namespace vehlwn {
 MotionData::MotionData()
     : m_moving_area{0}
@@ -19,13 +17,25 @@ const CvMatRaiiAdapter& MotionData::frame() const
     return m_frame;
 }
 
-MotionData& MotionData::set_fgmask(CvMatRaiiAdapter&& fgmask)
+MotionData& MotionData::set_arrival_time(
+    const std::optional<std::chrono::steady_clock::time_point> x)
+{
+    m_arrival_time = x;
+    return *this;
+}
+std::optional<std::chrono::steady_clock::time_point>
+    MotionData::arrival_time() const
+{
+    return m_arrival_time;
+}
+
+MotionData& MotionData::set_fgmask(RleMask&& fgmask)
 {
     m_fgmask = std::move(fgmask);
-    fgmask_changed();
+    m_moving_area = m_fgmask.area();
     return *this;
 }
-const CvMatRaiiAdapter& MotionData::fgmask() const
+const RleMask& MotionData::fgmask() const
 {
     return m_fgmask;
 }
@@ -35,8 +45,13 @@ int MotionData::moving_area() const
     return m_moving_area;
 }
 
-void MotionData::fgmask_changed()
+MotionData& MotionData::set_blobs(std::vector<Blob>&& blobs)
+{
+    m_blobs = std::move(blobs);
+    return *this;
+}
+const std::vector<Blob>& MotionData::blobs() const
 {
-    m_moving_area = cv::countNonZero(m_fgmask.get());
+    return m_blobs;
 }
 } // namespace vehlwn
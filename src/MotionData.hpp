@@ -1,8 +1,14 @@
 #pragma once
 
+#include <chrono>
+#include <optional>
+#include <vector>
+
 #include <opencv2/core/mat.hpp>
 
+#include "BlobExtractor.hpp"
 #include "CvMatRaiiAdapter.hpp"
+#include "RleMask.hpp"
 
 namespace vehlwn {
 class MotionData {
@@ -12,16 +18,27 @@ public:
     MotionData& set_frame(CvMatRaiiAdapter&& frame);
     [[nodiscard]] const CvMatRaiiAdapter& frame() const;
 
-    MotionData& set_fgmask(CvMatRaiiAdapter&& fgmask);
-    [[nodiscard]] const CvMatRaiiAdapter& fgmask() const;
+    // When the first packet of the frame was read from the input. Empty if
+    // unknown.
+    MotionData& set_arrival_time(
+        std::optional<std::chrono::steady_clock::time_point> x);
+    [[nodiscard]] std::optional<std::chrono::steady_clock::time_point>
+        arrival_time() const;
+
+    MotionData& set_fgmask(RleMask&& fgmask);
+    [[nodiscard]] const RleMask& fgmask() const;
 
     [[nodiscard]] int moving_area() const;
 
-private:
-    void fgmask_changed();
+    // Empty if blob extraction is disabled
+    MotionData& set_blobs(std::vector<Blob>&& blobs);
+    [[nodiscard]] const std::vector<Blob>& blobs() const;
 
+private:
     CvMatRaiiAdapter m_frame;
-    CvMatRaiiAdapter m_fgmask;
+    std::optional<std::chrono::steady_clock::time_point> m_arrival_time;
+    RleMask m_fgmask;
     int m_moving_area;
+    std::vector<Blob> m_blobs;
 };
 } // namespace vehlwn
@@ -1,38 +1,80 @@
 #include "MotionDataWorker.hpp"
 
 #include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <cstdlib>
 #include <exception>
 #include <memory>
+#include <optional>
+#include <string_view>
+#include <utility>
+#include <vector>
 
 #include <boost/log/attributes/named_scope.hpp>
 #include <boost/log/trivial.hpp>
 
 #include "CvMatRaiiAdapter.hpp"
 #include "FfmpegInputDeviceFactory.hpp"
+#include "HotPathLogging.hpp"
+#include "PreprocessImageFactory.hpp"
 
 namespace vehlwn {
+namespace {
+// Frames waiting between two stages. A stage slower than the previous one makes
+// the previous one wait, so frames are not accumulated and latency stays low.
+constexpr std::size_t PIPELINE_QUEUE_CAPACITY = 2;
+
+std::optional<BlobExtractor>
+    make_blob_extractor(const ApplicationSettings::Segmentation& settings)
+{
+    if(const auto& blobs = settings.blobs) {
+        return BlobExtractor(*blobs);
+    }
+    return std::nullopt;
+}
+} // namespace
+
 MotionDataWorker::MotionDataWorker(
-    std::shared_ptr<const vehlwn::ApplicationSettings>&& settings)
+    std::shared_ptr<const vehlwn::ApplicationSettings>&& settings,
+    std::shared_ptr<RecordingIndex> recording_index,
+    std::shared_ptr<RetentionSweeper> retention_sweeper,
+    std::shared_ptr<ThreadPool> preprocess_pool,
+    std::shared_ptr<ffmpeg::JpegEncoderPool> jpeg_encoders)
     : m_back_subtractor_factory(
         std::make_shared<vehlwn::BackgroundSubtractorFactory>(
             settings->segmentation.background_subtractor))
     , m_input_device(
           vehlwn::FfmpegInputDeviceFactory(std::shared_ptr(settings)).create())
-    , m_preprocess_image_factory(
-          std::make_shared<vehlwn::PreprocessImageFactory>(settings->preprocess))
-    , m_settings(std::move(settings))
+    , m_latency_tracer(m_input_device.latency_tracer())
+    , m_preprocess_pool(std::move(preprocess_pool))
+    , m_trigger(settings->segmentation)
+    , m_settings(std::shared_ptr(settings))
+    , m_publish_settings(std::move(settings))
+    , m_recording_index(std::move(recording_index))
+    , m_retention_sweeper(std::move(retention_sweeper))
     , m_motion_data{std::make_shared<SharedMutex<MotionData>>()}
-    , m_last_motion_point(std::chrono::system_clock::now())
     , m_stopped{false}
 {
     BOOST_LOG_FUNCTION();
     m_out_filename_factory = [&] {
         auto ret = std::make_shared<vehlwn::DateFolderFactory>();
-        ret->set_prefix(std::string(m_settings->output_files.prefix));
-        ret->set_extension(std::string(m_settings->output_files.extension));
+        const auto& output_files = m_publish_settings->output_files;
+        ret->set_prefix(std::string(output_files.prefix));
+        ret->set_extension(std::string(output_files.extension));
         return ret;
     }();
+    m_input_device.set_recording_callback(
+        [index = m_recording_index, sweeper = m_retention_sweeper](
+            const ffmpeg::RecordingInfo& info) {
+            index->append(info);
+            if(sweeper) {
+                sweeper->notify();
+            }
+        });
+    m_input_device.set_path_generator(
+        [factory = m_out_filename_factory] { return factory->generate(); });
+    m_input_device.set_jpeg_encoders(std::move(jpeg_encoders));
     BOOST_LOG_TRIVIAL(debug) << "constructor MotionDataWorker";
 }
 
@@ -54,59 +96,151 @@ std::shared_ptr<const SharedMutex<MotionData>>
 void MotionDataWorker::start()
 {
     m_stopped = false;
-    auto back_subtractor = m_back_subtractor_factory->create();
-    auto preprocess_filter = m_preprocess_image_factory->create();
-    m_working_thread = std::thread(
-        &MotionDataWorker::thread_func,
-        this,
-        std::move(back_subtractor),
-        std::move(preprocess_filter));
-}
-
-void MotionDataWorker::thread_func(
-    std::shared_ptr<IBackgroundSubtractor>&& back_subtractor,
-    std::shared_ptr<IImageFilter>&& preprocess_filter)
-try {
-    while(!m_stopped) {
-        auto frame = m_input_device.get_video_frame();
-        auto processed = preprocess_filter->apply(frame.clone());
-        auto fgmask = back_subtractor->apply(std::move(processed));
-        (*m_motion_data->write())
-            .set_frame(std::move(frame))
-            .set_fgmask(std::move(fgmask));
-        check_motion();
+    const auto settings = get_settings();
+    m_back_subtractor = m_back_subtractor_factory->create();
+    m_pipeline = std::make_unique<Pipeline<FrameItem>>(
+        PIPELINE_QUEUE_CAPACITY,
+        [this](const std::exception& ex) {
+            BOOST_LOG_FUNCTION();
+            BOOST_LOG_TRIVIAL(fatal) << "Pipeline stage failed: " << ex.what();
+            m_input_device.stop_recording();
+            std::exit(1);
+        });
+    m_pipeline->add_stage("decode", [this](FrameItem& item) {
+        item.frame = m_input_device.get_video_frame();
+        item.pts_us = m_input_device.last_video_pts_us();
+        item.arrival_time = m_input_device.last_video_arrival_time();
+    });
+    // Stages rebuild their components from reloaded settings between frames
+    m_pipeline->add_stage(
+        "preprocess",
+        [this,
+         applied = settings,
+         filter = PreprocessImageFactory(settings->preprocess, m_preprocess_pool)
+                      .create()](FrameItem& item) mutable {
+            if(auto latest = get_settings(); latest != applied) {
+                if(latest->preprocess != applied->preprocess) {
+                    filter = PreprocessImageFactory(
+                                 latest->preprocess,
+                                 m_preprocess_pool)
+                                 .create();
+                    BOOST_LOG_TRIVIAL(info) << "Applied reloaded preprocess";
+                }
+                applied = std::move(latest);
+            }
+            item.processed = filter->apply(item.frame.clone());
+        });
+    m_pipeline->add_stage(
+        "segment",
+        [this,
+         applied = settings,
+         back_subtractor = m_back_subtractor,
+         blob_extractor = make_blob_extractor(settings->segmentation)](
+            FrameItem& item) mutable {
+            if(auto latest = get_settings(); latest != applied) {
+                if(latest->segmentation.blobs != applied->segmentation.blobs) {
+                    blob_extractor = make_blob_extractor(latest->segmentation);
+                    BOOST_LOG_TRIVIAL(info) << "Applied reloaded segmentation.blobs";
+                }
+                applied = std::move(latest);
+            }
+            const auto fgmask = back_subtractor->apply(std::move(item.processed));
+            if(blob_extractor) {
+                item.blobs = blob_extractor->apply(fgmask.get());
+            }
+            item.fgmask = RleMask(fgmask.get());
+        });
+    m_pipeline->add_stage("publish", [this](FrameItem& item) { publish(item); });
+    if(m_latency_tracer->tracing_enabled()) {
+        using TimePoint = Pipeline<FrameItem>::Clock::time_point;
+        m_pipeline->set_stage_observer(
+            [tracer = m_latency_tracer](
+                const std::string_view stage_name,
+                const FrameItem& item,
+                const TimePoint begin,
+                const TimePoint end) {
+                // Every stage has its own thread
+                tracer->trace(stage_name, stage_name, begin, end, item.pts_us);
+            });
     }
-} catch(const std::exception& ex) {
-    BOOST_LOG_FUNCTION();
-    BOOST_LOG_TRIVIAL(fatal) << "thread_func: " << ex.what();
-    m_input_device.stop_recording();
-    std::exit(1);
+    m_pipeline->start();
 }
 
-void MotionDataWorker::check_motion()
+void MotionDataWorker::publish(FrameItem& item)
 {
-    BOOST_LOG_FUNCTION();
-    const auto& segmentation = m_settings->segmentation;
-    const auto current_moving_area = m_motion_data->read()->moving_area();
-    const auto now = std::chrono::system_clock::now();
-    if(current_moving_area >= segmentation.min_moving_area) {
-        m_last_motion_point = now;
-        if(!m_input_device.is_recording()) {
-            m_output_path = m_out_filename_factory->generate();
-            BOOST_LOG_TRIVIAL(info)
-                << "Motion detected. Opening file '" << m_output_path << "'";
-            m_input_device.start_recording(m_output_path.data());
+    if(auto latest = get_settings(); latest != m_publish_settings) {
+        m_trigger.reconfigure(latest->segmentation);
+        if(latest->output_files != m_publish_settings->output_files) {
+            m_input_device.set_settings(std::shared_ptr(latest));
         }
-    } else {
-        if(m_input_device.is_recording()) {
-            const auto duration
-                = std::chrono::duration<double>(now - m_last_motion_point).count();
-            if(duration >= segmentation.delta_without_motion) {
-                BOOST_LOG_TRIVIAL(info)
-                    << "End of motion. Closing file '" << m_output_path << "'";
-                m_input_device.stop_recording();
-            }
+        m_publish_settings = std::move(latest);
+    }
+    (*m_motion_data->write())
+        .set_frame(std::move(item.frame))
+        .set_arrival_time(item.arrival_time)
+        .set_fgmask(std::move(item.fgmask))
+        .set_blobs(std::move(item.blobs));
+    if(item.arrival_time) {
+        m_latency_tracer->record_publish(
+            *item.arrival_time,
+            ffmpeg::LatencyTracer::Clock::now(),
+            item.pts_us);
+    }
+    check_motion(item.pts_us);
+}
+
+void MotionDataWorker::check_motion(const std::int64_t pts_us)
+{
+    HOT_PATH_LOG_FUNCTION();
+    const auto& segmentation = m_publish_settings->segmentation;
+    auto current_moving_area = 0;
+    auto largest_blob_area = 0;
+    {
+        const auto lock = m_motion_data->read();
+        current_moving_area = lock->moving_area();
+        if(!lock->blobs().empty()) {
+            // Blobs are sorted by area
+            largest_blob_area = lock->blobs().front().area;
+        }
+    }
+    // Many small objects like leaves on wind do not count as motion
+    if(segmentation.blobs && largest_blob_area < segmentation.blobs->min_blob_area) {
+        current_moving_area = 0;
+    }
+    const auto event
+        = m_trigger.update(MotionTrigger::Clock::now(), current_moving_area);
+    if(event == MotionTrigger::Event::Start && !m_input_device.is_recording()) {
+        m_output_path = m_input_device.start_recording();
+        BOOST_LOG_TRIVIAL(info)
+            << "Motion detected. Opened file '" << m_output_path << "'";
+        // Deleting old files on a full disk is slow, so room for the new
+        // recording is freed in parallel on the low-priority sweeper thread
+        if(m_retention_sweeper) {
+            m_retention_sweeper->notify();
+        }
+    } else if(event == MotionTrigger::Event::Stop && m_input_device.is_recording()) {
+        BOOST_LOG_TRIVIAL(info)
+            << "End of motion. Closing file '" << m_output_path << "'";
+        m_input_device.stop_recording();
+    }
+    // Timeline of a recording has a sample for every frame, not only for moving
+    // ones, so that the player can show quiet intervals too
+    if(m_input_device.is_recording()) {
+        auto sample = ffmpeg::MotionSample();
+        sample.pts_us = pts_us;
+        // Shares pixels with the published frame which is replaced, not modified
+        auto frame = cv::Mat();
+        {
+            const auto lock = m_motion_data->read();
+            frame = lock->frame().get();
+            sample.moving_area = lock->moving_area();
+            sample.blob_count = static_cast<int>(lock->blobs().size());
+            lock->fgmask().coverage_grid(
+                ffmpeg::TIMELINE_GRID_COLS,
+                ffmpeg::TIMELINE_GRID_ROWS,
+                sample.heatmap);
         }
+        m_input_device.report_motion(sample, frame);
     }
 }
 
@@ -115,11 +249,19 @@ void MotionDataWorker::stop()
     BOOST_LOG_FUNCTION();
     BOOST_LOG_TRIVIAL(debug) << "Stopping...";
     m_stopped = true;
-    if(m_working_thread.joinable()) {
-        BOOST_LOG_TRIVIAL(debug) << "Joining working thread...";
-        m_working_thread.join();
+    if(m_pipeline) {
+        BOOST_LOG_TRIVIAL(debug) << "Joining pipeline threads...";
+        m_pipeline->stop();
         BOOST_LOG_TRIVIAL(debug) << "Joined";
     }
+    if(m_back_subtractor) {
+        try {
+            m_back_subtractor->save_snapshot();
+        } catch(const std::exception& ex) {
+            BOOST_LOG_TRIVIAL(error)
+                << "Failed to save background snapshot: " << ex.what();
+        }
+    }
 }
 
 double MotionDataWorker::get_fps() const
@@ -131,4 +273,43 @@ bool MotionDataWorker::is_recording() const
 {
     return m_input_device.is_recording();
 }
+
+std::optional<double> MotionDataWorker::get_start_latency() const
+{
+    if(const auto latency = m_input_device.start_latency()) {
+        return std::chrono::duration<double, std::milli>(*latency).count();
+    }
+    return std::nullopt;
+}
+
+std::optional<ffmpeg::WriteStats> MotionDataWorker::get_write_stats() const
+{
+    return m_input_device.write_stats();
+}
+
+std::vector<PipelineStageStats> MotionDataWorker::get_pipeline_stats() const
+{
+    if(m_pipeline) {
+        return m_pipeline->stats();
+    }
+    return {};
+}
+
+std::shared_ptr<const ffmpeg::LatencyTracer>
+    MotionDataWorker::get_latency_tracer() const
+{
+    return m_latency_tracer;
+}
+
+std::shared_ptr<const vehlwn::ApplicationSettings>
+    MotionDataWorker::get_settings() const
+{
+    return *m_settings.read();
+}
+
+void MotionDataWorker::reload_settings(
+    std::shared_ptr<const vehlwn::ApplicationSettings>&& settings)
+{
+    *m_settings.write() = std::move(settings);
+}
 } // namespace vehlwn
@@ -2,21 +2,33 @@
 
 #include <atomic>
 #include <chrono>
+#include <cstdint>
 #include <memory>
-#include <thread>
+#include <optional>
+#include <vector>
 
 #include "BackgroundSubtractorFactory.hpp"
+#include "BlobExtractor.hpp"
 #include "FileNameFactory.hpp"
 #include "MotionData.hpp"
-#include "PreprocessImageFactory.hpp"
+#include "MotionTrigger.hpp"
+#include "Pipeline.hpp"
+#include "RecordingIndex.hpp"
+#include "RetentionSweeper.hpp"
+#include "RleMask.hpp"
 #include "SharedMutex.hpp"
+#include "ThreadPool.hpp"
 #include "ffmpeg_adapters/InputDevice.hpp"
 
 namespace vehlwn {
 class MotionDataWorker {
 public:
-    explicit MotionDataWorker(
-        std::shared_ptr<const vehlwn::ApplicationSettings>&& settings);
+    MotionDataWorker(
+        std::shared_ptr<const vehlwn::ApplicationSettings>&& settings,
+        std::shared_ptr<RecordingIndex> recording_index,
+        std::shared_ptr<RetentionSweeper> retention_sweeper,
+        std::shared_ptr<ThreadPool> preprocess_pool,
+        std::shared_ptr<ffmpeg::JpegEncoderPool> jpeg_encoders);
     MotionDataWorker(const MotionDataWorker&) = delete;
     MotionDataWorker(MotionDataWorker&&) = delete;
     MotionDataWorker& operator=(const MotionDataWorker&) = delete;
@@ -28,24 +40,58 @@ public:
     void stop();
     [[nodiscard]] double get_fps() const;
     [[nodiscard]] bool is_recording() const;
+    // Motion to first packet latency of the current or last recording in
+    // milliseconds
+    [[nodiscard]] std::optional<double> get_start_latency() const;
+    [[nodiscard]] std::optional<ffmpeg::WriteStats> get_write_stats() const;
+    // Empty before start()
+    [[nodiscard]] std::vector<PipelineStageStats> get_pipeline_stats() const;
+    [[nodiscard]] std::shared_ptr<const ffmpeg::LatencyTracer>
+        get_latency_tracer() const;
+    [[nodiscard]] std::shared_ptr<const vehlwn::ApplicationSettings>
+        get_settings() const;
+    // Replaces settings of trigger thresholds, blobs, preprocessing and encoding
+    // of the next recording. Stages apply them from the next frame, other
+    // settings are expected to be unchanged, see merge_reloaded_settings().
+    void reload_settings(
+        std::shared_ptr<const vehlwn::ApplicationSettings>&& settings);
 
 private:
+    // Frame passed through decode, preprocess, segment and publish stages
+    struct FrameItem {
+        CvMatRaiiAdapter frame;
+        std::int64_t pts_us = 0;
+        std::optional<std::chrono::steady_clock::time_point> arrival_time;
+        CvMatRaiiAdapter processed;
+        RleMask fgmask;
+        std::vector<Blob> blobs;
+    };
+
     std::shared_ptr<BackgroundSubtractorFactory> m_back_subtractor_factory;
     ffmpeg::InputDevice m_input_device;
+    std::shared_ptr<ffmpeg::LatencyTracer> m_latency_tracer;
     std::shared_ptr<FileNameFactory> m_out_filename_factory;
-    std::shared_ptr<PreprocessImageFactory> m_preprocess_image_factory;
-    std::shared_ptr<const vehlwn::ApplicationSettings> m_settings;
+    // Can be null to preprocess frames on the preprocess stage thread
+    std::shared_ptr<ThreadPool> m_preprocess_pool;
+    MotionTrigger m_trigger;
+    // Latest settings. Stages compare it with the settings they applied before
+    // every frame and rebuild their components if it has changed.
+    SharedMutex<std::shared_ptr<const vehlwn::ApplicationSettings>> m_settings;
+    // Settings applied by the publish stage
+    std::shared_ptr<const vehlwn::ApplicationSettings> m_publish_settings;
+    std::shared_ptr<RecordingIndex> m_recording_index;
+    // Can be null if retention is disabled
+    std::shared_ptr<RetentionSweeper> m_retention_sweeper;
 
     std::shared_ptr<SharedMutex<MotionData>> m_motion_data;
-    std::chrono::system_clock::time_point m_last_motion_point;
     std::atomic_bool m_stopped;
     std::string m_output_path;
 
-    std::thread m_working_thread;
+    // Used by the segment stage, a snapshot of its model is saved on stop
+    std::shared_ptr<IBackgroundSubtractor> m_back_subtractor;
+    std::unique_ptr<Pipeline<FrameItem>> m_pipeline;
 
-    void thread_func(
-        std::shared_ptr<IBackgroundSubtractor>&& back_subtractor,
-        std::shared_ptr<IImageFilter>&& preprocess_filter);
-    void check_motion();
+    void publish(FrameItem& item);
+    void check_motion(std::int64_t pts_us);
 };
 } // namespace vehlwn
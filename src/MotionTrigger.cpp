@@ -0,0 +1,94 @@
+#include "MotionTrigger.hpp"
+
+#include <algorithm>
+#include <utility>
+
+namespace vehlwn {
+namespace {
+MotionTrigger::Clock::duration to_duration(const double seconds)
+{
+    return std::chrono::duration_cast<MotionTrigger::Clock::duration>(
+        std::chrono::duration<double>(seconds));
+}
+} // namespace
+
+MotionTrigger::MotionTrigger(const ApplicationSettings::Segmentation& config)
+    : m_start_area(config.min_moving_area)
+    , m_stop_area(std::min(config.trigger.stop_moving_area, config.min_moving_area))
+    , m_alpha(config.trigger.smoothing_factor)
+    , m_start_frames(config.trigger.start_frames)
+    , m_stop_delay(to_duration(config.delta_without_motion))
+    , m_min_clip_duration(to_duration(config.trigger.min_clip_duration))
+    , m_window(static_cast<std::size_t>(
+          std::max(config.trigger.window_frames, config.trigger.start_frames)))
+{}
+
+MotionTrigger::Event
+    MotionTrigger::update(const Clock::time_point now, const int moving_area)
+{
+    if(m_has_average) {
+        m_average += m_alpha * (moving_area - m_average);
+    } else {
+        m_average = moving_area;
+        m_has_average = true;
+    }
+
+    if(m_active) {
+        if(m_average >= m_stop_area) {
+            m_last_motion_time = now;
+            return Event::None;
+        }
+        if(now - m_last_motion_time >= m_stop_delay
+           && now - m_start_time >= m_min_clip_duration) {
+            m_active = false;
+            clear_window();
+            return Event::Stop;
+        }
+        return Event::None;
+    }
+
+    const std::uint8_t hit = m_average >= m_start_area ? 1 : 0;
+    m_window_hits += hit - m_window[m_window_pos];
+    m_window[m_window_pos] = hit;
+    m_window_pos = (m_window_pos + 1) % m_window.size();
+    if(m_window_hits >= m_start_frames) {
+        m_active = true;
+        m_start_time = now;
+        m_last_motion_time = now;
+        return Event::Start;
+    }
+    return Event::None;
+}
+
+void MotionTrigger::reconfigure(const ApplicationSettings::Segmentation& config)
+{
+    auto tmp = MotionTrigger(config);
+    m_start_area = tmp.m_start_area;
+    m_stop_area = tmp.m_stop_area;
+    m_alpha = tmp.m_alpha;
+    m_start_frames = tmp.m_start_frames;
+    m_stop_delay = tmp.m_stop_delay;
+    m_min_clip_duration = tmp.m_min_clip_duration;
+    if(tmp.m_window.size() != m_window.size()) {
+        m_window = std::move(tmp.m_window);
+        clear_window();
+    }
+}
+
+bool MotionTrigger::is_active() const
+{
+    return m_active;
+}
+
+double MotionTrigger::smoothed_area() const
+{
+    return m_average;
+}
+
+void MotionTrigger::clear_window()
+{
+    std::fill(m_window.begin(), m_window.end(), std::uint8_t{0});
+    m_window_pos = 0;
+    m_window_hits = 0;
+}
+} // namespace vehlwn
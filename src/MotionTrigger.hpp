@@ -0,0 +1,62 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "ApplicationSettings.hpp"
+
+namespace vehlwn {
+// Decides when to start and stop a recording from moving area of every frame.
+//
+// Moving area is smoothed with an exponential moving average. A recording starts
+// when start_frames of the last window_frames smoothed values reach
+// min_moving_area. It lasts while the smoothed value stays at or above
+// stop_moving_area and stops delta_without_motion seconds after it drops, but
+// not earlier than min_clip_duration seconds after the start. Lower stop
+// threshold and N-of-M start suppress single frame spikes and flapping near the
+// threshold which produce many tiny files.
+class MotionTrigger {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    enum class Event {
+        None,
+        Start,
+        Stop,
+    };
+
+    explicit MotionTrigger(const ApplicationSettings::Segmentation& config);
+
+    // Feeds moving area of the next frame captured at the given time
+    Event update(Clock::time_point now, int moving_area);
+    // Applies new thresholds keeping the smoothed area and the state, so an
+    // active recording is not interrupted. The start window is cleared if its
+    // size changes.
+    void reconfigure(const ApplicationSettings::Segmentation& config);
+
+    [[nodiscard]] bool is_active() const;
+    [[nodiscard]] double smoothed_area() const;
+
+private:
+    int m_start_area;
+    int m_stop_area;
+    double m_alpha;
+    int m_start_frames;
+    Clock::duration m_stop_delay;
+    Clock::duration m_min_clip_duration;
+
+    bool m_active = false;
+    bool m_has_average = false;
+    double m_average = 0.;
+    // Ring buffer of the last window_frames comparisons with start threshold
+    std::vector<std::uint8_t> m_window;
+    std::size_t m_window_pos = 0;
+    int m_window_hits = 0;
+    Clock::time_point m_start_time;
+    Clock::time_point m_last_motion_time;
+
+    void clear_window();
+};
+} // namespace vehlwn
@@ -0,0 +1,225 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "BoundedQueue.hpp"
+
+namespace vehlwn {
+// Metrics of one pipeline stage since start
+struct PipelineStageStats {
+    std::string name;
+    std::uint64_t items = 0;
+    // Time spent processing items
+    std::chrono::nanoseconds busy_time{0};
+    // Time spent waiting for an item from the previous stage
+    std::chrono::nanoseconds input_wait_time{0};
+    // Time spent waiting for free space in the queue of the next stage
+    std::chrono::nanoseconds output_wait_time{0};
+    // Items waiting in the input queue of the stage
+    std::size_t queued = 0;
+    std::size_t queue_capacity = 0;
+};
+
+inline std::ostream& operator<<(std::ostream& os, const PipelineStageStats& x)
+{
+    using Millis = std::chrono::duration<double, std::milli>;
+    const auto total = x.busy_time + x.input_wait_time + x.output_wait_time;
+    const auto share = [&](const std::chrono::nanoseconds t) {
+        return total.count() == 0
+            ? 0.0
+            : static_cast<double>(t.count()) / static_cast<double>(total.count());
+    };
+    const auto avg_busy_time = x.items == 0
+        ? Millis(0)
+        : Millis(x.busy_time) / static_cast<double>(x.items);
+    os << x.name << ": items = " << x.items
+       << ", occupancy = " << share(x.busy_time)
+       << ", input_wait = " << share(x.input_wait_time)
+       << ", output_wait = " << share(x.output_wait_time)
+       << ", avg_busy_ms = " << avg_busy_time.count() << ", queued = " << x.queued
+       << "/" << x.queue_capacity;
+    return os;
+}
+
+// Runs stages of processing on separate threads connected with bounded queues.
+// Stage k processes item n while stage k - 1 processes item n + 1. Every stage
+// has one thread, so items pass every stage in the order in which the first
+// stage produced them and stages may keep state between items.
+template<class T>
+class Pipeline {
+public:
+    using Clock = std::chrono::steady_clock;
+    // Stages modify the item in place. The first stage gets a default
+    // constructed item and fills it, e.g. from an input device.
+    using Stage = std::function<void(T&)>;
+    // Called on the stage thread if a stage throws, the pipeline is not stopped
+    // automatically
+    using ErrorHandler = std::function<void(const std::exception&)>;
+    // Called on the stage thread after a stage processed an item, e.g. to trace
+    // the item
+    using StageObserver = std::function<void(
+        std::string_view stage_name,
+        const T& item,
+        Clock::time_point begin,
+        Clock::time_point end)>;
+
+    Pipeline(const std::size_t queue_capacity, ErrorHandler&& on_error)
+        : m_queue_capacity{queue_capacity}
+        , m_on_error{std::move(on_error)}
+    {}
+    Pipeline(const Pipeline&) = delete;
+    Pipeline(Pipeline&&) = delete;
+    ~Pipeline()
+    {
+        stop();
+    }
+    Pipeline& operator=(const Pipeline&) = delete;
+    Pipeline& operator=(Pipeline&&) = delete;
+
+    // Must be called before start()
+    void add_stage(std::string name, Stage&& stage)
+    {
+        if(m_started) {
+            throw std::logic_error("Pipeline: add_stage after start");
+        }
+        auto state = std::make_unique<StageState>();
+        state->name = std::move(name);
+        state->stage = std::move(stage);
+        if(!m_stages.empty()) {
+            state->input = std::make_unique<BoundedQueue<T>>(m_queue_capacity);
+        }
+        m_stages.push_back(std::move(state));
+    }
+
+    // Must be called before start()
+    void set_stage_observer(StageObserver&& observer)
+    {
+        if(m_started) {
+            throw std::logic_error("Pipeline: set_stage_observer after start");
+        }
+        m_observer = std::move(observer);
+    }
+
+    void start()
+    {
+        if(m_started) {
+            throw std::logic_error("Pipeline: started twice");
+        }
+        m_started = true;
+        for(std::size_t i = 0; i < m_stages.size(); i++) {
+            m_stages[i]->thread = std::thread(&Pipeline::run_stage, this, i);
+        }
+    }
+
+    // Drops queued items and waits for the items being processed. The first
+    // stage is not interrupted, stop() waits for it to finish its item.
+    void stop()
+    {
+        m_stopped = true;
+        for(const auto& s : m_stages) {
+            if(s->input) {
+                s->input->close();
+            }
+        }
+        for(const auto& s : m_stages) {
+            if(s->thread.joinable()) {
+                s->thread.join();
+            }
+        }
+    }
+
+    [[nodiscard]] std::vector<PipelineStageStats> stats() const
+    {
+        auto ret = std::vector<PipelineStageStats>();
+        ret.reserve(m_stages.size());
+        for(const auto& s : m_stages) {
+            auto& x = ret.emplace_back();
+            x.name = s->name;
+            x.items = s->items;
+            x.busy_time = std::chrono::nanoseconds(s->busy_ns);
+            x.input_wait_time = std::chrono::nanoseconds(s->input_wait_ns);
+            x.output_wait_time = std::chrono::nanoseconds(s->output_wait_ns);
+            if(s->input) {
+                x.queued = s->input->size();
+                x.queue_capacity = s->input->capacity();
+            }
+        }
+        return ret;
+    }
+
+private:
+    struct StageState {
+        std::string name;
+        Stage stage;
+        // Null for the first stage
+        std::unique_ptr<BoundedQueue<T>> input;
+        std::atomic<std::uint64_t> items{0};
+        std::atomic<std::int64_t> busy_ns{0};
+        std::atomic<std::int64_t> input_wait_ns{0};
+        std::atomic<std::int64_t> output_wait_ns{0};
+        std::thread thread;
+    };
+
+    const std::size_t m_queue_capacity;
+    const ErrorHandler m_on_error;
+    StageObserver m_observer;
+    std::vector<std::unique_ptr<StageState>> m_stages;
+    bool m_started = false;
+    std::atomic_bool m_stopped{false};
+
+    void run_stage(const std::size_t index)
+    try {
+        auto& s = *m_stages[index];
+        auto* const output = index + 1 < m_stages.size()
+            ? m_stages[index + 1]->input.get()
+            : nullptr;
+        const auto elapsed_ns = [](const Clock::time_point from,
+                                   const Clock::time_point to) {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(to - from)
+                .count();
+        };
+        while(!m_stopped) {
+            const auto t0 = Clock::now();
+            auto item = std::optional<T>();
+            if(s.input) {
+                item = s.input->pop();
+                if(!item) {
+                    break;
+                }
+            } else {
+                item.emplace();
+            }
+            const auto t1 = Clock::now();
+            s.stage(*item);
+            const auto t2 = Clock::now();
+            if(m_observer) {
+                m_observer(s.name, *item, t1, t2);
+            }
+            if(output && !output->push(std::move(*item))) {
+                break;
+            }
+            const auto t3 = Clock::now();
+            s.input_wait_ns += elapsed_ns(t0, t1);
+            s.busy_ns += elapsed_ns(t1, t2);
+            s.output_wait_ns += elapsed_ns(t2, t3);
+            s.items++;
+        }
+    } catch(const std::exception& ex) {
+        m_on_error(ex);
+    }
+};
+} // namespace vehlwn
@@ -1,12 +1,17 @@
 #include "PreprocessImageFactory.hpp"
 
 #include <memory>
+#include <optional>
+#include <utility>
+#include <variant>
 
 #include <boost/log/attributes/named_scope.hpp>
 #include <boost/log/trivial.hpp>
 
 #include "ApplicationSettings.hpp"
+#include "filters/ConstantTimeMedianFilter.hpp"
 #include "filters/ConvertToGrayFilter.hpp"
+#include "filters/FusedPreprocessFilter.hpp"
 #include "filters/GaussianBlurFilter.hpp"
 #include "filters/IdentityFilter.hpp"
 #include "filters/ImageFilterChain.hpp"
@@ -15,14 +20,55 @@
 #include "filters/ResizeFilter.hpp"
 
 namespace vehlwn {
+namespace {
+// Returns std::nullopt if the filter has no fused implementation
+std::optional<FusedPreprocessFilter::Smoothing> to_fused_smoothing(
+    const std::optional<ApplicationSettings::Preprocess::Smoothing>& smoothing)
+{
+    using Smoothing = ApplicationSettings::Preprocess::Smoothing;
+    if(!smoothing) {
+        return std::monostate();
+    }
+    const auto& algorithm = smoothing->algorithm;
+    if(const auto normalized = std::get_if<Smoothing::NormalizedBox>(&algorithm)) {
+        return FusedPreprocessFilter::NormalizedBox{normalized->kernel_size};
+    }
+    if(const auto gaus = std::get_if<Smoothing::Gaussian>(&algorithm)) {
+        return FusedPreprocessFilter::Gaussian{gaus->kernel_size, gaus->sigma};
+    }
+    if(const auto median = std::get_if<Smoothing::ConstantTimeMedian>(&algorithm)) {
+        return FusedPreprocessFilter::ConstantTimeMedian{median->kernel_size};
+    }
+    return std::nullopt;
+}
+} // namespace
+
 PreprocessImageFactory::PreprocessImageFactory(
-    const ApplicationSettings::Preprocess& config)
+    const ApplicationSettings::Preprocess& config,
+    std::shared_ptr<ThreadPool> thread_pool)
     : m_config{config}
+    , m_thread_pool{std::move(thread_pool)}
 {}
 
 std::shared_ptr<IImageFilter> PreprocessImageFactory::create()
 {
     BOOST_LOG_FUNCTION();
+    // Common combinations are fused into a single pass over the frame which is
+    // also split into row bands for the thread pool
+    if(m_config.convert_to_gray || m_config.resize_factor || m_thread_pool) {
+        if(auto smoothing = to_fused_smoothing(m_config.smoothing)) {
+            auto ret = std::make_shared<FusedPreprocessFilter>(
+                m_config.convert_to_gray,
+                m_config.resize_factor,
+                std::move(*smoothing),
+                m_thread_pool);
+            if(!ret->is_fused()) {
+                BOOST_LOG_TRIVIAL(info) << "resize_factor is not 1/k, "
+                                           "preprocessing frames in one piece";
+            }
+            return ret;
+        }
+    }
     auto ret = std::make_shared<ImageFilterChain>();
     if(m_config.convert_to_gray) {
         ret->add_filter(std::make_shared<ConvertToGrayFilter>());
@@ -44,6 +90,10 @@ std::shared_ptr<IImageFilter> PreprocessImageFactory::create()
                 gaus->sigma));
         } else if(const auto median = std::get_if<Smoothing::Median>(&algorithm)) {
             ret->add_filter(std::make_shared<MedianFilter>(median->kernel_size));
+        } else if(const auto median_ct
+                  = std::get_if<Smoothing::ConstantTimeMedian>(&algorithm)) {
+            ret->add_filter(std::make_shared<ConstantTimeMedianFilter>(
+                median_ct->kernel_size));
         } else {
             BOOST_LOG_TRIVIAL(fatal) << "Unreachable!";
             std::exit(1);
@@ -3,15 +3,20 @@
 #include <memory>
 
 #include "ApplicationSettings.hpp"
+#include "ThreadPool.hpp"
 #include "filters/IImageFilter.hpp"
 
 namespace vehlwn {
 class PreprocessImageFactory {
 public:
-    explicit PreprocessImageFactory(const ApplicationSettings::Preprocess& config);
+    // thread_pool can be null to process frames on the worker thread
+    PreprocessImageFactory(
+        const ApplicationSettings::Preprocess& config,
+        std::shared_ptr<ThreadPool> thread_pool);
     std::shared_ptr<IImageFilter> create();
 
 private:
-    const ApplicationSettings::Preprocess& m_config;
+    ApplicationSettings::Preprocess m_config;
+    std::shared_ptr<ThreadPool> m_thread_pool;
 };
 } // namespace vehlwn
@@ -0,0 +1,289 @@
+#include "RecordingIndex.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <boost/log/attributes/named_scope.hpp>
+#include <boost/log/trivial.hpp>
+
+namespace vehlwn {
+namespace {
+constexpr auto INDEX_FILE_NAME = "recordings.idx";
+constexpr auto FIRST_ID_FILE_NAME = "recordings.idx.first";
+
+constexpr std::uint32_t HAS_THUMBNAIL = 1U;
+constexpr std::uint32_t HAS_SPRITE = 2U;
+
+// On-disk record in host byte order. Times are microseconds since Unix epoch.
+struct DiskRecord {
+    std::int64_t start_time_us;
+    std::int64_t end_time_us;
+    std::uint64_t size;
+    std::int64_t thumbnail_offset_us;
+    std::int32_t peak_moving_area;
+    // HAS_THUMBNAIL | HAS_SPRITE
+    std::uint32_t flags;
+    // Taken from the zero padding of path, so older records have no sprite
+    std::uint16_t sprite_tile_width;
+    std::uint16_t sprite_tile_height;
+    std::uint16_t sprite_columns;
+    std::uint16_t sprite_count;
+    std::uint32_t sprite_interval_ms;
+    std::uint32_t reserved;
+    std::array<char, 200> path;
+};
+static_assert(sizeof(DiskRecord) == 256);
+
+std::int64_t to_us(const std::chrono::system_clock::time_point t)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               t.time_since_epoch())
+        .count();
+}
+
+std::chrono::system_clock::time_point from_us(const std::int64_t us)
+{
+    return std::chrono::system_clock::time_point(
+        std::chrono::duration_cast<std::chrono::system_clock::duration>(
+            std::chrono::microseconds(us)));
+}
+
+RecordingIndex::Entry to_entry(const DiskRecord& record, const std::uint64_t id)
+{
+    auto ret = RecordingIndex::Entry();
+    ret.id = id;
+    ret.start_time = from_us(record.start_time_us);
+    ret.end_time = from_us(record.end_time_us);
+    ret.size = record.size;
+    ret.peak_moving_area = record.peak_moving_area;
+    ret.thumbnail_offset = std::chrono::microseconds(record.thumbnail_offset_us);
+    ret.has_thumbnail = (record.flags & HAS_THUMBNAIL) != 0U;
+    if((record.flags & HAS_SPRITE) != 0U) {
+        ret.sprite = ffmpeg::SpriteSheet{
+            .tile_width = record.sprite_tile_width,
+            .tile_height = record.sprite_tile_height,
+            .columns = record.sprite_columns,
+            .count = record.sprite_count,
+            .interval = std::chrono::milliseconds(record.sprite_interval_ms),
+        };
+    }
+    const auto* const end = std::find(record.path.begin(), record.path.end(), '\0');
+    ret.path.assign(record.path.begin(), end);
+    return ret;
+}
+
+std::system_error last_system_error(const std::string& what)
+{
+    return {errno, std::generic_category(), what};
+}
+} // namespace
+
+RecordingIndex::RecordingIndex(std::filesystem::path prefix)
+    : m_prefix(std::move(prefix))
+    , m_index_path(m_prefix / INDEX_FILE_NAME)
+{
+    BOOST_LOG_FUNCTION();
+    if(!m_prefix.empty()) {
+        // Errors are reported by open() below
+        auto ec = std::error_code();
+        std::filesystem::create_directories(m_prefix, ec);
+    }
+    m_fd = ::open(
+        m_index_path.c_str(),
+        O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC,
+        0666);
+    if(m_fd == -1) {
+        throw last_system_error("Failed to open " + m_index_path.string());
+    }
+    const auto first_id_path = m_prefix / FIRST_ID_FILE_NAME;
+    m_first_id_fd
+        = ::open(first_id_path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0666);
+    if(m_first_id_fd == -1) {
+        const auto error
+            = last_system_error("Failed to open " + first_id_path.string());
+        ::close(m_fd);
+        throw error;
+    }
+    try {
+        load();
+    } catch(...) {
+        ::close(m_fd);
+        ::close(m_first_id_fd);
+        throw;
+    }
+    BOOST_LOG_TRIVIAL(info) << "Loaded " << m_entries.size()
+                            << " recordings from " << m_index_path;
+}
+
+RecordingIndex::~RecordingIndex()
+{
+    ::close(m_fd);
+    ::close(m_first_id_fd);
+}
+
+void RecordingIndex::load()
+{
+    struct stat st {};
+    if(::fstat(m_fd, &st) != 0) {
+        throw last_system_error("fstat failed");
+    }
+    const auto count = static_cast<std::size_t>(st.st_size) / sizeof(DiskRecord);
+    const auto valid_size = static_cast<off_t>(count * sizeof(DiskRecord));
+    if(valid_size != st.st_size) {
+        // Torn write of the last record
+        BOOST_LOG_TRIVIAL(warning)
+            << "Truncating partial record at the end of " << m_index_path;
+        if(::ftruncate(m_fd, valid_size) != 0) {
+            throw last_system_error("ftruncate failed");
+        }
+    }
+    std::uint64_t first_id = 0;
+    const auto read_bytes
+        = ::pread(m_first_id_fd, &first_id, sizeof(first_id), 0);
+    if(read_bytes == static_cast<ssize_t>(sizeof(first_id))) {
+        m_first_id = std::min<std::uint64_t>(first_id, count);
+    } else if(read_bytes != 0) {
+        BOOST_LOG_TRIVIAL(warning) << "Ignoring broken " << FIRST_ID_FILE_NAME;
+    }
+
+    constexpr std::size_t BATCH = 4096;
+    auto buf = std::vector<DiskRecord>(std::min(count, BATCH));
+    auto done = static_cast<std::size_t>(m_first_id);
+    while(done < count) {
+        const auto n = std::min(count - done, BATCH);
+        const auto bytes = n * sizeof(DiskRecord);
+        const auto offset = static_cast<off_t>(done * sizeof(DiskRecord));
+        if(::pread(m_fd, buf.data(), bytes, offset)
+           != static_cast<ssize_t>(bytes)) {
+            throw last_system_error("Failed to read " + m_index_path.string());
+        }
+        for(std::size_t i = 0; i < n; i++) {
+            m_entries.push_back(to_entry(buf[i], done + i));
+            m_total_bytes += buf[i].size;
+        }
+        done += n;
+    }
+}
+
+void RecordingIndex::append(const ffmpeg::RecordingInfo& info)
+{
+    BOOST_LOG_FUNCTION();
+    auto record = DiskRecord();
+    record.start_time_us = to_us(info.start_time);
+    record.end_time_us = to_us(info.end_time);
+    record.size = info.size;
+    record.thumbnail_offset_us = info.peak_offset.count();
+    record.peak_moving_area = info.peak_moving_area;
+    record.flags = 0;
+    if(info.has_thumbnail) {
+        record.flags |= HAS_THUMBNAIL;
+    }
+    if(const auto& sprite = info.sprite) {
+        record.flags |= HAS_SPRITE;
+        record.sprite_tile_width = static_cast<std::uint16_t>(sprite->tile_width);
+        record.sprite_tile_height = static_cast<std::uint16_t>(sprite->tile_height);
+        record.sprite_columns = static_cast<std::uint16_t>(sprite->columns);
+        record.sprite_count = static_cast<std::uint16_t>(sprite->count);
+        record.sprite_interval_ms
+            = static_cast<std::uint32_t>(sprite->interval.count());
+    }
+    const auto relative_path
+        = std::filesystem::path(info.path).lexically_relative(m_prefix).string();
+    if(relative_path.empty() || relative_path.size() >= record.path.size()) {
+        throw std::runtime_error(
+            "Cannot store path '" + info.path + "' in recording index");
+    }
+    std::copy(relative_path.begin(), relative_path.end(), record.path.begin());
+
+    const std::lock_guard lock(m_mutex);
+    // O_APPEND makes a single write of one record atomic for readers
+    if(::write(m_fd, &record, sizeof(record))
+       != static_cast<ssize_t>(sizeof(record))) {
+        throw last_system_error("Failed to append to " + m_index_path.string());
+    }
+    m_entries.push_back(to_entry(record, m_first_id + m_entries.size()));
+    m_total_bytes += record.size;
+    BOOST_LOG_TRIVIAL(debug) << "Indexed recording " << m_entries.back().id
+                             << " '" << relative_path << "'";
+}
+
+std::vector<RecordingIndex::Entry> RecordingIndex::find(
+    const std::chrono::system_clock::time_point from,
+    const std::chrono::system_clock::time_point to,
+    const std::size_t limit) const
+{
+    auto ret = std::vector<Entry>();
+    const std::lock_guard lock(m_mutex);
+    // Recordings do not overlap and are appended in the order they were closed
+    // even if closes finish out of order, so both start and end times are sorted.
+    auto it = std::partition_point(
+        m_entries.begin(),
+        m_entries.end(),
+        [&](const Entry& x) { return x.end_time < from; });
+    for(; it != m_entries.end() && it->start_time <= to && ret.size() < limit;
+        ++it) {
+        ret.push_back(*it);
+    }
+    return ret;
+}
+
+std::optional<RecordingIndex::Entry>
+    RecordingIndex::get(const std::uint64_t id) const
+{
+    const std::lock_guard lock(m_mutex);
+    if(id < m_first_id || id - m_first_id >= m_entries.size()) {
+        return std::nullopt;
+    }
+    return m_entries[id - m_first_id];
+}
+
+std::filesystem::path RecordingIndex::absolute_path(const Entry& entry) const
+{
+    return m_prefix / entry.path;
+}
+
+std::optional<RecordingIndex::Entry> RecordingIndex::oldest() const
+{
+    const std::lock_guard lock(m_mutex);
+    if(m_entries.empty()) {
+        return std::nullopt;
+    }
+    return m_entries.front();
+}
+
+void RecordingIndex::remove_oldest(const std::uint64_t id)
+{
+    const std::lock_guard lock(m_mutex);
+    if(m_entries.empty() || m_entries.front().id != id) {
+        return;
+    }
+    m_total_bytes -= m_entries.front().size;
+    m_entries.pop_front();
+    m_first_id++;
+    store_first_id();
+}
+
+std::uint64_t RecordingIndex::total_bytes() const
+{
+    const std::lock_guard lock(m_mutex);
+    return m_total_bytes;
+}
+
+void RecordingIndex::store_first_id() const
+{
+    if(::pwrite(m_first_id_fd, &m_first_id, sizeof(m_first_id), 0)
+       != static_cast<ssize_t>(sizeof(m_first_id))) {
+        // Evicted entries reappear after restart and are skipped as missing files
+        BOOST_LOG_TRIVIAL(error)
+            << "Failed to store first recording id: " << std::strerror(errno);
+    }
+}
+} // namespace vehlwn
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "ffmpeg_adapters/RecordingInfo.hpp"
+
+namespace vehlwn {
+// Append-only catalog of recorded files stored in prefix/recordings.idx as
+// fixed-size records. All entries are kept in memory sorted by time so range
+// queries do not touch the disk. Evicted recordings are always the oldest ones
+// so they are tracked by the id of the first live entry stored in
+// prefix/recordings.idx.first.
+class RecordingIndex {
+public:
+    struct Entry {
+        std::uint64_t id = 0;
+        std::chrono::system_clock::time_point start_time;
+        std::chrono::system_clock::time_point end_time;
+        std::uint64_t size = 0;
+        int peak_moving_area = 0;
+        std::chrono::microseconds thumbnail_offset{0};
+        bool has_thumbnail = false;
+        std::optional<ffmpeg::SpriteSheet> sprite;
+        // Relative to prefix
+        std::string path;
+    };
+
+    explicit RecordingIndex(std::filesystem::path prefix);
+    RecordingIndex(const RecordingIndex&) = delete;
+    RecordingIndex(RecordingIndex&&) = delete;
+    ~RecordingIndex();
+    RecordingIndex& operator=(const RecordingIndex&) = delete;
+    RecordingIndex& operator=(RecordingIndex&&) = delete;
+
+    void append(const ffmpeg::RecordingInfo& info);
+    // Returns at most limit recordings overlapping [from, to] in time order
+    [[nodiscard]] std::vector<Entry> find(
+        std::chrono::system_clock::time_point from,
+        std::chrono::system_clock::time_point to,
+        std::size_t limit) const;
+    [[nodiscard]] std::optional<Entry> get(std::uint64_t id) const;
+    [[nodiscard]] std::filesystem::path absolute_path(const Entry& entry) const;
+
+    [[nodiscard]] std::optional<Entry> oldest() const;
+    // Forgets the oldest entry if its id is equal to id
+    void remove_oldest(std::uint64_t id);
+    // Total size of live recordings
+    [[nodiscard]] std::uint64_t total_bytes() const;
+
+private:
+    std::filesystem::path m_prefix;
+    std::filesystem::path m_index_path;
+    int m_fd = -1;
+    int m_first_id_fd = -1;
+    mutable std::mutex m_mutex;
+    // Entry with id is at m_entries[id - m_first_id]
+    std::deque<Entry> m_entries;
+    std::uint64_t m_first_id = 0;
+    std::uint64_t m_total_bytes = 0;
+
+    void load();
+    void store_first_id() const;
+};
+} // namespace vehlwn
@@ -0,0 +1,170 @@
+#include "RetentionSweeper.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <exception>
+#include <limits>
+#include <system_error>
+
+#include <sys/resource.h>
+#include <sys/statvfs.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <boost/log/attributes/named_scope.hpp>
+#include <boost/log/trivial.hpp>
+
+#include "ffmpeg_adapters/RecordingInfo.hpp"
+#include "ffmpeg_adapters/Timeline.hpp"
+
+namespace vehlwn {
+namespace {
+void lower_current_thread_priority()
+{
+    const auto tid = static_cast<id_t>(::syscall(SYS_gettid));
+    // On Linux nice value and I/O priority are per thread
+    if(::setpriority(PRIO_PROCESS, tid, 19) != 0) {
+        BOOST_LOG_TRIVIAL(warning) << "setpriority failed: " << std::strerror(errno);
+    }
+    constexpr int IOPRIO_WHO_PROCESS = 1;
+    constexpr int IOPRIO_CLASS_IDLE = 3;
+    constexpr int IOPRIO_CLASS_SHIFT = 13;
+    if(::syscall(
+           SYS_ioprio_set,
+           IOPRIO_WHO_PROCESS,
+           tid,
+           IOPRIO_CLASS_IDLE << IOPRIO_CLASS_SHIFT)
+       != 0) {
+        BOOST_LOG_TRIVIAL(warning) << "ioprio_set failed: " << std::strerror(errno);
+    }
+}
+} // namespace
+
+RetentionSweeper::RetentionSweeper(
+    const ApplicationSettings::Retention& settings,
+    std::filesystem::path prefix,
+    std::shared_ptr<RecordingIndex> index)
+    : m_settings(settings)
+    , m_prefix(std::move(prefix))
+    , m_index(std::move(index))
+    , m_thread(&RetentionSweeper::thread_func, this)
+{}
+
+RetentionSweeper::~RetentionSweeper()
+{
+    {
+        const std::lock_guard lock(m_mutex);
+        m_stopped = true;
+    }
+    m_cv.notify_one();
+    m_thread.join();
+}
+
+void RetentionSweeper::notify()
+{
+    {
+        const std::lock_guard lock(m_mutex);
+        m_notified = true;
+    }
+    m_cv.notify_one();
+}
+
+void RetentionSweeper::thread_func()
+try {
+    BOOST_LOG_FUNCTION();
+    lower_current_thread_priority();
+    const auto interval = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::duration<double>(m_settings.check_interval));
+    while(true) {
+        try {
+            sweep();
+        } catch(const std::exception& ex) {
+            BOOST_LOG_TRIVIAL(error) << "Retention sweep failed: " << ex.what();
+        }
+        std::unique_lock lock(m_mutex);
+        m_cv.wait_for(lock, interval, [&] { return m_notified || m_stopped; });
+        if(m_stopped) {
+            break;
+        }
+        m_notified = false;
+    }
+} catch(const std::exception& ex) {
+    BOOST_LOG_TRIVIAL(fatal) << "RetentionSweeper::thread_func: " << ex.what();
+}
+
+void RetentionSweeper::sweep()
+{
+    const auto now = std::chrono::system_clock::now();
+    const auto min_end_time = [&] {
+        if(m_settings.max_age_days) {
+            return now
+                - std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                       std::chrono::duration<double, std::ratio<86400>>(
+                           *m_settings.max_age_days));
+        }
+        return std::chrono::system_clock::time_point::min();
+    }();
+    while(const auto oldest = m_index->oldest()) {
+        if(oldest->end_time >= min_end_time && !needs_headroom()) {
+            break;
+        }
+        evict(*oldest);
+    }
+}
+
+bool RetentionSweeper::needs_headroom() const
+{
+    const auto reserve = m_settings.reserve_bytes;
+    const auto& max_bytes = m_settings.max_bytes;
+    if(max_bytes && m_index->total_bytes() + reserve > *max_bytes) {
+        return true;
+    }
+    return free_bytes() < reserve;
+}
+
+std::uint64_t RetentionSweeper::free_bytes() const
+{
+    struct statvfs st {};
+    const auto path = m_prefix.empty() ? std::filesystem::path(".") : m_prefix;
+    if(::statvfs(path.c_str(), &st) != 0) {
+        BOOST_LOG_TRIVIAL(error) << "statvfs failed: " << std::strerror(errno);
+        // Do not delete anything because of unknown free space
+        return std::numeric_limits<std::uint64_t>::max();
+    }
+    return static_cast<std::uint64_t>(st.f_bavail) * st.f_frsize;
+}
+
+void RetentionSweeper::evict(const RecordingIndex::Entry& entry)
+{
+    const auto path = m_index->absolute_path(entry);
+    auto ec = std::error_code();
+    if(std::filesystem::remove(path, ec)) {
+        BOOST_LOG_TRIVIAL(info) << "Retention: deleted " << path;
+    } else if(ec) {
+        BOOST_LOG_TRIVIAL(error)
+            << "Retention: failed to delete " << path << ": " << ec.message();
+    }
+    for(const auto* const extension :
+        {ffmpeg::TIMELINE_EXTENSION,
+         ffmpeg::PREVIEW_EXTENSION,
+         ffmpeg::THUMBNAIL_EXTENSION,
+         ffmpeg::SPRITE_EXTENSION}) {
+        auto sidecar_path = path;
+        sidecar_path += extension;
+        std::filesystem::remove(sidecar_path, ec);
+    }
+    // Forget the entry anyway so that one broken file does not stop the sweeper
+    m_index->remove_oldest(entry.id);
+
+    // Remove the date folder when its last recording is deleted
+    const auto folder = path.parent_path();
+    const auto prefix = m_prefix.empty() ? std::filesystem::path(".") : m_prefix;
+    if(folder.empty() || std::filesystem::equivalent(folder, prefix, ec)
+       || !std::filesystem::is_empty(folder, ec) || ec) {
+        return;
+    }
+    if(std::filesystem::remove(folder, ec)) {
+        BOOST_LOG_TRIVIAL(info) << "Retention: deleted folder " << folder;
+    }
+}
+} // namespace vehlwn
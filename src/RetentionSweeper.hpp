@@ -0,0 +1,49 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "ApplicationSettings.hpp"
+#include "RecordingIndex.hpp"
+
+namespace vehlwn {
+// Deletes the oldest recordings known to RecordingIndex to keep total size, age
+// and free disk space within ApplicationSettings::Retention limits.
+class RetentionSweeper {
+public:
+    RetentionSweeper(
+        const ApplicationSettings::Retention& settings,
+        std::filesystem::path prefix,
+        std::shared_ptr<RecordingIndex> index);
+    RetentionSweeper(const RetentionSweeper&) = delete;
+    RetentionSweeper(RetentionSweeper&&) = delete;
+    ~RetentionSweeper();
+    RetentionSweeper& operator=(const RetentionSweeper&) = delete;
+    RetentionSweeper& operator=(RetentionSweeper&&) = delete;
+
+    // Wakes up the background thread, e.g. after a new recording was indexed or
+    // when a new one has started and may need room. Does not block the caller.
+    void notify();
+
+private:
+    ApplicationSettings::Retention m_settings;
+    std::filesystem::path m_prefix;
+    std::shared_ptr<RecordingIndex> m_index;
+
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    bool m_notified = false;
+    bool m_stopped = false;
+    std::thread m_thread;
+
+    void thread_func();
+    void sweep();
+    [[nodiscard]] bool needs_headroom() const;
+    [[nodiscard]] std::uint64_t free_bytes() const;
+    void evict(const RecordingIndex::Entry& entry);
+};
+} // namespace vehlwn
@@ -0,0 +1,292 @@
+#include "RleMask.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+namespace vehlwn {
+namespace {
+void append_le(std::vector<std::uint8_t>& out, std::uint32_t value, int bytes)
+{
+    for(int i = 0; i < bytes; i++) {
+        out.push_back(static_cast<std::uint8_t>(value & 0xFFU));
+        value >>= 8U;
+    }
+}
+
+// Appends runs of a row of bits packed by RleMask::pack()
+void decode_packed_row(
+    const std::uint8_t* const bits,
+    const int cols,
+    std::vector<RleMask::Run>& out)
+{
+    const auto bit = [&](const int x) {
+        const auto byte = bits[static_cast<unsigned>(x) / 8U];
+        return ((byte >> (static_cast<unsigned>(x) % 8U)) & 1U) != 0U;
+    };
+    int x = 0;
+    while(x < cols) {
+        // Skip empty bytes at once
+        if(x % 8 == 0 && bits[x / 8] == 0) {
+            x += 8;
+            continue;
+        }
+        if(!bit(x)) {
+            x++;
+            continue;
+        }
+        const int begin = x;
+        while(x < cols && bit(x)) {
+            x++;
+        }
+        out.push_back(RleMask::Run{
+            static_cast<std::uint16_t>(begin),
+            static_cast<std::uint16_t>(x)});
+    }
+}
+} // namespace
+
+RleMask::RleMask(const cv::Mat& mask)
+{
+    assign(mask);
+}
+
+void RleMask::assign(const cv::Mat& mask)
+{
+    if(mask.type() != CV_8UC1) {
+        throw std::runtime_error("RleMask: expected CV_8UC1 mask");
+    }
+    if(mask.cols > std::numeric_limits<std::uint16_t>::max()) {
+        throw std::runtime_error(
+            "RleMask: mask is too wide: " + std::to_string(mask.cols));
+    }
+    m_width = mask.cols;
+    m_height = mask.rows;
+    m_area = 0;
+    m_packed = false;
+    m_bits.clear();
+    m_runs.clear();
+    m_row_offsets.clear();
+    m_row_offsets.reserve(static_cast<std::size_t>(m_height) + 1);
+    m_row_offsets.push_back(0);
+    const int cols = m_width;
+    // Runs of 4 bytes take more than 1/8 of the mask beyond this
+    const auto max_runs
+        = static_cast<std::size_t>(m_height) * static_cast<std::size_t>(cols) / 32;
+    for(int y = 0; y < m_height; y++) {
+        if(m_runs.size() > max_runs) {
+            pack(mask);
+            return;
+        }
+        const auto* const row = mask.ptr<std::uint8_t>(y);
+        int x = 0;
+        while(x < cols) {
+            // Skip empty background 8 pixels at a time
+            while(x + 8 <= cols) {
+                std::uint64_t word = 0;
+                std::memcpy(&word, row + x, sizeof(word));
+                if(word != 0) {
+                    break;
+                }
+                x += 8;
+            }
+            while(x < cols && row[x] == 0) {
+                x++;
+            }
+            if(x == cols) {
+                break;
+            }
+            const int begin = x;
+            while(x < cols && row[x] != 0) {
+                x++;
+            }
+            m_runs.push_back(Run{
+                static_cast<std::uint16_t>(begin),
+                static_cast<std::uint16_t>(x)});
+            m_area += x - begin;
+        }
+        m_row_offsets.push_back(static_cast<std::uint32_t>(m_runs.size()));
+    }
+    if(m_runs.size() > max_runs) {
+        pack(mask);
+        return;
+    }
+    m_run_count = m_runs.size();
+}
+
+void RleMask::pack(const cv::Mat& mask)
+{
+    m_packed = true;
+    // Runs of the noisy mask would be larger
+    m_runs = std::vector<Run>();
+    m_row_offsets = std::vector<std::uint32_t>();
+    const auto stride = packed_stride();
+    m_bits.assign(static_cast<std::size_t>(m_height) * stride, 0);
+    m_area = 0;
+    m_run_count = 0;
+    for(int y = 0; y < m_height; y++) {
+        const auto* const row = mask.ptr<std::uint8_t>(y);
+        auto* const bits = m_bits.data() + static_cast<std::size_t>(y) * stride;
+        bool previous = false;
+        for(int x = 0; x < m_width; x++) {
+            const bool current = row[x] != 0;
+            if(current) {
+                const auto ux = static_cast<unsigned>(x);
+                bits[ux / 8U] = static_cast<std::uint8_t>(
+                    bits[ux / 8U] | (1U << (ux % 8U)));
+                m_area++;
+                if(!previous) {
+                    m_run_count++;
+                }
+            }
+            previous = current;
+        }
+    }
+}
+
+std::size_t RleMask::packed_stride() const
+{
+    return (static_cast<std::size_t>(m_width) + 7) / 8;
+}
+
+int RleMask::width() const
+{
+    return m_width;
+}
+
+int RleMask::height() const
+{
+    return m_height;
+}
+
+bool RleMask::empty() const
+{
+    return m_width == 0 || m_height == 0;
+}
+
+bool RleMask::packed() const
+{
+    return m_packed;
+}
+
+boost::span<const RleMask::Run>
+    RleMask::row(const int y, std::vector<Run>& buffer) const
+{
+    const auto uy = static_cast<std::size_t>(y);
+    if(m_packed) {
+        buffer.clear();
+        decode_packed_row(m_bits.data() + uy * packed_stride(), m_width, buffer);
+        return {buffer.data(), buffer.size()};
+    }
+    const auto begin = m_row_offsets[uy];
+    const auto end = m_row_offsets[uy + 1];
+    return {m_runs.data() + begin, end - begin};
+}
+
+std::size_t RleMask::run_count() const
+{
+    return m_run_count;
+}
+
+int RleMask::area() const
+{
+    return m_area;
+}
+
+void RleMask::coverage_grid(
+    const int cols,
+    const int rows,
+    const boost::span<std::uint8_t> out) const
+{
+    const auto cell_count = static_cast<std::size_t>(cols) * rows;
+    if(out.size() != cell_count) {
+        throw std::invalid_argument("RleMask::coverage_grid: wrong output size");
+    }
+    std::fill(out.begin(), out.end(), std::uint8_t{0});
+    if(empty()) {
+        return;
+    }
+    // Cell (r, c) covers pixels [col_edges[c], col_edges[c + 1]) of rows
+    // [row_edges[r], row_edges[r + 1])
+    const auto make_edges = [](const int cells, const int size) {
+        auto ret = std::vector<int>(static_cast<std::size_t>(cells) + 1);
+        for(int i = 0; i <= cells; i++) {
+            ret[static_cast<std::size_t>(i)] = i * size / cells;
+        }
+        return ret;
+    };
+    const auto col_edges = make_edges(cols, m_width);
+    const auto row_edges = make_edges(rows, m_height);
+    auto counts = std::vector<std::int64_t>(cell_count, 0);
+    auto buffer = std::vector<Run>();
+    auto r = std::size_t{0};
+    for(int y = 0; y < m_height; y++) {
+        while(row_edges[r + 1] <= y) {
+            r++;
+        }
+        auto* const row_counts = counts.data() + r * static_cast<std::size_t>(cols);
+        auto c = std::size_t{0};
+        for(const auto& run : row(y, buffer)) {
+            int x = run.begin;
+            while(x < run.end) {
+                while(col_edges[c + 1] <= x) {
+                    c++;
+                }
+                const int stop = std::min<int>(run.end, col_edges[c + 1]);
+                row_counts[c] += stop - x;
+                x = stop;
+            }
+        }
+    }
+    for(std::size_t i = 0; i < cell_count; i++) {
+        const auto rr = i / static_cast<std::size_t>(cols);
+        const auto cc = i % static_cast<std::size_t>(cols);
+        const auto cell_area
+            = std::int64_t{row_edges[rr + 1] - row_edges[rr]}
+            * (col_edges[cc + 1] - col_edges[cc]);
+        if(cell_area > 0) {
+            out[i] = static_cast<std::uint8_t>(counts[i] * 255 / cell_area);
+        }
+    }
+}
+
+std::size_t RleMask::memory_usage() const
+{
+    return m_runs.size() * sizeof(Run)
+        + m_row_offsets.size() * sizeof(std::uint32_t) + m_bits.size();
+}
+
+cv::Mat RleMask::to_mat() const
+{
+    auto ret = cv::Mat(m_height, m_width, CV_8UC1, cv::Scalar(0));
+    auto buffer = std::vector<Run>();
+    for(int y = 0; y < m_height; y++) {
+        auto* const out = ret.ptr<std::uint8_t>(y);
+        for(const auto& run : row(y, buffer)) {
+            std::memset(out + run.begin, 255, run.end - run.begin);
+        }
+    }
+    return ret;
+}
+
+std::vector<std::uint8_t> RleMask::serialize() const
+{
+    auto ret = std::vector<std::uint8_t>();
+    ret.reserve(8 + 2 * static_cast<std::size_t>(m_height) + 4 * m_run_count);
+    append_le(ret, static_cast<std::uint32_t>(m_width), 4);
+    append_le(ret, static_cast<std::uint32_t>(m_height), 4);
+    auto buffer = std::vector<Run>();
+    for(int y = 0; y < m_height; y++) {
+        const auto runs = row(y, buffer);
+        // A row cannot have more than 32768 runs because its width fits u16
+        append_le(ret, static_cast<std::uint32_t>(runs.size()), 2);
+        for(const auto& run : runs) {
+            append_le(ret, run.begin, 2);
+            append_le(ret, run.end, 2);
+        }
+    }
+    return ret;
+}
+} // namespace vehlwn
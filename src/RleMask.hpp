@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <boost/core/span.hpp>
+#include <opencv2/core/mat.hpp>
+
+namespace vehlwn {
+// Binary image stored as horizontal runs of foreground pixels. Motion masks are
+// mostly empty so this takes a small fraction of an 8-bit cv::Mat and the
+// foreground area and connected components are computed from runs directly.
+// Noisy masks whose runs would take more than 1/8 of an 8-bit cv::Mat are
+// stored as one bit per pixel instead and their runs are decoded on demand.
+class RleMask {
+public:
+    // Foreground pixels [begin, end) of a row
+    struct Run {
+        std::uint16_t begin;
+        std::uint16_t end;
+    };
+
+    RleMask() = default;
+    // Nonzero pixels of an 8-bit single channel mask are foreground
+    explicit RleMask(const cv::Mat& mask);
+    // Same as the constructor but reuses allocated memory unless the mask is
+    // bit-packed
+    void assign(const cv::Mat& mask);
+
+    [[nodiscard]] int width() const;
+    [[nodiscard]] int height() const;
+    [[nodiscard]] bool empty() const;
+    [[nodiscard]] bool packed() const;
+    // Runs of row y. Runs of a bit-packed mask are decoded into buffer which
+    // must outlive the result.
+    [[nodiscard]] boost::span<const Run> row(int y, std::vector<Run>& buffer) const;
+    // Number of runs of all rows
+    [[nodiscard]] std::size_t run_count() const;
+    // Number of foreground pixels
+    [[nodiscard]] int area() const;
+    // Splits the mask into a grid of cols x rows cells and writes the share of
+    // foreground pixels of every cell scaled to 0-255 in row-major order
+    void coverage_grid(int cols, int rows, boost::span<std::uint8_t> out) const;
+    // Approximate number of bytes used by runs or packed pixels
+    [[nodiscard]] std::size_t memory_usage() const;
+
+    // Returns 8-bit mask with 0 for background and 255 for foreground
+    [[nodiscard]] cv::Mat to_mat() const;
+    // Compact binary form, all numbers are little-endian:
+    // u32 width, u32 height, then for every row u16 number of runs followed by
+    // u16 begin and u16 end of each run.
+    [[nodiscard]] std::vector<std::uint8_t> serialize() const;
+
+private:
+    int m_width = 0;
+    int m_height = 0;
+    int m_area = 0;
+    std::size_t m_run_count = 0;
+    std::vector<Run> m_runs;
+    // Runs of row y are [m_row_offsets[y], m_row_offsets[y + 1])
+    std::vector<std::uint32_t> m_row_offsets;
+    // Pixels of a packed mask, row y starts at byte y * packed_stride(). Bit i
+    // of a byte is pixel 8 * byte + i of the row.
+    bool m_packed = false;
+    std::vector<std::uint8_t> m_bits;
+
+    [[nodiscard]] std::size_t packed_stride() const;
+    void pack(const cv::Mat& mask);
+};
+} // namespace vehlwn
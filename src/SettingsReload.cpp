@@ -0,0 +1,87 @@
+#include "SettingsReload.hpp"
+
+#include <utility>
+
+#include <boost/algorithm/string/join.hpp>
+
+namespace vehlwn {
+SettingsReload merge_reloaded_settings(
+    const ApplicationSettings& running,
+    ApplicationSettings reloaded)
+{
+    auto ret = SettingsReload{std::move(reloaded), {}, {}};
+    auto& s = ret.settings;
+    const auto keep_running
+        = [&](auto& field, const auto& running_field, const char* const name) {
+              if(field != running_field) {
+                  ret.ignored.emplace_back(name);
+                  field = running_field;
+              }
+          };
+    keep_running(s.video_capture, running.video_capture, "video_capture");
+    keep_running(
+        s.output_files.prefix,
+        running.output_files.prefix,
+        "output_files.prefix");
+    keep_running(
+        s.output_files.extension,
+        running.output_files.extension,
+        "output_files.extension");
+    keep_running(s.logging, running.logging, "logging");
+    keep_running(
+        s.segmentation.background_subtractor,
+        running.segmentation.background_subtractor,
+        "segmentation.background_subtractor");
+    keep_running(
+        s.preprocess.threads,
+        running.preprocess.threads,
+        "preprocess.threads");
+    keep_running(s.retention, running.retention, "retention");
+    keep_running(s.tracing, running.tracing, "tracing");
+    keep_running(s.api, running.api, "api");
+
+    const auto check
+        = [&](const auto& field, const auto& running_field, const char* const name) {
+              if(field != running_field) {
+                  ret.applied.emplace_back(name);
+              }
+          };
+    check(s.output_files, running.output_files, "output_files");
+    check(
+        s.segmentation.min_moving_area,
+        running.segmentation.min_moving_area,
+        "segmentation.min_moving_area");
+    check(
+        s.segmentation.delta_without_motion,
+        running.segmentation.delta_without_motion,
+        "segmentation.delta_without_motion");
+    check(
+        s.segmentation.trigger,
+        running.segmentation.trigger,
+        "segmentation.trigger");
+    check(s.segmentation.blobs, running.segmentation.blobs, "segmentation.blobs");
+    check(
+        s.preprocess.convert_to_gray,
+        running.preprocess.convert_to_gray,
+        "preprocess.convert_to_gray");
+    check(
+        s.preprocess.resize_factor,
+        running.preprocess.resize_factor,
+        "preprocess.resize_factor");
+    check(
+        s.preprocess.smoothing,
+        running.preprocess.smoothing,
+        "preprocess.smoothing");
+    return ret;
+}
+
+std::ostream& operator<<(std::ostream& os, const SettingsReload& x)
+{
+    const auto list = [](const std::vector<std::string>& names) {
+        return names.empty() ? std::string("none") : boost::join(names, ", ");
+    };
+    os << "applied: " << list(x.applied)
+       << "; ignored until restart: " << list(x.ignored);
+    return os;
+}
+} // namespace vehlwn
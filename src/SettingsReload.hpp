@@ -0,0 +1,28 @@
+#pragma once
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "ApplicationSettings.hpp"
+
+namespace vehlwn {
+// Settings reloaded from app.ini merged with the running ones
+struct SettingsReload {
+    // Reloaded settings where sections which need a restart keep running values
+    ApplicationSettings settings;
+    // Changed settings which are applied to the running process: trigger
+    // thresholds, blobs, preprocessing and encoding of the next recording
+    std::vector<std::string> applied;
+    // Changed settings which are ignored until restart: the input, the
+    // background subtractor, logging, file naming, retention, tracing and API
+    // workers
+    std::vector<std::string> ignored;
+};
+
+SettingsReload merge_reloaded_settings(
+    const ApplicationSettings& running,
+    ApplicationSettings reloaded);
+
+std::ostream& operator<<(std::ostream& os, const SettingsReload& x);
+} // namespace vehlwn
@@ -0,0 +1,116 @@
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <stdexcept>
+
+namespace vehlwn {
+struct ThreadPool::Loop {
+    const int n;
+    const std::function<void(int)>& f;
+    std::atomic<int> next{0};
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    int finished = 0;
+    std::exception_ptr error;
+
+    // Runs iterations until none is left. Entries of a finished loop may stay in
+    // the queue, then f is not touched because next is already past n.
+    void run()
+    {
+        for(int i = next++; i < n; i = next++) {
+            auto ex = std::exception_ptr();
+            try {
+                f(i);
+            } catch(...) {
+                ex = std::current_exception();
+            }
+            const auto lock = std::lock_guard(mutex);
+            if(ex && !error) {
+                error = ex;
+            }
+            if(++finished == n) {
+                cv.notify_all();
+            }
+        }
+    }
+};
+
+ThreadPool::ThreadPool(const int threads)
+{
+    if(threads <= 0) {
+        throw std::invalid_argument("ThreadPool: threads must be positive");
+    }
+    m_workers.reserve(static_cast<std::size_t>(threads - 1));
+    for(int i = 1; i < threads; i++) {
+        m_workers.emplace_back(&ThreadPool::thread_func, this);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        const auto lock = std::lock_guard(m_mutex);
+        m_stopped = true;
+    }
+    m_cv.notify_all();
+    for(auto& t : m_workers) {
+        t.join();
+    }
+}
+
+int ThreadPool::size() const
+{
+    return static_cast<int>(m_workers.size()) + 1;
+}
+
+void ThreadPool::parallel_for(const int n, const std::function<void(int)>& f)
+{
+    if(n <= 0) {
+        return;
+    }
+    if(n == 1 || m_workers.empty()) {
+        for(int i = 0; i < n; i++) {
+            f(i);
+        }
+        return;
+    }
+    const auto loop = std::make_shared<Loop>(n, f);
+    const auto helpers = std::min(static_cast<std::size_t>(n - 1), m_workers.size());
+    {
+        const auto lock = std::lock_guard(m_mutex);
+        m_queue.insert(m_queue.end(), helpers, loop);
+    }
+    if(helpers == 1) {
+        m_cv.notify_one();
+    } else {
+        m_cv.notify_all();
+    }
+    loop->run();
+    auto lock = std::unique_lock(loop->mutex);
+    loop->cv.wait(lock, [&] { return loop->finished == n; });
+    if(loop->error) {
+        std::rethrow_exception(loop->error);
+    }
+}
+
+void ThreadPool::thread_func()
+{
+    for(;;) {
+        auto loop = std::shared_ptr<Loop>();
+        {
+            auto lock = std::unique_lock(m_mutex);
+            m_cv.wait(lock, [&] { return m_stopped || !m_queue.empty(); });
+            if(m_stopped) {
+                return;
+            }
+            loop = std::move(m_queue.front());
+            m_queue.pop_front();
+        }
+        loop->run();
+    }
+}
+} // namespace vehlwn
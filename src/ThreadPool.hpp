@@ -0,0 +1,43 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace vehlwn {
+// Fixed set of threads running parallel loops. The pool may be shared by several
+// callers: iterations of a loop are taken by workers and by the calling thread
+// itself, so a loop finishes even when all workers are busy with other loops.
+class ThreadPool {
+public:
+    // Total number of threads including the caller, threads - 1 workers are
+    // started
+    explicit ThreadPool(int threads);
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool(ThreadPool&&) = delete;
+    ~ThreadPool();
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    ThreadPool& operator=(ThreadPool&&) = delete;
+
+    [[nodiscard]] int size() const;
+    // Calls f(i) for every i in [0, n) and waits for all calls. The first
+    // exception thrown by f is rethrown when all calls have finished.
+    void parallel_for(int n, const std::function<void(int)>& f);
+
+private:
+    struct Loop;
+
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    // Every entry asks one worker to help with a loop
+    std::deque<std::shared_ptr<Loop>> m_queue;
+    bool m_stopped = false;
+    std::vector<std::thread> m_workers;
+
+    void thread_func();
+};
+} // namespace vehlwn
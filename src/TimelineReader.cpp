@@ -0,0 +1,102 @@
+#include "TimelineReader.hpp"
+
+#include <cerrno>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace vehlwn {
+namespace {
+class ScopedFd {
+public:
+    explicit ScopedFd(const int fd)
+        : m_fd(fd)
+    {}
+    ScopedFd(const ScopedFd&) = delete;
+    ScopedFd(ScopedFd&&) = delete;
+    ~ScopedFd()
+    {
+        if(m_fd != -1) {
+            ::close(m_fd);
+        }
+    }
+    ScopedFd& operator=(const ScopedFd&) = delete;
+    ScopedFd& operator=(ScopedFd&&) = delete;
+
+    [[nodiscard]] int get() const
+    {
+        return m_fd;
+    }
+
+private:
+    int m_fd;
+};
+
+std::system_error last_system_error(const std::string& what)
+{
+    return {errno, std::generic_category(), what};
+}
+} // namespace
+
+TimelineReader::TimelineReader(const std::filesystem::path& path)
+{
+    const auto fd = ScopedFd(::open(path.c_str(), O_RDONLY | O_CLOEXEC));
+    if(fd.get() == -1) {
+        throw last_system_error("Failed to open " + path.string());
+    }
+    struct stat st {};
+    if(::fstat(fd.get(), &st) == -1) {
+        throw last_system_error("Failed to stat " + path.string());
+    }
+    m_size = static_cast<std::size_t>(st.st_size);
+    if(m_size < sizeof(ffmpeg::TimelineHeader)) {
+        throw std::runtime_error(path.string() + " is too short for a timeline");
+    }
+    m_data = ::mmap(nullptr, m_size, PROT_READ, MAP_SHARED, fd.get(), 0);
+    if(m_data == MAP_FAILED) {
+        m_data = nullptr;
+        throw last_system_error("Failed to mmap " + path.string());
+    }
+    const auto& h = header();
+    const auto error = [&]() -> const char* {
+        if(h.magic != ffmpeg::TIMELINE_MAGIC) {
+            return " is not a timeline";
+        }
+        if(h.version != ffmpeg::TIMELINE_VERSION
+           || h.record_size != sizeof(ffmpeg::TimelineRecord)
+           || h.grid_cols != ffmpeg::TIMELINE_GRID_COLS
+           || h.grid_rows != ffmpeg::TIMELINE_GRID_ROWS) {
+            return " has unsupported timeline version";
+        }
+        return nullptr;
+    }();
+    if(error != nullptr) {
+        ::munmap(m_data, m_size);
+        throw std::runtime_error(path.string() + error);
+    }
+}
+
+TimelineReader::~TimelineReader()
+{
+    ::munmap(m_data, m_size);
+}
+
+const ffmpeg::TimelineHeader& TimelineReader::header() const
+{
+    return *static_cast<const ffmpeg::TimelineHeader*>(m_data);
+}
+
+boost::span<const ffmpeg::TimelineRecord> TimelineReader::records() const
+{
+    const auto* const begin = reinterpret_cast<const ffmpeg::TimelineRecord*>(
+        static_cast<const char*>(m_data) + sizeof(ffmpeg::TimelineHeader));
+    const auto count = (m_size - sizeof(ffmpeg::TimelineHeader))
+        / sizeof(ffmpeg::TimelineRecord);
+    return {begin, count};
+}
+} // namespace vehlwn
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+
+#include <boost/core/span.hpp>
+
+#include "ffmpeg_adapters/Timeline.hpp"
+
+namespace vehlwn {
+// Read-only memory mapping of a motion timeline sidecar. A partially written
+// last record of a recording in progress is ignored.
+class TimelineReader {
+public:
+    // Throws std::system_error if the file can't be mapped and
+    // std::runtime_error if it is not a timeline of a supported version
+    explicit TimelineReader(const std::filesystem::path& path);
+    TimelineReader(const TimelineReader&) = delete;
+    TimelineReader(TimelineReader&&) = delete;
+    ~TimelineReader();
+    TimelineReader& operator=(const TimelineReader&) = delete;
+    TimelineReader& operator=(TimelineReader&&) = delete;
+
+    [[nodiscard]] const ffmpeg::TimelineHeader& header() const;
+    [[nodiscard]] boost::span<const ffmpeg::TimelineRecord> records() const;
+
+private:
+    void* m_data = nullptr;
+    std::size_t m_size = 0;
+};
+} // namespace vehlwn
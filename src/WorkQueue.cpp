@@ -0,0 +1,64 @@
+#include "WorkQueue.hpp"
+
+#include <exception>
+#include <stdexcept>
+#include <utility>
+
+#include <boost/log/trivial.hpp>
+
+namespace vehlwn {
+WorkQueue::WorkQueue(const int threads, const std::size_t capacity)
+    : m_queue{capacity}
+{
+    if(threads <= 0) {
+        throw std::invalid_argument("WorkQueue: threads must be positive");
+    }
+    m_workers.reserve(static_cast<std::size_t>(threads));
+    for(int i = 0; i < threads; i++) {
+        m_workers.emplace_back(&WorkQueue::thread_func, this);
+    }
+}
+
+WorkQueue::~WorkQueue()
+{
+    m_queue.close();
+    for(auto& t : m_workers) {
+        t.join();
+    }
+}
+
+bool WorkQueue::try_submit(Task&& task)
+{
+    if(m_queue.try_push(std::move(task))) {
+        return true;
+    }
+    m_rejected.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+std::size_t WorkQueue::queued() const
+{
+    return m_queue.size();
+}
+
+std::size_t WorkQueue::capacity() const
+{
+    return m_queue.capacity();
+}
+
+std::uint64_t WorkQueue::rejected() const
+{
+    return m_rejected.load(std::memory_order_relaxed);
+}
+
+void WorkQueue::thread_func()
+{
+    while(auto task = m_queue.pop()) {
+        try {
+            (*task)();
+        } catch(const std::exception& ex) {
+            BOOST_LOG_TRIVIAL(error) << "WorkQueue: task failed: " << ex.what();
+        }
+    }
+}
+} // namespace vehlwn
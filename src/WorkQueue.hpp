@@ -0,0 +1,44 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#include "BoundedQueue.hpp"
+
+namespace vehlwn {
+// Threads running independent tasks from a bounded queue. Unlike ThreadPool the
+// caller does not wait for the task, and a task is rejected instead of queued
+// when the queue is full so that callers can shed load.
+class WorkQueue {
+public:
+    using Task = std::function<void()>;
+
+    WorkQueue(int threads, std::size_t capacity);
+    WorkQueue(const WorkQueue&) = delete;
+    WorkQueue(WorkQueue&&) = delete;
+    // Waits for running tasks, queued tasks are dropped
+    ~WorkQueue();
+    WorkQueue& operator=(const WorkQueue&) = delete;
+    WorkQueue& operator=(WorkQueue&&) = delete;
+
+    // Returns false if the queue is full, the task is dropped then. Exceptions
+    // thrown by the task are logged.
+    [[nodiscard]] bool try_submit(Task&& task);
+
+    [[nodiscard]] std::size_t queued() const;
+    [[nodiscard]] std::size_t capacity() const;
+    // Number of tasks rejected by try_submit
+    [[nodiscard]] std::uint64_t rejected() const;
+
+private:
+    BoundedQueue<Task> m_queue;
+    std::atomic<std::uint64_t> m_rejected{0};
+    std::vector<std::thread> m_workers;
+
+    void thread_func();
+};
+} // namespace vehlwn
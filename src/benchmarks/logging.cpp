@@ -0,0 +1,172 @@
+// Measures logging overhead of a simulated per-frame call chain and the cost of
+// emitting one record with synchronous and asynchronous sinks. Built twice: with
+// HOT_PATH_LOGGING=0 and HOT_PATH_LOGGING=1.
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <streambuf>
+#include <thread>
+#include <string_view>
+
+#include <boost/log/attributes/named_scope.hpp>
+#include <boost/log/core/core.hpp>
+#include <boost/log/expressions.hpp>
+#include <boost/log/sinks/async_frontend.hpp>
+#include <boost/log/sinks/block_on_overflow.hpp>
+#include <boost/log/sinks/bounded_fifo_queue.hpp>
+#include <boost/log/sinks/sync_frontend.hpp>
+#include <boost/log/sinks/text_ostream_backend.hpp>
+#include <boost/log/trivial.hpp>
+#include <boost/smart_ptr/make_shared.hpp>
+
+#include "../HotPathLogging.hpp"
+
+namespace {
+using TextBackend = boost::log::sinks::text_ostream_backend;
+using SyncSink = boost::log::sinks::synchronous_sink<TextBackend>;
+using AsyncSink = boost::log::sinks::asynchronous_sink<
+    TextBackend,
+    boost::log::sinks::bounded_fifo_queue<
+        4096,
+        boost::log::sinks::block_on_overflow>>;
+
+constexpr int FRAMES = 1'000'000;
+// Records are emitted in bursts which fit into the asynchronous sink queue so the
+// measured time is what the logging thread pays for a record.
+constexpr int BURST = 1000;
+constexpr int BURSTS = 200;
+
+// Discards output but makes every flush as slow as a write to a busy terminal or
+// journald pipe.
+class SlowNullBuf : public std::streambuf {
+protected:
+    int_type overflow(const int_type ch) override
+    {
+        return traits_type::not_eof(ch);
+    }
+    std::streamsize xsputn(const char* /*s*/, const std::streamsize n) override
+    {
+        return n;
+    }
+    int sync() override
+    {
+        std::this_thread::sleep_for(std::chrono::microseconds(20));
+        return 0;
+    }
+};
+
+// Prevents the compiler from removing simulated work
+volatile std::int64_t g_sink = 0;
+
+std::int64_t calc_pts(const std::int64_t pts)
+{
+    HOT_PATH_LOG_FUNCTION();
+    HOT_PATH_LOG_TRACE() << "calc_pts: pts = " << pts;
+    return pts * 3 / 2;
+}
+
+std::int64_t encode_write_frame(const std::int64_t pts)
+{
+    HOT_PATH_LOG_FUNCTION();
+    return calc_pts(pts) + 1;
+}
+
+std::int64_t decode_packet(const std::int64_t pts)
+{
+    HOT_PATH_LOG_FUNCTION();
+    HOT_PATH_LOG_TRACE() << "frame: pts = " << pts;
+    return encode_write_frame(pts);
+}
+
+std::int64_t read_packet(const std::int64_t pts)
+{
+    HOT_PATH_LOG_FUNCTION();
+    HOT_PATH_LOG_TRACE() << "packet: pts = " << pts;
+    return pts;
+}
+
+void check_motion(const std::int64_t pts)
+{
+    HOT_PATH_LOG_FUNCTION();
+    g_sink = g_sink + pts;
+}
+
+template<class F>
+double ns_per_iteration(const int iterations, F&& f)
+{
+    const auto start = std::chrono::steady_clock::now();
+    for(int i = 0; i < iterations; i++) {
+        f(i);
+    }
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+}
+
+double frame_ns()
+{
+    return ns_per_iteration(FRAMES, [](const int i) {
+        const auto pts = read_packet(i);
+        check_motion(decode_packet(pts));
+    });
+}
+
+template<class Sink>
+double record_ns(const boost::shared_ptr<std::ostream>& stream)
+{
+    auto backend = boost::make_shared<TextBackend>();
+    backend->add_stream(stream);
+    backend->auto_flush(true);
+    auto core = boost::log::core::get();
+    auto sink = boost::make_shared<Sink>(backend);
+    sink->set_formatter(
+        boost::log::expressions::stream << boost::log::expressions::smessage);
+    core->add_sink(sink);
+    double total = 0;
+    for(int i = 0; i < BURSTS; i++) {
+        total += ns_per_iteration(BURST, [](const int j) {
+            BOOST_LOG_TRIVIAL(info) << "Benchmark record " << j;
+        });
+        sink->flush();
+    }
+    core->remove_sink(sink);
+    return total / BURSTS;
+}
+
+void print(const std::string_view name, const double ns)
+{
+    std::cout << name << ": " << ns << " ns\n";
+}
+} // namespace
+
+int main()
+{
+    auto core = boost::log::core::get();
+    core->add_global_attribute("Scope", boost::log::attributes::named_scope());
+
+    const boost::shared_ptr<std::ostream> null_stream
+        = boost::make_shared<std::ofstream>("/dev/null");
+    auto slow_buf = SlowNullBuf();
+    const auto slow_stream = boost::make_shared<std::ostream>(&slow_buf);
+
+    std::cout << "HOT_PATH_LOGGING = " << HOT_PATH_LOGGING << '\n';
+    core->set_filter(boost::log::trivial::severity >= boost::log::trivial::info);
+    print("frame, app_level = info", frame_ns());
+
+    auto backend = boost::make_shared<TextBackend>();
+    backend->add_stream(null_stream);
+    auto sink = boost::make_shared<SyncSink>(backend);
+    core->add_sink(sink);
+    core->set_filter(boost::log::trivial::severity >= boost::log::trivial::trace);
+    print("frame, app_level = trace, synchronous sink", frame_ns());
+    core->remove_sink(sink);
+
+    core->set_filter(boost::log::trivial::severity >= boost::log::trivial::info);
+    print("info record, /dev/null, sync sink", record_ns<SyncSink>(null_stream));
+    print("info record, /dev/null, async sink", record_ns<AsyncSink>(null_stream));
+    print("info record, slow stream, sync sink", record_ns<SyncSink>(slow_stream));
+    print("info record, slow stream, async sink", record_ns<AsyncSink>(slow_stream));
+    return EXIT_SUCCESS;
+}
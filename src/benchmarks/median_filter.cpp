@@ -0,0 +1,59 @@
+// Compares cv::medianBlur with ConstantTimeMedianFilter on a gray frame of the
+// default preprocessing config (1920x1080 with resize_factor = 0.5). Noise is the
+// worst case for both, a smooth frame is closer to a real camera.
+
+#include <chrono>
+#include <cstdlib>
+#include <initializer_list>
+#include <iostream>
+
+#include <opencv2/core.hpp>
+#include <opencv2/core/utility.hpp>
+#include <opencv2/imgproc.hpp>
+
+#include "../filters/ConstantTimeMedianFilter.hpp"
+
+namespace {
+constexpr int FRAMES = 30;
+
+template<class F>
+double ms_per_frame(F&& filter)
+{
+    // Warm up buffers and caches
+    filter();
+    const auto start = std::chrono::steady_clock::now();
+    for(int i = 0; i < FRAMES; i++) {
+        filter();
+    }
+    const auto total = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::milli>(total).count() / FRAMES;
+}
+
+void run(const char* const name, const cv::Mat& src, const int threads)
+{
+    cv::setNumThreads(threads);
+    std::cout << name << ", " << cv::getNumThreads() << " threads\n";
+    auto dst = cv::Mat();
+    for(const int k : {3, 5, 7, 11, 15, 21, 31}) {
+        auto median_ct = vehlwn::ConstantTimeMedianFilter(k);
+        std::cout << "  kernel " << k << ": cv::medianBlur "
+                  << ms_per_frame([&] { cv::medianBlur(src, dst, k); })
+                  << " ms, median_ct "
+                  << ms_per_frame([&] { median_ct.apply(src, dst); }) << " ms\n";
+    }
+}
+} // namespace
+
+int main()
+{
+    auto noise = cv::Mat(540, 960, CV_8UC1);
+    cv::randu(noise, cv::Scalar::all(0), cv::Scalar::all(256));
+    auto smooth = cv::Mat();
+    cv::GaussianBlur(noise, smooth, {0, 0}, 8.);
+    const int threads = cv::getNumThreads();
+    for(const int t : {1, threads}) {
+        run("noise", noise, t);
+        run("smooth", smooth, t);
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,85 @@
+// Compares ImageFilterChain of separate filters with FusedPreprocessFilter on the
+// default preprocessing config: gray, resize_factor = 0.5 and normalized box 11.
+// The fused filter is also run on row bands in a thread pool.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <initializer_list>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include <opencv2/core.hpp>
+
+#include "../filters/ConvertToGrayFilter.hpp"
+#include "../filters/FusedPreprocessFilter.hpp"
+#include "../filters/ImageFilterChain.hpp"
+#include "../filters/NormalizedBoxFilter.hpp"
+#include "../filters/ResizeFilter.hpp"
+#include "../ThreadPool.hpp"
+
+namespace {
+constexpr int FRAMES = 300;
+constexpr double RESIZE_FACTOR = 0.5;
+constexpr int KERNEL_SIZE = 11;
+
+double ms_per_frame(vehlwn::IImageFilter& filter, const cv::Mat& frame)
+{
+    // Warm up buffers and caches
+    filter.apply(vehlwn::CvMatRaiiAdapter(frame.clone()));
+    auto input = vehlwn::CvMatRaiiAdapter();
+    auto total = std::chrono::steady_clock::duration();
+    for(int i = 0; i < FRAMES; i++) {
+        // Copy of a decoded frame is made by the capture thread, not measured
+        input = vehlwn::CvMatRaiiAdapter(frame.clone());
+        const auto start = std::chrono::steady_clock::now();
+        const auto output = filter.apply(std::move(input));
+        total += std::chrono::steady_clock::now() - start;
+    }
+    return std::chrono::duration<double, std::milli>(total).count() / FRAMES;
+}
+
+void print(const std::string_view name, const double ms)
+{
+    std::cout << name << ": " << ms << " ms\n";
+}
+} // namespace
+
+int main()
+{
+    // The pipeline runs preprocessing on one thread
+    cv::setNumThreads(1);
+    const int threads
+        = static_cast<int>(std::max(2U, std::thread::hardware_concurrency()));
+    const auto pool = std::make_shared<vehlwn::ThreadPool>(threads);
+    for(const auto& size : {cv::Size(1920, 1080), cv::Size(1280, 720)}) {
+        auto frame = cv::Mat(size, CV_8UC3);
+        cv::randu(frame, cv::Scalar::all(0), cv::Scalar::all(256));
+
+        auto chain = vehlwn::ImageFilterChain();
+        chain.add_filter(std::make_shared<vehlwn::ConvertToGrayFilter>());
+        chain.add_filter(std::make_shared<vehlwn::ResizeFilter>(RESIZE_FACTOR));
+        chain.add_filter(std::make_shared<vehlwn::NormalizedBoxFilter>(KERNEL_SIZE));
+        auto fused = vehlwn::FusedPreprocessFilter(
+            true,
+            RESIZE_FACTOR,
+            vehlwn::FusedPreprocessFilter::NormalizedBox{KERNEL_SIZE});
+
+        auto fused_bands = vehlwn::FusedPreprocessFilter(
+            true,
+            RESIZE_FACTOR,
+            vehlwn::FusedPreprocessFilter::NormalizedBox{KERNEL_SIZE},
+            pool);
+
+        std::cout << size.width << 'x' << size.height << '\n';
+        print("  filter chain", ms_per_frame(chain, frame));
+        print("  fused", ms_per_frame(fused, frame));
+        print(
+            "  fused, " + std::to_string(threads) + " threads",
+            ms_per_frame(fused_bands, frame));
+    }
+    return EXIT_SUCCESS;
+}
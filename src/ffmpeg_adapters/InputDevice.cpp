@@ -1,5 +1,12 @@
 #include "InputDevice.hpp"
 
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <future>
 #include <iomanip>
 #include <iostream>
 #include <map>
@@ -9,6 +16,9 @@
 #include <sstream>
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
 
 extern "C" {
 #include <libavcodec/codec.h>
@@ -28,12 +38,19 @@ extern "C" {
 #include <boost/range/algorithm/find_if.hpp>
 #include <boost/range/algorithm/for_each.hpp>
 
+#include "../HotPathLogging.hpp"
 #include "../SharedMutex.hpp"
+#include "ProbeCache.hpp"
+#include "RecordingImages.hpp"
 #include "ScopedAvDictionary.hpp"
+#include "SyntheticScene.hpp"
 #include "detail/AVRationalOutput.hpp"
 #include "detail/AvError.hpp"
 #include "detail/AvFrameAdapters.hpp"
+#include "detail/BackgroundTasks.hpp"
 #include "detail/HardwareHelpers.hpp"
+#include "detail/InputStreamInfo.hpp"
+#include "detail/OrderedCallbacks.hpp"
 #include "detail/OutputFile.hpp"
 #include "detail/ScopedAvFormatInput.hpp"
 #include "detail/ScopedDecoderContext.hpp"
@@ -42,18 +59,56 @@ extern "C" {
 namespace vehlwn::ffmpeg {
 using DecoderContextsMap = std::map<int, detail::ScopedDecoderContext>;
 
+namespace {
+// Audio packets kept while not recording. About 170 ms of AAC at 48 kHz.
+constexpr std::size_t AUDIO_PREROLL_PACKETS = 8;
+} // namespace
+
 struct InputDevice::Impl {
     std::shared_ptr<const ApplicationSettings> settings;
     detail::ScopedAvFormatInput input_format_context;
     DecoderContextsMap decoder_contexts;
+    detail::InputStreamsInfo input_streams_info;
     SharedMutex<std::optional<detail::OutputFile>> output_file;
+    SharedMutex<std::optional<std::chrono::steady_clock::duration>>
+        last_start_latency;
+    std::shared_ptr<LatencyTracer> latency_tracer;
+
+    PathGenerator path_generator;
+    RecordingCallback recording_callback;
+    // Encodes images of recordings, replaced by the pool of the application
+    std::shared_ptr<JpegEncoderPool> jpeg_encoders
+        = std::make_shared<JpegEncoderPool>();
+    // Opened in advance to avoid encoder and muxer initialization delay when
+    // motion starts. Declared after all members used by background opening.
+    std::future<detail::OutputFile> standby_output_file;
+    // Stopped recordings flush encoders, drain and sync their files here, so
+    // packets are not held up by the output_file lock meanwhile
+    detail::BackgroundTasks closing_output_files;
+    // Recordings and segments closed concurrently reach the callback in the
+    // order they were closed
+    std::shared_ptr<detail::OrderedCallbacks> close_order
+        = std::make_shared<detail::OrderedCallbacks>();
 
     std::optional<detail::SwsPixelConverter> pixel_converter;
     std::queue<detail::OwningAvframe> video_frames_queue;
+    AVRational video_time_base{0, 1};
+    // Timestamp of the frame last returned by get_video_frame()
+    std::int64_t last_video_pts_us = 0;
+    std::optional<detail::ArrivalTime> last_video_arrival_time;
 
     std::optional<std::string> video_bitrate;
     std::optional<std::string> audio_bitrate;
 
+    // Audio is decoded only while recording. Packets skipped before are kept to
+    // prime the decoder or, if the stream is copied, are muxed ahead of the
+    // first live packet when recording starts.
+    struct AudioInput {
+        std::deque<detail::OwningAvPacket> preroll;
+        bool decoding = false;
+    };
+    std::map<int, AudioInput> audio_inputs;
+
     Impl(
         std::shared_ptr<const ApplicationSettings>&& settings,
         detail::ScopedAvFormatInput&& input_format_context_,
@@ -61,17 +116,76 @@ struct InputDevice::Impl {
         : settings(std::move(settings))
         , input_format_context(std::move(input_format_context_))
         , decoder_contexts(std::move(decoder_contexts_))
+        , input_streams_info(detail::make_input_streams_info(
+              decoder_contexts,
+              input_format_context.streams()))
+        , latency_tracer(std::make_shared<LatencyTracer>(
+              [&]() -> std::optional<LatencyTracer::Clock::duration> {
+                  if(const auto& tracing = this->settings->tracing) {
+                      return std::chrono::duration_cast<
+                          LatencyTracer::Clock::duration>(
+                          std::chrono::duration<double>(tracing->window_seconds));
+                  }
+                  return std::nullopt;
+              }()))
     {}
 
+    // Background opening captures this
+    Impl(const Impl&) = delete;
+    Impl(Impl&&) = delete;
+    Impl& operator=(const Impl&) = delete;
+    Impl& operator=(Impl&&) = delete;
+    ~Impl()
+    {
+        // Recordings are complete before the input is closed
+        closing_output_files.wait();
+    }
+
+    detail::OutputFile open_output_file(std::string&& path) const
+    {
+        return detail::open_output_file(
+            std::shared_ptr(settings),
+            std::move(path),
+            PathGenerator(path_generator),
+            input_streams_info,
+            latency_tracer);
+    }
+
+    void prepare_standby_output_file()
+    {
+        // Waits for a previous standby file if any
+        standby_output_file = std::async(std::launch::async, [this] {
+            BOOST_LOG_FUNCTION();
+            auto path = path_generator();
+            BOOST_LOG_TRIVIAL(debug) << "Opening standby file '" << path << "'";
+            return open_output_file(std::move(path));
+        });
+    }
+
+    detail::OutputFile take_standby_output_file()
+    {
+        if(standby_output_file.valid()) {
+            try {
+                return standby_output_file.get();
+            } catch(const std::exception& ex) {
+                BOOST_LOG_TRIVIAL(error)
+                    << "Failed to open standby file: " << ex.what();
+            }
+        }
+        return open_output_file(path_generator());
+    }
+
     detail::OwningAvPacket read_packet()
     {
-        BOOST_LOG_FUNCTION();
+        HOT_PATH_LOG_FUNCTION();
         while(true) {
             detail::OwningAvPacket ret = input_format_context.read_packet();
+            // Decoders pass it to frames made of this packet
+            ret.set_arrival_time(LatencyTracer::Clock::now());
             const int in_stream_index = ret.stream_index();
             // Ignoge all non video and non audio streams
             if(decoder_contexts.contains(in_stream_index)) {
-                BOOST_LOG_TRIVIAL(trace)
+                HOT_PATH_LOG_TRACE()
                     << "packet: stream = " << in_stream_index
                     << " pts = " << ret.pts() << " dts = " << ret.dts();
                 return ret;
@@ -79,6 +193,77 @@ struct InputDevice::Impl {
         }
     }
 
+    void process_packet(detail::OwningAvPacket&& packet)
+    {
+        const int in_stream_index = packet.stream_index();
+        if(decoder_contexts.at(in_stream_index).codec_type()
+           == AVMEDIA_TYPE_AUDIO) {
+            process_audio_packet(std::move(packet));
+        } else {
+            decode_packet_to_queue(packet);
+        }
+    }
+
+    void process_audio_packet(detail::OwningAvPacket&& packet)
+    {
+        HOT_PATH_LOG_FUNCTION();
+        const int in_stream_index = packet.stream_index();
+        auto& audio = audio_inputs[in_stream_index];
+        // Empty if not recording
+        const auto copied = [&]() -> std::optional<bool> {
+            const auto lock = output_file.read();
+            if(const auto& opt = *lock) {
+                return opt->copies_stream(in_stream_index);
+            }
+            return std::nullopt;
+        }();
+        if(!copied) {
+            audio.decoding = false;
+            audio.preroll.push_back(std::move(packet));
+            if(audio.preroll.size() > AUDIO_PREROLL_PACKETS) {
+                audio.preroll.pop_front();
+            }
+            return;
+        }
+        if(*copied) {
+            const auto lock = output_file.write();
+            if(auto& opt = *lock) {
+                // Lets players decode the first live packets cleanly
+                if(!audio.preroll.empty()) {
+                    opt->write_preroll(audio.preroll, packet, in_stream_index);
+                }
+                opt->write_packet(packet, in_stream_index);
+            }
+            audio.preroll.clear();
+            return;
+        }
+        if(!audio.decoding) {
+            prime_audio_decoder(in_stream_index, audio);
+        }
+        decode_packet_to_queue(packet);
+    }
+
+    // Codecs with overlapping frames like AAC need previous packets to decode
+    // the first one cleanly. Frames of the pre-roll are dropped because audio
+    // timestamps of a recording start from its first encoded frame.
+    void prime_audio_decoder(const int in_stream_index, AudioInput& audio)
+    {
+        const auto& decoder_context = decoder_contexts.at(in_stream_index);
+        decoder_context.flush_buffers();
+        for(const auto& packet : audio.preroll) {
+            try {
+                decoder_context.send_packet(packet);
+                while(std::holds_alternative<detail::OwningAvframe>(
+                    decoder_context.receive_frame())) {
+                }
+            } catch(const std::exception& ex) {
+                BOOST_LOG_TRIVIAL(debug) << "Audio pre-roll: " << ex.what();
+            }
+        }
+        audio.preroll.clear();
+        audio.decoding = true;
+    }
+
     void create_pixel_converter(const detail::OwningAvframe& input_frame)
     {
         pixel_converter.emplace(
@@ -102,7 +287,7 @@ struct InputDevice::Impl {
 
     void decode_packet_to_queue(const detail::OwningAvPacket& packet)
     {
-        BOOST_LOG_FUNCTION();
+        HOT_PATH_LOG_FUNCTION();
         const int in_stream_index = packet.stream_index();
         auto& decoder_context = decoder_contexts.at(in_stream_index);
         decoder_context.send_packet(packet);
@@ -117,7 +302,7 @@ struct InputDevice::Impl {
                 const auto d_pts
                     = static_cast<double>(decoded_frame->best_effort_timestamp())
                     * av_q2d(in_stream_timebase);
-                BOOST_LOG_TRIVIAL(trace)
+                HOT_PATH_LOG_TRACE()
                     << "frame: stream = " << in_stream_index
                     << " pts = " << decoded_frame->pts()
                     << " best_effort = " << decoded_frame->best_effort_timestamp()
@@ -136,6 +321,10 @@ struct InputDevice::Impl {
                     auto converted_frame
                         = pixel_converter->scale_video(*decoded_frame);
                     converted_frame.set_pts(decoded_frame->pts());
+                    if(const auto arrival = decoded_frame->arrival_time()) {
+                        converted_frame.set_arrival_time(*arrival);
+                    }
+                    video_time_base = in_stream_timebase;
                     check_encode_write(converted_frame, in_stream_index);
                     video_frames_queue.emplace(std::move(converted_frame));
                 } else {
@@ -164,16 +353,33 @@ InputDevice& InputDevice::operator=(InputDevice&&) noexcept = default;
 CvMatRaiiAdapter InputDevice::get_video_frame() const
 {
     while(pimpl->video_frames_queue.empty()) {
-        const auto packet = pimpl->read_packet();
-        pimpl->decode_packet_to_queue(packet);
+        pimpl->process_packet(pimpl->read_packet());
     }
     auto next_frame = std::move(pimpl->video_frames_queue.front());
     pimpl->video_frames_queue.pop();
+    if(next_frame.pts() != AV_NOPTS_VALUE) {
+        pimpl->last_video_pts_us = av_rescale_q(
+            next_frame.pts(),
+            pimpl->video_time_base,
+            AVRational{1, 1'000'000});
+    }
+    pimpl->last_video_arrival_time = next_frame.arrival_time();
 
     auto ret = next_frame.copy_to_cv_mat();
     return CvMatRaiiAdapter(std::move(ret));
 }
 
+std::int64_t InputDevice::last_video_pts_us() const
+{
+    return pimpl->last_video_pts_us;
+}
+
+std::optional<std::chrono::steady_clock::time_point>
+    InputDevice::last_video_arrival_time() const
+{
+    return pimpl->last_video_arrival_time;
+}
+
 double InputDevice::fps() const
 {
     const auto values = boost::adaptors::values(pimpl->decoder_contexts);
@@ -186,20 +392,100 @@ double InputDevice::fps() const
     return 0.0;
 }
 
-void InputDevice::start_recording(const char* const path) const
+void InputDevice::set_path_generator(PathGenerator&& path_generator) const
 {
+    // Wait for the standby file which may use previous generator
+    pimpl->standby_output_file = {};
+    pimpl->path_generator = std::move(path_generator);
+    pimpl->prepare_standby_output_file();
+}
+
+void InputDevice::set_settings(
+    std::shared_ptr<const ApplicationSettings>&& settings) const
+{
+    // Background opening reads settings, wait for it
+    const bool had_standby = pimpl->standby_output_file.valid();
+    pimpl->standby_output_file = {};
+    pimpl->settings = std::move(settings);
+    if(had_standby && pimpl->path_generator) {
+        pimpl->prepare_standby_output_file();
+    }
+}
+
+void InputDevice::set_recording_callback(RecordingCallback&& on_close) const
+{
+    pimpl->recording_callback = std::move(on_close);
+}
+
+void InputDevice::set_jpeg_encoders(
+    std::shared_ptr<JpegEncoderPool>&& jpeg_encoders) const
+{
+    pimpl->jpeg_encoders = std::move(jpeg_encoders);
+}
+
+std::string InputDevice::start_recording() const
+{
+    BOOST_LOG_FUNCTION();
+    const auto motion_time = std::chrono::steady_clock::now();
+    if(!pimpl->path_generator) {
+        throw std::runtime_error("Output path generator is not set");
+    }
+    auto output_file = pimpl->take_standby_output_file();
+    auto path = pimpl->path_generator();
+    output_file.activate(
+        std::string(path),
+        motion_time,
+        RecordingCallback(pimpl->recording_callback),
+        std::shared_ptr(pimpl->jpeg_encoders),
+        std::shared_ptr(pimpl->close_order));
     const auto lock = pimpl->output_file.write();
-    lock->emplace(open_output_file(
-        std::shared_ptr(pimpl->settings),
-        path,
-        pimpl->decoder_contexts,
-        pimpl->input_format_context.streams()));
+    lock->emplace(std::move(output_file));
+    return path;
 }
 
 void InputDevice::stop_recording() const
 {
-    const auto lock = pimpl->output_file.write();
-    *lock = std::nullopt;
+    auto stopped = std::optional<detail::OutputFile>();
+    {
+        const auto lock = pimpl->output_file.write();
+        auto& opt = *lock;
+        if(opt) {
+            if(const auto latency = opt->start_latency()) {
+                *pimpl->last_start_latency.write() = latency;
+            }
+        }
+        stopped.swap(opt);
+    }
+    if(stopped) {
+        stopped->stop();
+        pimpl->closing_output_files.run(
+            [output_file = std::move(*stopped)]() mutable {
+                // Destroyed on the background thread
+                const auto closed = std::move(output_file);
+            });
+    }
+    if(pimpl->path_generator) {
+        pimpl->prepare_standby_output_file();
+    }
+}
+
+void InputDevice::report_motion(
+    const MotionSample& sample,
+    const cv::Mat& frame) const
+{
+    auto images = std::shared_ptr<RecordingImages>();
+    {
+        const auto lock = pimpl->output_file.write();
+        auto& opt = *lock;
+        if(opt) {
+            opt->report_motion(sample);
+            images = opt->images();
+        }
+    }
+    // Downscaling tiles must not hold up packets
+    if(images) {
+        images->add(sample, frame);
+    }
 }
 
 bool InputDevice::is_recording() const
@@ -208,6 +494,35 @@ bool InputDevice::is_recording() const
     return lock->has_value();
 }
 
+std::optional<std::chrono::steady_clock::duration> InputDevice::start_latency() const
+{
+    {
+        const auto lock = pimpl->output_file.read();
+        const auto& opt = *lock;
+        if(opt) {
+            if(const auto latency = opt->start_latency()) {
+                return latency;
+            }
+        }
+    }
+    return *pimpl->last_start_latency.read();
+}
+
+std::optional<WriteStats> InputDevice::write_stats() const
+{
+    const auto lock = pimpl->output_file.read();
+    const auto& opt = *lock;
+    if(opt) {
+        return opt->write_stats();
+    }
+    return std::nullopt;
+}
+
+std::shared_ptr<LatencyTracer> InputDevice::latency_tracer() const
+{
+    return pimpl->latency_tracer;
+}
+
 namespace {
 void unique_register_all_ffmpeg_devices()
 {
@@ -218,19 +533,173 @@ void unique_register_all_ffmpeg_devices()
     (void)register_devices_flag;
 }
 
-detail::ScopedAvFormatInput create_input_format_context(
+// Probe limits used if stream parameters are cached. The first packets are read
+// to check that the input still matches the cache.
+constexpr std::int64_t CACHED_PROBE_SIZE = 64 * 1024;
+constexpr std::int64_t CACHED_ANALYZE_DURATION_US = 200'000;
+
+// Logs how long every step of opening the input took
+class StartupTimer {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    void lap(const std::string_view step)
+    {
+        const auto now = Clock::now();
+        m_steps << step << " = " << to_ms(now - m_last) << " ms, ";
+        m_last = now;
+    }
+    void log() const
+    {
+        BOOST_LOG_TRIVIAL(info) << "Input startup: " << m_steps.str()
+                                << "total = " << to_ms(m_last - m_start) << " ms";
+    }
+
+private:
+    Clock::time_point m_start = Clock::now();
+    Clock::time_point m_last = m_start;
+    std::ostringstream m_steps;
+
+    static double to_ms(const Clock::duration x)
+    {
+        return std::chrono::duration<double, std::milli>(x).count();
+    }
+};
+
+ProbedStream::Rational to_probed(const AVRational x)
+{
+    return {x.num, x.den};
+}
+
+AVRational to_av(const ProbedStream::Rational x)
+{
+    return {x.num, x.den};
+}
+
+std::vector<ProbedStream>
+    to_probed_streams(const detail::ScopedAvFormatInput& input_format_context)
+{
+    auto ret = std::vector<ProbedStream>();
+    for(const AVStream* const stream : input_format_context.streams()) {
+        const AVCodecParameters* const par = stream->codecpar;
+        auto& x = ret.emplace_back();
+        x.codec_type = par->codec_type;
+        x.codec_id = par->codec_id;
+        x.time_base = to_probed(stream->time_base);
+        x.r_frame_rate = to_probed(stream->r_frame_rate);
+        x.avg_frame_rate = to_probed(stream->avg_frame_rate);
+        x.width = par->width;
+        x.height = par->height;
+        x.format = par->format;
+        x.sample_rate = par->sample_rate;
+        x.channels = par->ch_layout.nb_channels;
+    }
+    return ret;
+}
+
+// Fills parameters which a short probe did not find from the cache. Returns
+// false if the streams or the parameters found in the first packets differ
+// from the cached ones.
+bool apply_cached_streams(
+    const detail::ScopedAvFormatInput& input_format_context,
+    const std::vector<ProbedStream>& cached)
+{
+    const auto streams = input_format_context.streams();
+    if(streams.size() != cached.size()) {
+        return false;
+    }
+    const auto fill = [](int& probed, const int cached_value, const int unknown) {
+        if(probed == unknown) {
+            probed = cached_value;
+        }
+        return probed == cached_value;
+    };
+    for(std::size_t i = 0; i < cached.size(); i++) {
+        AVStream* const stream = streams[i];
+        AVCodecParameters* const par = stream->codecpar;
+        const auto& c = cached[i];
+        if(par->codec_type != c.codec_type || par->codec_id != c.codec_id
+           || av_cmp_q(stream->time_base, to_av(c.time_base)) != 0) {
+            return false;
+        }
+        if(!fill(par->width, c.width, 0) || !fill(par->height, c.height, 0)
+           || !fill(par->format, c.format, -1)
+           || !fill(par->sample_rate, c.sample_rate, 0)) {
+            return false;
+        }
+        if(par->ch_layout.nb_channels == 0 && c.channels > 0) {
+            av_channel_layout_default(&par->ch_layout, c.channels);
+        } else if(par->ch_layout.nb_channels != c.channels) {
+            return false;
+        }
+        // A frame rate estimated from a few packets is less precise
+        stream->r_frame_rate = to_av(c.r_frame_rate);
+        stream->avg_frame_rate = to_av(c.avg_frame_rate);
+    }
+    return true;
+}
+
+detail::ScopedAvFormatInput open_input_format_context(
     const char* const url,
     const std::optional<std::string>& file_format,
-    ScopedAvDictionary& options)
+    const std::map<std::string, std::string>& demuxer_options)
 {
+    auto options = ScopedAvDictionary::from_std_map(demuxer_options);
     BOOST_LOG_TRIVIAL(debug) << "Demuxer options = " << options;
     auto ret = detail::ScopedAvFormatInput(url, file_format, options);
     if(options.size() != 0) {
         BOOST_LOG_TRIVIAL(error) << "Unsupported demuxer options: " << options;
         throw std::runtime_error("Found unsupported demuxer options");
     }
+    return ret;
+}
+
+detail::ScopedAvFormatInput create_input_format_context(
+    const char* const url,
+    const std::optional<std::string>& file_format,
+    const std::map<std::string, std::string>& demuxer_options,
+    const std::optional<ProbeCache>& probe_cache,
+    StartupTimer& timer)
+{
+    BOOST_LOG_FUNCTION();
+    const auto key = ProbeCache::make_key(url, file_format, demuxer_options);
+    const auto cached = probe_cache ? probe_cache->load(key) : std::nullopt;
+    auto ret = open_input_format_context(url, file_format, demuxer_options);
+    timer.lap("open");
+    if(cached) {
+        ret.set_probe_limits(CACHED_PROBE_SIZE, CACHED_ANALYZE_DURATION_US);
+        ret.find_stream_info();
+        timer.lap("cached probe");
+        if(apply_cached_streams(ret, *cached)) {
+            ret.dump_format();
+            return ret;
+        }
+        BOOST_LOG_TRIVIAL(warning) << "Input does not match probe cache "
+                                   << probe_cache->path_of(key) << ", probing again";
+        probe_cache->remove(key);
+        {
+            // Devices like v4l2 cannot be opened twice
+            const auto stale = std::move(ret);
+        }
+        ret = open_input_format_context(url, file_format, demuxer_options);
+        timer.lap("reopen");
+    }
     ret.find_stream_info();
+    timer.lap("probe");
     ret.dump_format();
+    if(probe_cache) {
+        const auto streams = to_probed_streams(ret);
+        if(std::all_of(streams.begin(), streams.end(), [](const auto& x) {
+               return x.complete();
+           })) {
+            try {
+                probe_cache->save(key, streams);
+            } catch(const std::exception& ex) {
+                BOOST_LOG_TRIVIAL(warning)
+                    << "Failed to save probe cache: " << ex.what();
+            }
+        }
+    }
     return ret;
 }
 
@@ -307,6 +776,10 @@ DecoderContextsMap create_decoder_contexts(
         }
         // Set the packet timebase for the decoder.
         decoder_context.set_pkt_timebase(stream->time_base);
+        // Pass arrival times of packets to decoded frames
+        decoder_context.set_flags(static_cast<int>(
+            decoder_context.flags()
+            | static_cast<unsigned>(AV_CODEC_FLAG_COPY_OPAQUE)));
         decoder_context.open();
         BOOST_LOG_TRIVIAL(debug) << "stream " << index << ":"
                                  << " timebase = " << stream->time_base
@@ -338,10 +811,19 @@ InputDevice open_input_device(std::shared_ptr<const ApplicationSettings>&& setti
     BOOST_LOG_FUNCTION();
     unique_register_all_ffmpeg_devices();
 
-    const auto url = settings->video_capture.filename.data();
-    const auto& file_format = settings->video_capture.file_format;
-    auto demuxer_options
-        = ScopedAvDictionary::from_std_map(settings->video_capture.demuxer_options);
+    auto url = settings->video_capture.filename;
+    auto file_format = settings->video_capture.file_format;
+    if(const auto scene = SyntheticScene::from_url(url)) {
+        url = scene->filter_graph();
+        file_format = "lavfi";
+        BOOST_LOG_TRIVIAL(info) << "Synthetic input: " << url;
+    }
+    const auto probe_cache = [&]() -> std::optional<ProbeCache> {
+        if(const auto& dir = settings->video_capture.probe_cache_dir) {
+            return ProbeCache(*dir);
+        }
+        return std::nullopt;
+    }();
     const auto hw_decoder_type = [&]() -> std::optional<std::string> {
         if(const auto& video_decoder = settings->video_capture.video_decoder) {
             return video_decoder->hw_type;
@@ -349,11 +831,18 @@ InputDevice open_input_device(std::shared_ptr<const ApplicationSettings>&& setti
         return std::nullopt;
     }();
 
-    auto input_format_context
-        = create_input_format_context(url, file_format, demuxer_options);
+    auto timer = StartupTimer();
+    auto input_format_context = create_input_format_context(
+        url.data(),
+        file_format,
+        settings->video_capture.demuxer_options,
+        probe_cache,
+        timer);
 
     auto decoder_contexts
         = create_decoder_contexts(input_format_context, hw_decoder_type);
+    timer.lap("decoders");
+    timer.log();
     const int video_stream_index = find_video_stream_index(input_format_context);
     if(video_stream_index == -1) {
         BOOST_LOG_TRIVIAL(fatal) << "Input file does not contain video streams!";
@@ -1,12 +1,20 @@
 #pragma once
 
+#include <chrono>
+#include <cstdint>
 #include <memory>
 #include <optional>
 #include <string>
 
 #include "../ApplicationSettings.hpp"
 #include "../CvMatRaiiAdapter.hpp"
+#include "JpegEncoder.hpp"
+#include "LatencyTracer.hpp"
+#include "PathGenerator.hpp"
+#include "RecordingInfo.hpp"
 #include "ScopedAvDictionary.hpp"
+#include "Timeline.hpp"
+#include "WriteStats.hpp"
 
 namespace vehlwn::ffmpeg {
 class InputDevice {
@@ -21,10 +29,48 @@ public:
     InputDevice& operator=(InputDevice&&) noexcept;
 
     [[nodiscard]] CvMatRaiiAdapter get_video_frame() const;
+    // Timestamp of the frame last returned by get_video_frame(), microseconds
+    [[nodiscard]] std::int64_t last_video_pts_us() const;
+    // Time when the first packet of the frame last returned by get_video_frame()
+    // was read. Empty if the decoder did not pass it through.
+    [[nodiscard]] std::optional<std::chrono::steady_clock::time_point>
+        last_video_arrival_time() const;
     [[nodiscard]] double fps() const;
-    void start_recording(const char* path) const;
+    // Sets a generator of output file paths and opens a standby file in
+    // background. The generator is also used for next segments when
+    // output_files.segment_seconds is set.
+    void set_path_generator(PathGenerator&& path_generator) const;
+    // Replaces settings of next output files. A standby file is reopened with
+    // them, the current recording keeps its settings. Must be called on the
+    // thread which starts and stops recordings.
+    void set_settings(std::shared_ptr<const ApplicationSettings>&& settings) const;
+    // Sets a callback which receives a summary of every recorded file.
+    void set_recording_callback(RecordingCallback&& on_close) const;
+    // Sets the pool which encodes thumbnails and sprite sheets of next
+    // recordings, so they share encoders with other users of the pool.
+    void set_jpeg_encoders(std::shared_ptr<JpegEncoderPool>&& jpeg_encoders) const;
+    // Activates the standby file under a new generated path and returns it.
+    std::string start_recording() const;
+    // Motion statistics of a decoded frame for the summary and the timeline of
+    // the current recording. Frames may be reported after later frames have been
+    // decoded, so pts_us is set by the caller. frame is the BGR frame of the
+    // sample, the frame with the largest moving area is referenced until the
+    // recording is closed. Recording images are updated after the output file
+    // lock is released.
+    void report_motion(const MotionSample& sample, const cv::Mat& frame) const;
+    // Closes current file and opens a new standby file in background. Does not
+    // wait for the file to be flushed, the destructor does.
     void stop_recording() const;
     [[nodiscard]] bool is_recording() const;
+    // Time from start_recording() to the first written video packet of the
+    // current or last recording.
+    [[nodiscard]] std::optional<std::chrono::steady_clock::duration>
+        start_latency() const;
+    // Write-behind metrics of the current recording
+    [[nodiscard]] std::optional<WriteStats> write_stats() const;
+    // Frame latencies of the input and the recordings. Tracing is enabled by the
+    // tracing settings section.
+    [[nodiscard]] std::shared_ptr<LatencyTracer> latency_tracer() const;
 
 private:
     std::unique_ptr<Impl> pimpl;
@@ -0,0 +1,167 @@
+#include "JpegEncoder.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <opencv2/core.hpp>
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+
+#if HAVE_TURBOJPEG
+#include <turbojpeg.h>
+#endif
+
+namespace vehlwn::ffmpeg {
+namespace {
+// Validates options and returns the part of image to compress. Pixels are
+// copied only when the image is scaled.
+cv::Mat select(const cv::Mat& image, const JpegOptions& options, cv::Mat& scaled)
+{
+    if(image.empty() || image.type() != CV_8UC3) {
+        throw std::invalid_argument("Expected a non-empty BGR image");
+    }
+    if(options.quality < 1 || options.quality > 100) {
+        throw std::invalid_argument("quality must be in [1, 100]");
+    }
+    auto ret = image;
+    if(const auto& crop = options.crop) {
+        const auto bounds = cv::Rect(0, 0, image.cols, image.rows);
+        if(crop->empty() || (*crop & bounds) != *crop) {
+            throw std::invalid_argument(
+                "crop must be a non-empty part of the image");
+        }
+        ret = image(*crop);
+    }
+    if(const auto width = options.width) {
+        if(*width < 1) {
+            throw std::invalid_argument("width must be positive");
+        }
+        if(*width < ret.cols) {
+            const auto height
+                = static_cast<std::int64_t>(ret.rows) * *width / ret.cols;
+            cv::resize(
+                ret,
+                scaled,
+                {*width, std::max(1, static_cast<int>(height))},
+                0,
+                0,
+                cv::INTER_AREA);
+            ret = scaled;
+        }
+    }
+    return ret;
+}
+} // namespace
+
+#if HAVE_TURBOJPEG
+namespace {
+// Lower bound of the first guess of the output size
+constexpr std::size_t MIN_OUTPUT_SIZE = 64 * 1024;
+} // namespace
+
+JpegEncoder::JpegEncoder()
+    : m_handle{tjInitCompress()}
+{
+    if(m_handle == nullptr) {
+        throw std::runtime_error(
+            std::string("tjInitCompress failed: ") + tjGetErrorStr());
+    }
+}
+
+JpegEncoder::~JpegEncoder()
+{
+    tjDestroy(m_handle);
+}
+
+void JpegEncoder::encode(
+    const cv::Mat& image,
+    const JpegOptions& options,
+    std::string& out)
+{
+    const auto src = select(image, options, m_scaled);
+    const auto bound
+        = static_cast<std::size_t>(tjBufSize(src.cols, src.rows, TJSAMP_420));
+    // The compressed image is written straight into out. The worst case size is
+    // several times larger than a typical image, so the first attempt guesses
+    // from the previous image.
+    for(const auto size :
+        {std::min(bound, std::max(MIN_OUTPUT_SIZE, 2 * m_last_size)), bound}) {
+        out.resize(size);
+        auto* data = reinterpret_cast<unsigned char*>(out.data());
+        auto jpeg_size = static_cast<unsigned long>(size);
+        const int ret = tjCompress2(
+            m_handle,
+            src.data,
+            src.cols,
+            static_cast<int>(src.step),
+            src.rows,
+            TJPF_BGR,
+            &data,
+            &jpeg_size,
+            TJSAMP_420,
+            options.quality,
+            TJFLAG_NOREALLOC);
+        if(ret == 0) {
+            out.resize(jpeg_size);
+            m_last_size = jpeg_size;
+            return;
+        }
+        if(size == bound) {
+            break;
+        }
+    }
+    throw std::runtime_error(
+        std::string("tjCompress2 failed: ") + tjGetErrorStr2(m_handle));
+}
+#else
+JpegEncoder::JpegEncoder() = default;
+
+JpegEncoder::~JpegEncoder() = default;
+
+void JpegEncoder::encode(
+    const cv::Mat& image,
+    const JpegOptions& options,
+    std::string& out)
+{
+    const auto src = select(image, options, m_scaled);
+    // m_buf keeps its capacity between images
+    const auto params = std::vector<int>{cv::IMWRITE_JPEG_QUALITY, options.quality};
+    if(!cv::imencode(".jpg", src, m_buf, params)) {
+        throw std::runtime_error("cv::imencode failed");
+    }
+    out.assign(m_buf.begin(), m_buf.end());
+    m_last_size = m_buf.size();
+}
+#endif
+
+void JpegEncoderPool::Release::operator()(JpegEncoder* const encoder) const
+{
+    auto owned = std::unique_ptr<JpegEncoder>(encoder);
+    const auto lock = std::lock_guard(pool->m_mutex);
+    pool->m_idle.push_back(std::move(owned));
+}
+
+JpegEncoderPool::Lease JpegEncoderPool::acquire()
+{
+    {
+        const auto lock = std::lock_guard(m_mutex);
+        if(!m_idle.empty()) {
+            auto encoder = std::move(m_idle.back());
+            m_idle.pop_back();
+            return {encoder.release(), Release{this}};
+        }
+    }
+    return {std::make_unique<JpegEncoder>().release(), Release{this}};
+}
+
+std::size_t JpegEncoderPool::idle_count() const
+{
+    const auto lock = std::lock_guard(m_mutex);
+    return m_idle.size();
+}
+} // namespace vehlwn::ffmpeg
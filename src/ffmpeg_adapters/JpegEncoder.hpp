@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <opencv2/core/mat.hpp>
+#include <opencv2/core/types.hpp>
+
+namespace vehlwn::ffmpeg {
+constexpr int DEFAULT_JPEG_QUALITY = 95;
+
+struct JpegOptions {
+    // In [1, 100]
+    int quality = DEFAULT_JPEG_QUALITY;
+    // Part of the image to encode, the whole image if empty
+    std::optional<cv::Rect> crop;
+    // Output width, height keeps the aspect ratio. Images are never upscaled.
+    std::optional<int> width;
+};
+
+// Reusable JPEG compressor. Uses TurboJPEG when the build has found it and
+// cv::imencode otherwise. Not thread safe, see JpegEncoderPool.
+class JpegEncoder {
+public:
+    JpegEncoder();
+    JpegEncoder(const JpegEncoder&) = delete;
+    JpegEncoder(JpegEncoder&&) = delete;
+    ~JpegEncoder();
+    JpegEncoder& operator=(const JpegEncoder&) = delete;
+    JpegEncoder& operator=(JpegEncoder&&) = delete;
+
+    // Encodes an 8 bit BGR image and replaces the content of out. Throws
+    // std::invalid_argument if options do not fit the image.
+    void encode(const cv::Mat& image, const JpegOptions& options, std::string& out);
+
+private:
+    // tjhandle
+    void* m_handle = nullptr;
+    cv::Mat m_scaled;
+    std::vector<unsigned char> m_buf;
+    // Size of the previous image, the output buffer is sized from it
+    std::size_t m_last_size = 0;
+};
+
+// Idle encoders are reused so their handles and buffers are allocated once per
+// concurrent request rather than once per request
+class JpegEncoderPool {
+    struct Release {
+        JpegEncoderPool* pool;
+        void operator()(JpegEncoder* encoder) const;
+    };
+
+public:
+    // Returns the encoder to the pool when destroyed. Must not outlive the pool.
+    using Lease = std::unique_ptr<JpegEncoder, Release>;
+
+    [[nodiscard]] Lease acquire();
+    [[nodiscard]] std::size_t idle_count() const;
+
+private:
+    mutable std::mutex m_mutex;
+    std::vector<std::unique_ptr<JpegEncoder>> m_idle;
+};
+} // namespace vehlwn::ffmpeg
@@ -0,0 +1,230 @@
+#include "LatencyTracer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <iomanip>
+#include <ios>
+#include <map>
+#include <string_view>
+#include <utility>
+
+namespace vehlwn::ffmpeg {
+namespace {
+// Bucket 0 holds durations below 1 us, bucket i > 0 durations in
+// [2^((i - 1) / 4), 2^(i / 4)) us, the last bucket everything above
+std::chrono::nanoseconds bucket_upper_bound(const int index, const int per_octave)
+{
+    const auto us = std::exp2(static_cast<double>(index) / per_octave);
+    return std::chrono::nanoseconds(
+        static_cast<std::int64_t>(std::ceil(us * 1000.)));
+}
+
+double to_trace_us(const std::chrono::steady_clock::duration x)
+{
+    return std::chrono::duration<double, std::micro>(x).count();
+}
+} // namespace
+
+void LatencyHistogram::record(const std::chrono::nanoseconds x)
+{
+    const auto ns = std::max<std::int64_t>(x.count(), 0);
+    const auto us = static_cast<double>(ns) / 1000.;
+    int index = 0;
+    if(us >= 1.) {
+        const auto octaves = std::log2(us);
+        index = 1 + static_cast<int>(std::floor(octaves * BUCKETS_PER_OCTAVE));
+        index = std::min(index, BUCKETS - 1);
+    }
+    m_buckets[static_cast<std::size_t>(index)].fetch_add(
+        1,
+        std::memory_order_relaxed);
+    m_sum_ns.fetch_add(ns, std::memory_order_relaxed);
+    auto max = m_max_ns.load(std::memory_order_relaxed);
+    while(ns > max
+          && !m_max_ns.compare_exchange_weak(max, ns, std::memory_order_relaxed)) {
+    }
+}
+
+LatencySummary LatencyHistogram::summary() const
+{
+    // Concurrent records may be partially visible, which shifts percentiles
+    // by at most a few samples
+    auto counts = std::array<std::uint64_t, BUCKETS>();
+    std::uint64_t total = 0;
+    for(std::size_t i = 0; i < counts.size(); i++) {
+        counts[i] = m_buckets[i].load(std::memory_order_relaxed);
+        total += counts[i];
+    }
+    auto ret = LatencySummary();
+    if(total == 0) {
+        return ret;
+    }
+    ret.count = total;
+    ret.max = std::chrono::nanoseconds(m_max_ns.load(std::memory_order_relaxed));
+    ret.mean = std::chrono::nanoseconds(
+        m_sum_ns.load(std::memory_order_relaxed)
+        / static_cast<std::int64_t>(total));
+    const auto percentile = [&](const double q) {
+        const auto rank = static_cast<std::uint64_t>(
+            std::ceil(q * static_cast<double>(total)));
+        std::uint64_t seen = 0;
+        for(std::size_t i = 0; i < counts.size(); i++) {
+            seen += counts[i];
+            // The last bucket has no upper bound
+            if(seen >= rank && i + 1 < counts.size()) {
+                return std::min(
+                    bucket_upper_bound(static_cast<int>(i), BUCKETS_PER_OCTAVE),
+                    ret.max);
+            }
+        }
+        return ret.max;
+    };
+    ret.p50 = percentile(0.5);
+    ret.p90 = percentile(0.9);
+    ret.p99 = percentile(0.99);
+    return ret;
+}
+
+LatencyTracer::LatencyTracer(const std::optional<Clock::duration> trace_window)
+    : m_trace_window{trace_window}
+    , m_start_time{Clock::now()}
+{}
+
+void LatencyTracer::record_publish(
+    const Clock::time_point arrival,
+    const Clock::time_point published,
+    const std::int64_t frame_pts_us)
+{
+    m_glass_to_publish.record(published - arrival);
+    if(tracing_enabled()) {
+        add_span(Span{
+            .name = "glass_to_publish",
+            .thread = "latency",
+            .begin = arrival,
+            .end = published,
+            .frame_pts_us = frame_pts_us,
+            .async = true,
+        });
+    }
+}
+
+void LatencyTracer::record_disk(
+    const Clock::time_point arrival,
+    const Clock::time_point written)
+{
+    m_glass_to_disk.record(written - arrival);
+    if(tracing_enabled()) {
+        add_span(Span{
+            .name = "glass_to_disk",
+            .thread = "latency",
+            .begin = arrival,
+            .end = written,
+            .frame_pts_us = -1,
+            .async = true,
+        });
+    }
+}
+
+LatencySummary LatencyTracer::glass_to_publish() const
+{
+    return m_glass_to_publish.summary();
+}
+
+LatencySummary LatencyTracer::glass_to_disk() const
+{
+    return m_glass_to_disk.summary();
+}
+
+bool LatencyTracer::tracing_enabled() const
+{
+    return m_trace_window.has_value();
+}
+
+void LatencyTracer::trace(
+    const std::string_view name,
+    const std::string_view thread,
+    const Clock::time_point begin,
+    const Clock::time_point end,
+    const std::int64_t frame_pts_us)
+{
+    if(!tracing_enabled()) {
+        return;
+    }
+    add_span(Span{
+        .name = std::string(name),
+        .thread = std::string(thread),
+        .begin = begin,
+        .end = end,
+        .frame_pts_us = frame_pts_us,
+        .async = false,
+    });
+}
+
+void LatencyTracer::add_span(Span&& span)
+{
+    const auto lock = std::lock_guard(m_spans_mutex);
+    // Spans are added roughly in order of their end
+    const auto oldest = span.end - *m_trace_window;
+    while(!m_spans.empty() && m_spans.front().end < oldest) {
+        m_spans.pop_front();
+    }
+    m_spans.push_back(std::move(span));
+}
+
+void LatencyTracer::write_chrome_trace(std::ostream& os) const
+{
+    const auto lock = std::lock_guard(m_spans_mutex);
+    const auto oldest = m_trace_window
+        ? Clock::now() - *m_trace_window
+        : Clock::time_point::max();
+    // Threads are numbered in order of appearance
+    auto tids = std::map<std::string_view, int>();
+    const auto tid_of = [&](const std::string_view thread) {
+        return tids.try_emplace(thread, static_cast<int>(tids.size()) + 1)
+            .first->second;
+    };
+    const auto old_flags = os.flags();
+    const auto old_precision = os.precision();
+    os << std::fixed << std::setprecision(3);
+    os << R"({"displayTimeUnit":"ms","traceEvents":[)"
+       << R"({"name":"process_name","ph":"M","pid":1,)"
+       << R"("args":{"name":"motion-detection"}})";
+    const auto write_event = [&](const Span& span,
+                                 const std::string_view phase,
+                                 const Clock::time_point ts) {
+        os << R"(,{"name":")" << span.name << R"(","ph":")" << phase
+           << R"(","pid":1,"tid":)" << tid_of(span.thread)
+           << R"(,"ts":)" << to_trace_us(ts - m_start_time);
+        if(span.async) {
+            // Latency spans of a frame are paired by its arrival time
+            os << R"(,"cat":"latency","id":)"
+               << (span.begin - m_start_time).count();
+        } else if(phase == "X") {
+            os << R"(,"dur":)" << to_trace_us(span.end - span.begin);
+        }
+        if(span.frame_pts_us >= 0) {
+            os << R"(,"args":{"pts_us":)" << span.frame_pts_us << "}";
+        }
+        os << "}";
+    };
+    for(const auto& span : m_spans) {
+        if(span.end < oldest) {
+            continue;
+        }
+        if(span.async) {
+            write_event(span, "b", span.begin);
+            write_event(span, "e", span.end);
+        } else {
+            write_event(span, "X", span.begin);
+        }
+    }
+    for(const auto& [thread, tid] : tids) {
+        os << R"(,{"name":"thread_name","ph":"M","pid":1,"tid":)" << tid
+           << R"(,"args":{"name":")" << thread << R"("}})";
+    }
+    os << "]}";
+    os.flags(old_flags);
+    os.precision(old_precision);
+}
+} // namespace vehlwn::ffmpeg
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+namespace vehlwn::ffmpeg {
+// Percentiles of a LatencyHistogram. Percentiles are upper bounds of histogram
+// buckets, i.e. overestimated by less than 19%.
+struct LatencySummary {
+    std::uint64_t count = 0;
+    std::chrono::nanoseconds mean{0};
+    std::chrono::nanoseconds p50{0};
+    std::chrono::nanoseconds p90{0};
+    std::chrono::nanoseconds p99{0};
+    std::chrono::nanoseconds max{0};
+};
+
+inline std::ostream& operator<<(std::ostream& os, const LatencySummary& x)
+{
+    using Millis = std::chrono::duration<double, std::milli>;
+    os << "count = " << x.count << ", mean_ms = " << Millis(x.mean).count()
+       << ", p50_ms = " << Millis(x.p50).count()
+       << ", p90_ms = " << Millis(x.p90).count()
+       << ", p99_ms = " << Millis(x.p99).count()
+       << ", max_ms = " << Millis(x.max).count();
+    return os;
+}
+
+// Histogram of durations with logarithmic buckets, four per power of two of
+// microseconds from 1 us to about 17 s. Recording is lock free.
+class LatencyHistogram {
+public:
+    void record(std::chrono::nanoseconds x);
+    [[nodiscard]] LatencySummary summary() const;
+
+private:
+    static constexpr int BUCKETS_PER_OCTAVE = 4;
+    static constexpr int BUCKETS = 24 * BUCKETS_PER_OCTAVE + 1;
+
+    std::array<std::atomic<std::uint64_t>, BUCKETS> m_buckets{};
+    std::atomic<std::int64_t> m_sum_ns{0};
+    std::atomic<std::int64_t> m_max_ns{0};
+};
+
+// End-to-end latency of frames measured from the moment their packets are read
+// from the input: until the frame is published in MotionData and until its
+// encoded packet is passed to the muxer of a recording. Optionally keeps spans of
+// the last window of time and writes them in Chrome trace event format which
+// can be opened in chrome://tracing or https://ui.perfetto.dev.
+class LatencyTracer {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // Tracing is disabled if trace_window is empty
+    explicit LatencyTracer(std::optional<Clock::duration> trace_window);
+
+    void record_publish(
+        Clock::time_point arrival,
+        Clock::time_point published,
+        std::int64_t frame_pts_us);
+    void record_disk(Clock::time_point arrival, Clock::time_point written);
+    [[nodiscard]] LatencySummary glass_to_publish() const;
+    [[nodiscard]] LatencySummary glass_to_disk() const;
+
+    [[nodiscard]] bool tracing_enabled() const;
+    // Adds a span of work on a thread. Does nothing if tracing is disabled.
+    void trace(
+        std::string_view name,
+        std::string_view thread,
+        Clock::time_point begin,
+        Clock::time_point end,
+        std::int64_t frame_pts_us);
+    // Writes spans of the last trace_window as a JSON object
+    void write_chrome_trace(std::ostream& os) const;
+
+private:
+    struct Span {
+        std::string name;
+        std::string thread;
+        Clock::time_point begin;
+        Clock::time_point end;
+        // Negative if unknown
+        std::int64_t frame_pts_us;
+        // Latency spans of different frames overlap and are written as async
+        // events, spans of work on a thread are complete events
+        bool async;
+    };
+
+    const std::optional<Clock::duration> m_trace_window;
+    const Clock::time_point m_start_time;
+    LatencyHistogram m_glass_to_publish;
+    LatencyHistogram m_glass_to_disk;
+    mutable std::mutex m_spans_mutex;
+    std::deque<Span> m_spans;
+
+    void add_span(Span&& span);
+};
+} // namespace vehlwn::ffmpeg
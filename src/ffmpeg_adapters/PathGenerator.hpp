@@ -0,0 +1,9 @@
+#pragma once
+
+#include <functional>
+#include <string>
+
+namespace vehlwn::ffmpeg {
+// Returns a path to a new output file each time it is called.
+using PathGenerator = std::function<std::string()>;
+} // namespace vehlwn::ffmpeg
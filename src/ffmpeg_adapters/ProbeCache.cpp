@@ -0,0 +1,198 @@
+#include "ProbeCache.hpp"
+
+#include <charconv>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <ios>
+#include <sstream>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+
+namespace vehlwn::ffmpeg {
+namespace {
+constexpr std::string_view HEADER = "motion-detection probe cache 1";
+// Values of AVMediaType
+constexpr int MEDIA_TYPE_VIDEO = 0;
+constexpr int MEDIA_TYPE_AUDIO = 1;
+
+std::uint64_t fnv1a(const std::string_view s)
+{
+    std::uint64_t ret = 14695981039346656037ULL;
+    for(const char c : s) {
+        ret ^= static_cast<unsigned char>(c);
+        ret *= 1099511628211ULL;
+    }
+    return ret;
+}
+
+std::ostream& operator<<(std::ostream& os, const ProbedStream::Rational& x)
+{
+    return os << x.num << '/' << x.den;
+}
+
+int parse_int(const std::string_view s)
+{
+    int ret = 0;
+    const auto [end, ec] = std::from_chars(s.data(), s.data() + s.size(), ret);
+    if(ec != std::errc() || end != s.data() + s.size()) {
+        throw std::invalid_argument("Invalid number: " + std::string(s));
+    }
+    return ret;
+}
+
+ProbedStream::Rational parse_rational(const std::string_view s)
+{
+    const auto slash = s.find('/');
+    if(slash == std::string_view::npos) {
+        throw std::invalid_argument("Invalid rational: " + std::string(s));
+    }
+    return {parse_int(s.substr(0, slash)), parse_int(s.substr(slash + 1))};
+}
+
+// Parses "stream name=value ..." with every field of ProbedStream
+ProbedStream parse_stream(const std::string& line)
+{
+    auto is = std::istringstream(line);
+    auto word = std::string();
+    if(!(is >> word) || word != "stream") {
+        throw std::invalid_argument("Expected stream: " + line);
+    }
+    auto values = std::map<std::string, std::string, std::less<>>();
+    while(is >> word) {
+        const auto eq = word.find('=');
+        if(eq == std::string::npos) {
+            throw std::invalid_argument("Expected name=value: " + word);
+        }
+        values.emplace(word.substr(0, eq), word.substr(eq + 1));
+    }
+    const auto value = [&](const std::string_view name) -> const std::string& {
+        const auto it = values.find(name);
+        if(it == values.end()) {
+            throw std::invalid_argument("Missing " + std::string(name));
+        }
+        return it->second;
+    };
+    auto ret = ProbedStream();
+    ret.codec_type = parse_int(value("codec_type"));
+    ret.codec_id = parse_int(value("codec_id"));
+    ret.time_base = parse_rational(value("time_base"));
+    ret.r_frame_rate = parse_rational(value("r_frame_rate"));
+    ret.avg_frame_rate = parse_rational(value("avg_frame_rate"));
+    ret.width = parse_int(value("width"));
+    ret.height = parse_int(value("height"));
+    ret.format = parse_int(value("format"));
+    ret.sample_rate = parse_int(value("sample_rate"));
+    ret.channels = parse_int(value("channels"));
+    return ret;
+}
+} // namespace
+
+bool ProbedStream::complete() const
+{
+    switch(codec_type) {
+        case MEDIA_TYPE_VIDEO:
+            return width > 0 && height > 0 && format >= 0;
+        case MEDIA_TYPE_AUDIO:
+            return sample_rate > 0 && channels > 0 && format >= 0;
+        default:
+            return true;
+    }
+}
+
+ProbeCache::ProbeCache(std::filesystem::path dir)
+    : m_dir(std::move(dir))
+{}
+
+std::string ProbeCache::make_key(
+    const std::string_view url,
+    const std::optional<std::string>& file_format,
+    const std::map<std::string, std::string>& demuxer_options)
+{
+    // Looks like ffmpeg arguments, e.g. "-f v4l2 -video_size 1280x720 -i
+    // /dev/video0"
+    auto os = std::ostringstream();
+    if(file_format) {
+        os << "-f " << *file_format << ' ';
+    }
+    for(const auto& [key, value] : demuxer_options) {
+        os << '-' << key << ' ' << value << ' ';
+    }
+    os << "-i " << url;
+    return os.str();
+}
+
+std::optional<std::vector<ProbedStream>>
+    ProbeCache::load(const std::string& key) const
+{
+    auto file = std::ifstream(path_of(key));
+    if(!file) {
+        return std::nullopt;
+    }
+    auto line = std::string();
+    if(!std::getline(file, line) || line != HEADER) {
+        return std::nullopt;
+    }
+    // Different keys can have the same file name
+    if(!std::getline(file, line) || line != "key " + key) {
+        return std::nullopt;
+    }
+    auto ret = std::vector<ProbedStream>();
+    try {
+        while(std::getline(file, line)) {
+            ret.push_back(parse_stream(line));
+        }
+    } catch(const std::invalid_argument&) {
+        return std::nullopt;
+    }
+    if(ret.empty()) {
+        return std::nullopt;
+    }
+    return ret;
+}
+
+void ProbeCache::save(
+    const std::string& key,
+    const std::vector<ProbedStream>& streams) const
+{
+    std::filesystem::create_directories(m_dir);
+    const auto path = path_of(key);
+    auto tmp_path = path;
+    tmp_path += ".tmp";
+    {
+        auto file = std::ofstream(tmp_path, std::ios::trunc);
+        file << HEADER << '\n' << "key " << key << '\n';
+        for(const auto& s : streams) {
+            file << "stream codec_type=" << s.codec_type
+                 << " codec_id=" << s.codec_id << " time_base=" << s.time_base
+                 << " r_frame_rate=" << s.r_frame_rate
+                 << " avg_frame_rate=" << s.avg_frame_rate
+                 << " width=" << s.width << " height=" << s.height
+                 << " format=" << s.format << " sample_rate=" << s.sample_rate
+                 << " channels=" << s.channels << '\n';
+        }
+        file.close();
+        if(!file) {
+            std::filesystem::remove(tmp_path);
+            throw std::runtime_error("Failed to write " + tmp_path.string());
+        }
+    }
+    std::filesystem::rename(tmp_path, path);
+}
+
+void ProbeCache::remove(const std::string& key) const
+{
+    auto ec = std::error_code();
+    std::filesystem::remove(path_of(key), ec);
+}
+
+std::filesystem::path ProbeCache::path_of(const std::string& key) const
+{
+    auto name = std::ostringstream();
+    name << std::hex << std::setw(16) << std::setfill('0') << fnv1a(key)
+         << ".probe";
+    return m_dir / name.str();
+}
+} // namespace vehlwn::ffmpeg
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <filesystem>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace vehlwn::ffmpeg {
+// Parameters of an input stream found by avformat_find_stream_info(). libav enums
+// are stored as ints.
+struct ProbedStream {
+    struct Rational {
+        int num = 0;
+        int den = 1;
+        bool operator==(const Rational&) const = default;
+    };
+    int codec_type = -1;
+    int codec_id = 0;
+    Rational time_base;
+    Rational r_frame_rate;
+    Rational avg_frame_rate;
+    int width = 0;
+    int height = 0;
+    // Pixel format of video or sample format of audio, -1 if unknown
+    int format = -1;
+    int sample_rate = 0;
+    int channels = 0;
+    bool operator==(const ProbedStream&) const = default;
+
+    // True if decoders can be opened without probing again
+    [[nodiscard]] bool complete() const;
+};
+
+// Probed streams of inputs kept on disk, one file per input. Inputs are
+// identified by keys which include everything affecting their streams.
+class ProbeCache {
+public:
+    explicit ProbeCache(std::filesystem::path dir);
+
+    [[nodiscard]] static std::string make_key(
+        std::string_view url,
+        const std::optional<std::string>& file_format,
+        const std::map<std::string, std::string>& demuxer_options);
+
+    // Empty if there is no entry for the key or it cannot be parsed
+    [[nodiscard]] std::optional<std::vector<ProbedStream>>
+        load(const std::string& key) const;
+    // Replaces the entry atomically. Throws on I/O errors.
+    void save(const std::string& key, const std::vector<ProbedStream>& streams)
+        const;
+    void remove(const std::string& key) const;
+    [[nodiscard]] std::filesystem::path path_of(const std::string& key) const;
+
+private:
+    std::filesystem::path m_dir;
+};
+} // namespace vehlwn::ffmpeg
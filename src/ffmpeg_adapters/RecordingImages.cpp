@@ -0,0 +1,173 @@
+#include "RecordingImages.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <fstream>
+#include <exception>
+#include <ios>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+
+#include <boost/log/trivial.hpp>
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+
+namespace vehlwn::ffmpeg {
+namespace {
+// Keeps the aspect ratio of frame
+cv::Size scaled_size(const cv::Mat& frame, const int width)
+{
+    const auto height = static_cast<std::int64_t>(frame.rows) * width
+        / std::max(frame.cols, 1);
+    return {width, std::max(1, static_cast<int>(height))};
+}
+
+cv::Mat downscale(const cv::Mat& frame, const cv::Size size)
+{
+    auto ret = cv::Mat();
+    cv::resize(frame, ret, size, 0, 0, cv::INTER_AREA);
+    return ret;
+}
+
+void write_jpeg(
+    JpegEncoderPool& encoders,
+    const std::string& path,
+    const cv::Mat& image,
+    const JpegOptions& options)
+{
+    auto buf = std::string();
+    encoders.acquire()->encode(image, options, buf);
+    auto file = std::ofstream(path, std::ios::binary | std::ios::trunc);
+    file.write(buf.data(), static_cast<std::streamsize>(buf.size()));
+    file.close();
+    if(!file) {
+        throw std::runtime_error("Failed to write " + path);
+    }
+}
+} // namespace
+
+RecordingImages::RecordingImages(
+    const ApplicationSettings::OutputFiles::Thumbnails& settings,
+    std::shared_ptr<JpegEncoderPool>&& jpeg_encoders)
+    : m_settings{settings}
+    , m_jpeg_encoders{std::move(jpeg_encoders)}
+    , m_interval_us{std::max<std::int64_t>(
+          std::llround(settings.sprite_interval * 1e6),
+          1)}
+{}
+
+void RecordingImages::add(const MotionSample& sample, const cv::Mat& frame)
+{
+    const auto lock = std::lock_guard(m_mutex);
+    if(m_failed) {
+        return;
+    }
+    try {
+        add_locked(sample, frame);
+    } catch(const std::exception& ex) {
+        BOOST_LOG_TRIVIAL(error) << "Disabling recording images: " << ex.what();
+        m_failed = true;
+        m_peak_frame.release();
+        m_tiles.clear();
+    }
+}
+
+void RecordingImages::add_locked(const MotionSample& sample, const cv::Mat& frame)
+{
+    if(frame.empty()) {
+        return;
+    }
+    if(!m_start_pts_us) {
+        m_start_pts_us = sample.pts_us;
+    }
+    if(sample.moving_area > m_peak_moving_area) {
+        m_peak_moving_area = sample.moving_area;
+        m_peak_frame = frame;
+    }
+    const auto offset = sample.pts_us - *m_start_pts_us;
+    if(offset < m_next_tile_us) {
+        return;
+    }
+    // Tile i is the frame at i * interval. Missed slots repeat the frame.
+    const auto tile = downscale(
+        frame,
+        m_tiles.empty() ? scaled_size(frame, m_settings.sprite_tile_width)
+                        : m_tiles.front().size());
+    while(offset >= m_next_tile_us) {
+        m_tiles.push_back(tile);
+        m_next_tile_us += m_interval_us;
+        if(m_tiles.size() > static_cast<std::size_t>(m_settings.sprite_max_tiles)) {
+            // Keep every other tile so that the sheet still covers the whole
+            // recording with the same number of tiles
+            for(std::size_t i = 1; 2 * i < m_tiles.size(); i++) {
+                m_tiles[i] = std::move(m_tiles[2 * i]);
+            }
+            m_tiles.resize((m_tiles.size() + 1) / 2);
+            m_interval_us *= 2;
+            m_next_tile_us
+                = static_cast<std::int64_t>(m_tiles.size()) * m_interval_us;
+        }
+    }
+}
+
+void RecordingImages::write(const std::string& path, RecordingInfo& info) const
+{
+    const auto lock = std::lock_guard(m_mutex);
+    if(m_failed || m_peak_frame.empty() || m_tiles.empty()) {
+        return;
+    }
+    // The encoder scales the frame
+    write_jpeg(
+        *m_jpeg_encoders,
+        path + THUMBNAIL_EXTENSION,
+        m_peak_frame,
+        JpegOptions{.quality = m_settings.jpeg_quality, .width = m_settings.width});
+    info.has_thumbnail = true;
+
+    const auto count = static_cast<int>(m_tiles.size());
+    const auto columns = std::min(m_settings.sprite_columns, count);
+    const auto rows = (count + columns - 1) / columns;
+    const auto tile_size = m_tiles.front().size();
+    auto sheet = cv::Mat(
+        rows * tile_size.height,
+        columns * tile_size.width,
+        m_tiles.front().type(),
+        cv::Scalar::all(0));
+    for(int i = 0; i < count; i++) {
+        const auto roi = cv::Rect(
+            i % columns * tile_size.width,
+            i / columns * tile_size.height,
+            tile_size.width,
+            tile_size.height);
+        m_tiles[static_cast<std::size_t>(i)].copyTo(sheet(roi));
+    }
+    write_jpeg(
+        *m_jpeg_encoders,
+        path + SPRITE_EXTENSION,
+        sheet,
+        JpegOptions{.quality = m_settings.jpeg_quality});
+    info.sprite = SpriteSheet{
+        .tile_width = tile_size.width,
+        .tile_height = tile_size.height,
+        .columns = columns,
+        .count = count,
+        .interval = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::microseconds(m_interval_us)),
+    };
+}
+
+std::size_t RecordingImages::tile_count() const
+{
+    const auto lock = std::lock_guard(m_mutex);
+    return m_tiles.size();
+}
+
+std::int64_t RecordingImages::interval_us() const
+{
+    const auto lock = std::lock_guard(m_mutex);
+    return m_interval_us;
+}
+} // namespace vehlwn::ffmpeg
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <opencv2/core/mat.hpp>
+
+#include "../ApplicationSettings.hpp"
+#include "JpegEncoder.hpp"
+#include "RecordingInfo.hpp"
+#include "Timeline.hpp"
+
+namespace vehlwn::ffmpeg {
+// Thumbnail of the frame with the largest moving area and a sprite sheet of
+// evenly spaced frames of a recording. Frames are the BGR images decoded for
+// motion detection, so clips are not decoded again to browse them. Thread
+// safe: frames are added by the motion thread and written by a closing thread.
+class RecordingImages {
+public:
+    RecordingImages(
+        const ApplicationSettings::OutputFiles::Thumbnails& settings,
+        std::shared_ptr<JpegEncoderPool>&& jpeg_encoders);
+
+    // Samples must be added in order of pts_us. The frame of the largest moving
+    // area is referenced, not copied, so it must not be modified in place.
+    // Errors are logged and disable the images.
+    void add(const MotionSample& sample, const cv::Mat& frame);
+    // Writes path + THUMBNAIL_EXTENSION and path + SPRITE_EXTENSION and sets
+    // image fields of info. Nothing is written if no frames were added.
+    void write(const std::string& path, RecordingInfo& info) const;
+
+    [[nodiscard]] std::size_t tile_count() const;
+    // Time between tiles, microseconds
+    [[nodiscard]] std::int64_t interval_us() const;
+
+private:
+    ApplicationSettings::OutputFiles::Thumbnails m_settings;
+    std::shared_ptr<JpegEncoderPool> m_jpeg_encoders;
+    mutable std::mutex m_mutex;
+    bool m_failed = false;
+    cv::Mat m_peak_frame;
+    int m_peak_moving_area = -1;
+    std::optional<std::int64_t> m_start_pts_us;
+    std::int64_t m_interval_us;
+    // Offset of the next tile from the first frame
+    std::int64_t m_next_tile_us = 0;
+    std::vector<cv::Mat> m_tiles;
+
+    void add_locked(const MotionSample& sample, const cv::Mat& frame);
+};
+} // namespace vehlwn::ffmpeg
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+
+namespace vehlwn::ffmpeg {
+// Frames taken every interval from the start of a recording, scaled to tiles of
+// the same size and placed in a grid in row-major order
+struct SpriteSheet {
+    int tile_width = 0;
+    int tile_height = 0;
+    int columns = 0;
+    int count = 0;
+    std::chrono::milliseconds interval{0};
+};
+
+// Summary of a closed output file
+struct RecordingInfo {
+    std::string path;
+    std::chrono::system_clock::time_point start_time;
+    std::chrono::system_clock::time_point end_time;
+    std::uintmax_t size = 0;
+    int peak_moving_area = 0;
+    // Time of the frame with peak_moving_area from start_time
+    std::chrono::microseconds peak_offset{0};
+    // JPEG images written next to the file if [output_files.thumbnails] is
+    // enabled, see THUMBNAIL_EXTENSION and SPRITE_EXTENSION
+    bool has_thumbnail = false;
+    std::optional<SpriteSheet> sprite;
+};
+
+// Sidecar file path + PREVIEW_EXTENSION with a low resolution rendition is
+// written next to every recording if [output_files.preview] is enabled
+constexpr auto PREVIEW_EXTENSION = ".preview.mp4";
+// Frame with the largest moving area and the sprite sheet of a recording
+constexpr auto THUMBNAIL_EXTENSION = ".thumb.jpg";
+constexpr auto SPRITE_EXTENSION = ".sprite.jpg";
+
+// Called after an output file is closed. Can be called from background threads.
+using RecordingCallback = std::function<void(const RecordingInfo&)>;
+} // namespace vehlwn::ffmpeg
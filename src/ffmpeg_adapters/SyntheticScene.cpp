@@ -0,0 +1,228 @@
+#include "SyntheticScene.hpp"
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cmath>
+#include <cstddef>
+#include <sstream>
+#include <stdexcept>
+#include <system_error>
+
+#include <opencv2/imgproc.hpp>
+
+namespace vehlwn::ffmpeg {
+namespace {
+constexpr std::string_view MOVING_BOX = "moving_box";
+constexpr std::uint32_t BACKGROUND_COLOR = 0x202020;
+// RGB colors of boxes, repeated if there are more objects
+constexpr std::array<std::uint32_t, 6> BOX_COLORS{
+    0xF0F0F0,
+    0xF0C020,
+    0x20C0F0,
+    0xC020F0,
+    0x20F060,
+    0xF04040,
+};
+
+cv::Scalar to_bgr(const std::uint32_t rgb)
+{
+    return {
+        static_cast<double>(rgb & 0xFF),
+        static_cast<double>((rgb >> 8) & 0xFF),
+        static_cast<double>((rgb >> 16) & 0xFF)};
+}
+
+std::string format_hex(const std::uint32_t rgb)
+{
+    auto os = std::ostringstream();
+    os << "0x" << std::hex << std::uppercase << rgb;
+    return os.str();
+}
+
+// Shortest representation which is parsed back to the same double, so the
+// filter graph evaluates exactly the same path as boxes_at()
+std::string format_double(const double x)
+{
+    auto buf = std::array<char, 32>();
+    const auto [ptr, ec] = std::to_chars(buf.data(), buf.data() + buf.size(), x);
+    if(ec != std::errc()) {
+        throw std::runtime_error("format_double: to_chars failed");
+    }
+    return {buf.data(), ptr};
+}
+
+// Same expression as in the filter graph. mod(u, 2) of ffmpeg is computed as
+// u - floor(u / 2) * 2.
+double triangle_wave(const double u)
+{
+    return 1. - std::abs(u - std::floor(u / 2.) * 2. - 1.);
+}
+
+int parse_int(
+    const std::string_view key,
+    const std::string_view value,
+    const int min,
+    const int max)
+{
+    int ret = 0;
+    const auto* const end = value.data() + value.size();
+    const auto [ptr, ec] = std::from_chars(value.data(), end, ret);
+    if(ec != std::errc() || ptr != end || ret < min || ret > max) {
+        throw std::invalid_argument(
+            "synthetic: " + std::string(key) + " must be int in ["
+            + std::to_string(min) + ", " + std::to_string(max) + "]");
+    }
+    return ret;
+}
+} // namespace
+
+std::optional<SyntheticScene> SyntheticScene::from_url(std::string_view url)
+{
+    if(!url.starts_with(URL_PREFIX)) {
+        return std::nullopt;
+    }
+    url.remove_prefix(URL_PREFIX.size());
+    const auto query_pos = url.find('?');
+    const auto scene = url.substr(0, query_pos);
+    if(scene != MOVING_BOX) {
+        throw std::invalid_argument(
+            "synthetic: unknown scene '" + std::string(scene) + "'");
+    }
+    auto params = Params();
+    auto query = query_pos == std::string_view::npos ? std::string_view()
+                                                     : url.substr(query_pos + 1);
+    while(!query.empty()) {
+        const auto amp_pos = query.find('&');
+        const auto item = query.substr(0, amp_pos);
+        query = amp_pos == std::string_view::npos ? std::string_view()
+                                                  : query.substr(amp_pos + 1);
+        const auto eq_pos = item.find('=');
+        if(eq_pos == std::string_view::npos) {
+            throw std::invalid_argument(
+                "synthetic: parameter without value '" + std::string(item) + "'");
+        }
+        const auto key = item.substr(0, eq_pos);
+        const auto value = item.substr(eq_pos + 1);
+        if(key == "w") {
+            params.width = parse_int(key, value, 16, 8192);
+        } else if(key == "h") {
+            params.height = parse_int(key, value, 16, 8192);
+        } else if(key == "fps") {
+            params.fps = parse_int(key, value, 1, 1000);
+        } else if(key == "objects") {
+            params.objects = parse_int(key, value, 1, 64);
+        } else if(key == "realtime") {
+            params.realtime = parse_int(key, value, 0, 1) == 1;
+        } else {
+            throw std::invalid_argument(
+                "synthetic: unknown parameter '" + std::string(key) + "'");
+        }
+    }
+    return SyntheticScene(params);
+}
+
+SyntheticScene::SyntheticScene(const Params& params)
+    : m_params{params}
+    , m_box_size{std::max(1, params.width / 8), std::max(1, params.height / 8)}
+{
+    // yuv420p needs even sizes
+    if(params.width <= 0 || params.height <= 0 || params.width % 2 != 0
+       || params.height % 2 != 0) {
+        throw std::invalid_argument(
+            "synthetic: frame width and height must be positive and even");
+    }
+    if(params.fps <= 0 || params.objects <= 0) {
+        throw std::invalid_argument("synthetic: fps and objects must be positive");
+    }
+    // Incommensurate speeds so that boxes do not move in sync. Units are
+    // half periods per second: a box crosses the frame in 1 / speed seconds.
+    for(int i = 0; i < params.objects; i++) {
+        m_paths.push_back(Path{
+            .speed_x = 0.25 + 0.1 * i,
+            .phase_x = 0.5 * i,
+            .speed_y = 0.17 + 0.07 * i,
+            .phase_y = 0.2 + 0.3 * i,
+        });
+    }
+}
+
+const SyntheticScene::Params& SyntheticScene::params() const
+{
+    return m_params;
+}
+
+std::string SyntheticScene::filter_graph() const
+{
+    const auto range_x = m_params.width - m_box_size.width;
+    const auto range_y = m_params.height - m_box_size.height;
+    // Quotes keep commas of the expression inside the filter arguments
+    const auto coordinate
+        = [](const int range, const double speed, const double phase) {
+              return "'floor(" + std::to_string(range) + "*(1-abs(mod(t*"
+                  + format_double(speed) + "+" + format_double(phase)
+                  + ",2)-1)))'";
+          };
+    const auto color_source = [&](const std::uint32_t rgb, const cv::Size size) {
+        return "color=c=" + format_hex(rgb) + ":s=" + std::to_string(size.width)
+            + "x" + std::to_string(size.height)
+            + ":r=" + std::to_string(m_params.fps);
+    };
+    // Every box is a color source overlaid on the result of the previous one.
+    // x and y of overlay are evaluated for every frame, packed RGB keeps them
+    // exact while subsampled chroma would round them to even numbers.
+    auto ret = color_source(
+                   BACKGROUND_COLOR,
+                   cv::Size(m_params.width, m_params.height))
+        + "[bg0]";
+    for(std::size_t i = 0; i < m_paths.size(); i++) {
+        const auto& path = m_paths[i];
+        const auto index = std::to_string(i);
+        ret += ";" + color_source(BOX_COLORS[i % BOX_COLORS.size()], m_box_size)
+            + "[box" + index + "];[bg" + index + "][box" + index
+            + "]overlay=x=" + coordinate(range_x, path.speed_x, path.phase_x)
+            + ":y=" + coordinate(range_y, path.speed_y, path.phase_y)
+            + ":format=rgb[bg" + std::to_string(i + 1) + "]";
+    }
+    ret += ";[bg" + std::to_string(m_paths.size()) + "]format=yuv420p";
+    if(m_params.realtime) {
+        ret += ",realtime";
+    }
+    // The lavfi device takes the output labeled out0
+    return ret + "[out0]";
+}
+
+std::vector<cv::Rect> SyntheticScene::boxes_at(const std::int64_t n) const
+{
+    // drawbox computes time as pts * time_base with time_base = 1 / fps
+    const double t = static_cast<double>(n) * (1. / m_params.fps);
+    const auto range_x = m_params.width - m_box_size.width;
+    const auto range_y = m_params.height - m_box_size.height;
+    auto ret = std::vector<cv::Rect>();
+    ret.reserve(m_paths.size());
+    for(const auto& path : m_paths) {
+        const auto x
+            = std::floor(range_x * triangle_wave(t * path.speed_x + path.phase_x));
+        const auto y
+            = std::floor(range_y * triangle_wave(t * path.speed_y + path.phase_y));
+        ret.emplace_back(
+            cv::Point(static_cast<int>(x), static_cast<int>(y)),
+            m_box_size);
+    }
+    return ret;
+}
+
+void SyntheticScene::render(const std::int64_t n, cv::Mat& dst) const
+{
+    dst.create(m_params.height, m_params.width, CV_8UC3);
+    dst.setTo(to_bgr(BACKGROUND_COLOR));
+    const auto boxes = boxes_at(n);
+    for(std::size_t i = 0; i < boxes.size(); i++) {
+        cv::rectangle(
+            dst,
+            boxes[i],
+            to_bgr(BOX_COLORS[i % BOX_COLORS.size()]),
+            cv::FILLED);
+    }
+}
+} // namespace vehlwn::ffmpeg
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <opencv2/core/mat.hpp>
+#include <opencv2/core/types.hpp>
+
+namespace vehlwn::ffmpeg {
+// Generated input for testing without a camera. Filled boxes bounce over a dark
+// background along known paths. Frames come from a libavfilter graph opened with
+// the lavfi device, so decoding and recording work as with a real camera, and
+// boxes_at() gives exact positions to compare detected motion with.
+//
+// URL syntax: synthetic://moving_box?w=640&h=480&fps=25&objects=1&realtime=1
+// All parameters are optional. With realtime=0 frames are generated as fast as
+// they are read.
+class SyntheticScene {
+public:
+    static constexpr std::string_view URL_PREFIX = "synthetic://";
+
+    struct Params {
+        int width = 640;
+        int height = 480;
+        int fps = 25;
+        int objects = 1;
+        bool realtime = true;
+    };
+
+    // Returns std::nullopt if url does not start with URL_PREFIX. Throws
+    // std::invalid_argument for an unknown scene or a bad parameter.
+    static std::optional<SyntheticScene> from_url(std::string_view url);
+
+    explicit SyntheticScene(const Params& params);
+
+    [[nodiscard]] const Params& params() const;
+    // Filter graph description for the lavfi input format
+    [[nodiscard]] std::string filter_graph() const;
+    // Boxes of frame n, i.e. at time n / fps
+    [[nodiscard]] std::vector<cv::Rect> boxes_at(std::int64_t n) const;
+    // Draws frame n as an 8-bit BGR image like the decoded frames. Colors may
+    // differ from lavfi output by YUV conversion, boxes are the same.
+    void render(std::int64_t n, cv::Mat& dst) const;
+
+private:
+    // Box i moves along x and y with triangle waves of its own speed and phase
+    struct Path {
+        double speed_x;
+        double phase_x;
+        double speed_y;
+        double phase_y;
+    };
+
+    Params m_params;
+    cv::Size m_box_size;
+    std::vector<Path> m_paths;
+};
+} // namespace vehlwn::ffmpeg
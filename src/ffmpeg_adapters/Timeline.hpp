@@ -0,0 +1,52 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+namespace vehlwn::ffmpeg {
+// Motion heatmap is a grid of TIMELINE_GRID_COLS x TIMELINE_GRID_ROWS cells in
+// row-major order. Every cell is the share of foreground pixels scaled to 0-255.
+constexpr int TIMELINE_GRID_COLS = 8;
+constexpr int TIMELINE_GRID_ROWS = 8;
+using MotionHeatmap
+    = std::array<std::uint8_t, TIMELINE_GRID_COLS * TIMELINE_GRID_ROWS>;
+
+// Motion statistics of one processed video frame
+struct MotionSample {
+    // Timestamp of the decoded frame, microseconds
+    std::int64_t pts_us = 0;
+    int moving_area = 0;
+    int blob_count = 0;
+    MotionHeatmap heatmap{};
+};
+
+// Sidecar file path + TIMELINE_EXTENSION is written next to every recording. It
+// consists of TimelineHeader followed by TimelineRecord for every frame. Numbers
+// are in host byte order.
+constexpr auto TIMELINE_EXTENSION = ".timeline";
+constexpr std::array<char, 8> TIMELINE_MAGIC{'M', 'D', 'T', 'L', 'I', 'N', 'E', 0};
+constexpr std::uint32_t TIMELINE_VERSION = 1;
+
+struct TimelineHeader {
+    std::array<char, 8> magic;
+    std::uint32_t version;
+    std::uint32_t record_size;
+    std::uint8_t grid_cols;
+    std::uint8_t grid_rows;
+    std::uint16_t reserved;
+    std::uint32_t reserved2;
+    // Unix time of the first video packet of the recording, microseconds
+    std::int64_t start_time_us;
+};
+static_assert(sizeof(TimelineHeader) == 32);
+
+struct TimelineRecord {
+    // Frame timestamp relative to the first video packet of the recording
+    std::uint32_t pts_ms;
+    std::uint32_t moving_area;
+    std::uint16_t blob_count;
+    std::uint16_t reserved;
+    MotionHeatmap heatmap;
+};
+static_assert(sizeof(TimelineRecord) == 76);
+} // namespace vehlwn::ffmpeg
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+namespace vehlwn::ffmpeg {
+// Metrics of a write-behind output file
+struct WriteStats {
+    std::uint64_t bytes_written = 0;
+    std::uint64_t writes = 0;
+    std::size_t queued_bytes = 0;
+    std::size_t max_queued_bytes = 0;
+    // Number of times the encoding thread waited for free buffer space
+    std::uint64_t producer_stalls = 0;
+    std::chrono::nanoseconds total_write_time{0};
+    std::chrono::nanoseconds max_write_time{0};
+};
+
+inline std::ostream& operator<<(std::ostream& os, const WriteStats& x)
+{
+    using Millis = std::chrono::duration<double, std::milli>;
+    const auto avg_write_time = x.writes == 0
+        ? Millis(0)
+        : Millis(x.total_write_time) / static_cast<double>(x.writes);
+    os << "bytes_written = " << x.bytes_written << ", writes = " << x.writes
+       << ", queued_bytes = " << x.queued_bytes
+       << ", max_queued_bytes = " << x.max_queued_bytes
+       << ", producer_stalls = " << x.producer_stalls
+       << ", avg_write_ms = " << avg_write_time.count()
+       << ", max_write_ms = " << Millis(x.max_write_time).count();
+    return os;
+}
+} // namespace vehlwn::ffmpeg
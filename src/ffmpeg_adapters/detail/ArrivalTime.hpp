@@ -0,0 +1,32 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+
+namespace vehlwn::ffmpeg::detail {
+// Monotonic time when a packet was read from the input. It is kept in the opaque
+// field of AVPacket and AVFrame, decoders opened with AV_CODEC_FLAG_COPY_OPAQUE
+// copy it from packets to frames in presentation order.
+using ArrivalTime = std::chrono::steady_clock::time_point;
+
+inline void* arrival_time_to_opaque(const ArrivalTime x)
+{
+    static_assert(sizeof(void*) >= sizeof(std::int64_t));
+    const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        x.time_since_epoch())
+                        .count();
+    // NOLINTNEXTLINE: the pointer is never dereferenced
+    return reinterpret_cast<void*>(static_cast<std::intptr_t>(ns));
+}
+
+inline std::optional<ArrivalTime> arrival_time_from_opaque(const void* const x)
+{
+    if(x == nullptr) {
+        return std::nullopt;
+    }
+    // NOLINTNEXTLINE: the pointer is never dereferenced
+    const auto ns = std::chrono::nanoseconds(reinterpret_cast<std::intptr_t>(x));
+    return ArrivalTime(std::chrono::duration_cast<ArrivalTime::duration>(ns));
+}
+} // namespace vehlwn::ffmpeg::detail
@@ -0,0 +1,254 @@
+#include "AsyncFileWriter.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <exception>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <boost/log/attributes/named_scope.hpp>
+#include <boost/log/trivial.hpp>
+
+namespace vehlwn::ffmpeg::detail {
+namespace {
+// Consecutive writes are merged into one chunk up to this size
+constexpr std::size_t MAX_CHUNK_SIZE = 1 << 20;
+
+std::system_error last_system_error(const char* const what)
+{
+    return {errno, std::generic_category(), what};
+}
+
+int open_file(const char* const path)
+{
+    const int fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    if(fd == -1) {
+        throw last_system_error("Failed to open output file");
+    }
+    return fd;
+}
+} // namespace
+
+AsyncFileWriter::AsyncFileWriter(
+    const char* const path,
+    const std::size_t buffer_size,
+    const FsyncPolicy fsync,
+    const OpenPolicy open)
+    : m_path(path)
+    , m_buffer_size(buffer_size)
+    , m_fsync(fsync)
+{
+    if(open == OpenPolicy::Now) {
+        m_fd = open_file(path);
+    }
+    m_thread = std::thread(&AsyncFileWriter::thread_func, this);
+}
+
+AsyncFileWriter::~AsyncFileWriter()
+{
+    try {
+        close();
+    } catch(const std::exception& ex) {
+        BOOST_LOG_TRIVIAL(error) << "~AsyncFileWriter: " << ex.what();
+    }
+}
+
+void AsyncFileWriter::write(const boost::span<const std::uint8_t> data)
+{
+    std::unique_lock lock(m_mutex);
+    throw_if_failed();
+    if(m_closing) {
+        throw std::runtime_error("Write to closed file");
+    }
+    if(m_stats.queued_bytes != 0
+       && m_stats.queued_bytes + data.size() > m_buffer_size) {
+        m_stats.producer_stalls++;
+        BOOST_LOG_TRIVIAL(debug)
+            << "Write-behind buffer is full, queued " << m_stats.queued_bytes
+            << " bytes";
+        m_not_full.wait(lock, [&] {
+            return m_stats.queued_bytes == 0
+                || m_stats.queued_bytes + data.size() <= m_buffer_size
+                || m_error.has_value();
+        });
+        throw_if_failed();
+    }
+    const bool can_merge = !m_queue.empty()
+        && m_queue.back().offset
+                + static_cast<std::int64_t>(m_queue.back().data.size())
+            == m_position
+        && m_queue.back().data.size() + data.size() <= MAX_CHUNK_SIZE;
+    if(can_merge) {
+        auto& back = m_queue.back().data;
+        back.insert(back.end(), data.begin(), data.end());
+    } else {
+        m_queue.push_back(Chunk{m_position, {data.begin(), data.end()}});
+    }
+    m_stats.queued_bytes += data.size();
+    m_stats.max_queued_bytes
+        = std::max(m_stats.max_queued_bytes, m_stats.queued_bytes);
+    m_position += static_cast<std::int64_t>(data.size());
+    m_size = std::max(m_size, m_position);
+    m_not_empty.notify_one();
+}
+
+std::int64_t AsyncFileWriter::seek(const std::int64_t offset, const int whence)
+{
+    const std::lock_guard lock(m_mutex);
+    std::int64_t ret = -1;
+    switch(whence) {
+        case SEEK_SET:
+            ret = offset;
+            break;
+        case SEEK_CUR:
+            ret = m_position + offset;
+            break;
+        case SEEK_END:
+            ret = m_size + offset;
+            break;
+        default:
+            return -1;
+    }
+    if(ret < 0) {
+        return -1;
+    }
+    m_position = ret;
+    return ret;
+}
+
+std::int64_t AsyncFileWriter::size() const
+{
+    const std::lock_guard lock(m_mutex);
+    return m_size;
+}
+
+void AsyncFileWriter::close()
+{
+    BOOST_LOG_FUNCTION();
+    if(!m_thread.joinable()) {
+        return;
+    }
+    {
+        const std::lock_guard lock(m_mutex);
+        m_closing = true;
+    }
+    m_not_empty.notify_one();
+    m_thread.join();
+
+    auto error = std::optional<std::system_error>();
+    if(m_fd == -1) {
+        // Failed to open on the I/O thread, m_error is set
+        throw_if_failed();
+    }
+    if(m_fsync != FsyncPolicy::Never && ::fsync(m_fd) != 0) {
+        error = last_system_error("fsync failed");
+    }
+    if(::close(m_fd) != 0 && !error) {
+        error = last_system_error("close failed");
+    }
+    m_fd = -1;
+    throw_if_failed();
+    if(error) {
+        throw *error;
+    }
+}
+
+WriteStats AsyncFileWriter::stats() const
+{
+    const std::lock_guard lock(m_mutex);
+    return m_stats;
+}
+
+void AsyncFileWriter::thread_func()
+{
+    BOOST_LOG_FUNCTION();
+    if(m_fd == -1) {
+        // OpenPolicy::OnThread. Only this thread uses m_fd until close() joins
+        // it, the mutex is not held so that writers are not blocked.
+        try {
+            m_fd = open_file(m_path.c_str());
+        } catch(const std::exception& ex) {
+            BOOST_LOG_TRIVIAL(error)
+                << "Write-behind thread: " << ex.what() << ": " << m_path;
+            const std::lock_guard lock(m_mutex);
+            m_error = ex.what();
+            m_queue.clear();
+            m_stats.queued_bytes = 0;
+            m_not_full.notify_all();
+            return;
+        }
+    }
+    std::unique_lock lock(m_mutex);
+    while(true) {
+        m_not_empty.wait(lock, [&] { return !m_queue.empty() || m_closing; });
+        if(m_queue.empty()) {
+            break;
+        }
+        auto chunk = std::move(m_queue.front());
+        m_queue.pop_front();
+        lock.unlock();
+
+        const auto start = std::chrono::steady_clock::now();
+        auto error = std::optional<std::string>();
+        try {
+            write_chunk(chunk);
+            if(m_fsync == FsyncPolicy::Always && ::fsync(m_fd) != 0) {
+                throw last_system_error("fsync failed");
+            }
+        } catch(const std::exception& ex) {
+            BOOST_LOG_TRIVIAL(error) << "Write-behind thread: " << ex.what();
+            error = ex.what();
+        }
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+
+        lock.lock();
+        m_stats.queued_bytes -= chunk.data.size();
+        if(error) {
+            // Drop everything, the file is broken anyway
+            m_error = std::move(error);
+            m_queue.clear();
+            m_stats.queued_bytes = 0;
+        } else {
+            m_stats.bytes_written += chunk.data.size();
+            m_stats.writes++;
+            m_stats.total_write_time += elapsed;
+            m_stats.max_write_time = std::max(
+                m_stats.max_write_time,
+                std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed));
+        }
+        m_not_full.notify_all();
+    }
+}
+
+void AsyncFileWriter::write_chunk(const Chunk& chunk) const
+{
+    std::size_t done = 0;
+    while(done < chunk.data.size()) {
+        const auto n = ::pwrite(
+            m_fd,
+            chunk.data.data() + done,
+            chunk.data.size() - done,
+            static_cast<off_t>(chunk.offset + static_cast<std::int64_t>(done)));
+        if(n < 0) {
+            if(errno == EINTR) {
+                continue;
+            }
+            throw last_system_error("pwrite failed");
+        }
+        done += static_cast<std::size_t>(n);
+    }
+}
+
+void AsyncFileWriter::throw_if_failed() const
+{
+    if(m_error) {
+        throw std::runtime_error("Write-behind I/O failed: " + *m_error);
+    }
+}
+} // namespace vehlwn::ffmpeg::detail
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/core/span.hpp>
+
+#include "../WriteStats.hpp"
+
+namespace vehlwn::ffmpeg::detail {
+// Write-behind file. Data is copied into a bounded queue and written at tracked
+// offsets by a separate I/O thread, so seeking does not wait for the queue. A
+// producer blocks only when buffer_size bytes are waiting.
+class AsyncFileWriter {
+public:
+    enum class FsyncPolicy { Never, OnClose, Always };
+    // Now throws from the constructor if the file cannot be opened. OnThread
+    // opens it on the I/O thread, so the constructor does no I/O and an open
+    // error is thrown by a later write() or close().
+    enum class OpenPolicy { Now, OnThread };
+
+    AsyncFileWriter(
+        const char* path,
+        std::size_t buffer_size,
+        FsyncPolicy fsync,
+        OpenPolicy open = OpenPolicy::Now);
+    AsyncFileWriter(const AsyncFileWriter&) = delete;
+    AsyncFileWriter(AsyncFileWriter&&) = delete;
+    ~AsyncFileWriter();
+    AsyncFileWriter& operator=(const AsyncFileWriter&) = delete;
+    AsyncFileWriter& operator=(AsyncFileWriter&&) = delete;
+
+    // Queues data at current position. Throws if the I/O thread failed.
+    void write(boost::span<const std::uint8_t> data);
+    // Returns new position or -1 on invalid arguments.
+    std::int64_t seek(std::int64_t offset, int whence);
+    [[nodiscard]] std::int64_t size() const;
+    // Writes all queued data, syncs and closes the file. Throws on I/O errors.
+    void close();
+    [[nodiscard]] WriteStats stats() const;
+
+private:
+    struct Chunk {
+        std::int64_t offset = 0;
+        std::vector<std::uint8_t> data;
+    };
+
+    std::string m_path;
+    int m_fd = -1;
+    std::size_t m_buffer_size;
+    FsyncPolicy m_fsync;
+    std::int64_t m_position = 0;
+    std::int64_t m_size = 0;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_not_empty;
+    std::condition_variable m_not_full;
+    std::deque<Chunk> m_queue;
+    bool m_closing = false;
+    std::optional<std::string> m_error;
+    WriteStats m_stats;
+    std::thread m_thread;
+
+    void thread_func();
+    void write_chunk(const Chunk& chunk) const;
+    void throw_if_failed() const;
+};
+} // namespace vehlwn::ffmpeg::detail
@@ -17,6 +17,7 @@ extern "C" {
 }
 
 #include "../ErrorWithContext.hpp"
+#include "ArrivalTime.hpp"
 #include "AvError.hpp"
 
 namespace vehlwn::ffmpeg::detail {
@@ -50,6 +51,16 @@ public:
     {
         std::swap(m_raw, rhs.m_raw);
     }
+    // New reference to the same data with a copy of properties
+    [[nodiscard]] OwningAvframe clone() const
+    {
+        OwningAvframe ret;
+        const int errnum = av_frame_ref(ret.raw(), m_raw);
+        if(errnum < 0) {
+            throw ErrorWithContext("av_frame_ref failed: ", AvError(errnum));
+        }
+        return ret;
+    }
     AVFrame* raw()
     {
         return m_raw;
@@ -82,6 +93,14 @@ public:
     {
         return m_raw->best_effort_timestamp;
     }
+    void set_arrival_time(const ArrivalTime x) const
+    {
+        m_raw->opaque = arrival_time_to_opaque(x);
+    }
+    [[nodiscard]] std::optional<ArrivalTime> arrival_time() const
+    {
+        return arrival_time_from_opaque(m_raw->opaque);
+    }
     [[nodiscard]] const std::uint8_t** extended_data() const
     {
         // NOLINTNEXTLINE: adding const to non const data
@@ -95,6 +114,16 @@ public:
     {
         m_raw->nb_samples = x;
     }
+    // Copies data only if it is still referenced elsewhere, e.g. by an encoder
+    void make_writable() const
+    {
+        const int errnum = av_frame_make_writable(m_raw);
+        if(errnum < 0) {
+            throw ErrorWithContext(
+                "av_frame_make_writable failed: ",
+                AvError(errnum));
+        }
+    }
     void set_ch_layout(const AVChannelLayout& x) const
     {
         const int errnum = av_channel_layout_copy(&m_raw->ch_layout, &x);
@@ -11,6 +11,10 @@ extern "C" {
 #include <libavutil/rational.h>
 }
 
+#include "../ErrorWithContext.hpp"
+#include "ArrivalTime.hpp"
+#include "AvError.hpp"
+
 namespace vehlwn::ffmpeg::detail {
 class OwningAvPacket {
     AVPacket* m_raw = nullptr;
@@ -43,6 +47,17 @@ public:
         std::swap(m_raw, rhs.m_raw);
     }
 
+    // New reference to the same data
+    [[nodiscard]] OwningAvPacket clone() const
+    {
+        OwningAvPacket ret;
+        const int errnum = av_packet_ref(ret.raw(), m_raw);
+        if(errnum < 0) {
+            throw ErrorWithContext("av_packet_ref failed: ", AvError(errnum));
+        }
+        return ret;
+    }
+
     [[nodiscard]] const AVPacket* raw() const
     {
         return m_raw;
@@ -75,5 +90,19 @@ public:
     {
         m_raw->dts = x;
     }
+    void set_arrival_time(const ArrivalTime x) const
+    {
+        m_raw->opaque = arrival_time_to_opaque(x);
+    }
+    [[nodiscard]] bool is_key() const
+    {
+        return (static_cast<unsigned>(m_raw->flags)
+                & static_cast<unsigned>(AV_PKT_FLAG_KEY))
+            != 0U;
+    }
+    void rescale_ts(const AVRational src_tb, const AVRational dst_tb)
+    {
+        av_packet_rescale_ts(m_raw, src_tb, dst_tb);
+    }
 };
 } // namespace vehlwn::ffmpeg::detail
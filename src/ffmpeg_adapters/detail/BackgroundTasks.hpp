@@ -0,0 +1,64 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <future>
+#include <utility>
+#include <vector>
+
+#include <boost/log/trivial.hpp>
+
+namespace vehlwn::ffmpeg::detail {
+// Tasks such as closing files which run on their own threads. Starting a task
+// never waits for previous ones, unlike assigning a std::async future over a
+// running one. The destructor waits for all tasks. Not thread safe.
+class BackgroundTasks {
+public:
+    BackgroundTasks() = default;
+    BackgroundTasks(const BackgroundTasks&) = delete;
+    BackgroundTasks(BackgroundTasks&&) = delete;
+    ~BackgroundTasks()
+    {
+        wait();
+    }
+    BackgroundTasks& operator=(const BackgroundTasks&) = delete;
+    BackgroundTasks& operator=(BackgroundTasks&&) = delete;
+
+    // f must handle its own errors. Objects captured by f are destroyed on the
+    // calling thread if f does not move them into locals.
+    template<class F>
+    void run(F&& f)
+    {
+        forget_finished();
+        if(!m_pending.empty()) {
+            BOOST_LOG_TRIVIAL(debug)
+                << m_pending.size() << " background tasks are still running";
+        }
+        m_pending.push_back(std::async(std::launch::async, std::forward<F>(f)));
+    }
+
+    void wait()
+    {
+        for(auto& f : m_pending) {
+            f.wait();
+        }
+        m_pending.clear();
+    }
+
+    [[nodiscard]] std::size_t pending()
+    {
+        forget_finished();
+        return m_pending.size();
+    }
+
+private:
+    std::vector<std::future<void>> m_pending;
+
+    void forget_finished()
+    {
+        std::erase_if(m_pending, [](const std::future<void>& f) {
+            return f.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+        });
+    }
+};
+} // namespace vehlwn::ffmpeg::detail
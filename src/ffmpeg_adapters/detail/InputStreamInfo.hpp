@@ -0,0 +1,93 @@
+#pragma once
+
+#include <map>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavutil/rational.h>
+}
+
+#include "ScopedAvCodecParameters.hpp"
+#include "ScopedAvFormatInput.hpp"
+#include "ScopedDecoderContext.hpp"
+
+namespace vehlwn::ffmpeg::detail {
+// Snapshot of a decoded input stream properties needed to set up an encoder.
+// Output files are opened in background while decoder contexts are in use by the
+// reading thread so they cannot be accessed directly.
+class InputStreamInfo {
+    ScopedAvCodecParameters m_parameters;
+    AVRational m_time_base{};
+
+public:
+    InputStreamInfo(
+        const ScopedDecoderContext& decoder_context,
+        const AVRational stream_time_base)
+        : m_time_base(stream_time_base)
+    {
+        m_parameters.copy_from_context(decoder_context.raw());
+    }
+
+    [[nodiscard]] AVMediaType codec_type() const
+    {
+        return m_parameters.raw()->codec_type;
+    }
+    [[nodiscard]] AVCodecID codec_id() const
+    {
+        return m_parameters.raw()->codec_id;
+    }
+    // Codec parameters of a stream copied without decoding
+    void copy_parameters_to(AVCodecParameters* const dst) const
+    {
+        m_parameters.copy_to(dst);
+    }
+    [[nodiscard]] int width() const
+    {
+        return m_parameters.raw()->width;
+    }
+    [[nodiscard]] int height() const
+    {
+        return m_parameters.raw()->height;
+    }
+    [[nodiscard]] AVRational sample_aspect_ratio() const
+    {
+        return m_parameters.raw()->sample_aspect_ratio;
+    }
+    [[nodiscard]] AVRational framerate() const
+    {
+        return m_parameters.raw()->framerate;
+    }
+    [[nodiscard]] int sample_rate() const
+    {
+        return m_parameters.raw()->sample_rate;
+    }
+    [[nodiscard]] const AVChannelLayout& ch_layout() const
+    {
+        return m_parameters.raw()->ch_layout;
+    }
+    [[nodiscard]] AVSampleFormat sample_fmt() const
+    {
+        return static_cast<AVSampleFormat>(m_parameters.raw()->format);
+    }
+    // Time base of the input stream
+    [[nodiscard]] AVRational time_base() const
+    {
+        return m_time_base;
+    }
+};
+
+using InputStreamsInfo = std::map<int, InputStreamInfo>;
+
+inline InputStreamsInfo make_input_streams_info(
+    const std::map<int, ScopedDecoderContext>& decoder_contexts,
+    const ScopedAvFormatInput::StreamsView in_streams)
+{
+    auto ret = InputStreamsInfo();
+    for(const auto& [in_stream_index, decoder_context] : decoder_contexts) {
+        const auto time_base
+            = in_streams[static_cast<std::size_t>(in_stream_index)]->time_base;
+        ret.emplace(in_stream_index, InputStreamInfo(decoder_context, time_base));
+    }
+    return ret;
+}
+} // namespace vehlwn::ffmpeg::detail
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+#include <boost/log/trivial.hpp>
+
+namespace vehlwn::ffmpeg::detail {
+// Runs callbacks of background tasks in the order their tickets were taken
+// although the tasks finish in any order. A completed ticket waits for all
+// earlier ones, a ticket destroyed without a callback is skipped. Callbacks run
+// on the thread which completes the last missing ticket. Thread safe.
+class OrderedCallbacks : public std::enable_shared_from_this<OrderedCallbacks> {
+public:
+    class Ticket {
+    public:
+        Ticket(const Ticket&) = delete;
+        Ticket(Ticket&& rhs) noexcept
+            : m_owner(std::move(rhs.m_owner))
+            , m_id(rhs.m_id)
+        {}
+        ~Ticket()
+        {
+            if(m_owner) {
+                m_owner->complete(m_id, nullptr);
+            }
+        }
+        Ticket& operator=(const Ticket&) = delete;
+        Ticket& operator=(Ticket&&) = delete;
+
+        // Runs f now or after callbacks of all earlier tickets
+        void complete(std::function<void()>&& f)
+        {
+            const auto owner = std::move(m_owner);
+            owner->complete(m_id, std::move(f));
+        }
+
+    private:
+        friend class OrderedCallbacks;
+        Ticket(std::shared_ptr<OrderedCallbacks>&& owner, const std::uint64_t id)
+            : m_owner(std::move(owner))
+            , m_id(id)
+        {}
+
+        std::shared_ptr<OrderedCallbacks> m_owner;
+        std::uint64_t m_id;
+    };
+
+    // Must be owned by a std::shared_ptr
+    [[nodiscard]] Ticket take()
+    {
+        const auto lock = std::lock_guard(m_mutex);
+        return {shared_from_this(), m_next_ticket++};
+    }
+
+private:
+    std::mutex m_mutex;
+    std::uint64_t m_next_ticket = 0;
+    std::uint64_t m_next_to_run = 0;
+    // Completed tickets waiting for earlier ones, empty if skipped
+    std::map<std::uint64_t, std::function<void()>> m_completed;
+
+    void complete(const std::uint64_t id, std::function<void()>&& f)
+    {
+        // Held while running so that callbacks of later tickets completed on
+        // other threads do not overtake
+        const auto lock = std::lock_guard(m_mutex);
+        m_completed.emplace(id, std::move(f));
+        while(!m_completed.empty()
+              && m_completed.begin()->first == m_next_to_run) {
+            const auto node = m_completed.extract(m_completed.begin());
+            m_next_to_run++;
+            if(!node.mapped()) {
+                continue;
+            }
+            try {
+                node.mapped()();
+            } catch(const std::exception& ex) {
+                BOOST_LOG_TRIVIAL(error) << "Ordered callback failed: " << ex.what();
+            }
+        }
+    }
+};
+} // namespace vehlwn::ffmpeg::detail
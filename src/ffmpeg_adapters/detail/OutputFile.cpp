@@ -1,14 +1,20 @@
 #include "OutputFile.hpp"
 
 #include <algorithm>
+#include <chrono>
 #include <cstddef>
 #include <cstdint>
 #include <exception>
+#include <filesystem>
+#include <future>
 #include <iostream>
+#include <map>
 #include <memory>
 #include <optional>
 #include <stdexcept>
 #include <string>
+#include <system_error>
+#include <utility>
 #include <vector>
 
 #include <boost/core/span.hpp>
@@ -26,26 +32,164 @@ extern "C" {
 #include <libavutil/rational.h>
 }
 
+#include "../HotPathLogging.hpp"
 #include "AVRationalOutput.hpp"
 #include "AvFrameAdapters.hpp"
 #include "AvPacketAdapters.hpp"
+#include "BackgroundTasks.hpp"
+#include "OrderedCallbacks.hpp"
+#include "PreviewEncoder.hpp"
+#include "ScopedAsyncAvioContext.hpp"
 #include "ScopedAvAudioFifo.hpp"
-#include "ScopedAvFormatInput.hpp"
+#include "ScopedAvCodecParameters.hpp"
+#include "ScopedAvDictionary.hpp"
 #include "ScopedAvFormatOutput.hpp"
 #include "ScopedAvSAmplesBuffer.hpp"
 #include "ScopedEncoderContext.hpp"
+#include "SegmentOffsets.hpp"
 #include "SwrResampler.hpp"
 #include "SwsPixelConverter.hpp"
+#include "TimelineWriter.hpp"
 #include "detail/HardwareHelpers.hpp"
 
 namespace vehlwn::ffmpeg::detail {
+namespace {
+// Frames in the encoder are bounded by its delay, e.g. lookahead of libx264
+constexpr std::size_t MAX_PENDING_ARRIVAL_TIMES = 256;
+// The next segment is opened this long before its boundary, so that it is
+// ready for the first keyframe after the boundary
+constexpr double SEGMENT_OPEN_LEAD_SECONDS = 2.0;
+
+void write_header_with_options(
+    const ScopedAvFormatOutput& out_format_context,
+    const std::map<std::string, std::string>& muxer_options)
+{
+    auto options = ScopedAvDictionary::from_std_map(muxer_options);
+    BOOST_LOG_TRIVIAL(debug) << "Muxer options = " << options;
+    out_format_context.write_header(options);
+    if(options.size() != 0) {
+        BOOST_LOG_TRIVIAL(error) << "Unsupported muxer options: " << options;
+        throw std::runtime_error("Found unsupported muxer options");
+    }
+}
+
+std::optional<WriteBehindOptions>
+    make_write_behind_options(const ApplicationSettings::OutputFiles& settings)
+{
+    const auto& write_behind = settings.write_behind;
+    if(!write_behind) {
+        return std::nullopt;
+    }
+    using Fsync = ApplicationSettings::OutputFiles::WriteBehind::Fsync;
+    const auto fsync = [&] {
+        switch(write_behind->fsync) {
+            case Fsync::Never:
+                return AsyncFileWriter::FsyncPolicy::Never;
+            case Fsync::OnClose:
+                return AsyncFileWriter::FsyncPolicy::OnClose;
+            case Fsync::Always:
+                return AsyncFileWriter::FsyncPolicy::Always;
+        }
+        throw std::runtime_error("Unreachable!");
+    }();
+    return WriteBehindOptions{write_behind->buffer_size, fsync};
+}
+
+// Waits for buffered data and logs write-behind metrics
+void close_output(
+    const ScopedAvFormatOutput& format_context,
+    const std::string& path)
+{
+    format_context.close_async_io();
+    if(const auto stats = format_context.write_stats()) {
+        BOOST_LOG_TRIVIAL(debug)
+            << "Write-behind stats for '" << path << "': " << *stats;
+    }
+}
+
+void notify_closed(const RecordingCallback& on_close, RecordingInfo&& info)
+{
+    if(!on_close) {
+        return;
+    }
+    auto ec = std::error_code();
+    const auto size = std::filesystem::file_size(info.path, ec);
+    if(!ec) {
+        info.size = size;
+    }
+    try {
+        on_close(info);
+    } catch(const std::exception& ex) {
+        BOOST_LOG_TRIVIAL(error) << "Recording callback failed: " << ex.what();
+    }
+}
+
+// Closes finish in any order, the index expects them in the order of tickets
+void complete_close(
+    OrderedCallbacks::Ticket&& ticket,
+    const RecordingCallback& on_close,
+    RecordingInfo&& info)
+{
+    ticket.complete([on_close, info = std::move(info)]() mutable {
+        notify_closed(on_close, std::move(info));
+    });
+}
+
+void write_images(
+    const std::shared_ptr<RecordingImages>& images,
+    RecordingInfo& info)
+{
+    if(!images) {
+        return;
+    }
+    try {
+        images->write(info.path, info);
+    } catch(const std::exception& ex) {
+        // The recording is indexed without images
+        BOOST_LOG_TRIVIAL(error)
+            << "Failed to write images of '" << info.path << "': " << ex.what();
+    }
+}
+
+struct OutputSegment {
+    std::string path;
+    ScopedAvFormatOutput format_context;
+};
+
+// Creates a new file with the same streams as the first one and writes its header.
+OutputSegment open_segment(
+    std::string&& path,
+    const std::vector<ScopedAvCodecParameters>& stream_parameters,
+    const std::vector<AVRational>& stream_time_bases,
+    const ApplicationSettings::OutputFiles& settings)
+{
+    BOOST_LOG_FUNCTION();
+    auto format_context = ScopedAvFormatOutput(
+        path.data(),
+        make_write_behind_options(settings));
+    for(std::size_t i = 0; i < stream_parameters.size(); i++) {
+        AVStream* const out_stream = format_context.new_stream();
+        stream_parameters[i].copy_to(out_stream->codecpar);
+        out_stream->time_base = stream_time_bases[i];
+    }
+    write_header_with_options(format_context, settings.muxer_options);
+    return {std::move(path), std::move(format_context)};
+}
+} // namespace
+
 struct OutputFile::Impl {
     std::shared_ptr<const ApplicationSettings> settings;
+    std::string path;
+    PathGenerator next_segment_path;
     ScopedAvFormatOutput out_format_context;
-    std::vector<ScopedEncoderContext> encoder_contexts;
+    // Out streams without an encoder are copied from the input
+    std::map<int, ScopedEncoderContext> encoder_contexts;
     std::map<int, int> in_out_stream_mapping;
     std::map<int, ScopedAvAudioFifo> audio_fifos;
     std::map<int, ScopedSwrResampler> resamplers;
+    // Reused for every audio frame of an out stream
+    std::map<int, ScopedAvSAmplesBuffer> converted_samples;
+    std::map<int, OwningAvframe> encoder_frames;
     std::optional<SwsPixelConverter> video_pix_converter;
     std::map<int, AVRational> orig_stream_time_bases;
 
@@ -53,16 +197,68 @@ struct OutputFile::Impl {
     std::map<int, std::int64_t> next_pts;
     std::map<int, std::int64_t> last_mux_dts;
 
+    // Segmentation state. Encoders produce one continuous timeline in
+    // packet_time_bases which is shifted by segment_offsets for every file.
+    std::vector<ScopedAvCodecParameters> stream_parameters;
+    std::vector<AVRational> stream_time_bases;
+    std::vector<AVRational> packet_time_bases;
+    SegmentOffsets segment_offsets{0};
+    std::int64_t segment_start_dts = 0;
+    std::future<OutputSegment> next_segment;
+    // Closing previous segments. Several may drain at once when segments are
+    // shorter than a drain of the write-behind buffer.
+    BackgroundTasks segment_closes;
+
+    bool has_packets = false;
+    std::optional<std::chrono::steady_clock::time_point> activation_time;
+    std::optional<std::chrono::steady_clock::duration> start_latency;
+
+    RecordingCallback on_close;
+    // Closed segments are reported in the order they stopped being written
+    std::shared_ptr<OrderedCallbacks> close_order;
+    std::optional<OrderedCallbacks::Ticket> close_ticket;
+    std::chrono::system_clock::time_point segment_start_time;
+    int peak_moving_area = 0;
+    std::chrono::system_clock::time_point peak_time;
+    // Input timestamp of the first video packet muxed into the current segment
+    // since activation, microseconds. Origin of its timeline.
+    std::optional<std::int64_t> timeline_origin_us;
+    // Opened on the first motion sample of every segment after its origin
+    std::unique_ptr<TimelineWriter> timeline;
+    bool timeline_failed = false;
+    // Thumbnail and sprite sheet of the current segment
+    std::shared_ptr<RecordingImages> images;
+    std::shared_ptr<JpegEncoderPool> jpeg_encoders;
+
+    // Present if output_files.preview is enabled and there is a video stream
+    std::optional<PreviewInput> preview_input;
+    // Preview of the current segment, started on activation
+    std::unique_ptr<PreviewEncoder> preview;
+
+    std::shared_ptr<LatencyTracer> latency_tracer;
+    // Encoders do not keep AVFrame::opaque without
+    // AV_CODEC_CAP_ENCODER_REORDERED_OPAQUE, so arrival times of video frames
+    // are looked up by pts of encoded packets
+    std::map<std::int64_t, ArrivalTime> arrival_times;
+
     Impl(
         std::shared_ptr<const ApplicationSettings>&& settings_,
+        std::string&& path_,
+        PathGenerator&& next_segment_path_,
         ScopedAvFormatOutput&& out_format_context_,
-        std::vector<ScopedEncoderContext>&& encoder_contexts_,
+        std::map<int, ScopedEncoderContext>&& encoder_contexts_,
         std::map<int, int>&& in_out_stream_mapping_,
         std::map<int, ScopedAvAudioFifo>&& audio_fifos_,
         std::map<int, ScopedSwrResampler>&& resamplers_,
         std::optional<SwsPixelConverter>&& video_pix_converter_,
-        std::map<int, AVRational>&& orig_stream_time_bases_)
+        std::map<int, AVRational>&& orig_stream_time_bases_,
+        std::vector<ScopedAvCodecParameters>&& stream_parameters_,
+        std::vector<AVRational>&& stream_time_bases_,
+        std::optional<PreviewInput>&& preview_input_,
+        std::shared_ptr<LatencyTracer>&& latency_tracer_)
         : settings(std::move(settings_))
+        , path(std::move(path_))
+        , next_segment_path(std::move(next_segment_path_))
         , out_format_context(std::move(out_format_context_))
         , encoder_contexts(std::move(encoder_contexts_))
         , in_out_stream_mapping(std::move(in_out_stream_mapping_))
@@ -70,45 +266,322 @@ struct OutputFile::Impl {
         , resamplers(std::move(resamplers_))
         , video_pix_converter(std::move(video_pix_converter_))
         , orig_stream_time_bases(std::move(orig_stream_time_bases_))
+        , stream_parameters(std::move(stream_parameters_))
+        , stream_time_bases(std::move(stream_time_bases_))
+        , preview_input(std::move(preview_input_))
+        , latency_tracer(std::move(latency_tracer_))
     {
         BOOST_LOG_FUNCTION();
         // init muxer, write output file header
-        out_format_context.write_header();
+        write_header_with_options(
+            out_format_context,
+            settings->output_files.muxer_options);
         boost::for_each(
             boost::adaptors::index(out_format_context.streams()),
             [&](auto&& elem) {
                 BOOST_LOG_TRIVIAL(debug)
                     << "out stream " << elem.index()
                     << ": time_base = " << elem.value()->time_base;
+                packet_time_bases.push_back(elem.value()->time_base);
             });
+        segment_offsets = SegmentOffsets(packet_time_bases.size());
     }
 
     ~Impl()
     try {
         BOOST_LOG_FUNCTION();
+        if(preview) {
+            // Encodes its queue meanwhile
+            preview->finish();
+        }
         flush_audio_fifos();
         flush_encoders();
         out_format_context.write_trailer();
+        close_output(out_format_context, path);
+        timeline.reset();
+        preview.reset();
+        discard_next_segment();
+        // Previous segments are indexed first
+        segment_closes.wait();
+        if(activation_time && has_packets) {
+            auto info = make_recording_info();
+            write_images(images, info);
+            if(!close_ticket) {
+                close_ticket.emplace(close_order->take());
+            }
+            complete_close(std::move(*close_ticket), on_close, std::move(info));
+        }
+        if(!has_packets) {
+            // Standby file which was never activated
+            {
+                const auto closed = std::move(out_format_context);
+            }
+            std::filesystem::remove(path);
+            auto ec = std::error_code();
+            std::filesystem::remove(path + TIMELINE_EXTENSION, ec);
+            BOOST_LOG_TRIVIAL(debug) << "Removed empty file '" << path << "'";
+        }
     } catch(const std::exception& ex) {
         BOOST_LOG_TRIVIAL(error) << "~Impl dtor: " << ex.what();
     }
 
+    // Background segment opening captures this
     Impl(const Impl&) = delete;
-    Impl(Impl&&) = default;
+    Impl(Impl&&) = delete;
     Impl& operator=(const Impl&) = delete;
-    Impl& operator=(Impl&&) = default;
+    Impl& operator=(Impl&&) = delete;
+
+    void rename(std::string&& new_path)
+    {
+        std::filesystem::rename(path, new_path);
+        out_format_context.set_url(new_path.data());
+        path = std::move(new_path);
+    }
+
+    [[nodiscard]] RecordingInfo make_recording_info() const
+    {
+        auto ret = RecordingInfo();
+        ret.path = path;
+        ret.start_time = segment_start_time;
+        ret.end_time = std::chrono::system_clock::now();
+        ret.peak_moving_area = peak_moving_area;
+        ret.peak_offset = std::chrono::duration_cast<std::chrono::microseconds>(
+            peak_time - segment_start_time);
+        return ret;
+    }
+
+    void append_timeline(const MotionSample& sample)
+    {
+        // Frames before the first video packet of the segment are not in it
+        if(timeline_failed || !timeline_origin_us
+           || sample.pts_us < *timeline_origin_us) {
+            return;
+        }
+        try {
+            if(!timeline) {
+                timeline = std::make_unique<TimelineWriter>(
+                    path + TIMELINE_EXTENSION,
+                    *timeline_origin_us);
+            }
+            timeline->append(sample);
+        } catch(const std::exception& ex) {
+            // Recording is more important than its timeline
+            BOOST_LOG_TRIVIAL(error) << "Disabling motion timeline: " << ex.what();
+            timeline_failed = true;
+            timeline.reset();
+        }
+    }
+
+    void start_images()
+    {
+        images.reset();
+        if(const auto& thumbnails = settings->output_files.thumbnails) {
+            images = std::make_shared<RecordingImages>(
+                *thumbnails,
+                std::shared_ptr(jpeg_encoders));
+        }
+    }
+
+    void start_preview()
+    {
+        const auto& preview_settings = settings->output_files.preview;
+        if(!preview_input || !preview_settings) {
+            return;
+        }
+        try {
+            preview = std::make_unique<PreviewEncoder>(
+                path + PREVIEW_EXTENSION,
+                *preview_settings,
+                *preview_input);
+        } catch(const std::exception& ex) {
+            BOOST_LOG_TRIVIAL(error) << "Failed to start preview: " << ex.what();
+        }
+    }
+
+    void discard_next_segment()
+    {
+        if(!next_segment.valid()) {
+            return;
+        }
+        // Closes the file which has only a header
+        const auto unused_path = next_segment.get().path;
+        std::filesystem::remove(unused_path);
+        BOOST_LOG_TRIVIAL(debug) << "Removed unused segment '" << unused_path << "'";
+    }
+
+    void check_next_segment(const OwningAvPacket& packet)
+    {
+        const auto& segment_seconds = settings->output_files.segment_seconds;
+        if(!segment_seconds || packet.dts() == AV_NOPTS_VALUE) {
+            return;
+        }
+        const auto out_stream_index
+            = static_cast<std::size_t>(packet.stream_index());
+        const double elapsed
+            = static_cast<double>(packet.dts() - segment_start_dts)
+            * av_q2d(packet_time_bases.at(out_stream_index));
+        if(!next_segment.valid()) {
+            if(elapsed >= segment_seconds.value() - SEGMENT_OPEN_LEAD_SECONDS) {
+                // Opening does not stall encoding
+                next_segment = std::async(std::launch::async, [this] {
+                    return open_segment(
+                        next_segment_path(),
+                        stream_parameters,
+                        stream_time_bases,
+                        settings->output_files);
+                });
+            }
+            return;
+        }
+        if(elapsed < segment_seconds.value() || !packet.is_key()
+           || next_segment.wait_for(std::chrono::seconds(0))
+               != std::future_status::ready) {
+            return;
+        }
+        switch_segment(packet.dts(), out_stream_index);
+    }
+
+    void switch_segment(const std::int64_t key_dts, const std::size_t video_index)
+    {
+        BOOST_LOG_FUNCTION();
+        auto segment = [&]() -> std::optional<OutputSegment> {
+            try {
+                return next_segment.get();
+            } catch(const std::exception& ex) {
+                // Keep writing the current file and try again later
+                BOOST_LOG_TRIVIAL(error)
+                    << "Failed to open next segment: " << ex.what();
+                return std::nullopt;
+            }
+        }();
+        if(!segment) {
+            return;
+        }
+        out_format_context.write_trailer();
+        BOOST_LOG_TRIVIAL(info) << "Closed segment '" << path << "', continuing in '"
+                                << segment->path << "'";
+        auto previous_info = make_recording_info();
+        auto ticket = close_order->take();
+        path = std::move(segment->path);
+        out_format_context.swap(segment->format_context);
+        segment_start_time = previous_info.end_time;
+        peak_moving_area = 0;
+        peak_time = segment_start_time;
+        // Taken from the keyframe the new segment starts with
+        timeline_origin_us.reset();
+        // Write-behind buffer of the previous file may take a while to drain, the
+        // previous preview encodes its queued frames
+        segment_closes.run(
+            [format_context = std::move(segment->format_context),
+             previous_preview = std::move(preview),
+             previous_timeline = std::move(timeline),
+             previous_images = std::move(images),
+             previous_info = std::move(previous_info),
+             ticket = std::move(ticket),
+             on_close = on_close]() mutable {
+                previous_preview.reset();
+                // Waits for its I/O thread
+                previous_timeline.reset();
+                const auto closed = std::move(format_context);
+                try {
+                    close_output(closed, previous_info.path);
+                } catch(const std::exception& ex) {
+                    BOOST_LOG_TRIVIAL(error)
+                        << "Failed to close '" << previous_info.path
+                        << "': " << ex.what();
+                    // Destroying the ticket lets later segments be reported
+                    return;
+                }
+                write_images(previous_images, previous_info);
+                complete_close(
+                    std::move(ticket),
+                    on_close,
+                    std::move(previous_info));
+            });
+        start_preview();
+        start_images();
+        const auto key_tb = packet_time_bases.at(video_index);
+        auto key_offsets = std::vector<std::int64_t>();
+        for(const auto tb : packet_time_bases) {
+            key_offsets.push_back(av_rescale_q(key_dts, key_tb, tb));
+        }
+        segment_offsets.start_segment(std::move(key_offsets));
+        segment_start_dts = key_dts;
+    }
+
+    // Converts pts of a packet in packet_time_bases, before segment offsets, back
+    // to the timestamp of the input frame it was made of
+    std::int64_t
+        input_pts_us(const std::int64_t pts, const std::size_t stream_index) const
+    {
+        constexpr auto US = AVRational{1, 1'000'000};
+        const auto out_stream_index = static_cast<int>(stream_index);
+        const auto start_time = start_times.find(out_stream_index);
+        const auto start_us = start_time == start_times.end()
+            ? 0
+            : av_rescale_q(
+                start_time->second,
+                orig_stream_time_bases.at(out_stream_index),
+                US);
+        return av_rescale_q(pts, packet_time_bases.at(stream_index), US) + start_us;
+    }
+
+    void mux_packet(OwningAvPacket&& packet)
+    {
+        const auto out_stream_index
+            = static_cast<std::size_t>(packet.stream_index());
+        const auto codec_type
+            = out_format_context.streams()[out_stream_index]->codecpar->codec_type;
+        if(codec_type == AVMEDIA_TYPE_VIDEO) {
+            check_next_segment(packet);
+        }
+        if(codec_type == AVMEDIA_TYPE_VIDEO && activation_time && !timeline_origin_us
+           && packet.pts() != AV_NOPTS_VALUE) {
+            timeline_origin_us = input_pts_us(packet.pts(), out_stream_index);
+        }
+        const auto packet_ts = [&]() -> std::optional<std::int64_t> {
+            if(packet.dts() != AV_NOPTS_VALUE) {
+                // Not above pts
+                return packet.dts();
+            }
+            if(packet.pts() != AV_NOPTS_VALUE) {
+                return packet.pts();
+            }
+            return std::nullopt;
+        }();
+        const auto offset = segment_offsets.offset(out_stream_index, packet_ts);
+        if(packet.pts() != AV_NOPTS_VALUE) {
+            packet.set_pts(packet.pts() - offset);
+        }
+        if(packet.dts() != AV_NOPTS_VALUE) {
+            packet.set_dts(packet.dts() - offset);
+        }
+        const auto packet_tb = packet_time_bases.at(out_stream_index);
+        const auto segment_tb
+            = out_format_context.streams()[out_stream_index]->time_base;
+        if(av_cmp_q(packet_tb, segment_tb) != 0) {
+            packet.rescale_ts(packet_tb, segment_tb);
+        }
+        out_format_context.interleaved_write_packet(std::move(packet));
+        has_packets = true;
+        if(activation_time && !start_latency && codec_type == AVMEDIA_TYPE_VIDEO) {
+            start_latency = std::chrono::steady_clock::now() - *activation_time;
+            BOOST_LOG_TRIVIAL(info)
+                << "Motion to first packet latency: "
+                << std::chrono::duration<double, std::milli>(*start_latency).count()
+                << " ms";
+        }
+    }
 
     void flush_encoders()
     {
-        boost::for_each(boost::adaptors::index(encoder_contexts), [&](auto&& elem) {
-            const auto out_stream_index = static_cast<int>(elem.index());
-            const auto& encoder_context = elem.value();
+        for(const auto& [out_stream_index, encoder_context] : encoder_contexts) {
             if(!(encoder_context.codec_capabilities()
                  & static_cast<unsigned>(AV_CODEC_CAP_DELAY))) {
-                return;
+                continue;
             }
             encode_write_frame_impl(std::nullopt, out_stream_index);
-        });
+        }
     }
 
     void flush_audio_fifos()
@@ -116,8 +589,7 @@ struct OutputFile::Impl {
         boost::for_each(audio_fifos, [&](const auto& p) {
             const int out_stream_index = p.first;
             const auto& fifo = p.second;
-            const auto& encoder_context
-                = encoder_contexts.at(static_cast<std::size_t>(out_stream_index));
+            const auto& encoder_context = encoder_contexts.at(out_stream_index);
             while(fifo.size() > 0) {
                 consume_encode_audio_fifo(fifo, encoder_context, out_stream_index);
             }
@@ -126,14 +598,13 @@ struct OutputFile::Impl {
 
     void process_audio_frame(const OwningAvframe& frame, const int out_stream_index)
     {
-        BOOST_LOG_FUNCTION();
-        const auto& encoder_context
-            = encoder_contexts.at(static_cast<std::size_t>(out_stream_index));
+        HOT_PATH_LOG_FUNCTION();
+        const auto& encoder_context = encoder_contexts.at(out_stream_index);
         const auto& fifo = audio_fifos.at(out_stream_index);
-        ScopedAvSAmplesBuffer converted_buffer(
-            encoder_context.ch_layout().nb_channels,
-            frame.nb_samples(),
-            encoder_context.sample_fmt());
+        auto& converted_buffer = converted_samples_buffer(
+            encoder_context,
+            out_stream_index,
+            frame.nb_samples());
         const auto& resampler = resamplers.at(out_stream_index);
         // Convert the input samples to the desired output sample format
         resampler.convert(
@@ -147,14 +618,60 @@ struct OutputFile::Impl {
         // FIFO buffer to store as many frames worth of input samples that they
         // make up at least one frame worth of output samples.
         const int out_frame_size = encoder_context.frame_size();
-        BOOST_LOG_TRIVIAL(trace) << "audio stream " << out_stream_index
-                                 << ": nb_samples = " << frame.nb_samples()
-                                 << ": out_frame_size = " << out_frame_size;
+        HOT_PATH_LOG_TRACE() << "audio stream " << out_stream_index
+                             << ": nb_samples = " << frame.nb_samples()
+                             << ": out_frame_size = " << out_frame_size;
         while(fifo.size() >= out_frame_size) {
             consume_encode_audio_fifo(fifo, encoder_context, out_stream_index);
         }
     }
 
+    ScopedAvSAmplesBuffer& converted_samples_buffer(
+        const ScopedEncoderContext& encoder_context,
+        const int out_stream_index,
+        const int nb_samples)
+    {
+        auto it = converted_samples.find(out_stream_index);
+        if(it == converted_samples.end() || it->second.frame_size() < nb_samples) {
+            // Grows to the largest decoded frame
+            it = converted_samples
+                     .insert_or_assign(
+                         out_stream_index,
+                         ScopedAvSAmplesBuffer(
+                             encoder_context.ch_layout().nb_channels,
+                             nb_samples,
+                             encoder_context.sample_fmt()))
+                     .first;
+        }
+        return it->second;
+    }
+
+    OwningAvframe& encoder_frame(
+        const ScopedEncoderContext& encoder_context,
+        const int out_stream_index,
+        const int nb_samples)
+    {
+        auto it = encoder_frames.find(out_stream_index);
+        if(it == encoder_frames.end() || it->second.nb_samples() != nb_samples) {
+            // Allocate the samples of the created frame. This call will make
+            // sure that the audio frame can hold as many samples as specified.
+            auto frame = AudioAvFrameBuilder()
+                             .format(encoder_context.sample_fmt())
+                             .nb_samples(nb_samples)
+                             .ch_layout(encoder_context.ch_layout())
+                             .get_buffer();
+            frame.set_sample_rate(encoder_context.sample_rate());
+            it = encoder_frames.insert_or_assign(out_stream_index, std::move(frame))
+                     .first;
+        } else {
+            // The encoder may still reference samples of the previous frame
+            it->second.make_writable();
+        }
+        // calc_pts() assigns pts of audio frames
+        it->second.set_pts(AV_NOPTS_VALUE);
+        return it->second;
+    }
+
     void consume_encode_audio_fifo(
         const ScopedAvAudioFifo& fifo,
         const ScopedEncoderContext& encoder_context,
@@ -163,18 +680,56 @@ struct OutputFile::Impl {
         const int out_frame_size = encoder_context.frame_size();
         // Each frame will contain exactly out_frame_size samples except the last
         const int fifo_frame_size = std::min(fifo.size(), out_frame_size);
-        // Allocate the samples of the created frame. This call will make sure
-        // that the audio frame can hold as many samples as specified.
-        // Read as many samples from the FIFO buffer as required to fill the
-        OwningAvframe tmp_frame = AudioAvFrameBuilder()
-                                      .format(encoder_context.sample_fmt())
-                                      .nb_samples(fifo_frame_size)
-                                      .ch_layout(encoder_context.ch_layout())
-                                      .get_buffer();
-        tmp_frame.set_sample_rate(encoder_context.sample_rate());
+        auto& frame
+            = encoder_frame(encoder_context, out_stream_index, fifo_frame_size);
+        // Read as many samples from the FIFO buffer as required to fill the frame
         // NOLINTNEXTLINE: cast uint8_t** to void**
-        fifo.read(reinterpret_cast<void**>(tmp_frame.data()), fifo_frame_size);
-        encode_write_frame_impl(std::cref(tmp_frame), out_stream_index);
+        fifo.read(reinterpret_cast<void**>(frame.data()), fifo_frame_size);
+        encode_write_frame_impl(std::cref(frame), out_stream_index);
+    }
+
+    // Taken from the first packet of a copied stream with a timestamp
+    std::optional<std::int64_t>
+        copy_start_time(const OwningAvPacket& packet, const int out_stream_index)
+    {
+        if(const auto it = start_times.find(out_stream_index);
+           it != start_times.end()) {
+            return it->second;
+        }
+        const auto start_time
+            = packet.dts() != AV_NOPTS_VALUE ? packet.dts() : packet.pts();
+        if(start_time == AV_NOPTS_VALUE) {
+            return std::nullopt;
+        }
+        BOOST_LOG_TRIVIAL(debug) << "Setting copied stream " << out_stream_index
+                                 << " start_time = " << start_time;
+        start_times.emplace(out_stream_index, start_time);
+        return start_time;
+    }
+
+    void copy_packet(const OwningAvPacket& packet, const int out_stream_index)
+    {
+        HOT_PATH_LOG_FUNCTION();
+        const auto start_time = copy_start_time(packet, out_stream_index);
+        if(!start_time) {
+            // Wait for a packet to start the stream from
+            return;
+        }
+        // Copied streams start from zero like encoded ones
+        auto copy = packet.clone();
+        if(copy.pts() != AV_NOPTS_VALUE) {
+            copy.set_pts(copy.pts() - *start_time);
+        }
+        if(copy.dts() != AV_NOPTS_VALUE) {
+            copy.set_dts(copy.dts() - *start_time);
+        }
+        copy.rescale_ts(
+            orig_stream_time_bases.at(out_stream_index),
+            packet_time_bases.at(static_cast<std::size_t>(out_stream_index)));
+        copy.set_stream_index(out_stream_index);
+        copy.raw()->pos = -1;
+        check_dts_monotonicity(copy);
+        mux_packet(std::move(copy));
     }
 
     void process_video_frame(const OwningAvframe& frame, const int out_stream_index)
@@ -182,6 +737,9 @@ struct OutputFile::Impl {
         if(video_pix_converter) {
             const auto converted = video_pix_converter.value().scale_video(frame);
             converted.set_pts(frame.pts());
+            if(const auto arrival = frame.arrival_time()) {
+                converted.set_arrival_time(*arrival);
+            }
             encode_write_frame_impl(std::cref(converted), out_stream_index);
         } else {
             encode_write_frame_impl(std::cref(frame), out_stream_index);
@@ -190,9 +748,8 @@ struct OutputFile::Impl {
 
     void calc_pts(const OwningAvframe& frame, const int out_stream_index)
     {
-        BOOST_LOG_FUNCTION();
-        const auto& encoder_context
-            = encoder_contexts.at(static_cast<std::size_t>(out_stream_index));
+        HOT_PATH_LOG_FUNCTION();
+        const auto& encoder_context = encoder_contexts.at(out_stream_index);
         const auto frame_type = encoder_context.codec_type();
         const auto in_stream_tb = orig_stream_time_bases.at(out_stream_index);
         const auto out_stream_tb
@@ -244,7 +801,7 @@ struct OutputFile::Impl {
 
     void check_dts_monotonicity(detail::OwningAvPacket& packet)
     {
-        BOOST_LOG_FUNCTION();
+        HOT_PATH_LOG_FUNCTION();
         // See https://github.com/FFmpeg/FFmpeg/blob/master/fftools/ffmpeg_mux.c
         if((out_format_context.oformat_flags()
             & static_cast<unsigned>(AVFMT_NOTIMESTAMPS))
@@ -288,16 +845,49 @@ struct OutputFile::Impl {
         last_mux_dts[packet.stream_index()] = packet.dts();
     }
 
+    void remember_arrival_time(
+        const OwningAvframe& frame,
+        const ScopedEncoderContext& encoder_context)
+    {
+        if(encoder_context.codec_type() != AVMEDIA_TYPE_VIDEO) {
+            return;
+        }
+        if(const auto arrival = frame.arrival_time();
+           arrival && frame.pts() != AV_NOPTS_VALUE) {
+            arrival_times.insert_or_assign(frame.pts(), *arrival);
+            // Frames dropped by the encoder never produce packets
+            if(arrival_times.size() > MAX_PENDING_ARRIVAL_TIMES) {
+                arrival_times.erase(arrival_times.begin());
+            }
+        }
+    }
+
+    std::optional<ArrivalTime> take_arrival_time(
+        const OwningAvPacket& packet,
+        const ScopedEncoderContext& encoder_context)
+    {
+        if(encoder_context.codec_type() != AVMEDIA_TYPE_VIDEO) {
+            return std::nullopt;
+        }
+        const auto it = arrival_times.find(packet.pts());
+        if(it == arrival_times.end()) {
+            return std::nullopt;
+        }
+        const auto ret = it->second;
+        arrival_times.erase(it);
+        return ret;
+    }
+
     void encode_write_frame_impl(
         const std::optional<std::reference_wrapper<const OwningAvframe>> frame,
         const int out_stream_index)
     {
-        auto& encoder_context
-            = encoder_contexts.at(static_cast<std::size_t>(out_stream_index));
+        auto& encoder_context = encoder_contexts.at(out_stream_index);
         if(frame) {
             const auto& unpacked_frame = frame.value().get();
             unpacked_frame.set_pict_type(AV_PICTURE_TYPE_NONE);
             calc_pts(unpacked_frame, out_stream_index);
+            remember_arrival_time(unpacked_frame, encoder_context);
             encoder_context.send_frame(unpacked_frame);
         } else {
             encoder_context.send_flush_frame();
@@ -308,9 +898,16 @@ struct OutputFile::Impl {
                = std::get_if<OwningAvPacket>(&encoded_result)) {
                 // prepare packet for muxing
                 enc_packet->set_stream_index(out_stream_index);
+                const auto arrival
+                    = take_arrival_time(*enc_packet, encoder_context);
                 check_dts_monotonicity(*enc_packet);
                 // mux encoded frame
-                out_format_context.interleaved_write_packet(std::move(*enc_packet));
+                mux_packet(std::move(*enc_packet));
+                if(arrival) {
+                    latency_tracer->record_disk(
+                        *arrival,
+                        std::chrono::steady_clock::now());
+                }
             } else if(std::holds_alternative<ScopedEncoderContext::Again>(
                           encoded_result)) {
                 break;
@@ -331,39 +928,150 @@ void OutputFile::encode_write_frame(
     const OwningAvframe& frame,
     const int in_stream_index)
 {
-    BOOST_LOG_FUNCTION();
+    HOT_PATH_LOG_FUNCTION();
     const int out_stream_index = pimpl->in_out_stream_mapping.at(in_stream_index);
-    const auto& encoder_context
-        = pimpl->encoder_contexts.at(static_cast<std::size_t>(out_stream_index));
+    const auto& encoder_context = pimpl->encoder_contexts.at(out_stream_index);
     if(encoder_context.codec_type() == AVMEDIA_TYPE_AUDIO) {
         pimpl->process_audio_frame(frame, out_stream_index);
     } else if(encoder_context.codec_type() == AVMEDIA_TYPE_VIDEO) {
+        // Before calc_pts() rescales the timestamp of the frame
+        if(pimpl->preview) {
+            pimpl->preview->push(frame);
+        }
         pimpl->process_video_frame(frame, out_stream_index);
     } else {
         throw std::runtime_error("Unreachable!");
     }
 }
 
+bool OutputFile::copies_stream(const int in_stream_index) const
+{
+    const auto it = pimpl->in_out_stream_mapping.find(in_stream_index);
+    return it != pimpl->in_out_stream_mapping.end()
+        && !pimpl->encoder_contexts.contains(it->second);
+}
+
+void OutputFile::write_packet(
+    const OwningAvPacket& packet,
+    const int in_stream_index)
+{
+    pimpl->copy_packet(packet, pimpl->in_out_stream_mapping.at(in_stream_index));
+}
+
+void OutputFile::write_preroll(
+    const std::deque<OwningAvPacket>& preroll,
+    const OwningAvPacket& first,
+    const int in_stream_index)
+{
+    const int out_stream_index = pimpl->in_out_stream_mapping.at(in_stream_index);
+    // The live packet fixes the start time before earlier ones are copied
+    if(!pimpl->copy_start_time(first, out_stream_index)) {
+        return;
+    }
+    for(const auto& packet : preroll) {
+        pimpl->copy_packet(packet, out_stream_index);
+    }
+}
+
+void OutputFile::activate(
+    std::string&& path,
+    const std::chrono::steady_clock::time_point motion_time,
+    RecordingCallback&& on_close,
+    std::shared_ptr<JpegEncoderPool>&& jpeg_encoders,
+    std::shared_ptr<OrderedCallbacks>&& close_order)
+{
+    pimpl->rename(std::move(path));
+    pimpl->activation_time = motion_time;
+    pimpl->on_close = std::move(on_close);
+    pimpl->jpeg_encoders = std::move(jpeg_encoders);
+    pimpl->close_order = std::move(close_order);
+    pimpl->segment_start_time = std::chrono::system_clock::now();
+    pimpl->peak_time = pimpl->segment_start_time;
+    pimpl->start_preview();
+    pimpl->start_images();
+}
+
+void OutputFile::stop()
+{
+    if(pimpl->activation_time && !pimpl->close_ticket) {
+        pimpl->close_ticket.emplace(pimpl->close_order->take());
+    }
+}
+
+void OutputFile::report_motion(const MotionSample& sample)
+{
+    if(sample.moving_area > pimpl->peak_moving_area) {
+        pimpl->peak_moving_area = sample.moving_area;
+        pimpl->peak_time = std::chrono::system_clock::now();
+    }
+    if(pimpl->activation_time) {
+        pimpl->append_timeline(sample);
+    }
+}
+
+std::shared_ptr<RecordingImages> OutputFile::images() const
+{
+    if(!pimpl->activation_time) {
+        return nullptr;
+    }
+    return pimpl->images;
+}
+
+std::optional<std::chrono::steady_clock::duration> OutputFile::start_latency() const
+{
+    return pimpl->start_latency;
+}
+
+std::optional<WriteStats> OutputFile::write_stats() const
+{
+    return pimpl->out_format_context.write_stats();
+}
+
 OutputFile open_output_file(
     std::shared_ptr<const ApplicationSettings>&& settings,
-    const char* const url,
-    const std::map<int, ScopedDecoderContext>& decoder_contexts,
-    const ScopedAvFormatInput::StreamsView in_streams)
+    std::string url,
+    PathGenerator&& next_segment_path,
+    const InputStreamsInfo& input_streams,
+    std::shared_ptr<LatencyTracer> latency_tracer)
 {
     BOOST_LOG_FUNCTION();
-    auto out_format_context = ScopedAvFormatOutput(url);
-    std::vector<ScopedEncoderContext> encoder_contexts;
+    auto out_format_context = ScopedAvFormatOutput(
+        url.data(),
+        make_write_behind_options(settings->output_files));
+    std::map<int, ScopedEncoderContext> encoder_contexts;
+    std::vector<ScopedAvCodecParameters> stream_parameters;
+    std::vector<AVRational> stream_time_bases;
     std::map<int, int> in_out_stream_mapping;
     std::map<int, ScopedAvAudioFifo> audio_fifos;
     std::map<int, ScopedSwrResampler> resamplers;
     std::optional<SwsPixelConverter> video_pix_converter;
+    std::optional<PreviewInput> preview_input;
 
     constexpr auto out_acodec = AV_CODEC_ID_AAC;
     constexpr auto input_pix_fmt = AV_PIX_FMT_BGR24;
 
     int out_stream_counter = 0;
-    for(auto&& [in_stream_index, decoder_context] : decoder_contexts) {
-        const AVMediaType input_codec_type = decoder_context.codec_type();
+    for(const auto& [in_stream_index, input_stream] : input_streams) {
+        const AVMediaType input_codec_type = input_stream.codec_type();
+        if(input_codec_type == AVMEDIA_TYPE_AUDIO
+           && input_stream.codec_id() == out_acodec) {
+            // Muxed as is without decoding and encoding
+            AVStream* const out_stream = out_format_context.new_stream();
+            input_stream.copy_parameters_to(out_stream->codecpar);
+            out_stream->codecpar->codec_tag = 0;
+            out_stream->time_base = input_stream.time_base();
+            BOOST_LOG_TRIVIAL(debug)
+                << "out stream " << out_stream_counter << ": copying "
+                << avcodec_get_name(out_acodec) << " input stream "
+                << in_stream_index;
+            auto parameters = ScopedAvCodecParameters();
+            parameters.copy_from(out_stream->codecpar);
+            stream_parameters.emplace_back(std::move(parameters));
+            stream_time_bases.push_back(out_stream->time_base);
+            in_out_stream_mapping.emplace(in_stream_index, out_stream_counter);
+            out_stream_counter++;
+            continue;
+        }
         const AVCodec* encoder = nullptr;
         if(input_codec_type == AVMEDIA_TYPE_VIDEO) {
             const auto name = settings->output_files.video_encoder.codec_name.data();
@@ -381,14 +1089,23 @@ OutputFile open_output_file(
 
         switch(input_codec_type) {
             case AVMEDIA_TYPE_VIDEO: {
+                if(settings->output_files.preview && !preview_input) {
+                    preview_input = PreviewInput{
+                        .width = input_stream.width(),
+                        .height = input_stream.height(),
+                        .time_base = input_stream.time_base(),
+                        .framerate = input_stream.framerate(),
+                        .sample_aspect_ratio = input_stream.sample_aspect_ratio(),
+                    };
+                }
                 // transcode to same properties
-                encoder_context.set_height(decoder_context.height());
-                encoder_context.set_width(decoder_context.width());
+                encoder_context.set_height(input_stream.height());
+                encoder_context.set_width(input_stream.width());
                 encoder_context.set_sample_aspect_ratio(
-                    decoder_context.sample_aspect_ratio());
+                    input_stream.sample_aspect_ratio());
                 // video time_base can be set to whatever is handy and supported
                 // by encoder
-                encoder_context.set_time_base(av_inv_q(decoder_context.framerate()));
+                encoder_context.set_time_base(av_inv_q(input_stream.framerate()));
                 if(const auto& video_bitrate
                    = settings->output_files.video_bitrate) {
                     encoder_options.set_str("b", video_bitrate->data());
@@ -406,11 +1123,11 @@ OutputFile open_output_file(
                     encoder_context.create_hw_device_context(type);
                     encoder_context.create_hw_frames(
                         ScopedEncoderContext::HwFramesContextParams{
-                            .width = decoder_context.width(),
-                            .height = decoder_context.height()});
+                            .width = input_stream.width(),
+                            .height = input_stream.height()});
                     video_pix_converter = SwsPixelConverter(
-                        decoder_context.width(),
-                        decoder_context.height(),
+                        input_stream.width(),
+                        input_stream.height(),
                         input_pix_fmt,
                         hw_helpers::DEFAULT_SW_FORMAT);
                     BOOST_LOG_TRIVIAL(debug) << "Using hardware encoder: "
@@ -442,8 +1159,8 @@ OutputFile open_output_file(
                             // Take first format.
                             const auto dst_format = enc_pix_fmts[0];
                             video_pix_converter = SwsPixelConverter(
-                                decoder_context.width(),
-                                decoder_context.height(),
+                                input_stream.width(),
+                                input_stream.height(),
                                 input_pix_fmt,
                                 dst_format);
                             encoder_context.set_pix_fmt(dst_format);
@@ -457,8 +1174,8 @@ OutputFile open_output_file(
                 break;
             }
             case AVMEDIA_TYPE_AUDIO: {
-                encoder_context.set_sample_rate(decoder_context.sample_rate());
-                encoder_context.set_ch_layout(decoder_context.ch_layout());
+                encoder_context.set_sample_rate(input_stream.sample_rate());
+                encoder_context.set_ch_layout(input_stream.ch_layout());
                 // take first format from list of supported formats
                 encoder_context.set_sample_fmt(encoder->sample_fmts[0]);
                 encoder_context.set_time_base(
@@ -469,9 +1186,9 @@ OutputFile open_output_file(
                 }
 
                 auto resampler = SwrResamplerBuiler()
-                                     .in_ch_layout(&decoder_context.ch_layout())
-                                     .in_sample_fmt(decoder_context.sample_fmt())
-                                     .in_sample_rate(decoder_context.sample_rate())
+                                     .in_ch_layout(&input_stream.ch_layout())
+                                     .in_sample_fmt(input_stream.sample_fmt())
+                                     .in_sample_rate(input_stream.sample_rate())
                                      .out_ch_layout(&encoder_context.ch_layout())
                                      .out_sample_fmt(encoder_context.sample_fmt())
                                      .out_sample_rate(encoder_context.sample_rate())
@@ -511,31 +1228,38 @@ OutputFile open_output_file(
                                      << ": options not found = " << encoder_options;
             throw std::runtime_error("Encoder option not found");
         }
-        encoder_contexts.emplace_back(std::move(encoder_context));
+        // Remember stream properties to recreate them in next segments
+        auto parameters = ScopedAvCodecParameters();
+        parameters.copy_from(out_stream->codecpar);
+        stream_parameters.emplace_back(std::move(parameters));
+        stream_time_bases.push_back(out_stream->time_base);
+        encoder_contexts.emplace(out_stream_counter, std::move(encoder_context));
         in_out_stream_mapping.emplace(in_stream_index, out_stream_counter);
         out_stream_counter++;
     }
     out_format_context.dump_format();
 
     std::map<int, AVRational> orig_stream_time_bases;
-    for(const auto& [in_stream_index, stream] : boost::adaptors::index(in_streams)) {
-        if(const auto it
-           = in_out_stream_mapping.find(static_cast<int>(in_stream_index));
-           it != in_out_stream_mapping.end()) {
-            orig_stream_time_bases.emplace(it->second, stream->time_base);
-        } else {
-            continue;
-        }
+    for(const auto& [in_stream_index, out_stream_index] : in_out_stream_mapping) {
+        orig_stream_time_bases.emplace(
+            out_stream_index,
+            input_streams.at(in_stream_index).time_base());
     }
 
     return OutputFile(std::make_unique<OutputFile::Impl>(
         std::move(settings),
+        std::move(url),
+        std::move(next_segment_path),
         std::move(out_format_context),
         std::move(encoder_contexts),
         std::move(in_out_stream_mapping),
         std::move(audio_fifos),
         std::move(resamplers),
         std::move(video_pix_converter),
-        std::move(orig_stream_time_bases)));
+        std::move(orig_stream_time_bases),
+        std::move(stream_parameters),
+        std::move(stream_time_bases),
+        std::move(preview_input),
+        std::move(latency_tracer)));
 }
 } // namespace vehlwn::ffmpeg::detail
@@ -1,14 +1,23 @@
 #pragma once
 
-#include <map>
+#include <chrono>
+#include <deque>
 #include <memory>
 #include <optional>
 #include <string>
 
 #include "../ApplicationSettings.hpp"
+#include "../JpegEncoder.hpp"
+#include "../LatencyTracer.hpp"
+#include "../PathGenerator.hpp"
+#include "../RecordingImages.hpp"
+#include "../RecordingInfo.hpp"
+#include "../Timeline.hpp"
+#include "../WriteStats.hpp"
 #include "AvFrameAdapters.hpp"
-#include "ScopedAvFormatInput.hpp"
-#include "ScopedDecoderContext.hpp"
+#include "AvPacketAdapters.hpp"
+#include "InputStreamInfo.hpp"
+#include "OrderedCallbacks.hpp"
 
 namespace vehlwn::ffmpeg::detail {
 class OutputFile {
@@ -22,14 +31,56 @@ public:
     OutputFile& operator=(OutputFile&&) noexcept;
 
     void encode_write_frame(const OwningAvframe& frame, int in_stream_index);
+    // True if packets of the input stream are muxed without decoding and
+    // encoding, i.e. passed to write_packet() instead of encode_write_frame()
+    [[nodiscard]] bool copies_stream(int in_stream_index) const;
+    void write_packet(const OwningAvPacket& packet, int in_stream_index);
+    // Muxes packets of a copied stream received before recording started ahead
+    // of the first live packet, which is written next by write_packet(). The
+    // stream still starts from the live packet to stay in sync with video, so
+    // the pre-roll gets negative timestamps.
+    void write_preroll(
+        const std::deque<OwningAvPacket>& preroll,
+        const OwningAvPacket& first,
+        int in_stream_index);
+
+    // Renames a file opened in advance to path and starts measuring latency from
+    // motion_time to the first written video packet. on_close is called for this
+    // file and every next segment after they are closed, in the order of
+    // close_order tickets taken when they stop. Recording images are encoded by
+    // jpeg_encoders.
+    void activate(
+        std::string&& path,
+        std::chrono::steady_clock::time_point motion_time,
+        RecordingCallback&& on_close,
+        std::shared_ptr<JpegEncoderPool>&& jpeg_encoders,
+        std::shared_ptr<OrderedCallbacks>&& close_order);
+    // Takes the place of the last segment among closed recordings. Called when
+    // recording stops, before the file is destroyed in the background.
+    void stop();
+    // Remembers the frame with the largest moving area for the recording summary
+    // and appends the sample to the timeline sidecar of the current segment.
+    void report_motion(const MotionSample& sample);
+    // Thumbnail and sprite sheet of the current segment if enabled and active.
+    // Frames are added by the caller without holding locks the encoder needs.
+    [[nodiscard]] std::shared_ptr<RecordingImages> images() const;
+    [[nodiscard]] std::optional<std::chrono::steady_clock::duration>
+        start_latency() const;
+    // Write-behind metrics of the current file if enabled
+    [[nodiscard]] std::optional<WriteStats> write_stats() const;
 
 private:
     std::unique_ptr<Impl> pimpl;
 };
 
+// Opens a new output file at the path url. If output_files.segment_seconds is set,
+// next segments are opened at paths returned by next_segment_path. Latency of
+// video frames with an arrival time is recorded in latency_tracer when their
+// packets are muxed. AAC audio is copied, other audio is encoded to AAC.
 OutputFile open_output_file(
     std::shared_ptr<const ApplicationSettings>&& settings,
-    const char* url,
-    const std::map<int, ScopedDecoderContext>& decoder_contexts,
-    ScopedAvFormatInput::StreamsView in_streams);
+    std::string url,
+    PathGenerator&& next_segment_path,
+    const InputStreamsInfo& input_streams,
+    std::shared_ptr<LatencyTracer> latency_tracer);
 } // namespace vehlwn::ffmpeg::detail
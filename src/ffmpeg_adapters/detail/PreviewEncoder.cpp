@@ -0,0 +1,240 @@
+#include "PreviewEncoder.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <variant>
+
+#include <boost/log/attributes/named_scope.hpp>
+#include <boost/log/trivial.hpp>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavutil/avutil.h>
+#include <libavutil/mathematics.h>
+#include <libavutil/pixfmt.h>
+#include <libswscale/swscale.h>
+}
+
+#include "../BoundedQueue.hpp"
+#include "AvPacketAdapters.hpp"
+#include "ScopedAvDictionary.hpp"
+#include "ScopedAvFormatOutput.hpp"
+#include "ScopedEncoderContext.hpp"
+#include "SwsPixelConverter.hpp"
+
+namespace vehlwn::ffmpeg::detail {
+namespace {
+// About a second of video. Enough to ride out a slow keyframe.
+constexpr std::size_t PREVIEW_QUEUE_CAPACITY = 32;
+
+// Keeps the aspect ratio, rounded down to an even number for yuv420p
+int scaled_height(const PreviewInput& input, const int width)
+{
+    const auto height = static_cast<std::int64_t>(input.height) * width
+        / std::max(input.width, 1);
+    return std::max(2, static_cast<int>(height / 2 * 2));
+}
+} // namespace
+
+struct PreviewEncoder::Impl {
+    std::string path;
+    ApplicationSettings::OutputFiles::Preview settings;
+    PreviewInput input;
+    // Empty frame is the end of the recording
+    BoundedQueue<std::optional<OwningAvframe>> frames{PREVIEW_QUEUE_CAPACITY};
+    std::atomic<std::uint64_t> dropped_frames{0};
+    bool finished = false;
+
+    // Owned by the encoding thread
+    std::optional<ScopedAvFormatOutput> format_context;
+    std::optional<ScopedEncoderContext> encoder_context;
+    std::optional<SwsPixelConverter> scaler;
+    std::int64_t start_pts = AV_NOPTS_VALUE;
+    std::int64_t last_pts = AV_NOPTS_VALUE;
+
+    std::thread thread;
+
+    Impl(
+        std::string&& path_,
+        const ApplicationSettings::OutputFiles::Preview& settings_,
+        const PreviewInput& input_)
+        : path(std::move(path_))
+        , settings(settings_)
+        , input(input_)
+        , thread([this] { run(); })
+    {}
+
+    void run()
+    {
+        BOOST_LOG_FUNCTION();
+        try {
+            while(auto frame = frames.pop()) {
+                if(!*frame) {
+                    break;
+                }
+                encode_frame(**frame);
+            }
+            close();
+        } catch(const std::exception& ex) {
+            BOOST_LOG_TRIVIAL(error)
+                << "Preview '" << path << "' failed: " << ex.what();
+            // Next frames are dropped without waiting
+            frames.close();
+            // The recording is still complete without its preview
+            encoder_context.reset();
+            format_context.reset();
+            auto ec = std::error_code();
+            std::filesystem::remove(path, ec);
+        }
+    }
+
+    void open()
+    {
+        BOOST_LOG_FUNCTION();
+        const auto* const encoder
+            = avcodec_find_encoder_by_name(settings.codec_name.data());
+        if(encoder == nullptr) {
+            throw std::runtime_error(
+                "Preview encoder " + settings.codec_name + " not found");
+        }
+        auto& output = format_context.emplace(path.data());
+        auto& context = encoder_context.emplace(encoder);
+        const int height = scaled_height(input, settings.width);
+        context.set_width(settings.width);
+        context.set_height(height);
+        context.set_sample_aspect_ratio(input.sample_aspect_ratio);
+        context.set_time_base(
+            input.framerate.num > 0 ? av_inv_q(input.framerate) : input.time_base);
+        const auto pix_fmt = encoder->pix_fmts != nullptr ? encoder->pix_fmts[0]
+                                                          : AV_PIX_FMT_YUV420P;
+        context.set_pix_fmt(pix_fmt);
+        if((output.oformat_flags() & static_cast<unsigned>(AVFMT_GLOBALHEADER))
+           != 0U) {
+            context.set_flags(static_cast<int>(
+                context.flags()
+                | static_cast<unsigned>(AV_CODEC_FLAG_GLOBAL_HEADER)));
+        }
+        auto options = ScopedAvDictionary();
+        if(settings.video_bitrate) {
+            options.set_str("b", settings.video_bitrate->data());
+        }
+        AVStream* const out_stream = output.new_stream();
+        out_stream->time_base = context.time_base();
+        context.open(out_stream->codecpar, options);
+        if(options.size() != 0) {
+            BOOST_LOG_TRIVIAL(error) << "Preview options not found = " << options;
+            throw std::runtime_error("Preview encoder option not found");
+        }
+        auto header_options = ScopedAvDictionary();
+        output.write_header(header_options);
+        // Downscaling is combined with the conversion the encoder needs anyway
+        scaler.emplace(
+            input.width,
+            input.height,
+            AV_PIX_FMT_BGR24,
+            settings.width,
+            height,
+            pix_fmt,
+            SWS_BILINEAR);
+        BOOST_LOG_TRIVIAL(debug) << "Opened preview '" << path << "' "
+                                 << settings.width << "x" << height;
+    }
+
+    void encode_frame(const OwningAvframe& frame)
+    {
+        if(frame.pts() == AV_NOPTS_VALUE) {
+            return;
+        }
+        if(!encoder_context) {
+            open();
+            start_pts = frame.pts();
+        }
+        const auto pts = av_rescale_q(
+            frame.pts() - start_pts,
+            input.time_base,
+            encoder_context->time_base());
+        // Frames closer than a tick of the encoder time base
+        if(last_pts != AV_NOPTS_VALUE && pts <= last_pts) {
+            return;
+        }
+        last_pts = pts;
+        const auto scaled = scaler->scale_video(frame);
+        scaled.set_pts(pts);
+        encoder_context->send_frame(scaled);
+        write_packets();
+    }
+
+    void write_packets()
+    {
+        const auto stream_time_base = format_context->streams()[0]->time_base;
+        while(true) {
+            auto result = encoder_context->receive_packet();
+            auto* const packet = std::get_if<OwningAvPacket>(&result);
+            if(packet == nullptr) {
+                break;
+            }
+            packet->set_stream_index(0);
+            packet->rescale_ts(encoder_context->time_base(), stream_time_base);
+            format_context->interleaved_write_packet(std::move(*packet));
+        }
+    }
+
+    void close()
+    {
+        BOOST_LOG_FUNCTION();
+        if(!encoder_context) {
+            // Not a single frame
+            return;
+        }
+        encoder_context->send_flush_frame();
+        write_packets();
+        format_context->write_trailer();
+        BOOST_LOG_TRIVIAL(debug)
+            << "Closed preview '" << path << "', dropped frames = "
+            << dropped_frames.load(std::memory_order_relaxed);
+    }
+};
+
+PreviewEncoder::PreviewEncoder(
+    std::string path,
+    const ApplicationSettings::OutputFiles::Preview& settings,
+    const PreviewInput& input)
+    : pimpl(std::make_unique<Impl>(std::move(path), settings, input))
+{}
+
+PreviewEncoder::~PreviewEncoder()
+{
+    finish();
+    pimpl->thread.join();
+}
+
+void PreviewEncoder::push(const OwningAvframe& frame)
+{
+    if(pimpl->finished) {
+        return;
+    }
+    if(!pimpl->frames.try_push(frame.clone())) {
+        pimpl->dropped_frames.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void PreviewEncoder::finish()
+{
+    if(pimpl->finished) {
+        return;
+    }
+    pimpl->finished = true;
+    // Fails if the thread has stopped because of an error
+    pimpl->frames.push(std::nullopt);
+}
+} // namespace vehlwn::ffmpeg::detail
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <memory>
+#include <string>
+
+extern "C" {
+#include <libavutil/rational.h>
+}
+
+#include "../ApplicationSettings.hpp"
+#include "AvFrameAdapters.hpp"
+
+namespace vehlwn::ffmpeg::detail {
+// Video stream of BGR24 frames passed to PreviewEncoder
+struct PreviewInput {
+    int width = 0;
+    int height = 0;
+    // Of frame timestamps
+    AVRational time_base{0, 1};
+    AVRational framerate{0, 1};
+    AVRational sample_aspect_ratio{0, 1};
+};
+
+// Encodes a low resolution rendition of a recording on a separate thread. The
+// file is opened on the first frame. Frames are dropped when the thread falls
+// behind so the preview never slows down the full quality recording.
+class PreviewEncoder {
+public:
+    PreviewEncoder(
+        std::string path,
+        const ApplicationSettings::OutputFiles::Preview& settings,
+        const PreviewInput& input);
+    PreviewEncoder(const PreviewEncoder&) = delete;
+    PreviewEncoder(PreviewEncoder&&) = delete;
+    // Waits until queued frames are encoded and the file is closed. Keep it
+    // off threads which must not stall, see OutputFile.
+    ~PreviewEncoder();
+    PreviewEncoder& operator=(const PreviewEncoder&) = delete;
+    PreviewEncoder& operator=(PreviewEncoder&&) = delete;
+
+    // Queues a new reference to the frame, pixels are not copied
+    void push(const OwningAvframe& frame);
+    // Ends the preview without waiting for queued frames, so they are encoded
+    // while the caller finishes the full quality file. Later frames are
+    // ignored.
+    void finish();
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> pimpl;
+};
+} // namespace vehlwn::ffmpeg::detail
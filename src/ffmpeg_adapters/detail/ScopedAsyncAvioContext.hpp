@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <stdexcept>
+
+extern "C" {
+#include <libavformat/avio.h>
+#include <libavutil/error.h>
+#include <libavutil/mem.h>
+}
+
+#include <boost/log/trivial.hpp>
+
+#include "AsyncFileWriter.hpp"
+
+namespace vehlwn::ffmpeg::detail {
+struct WriteBehindOptions {
+    std::size_t buffer_size;
+    AsyncFileWriter::FsyncPolicy fsync;
+};
+
+// Output AVIOContext which writes through AsyncFileWriter instead of the file
+// protocol.
+class ScopedAsyncAvioContext {
+    static constexpr int IO_BUFFER_SIZE = 64 * 1024;
+
+    AsyncFileWriter m_writer;
+    AVIOContext* m_raw = nullptr;
+
+public:
+    ScopedAsyncAvioContext(const char* const path, const WriteBehindOptions& options)
+        : m_writer(path, options.buffer_size, options.fsync)
+    {
+        auto* const buffer = static_cast<unsigned char*>(av_malloc(IO_BUFFER_SIZE));
+        if(buffer == nullptr) {
+            throw std::runtime_error("Failed to allocate avio buffer");
+        }
+        m_raw = avio_alloc_context(
+            buffer,
+            IO_BUFFER_SIZE,
+            1,
+            &m_writer,
+            nullptr,
+            &ScopedAsyncAvioContext::write_packet,
+            &ScopedAsyncAvioContext::seek);
+        if(m_raw == nullptr) {
+            av_free(buffer);
+            throw std::runtime_error("avio_alloc_context failed");
+        }
+    }
+    ScopedAsyncAvioContext(const ScopedAsyncAvioContext&) = delete;
+    ScopedAsyncAvioContext(ScopedAsyncAvioContext&&) = delete;
+    ~ScopedAsyncAvioContext()
+    {
+        avio_flush(m_raw);
+        av_freep(&m_raw->buffer);
+        avio_context_free(&m_raw);
+    }
+    ScopedAsyncAvioContext& operator=(const ScopedAsyncAvioContext&) = delete;
+    ScopedAsyncAvioContext& operator=(ScopedAsyncAvioContext&&) = delete;
+
+    [[nodiscard]] AVIOContext* raw() const
+    {
+        return m_raw;
+    }
+
+    // Writes out avio and write-behind buffers. Throws on I/O errors.
+    void close()
+    {
+        avio_flush(m_raw);
+        m_writer.close();
+    }
+
+    [[nodiscard]] WriteStats stats() const
+    {
+        return m_writer.stats();
+    }
+
+private:
+    static int write_packet(void* opaque, const std::uint8_t* buf, int buf_size)
+    {
+        try {
+            static_cast<AsyncFileWriter*>(opaque)->write(
+                {buf, static_cast<std::size_t>(buf_size)});
+            return buf_size;
+        } catch(const std::exception& ex) {
+            BOOST_LOG_TRIVIAL(error) << "Async avio write: " << ex.what();
+            return AVERROR(EIO);
+        }
+    }
+
+    static std::int64_t seek(void* opaque, const std::int64_t offset, int whence)
+    {
+        auto* const writer = static_cast<AsyncFileWriter*>(opaque);
+        if((whence & AVSEEK_SIZE) != 0) {
+            return writer->size();
+        }
+        whence &= ~AVSEEK_FORCE;
+        const auto ret = writer->seek(offset, whence);
+        return ret < 0 ? AVERROR(EINVAL) : ret;
+    }
+};
+} // namespace vehlwn::ffmpeg::detail
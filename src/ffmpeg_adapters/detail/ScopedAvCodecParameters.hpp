@@ -0,0 +1,83 @@
+#pragma once
+
+#include <stdexcept>
+#include <utility>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+}
+
+#include "../ErrorWithContext.hpp"
+#include "AvError.hpp"
+
+namespace vehlwn::ffmpeg::detail {
+class ScopedAvCodecParameters {
+    AVCodecParameters* m_raw = nullptr;
+
+public:
+    ScopedAvCodecParameters()
+        : m_raw(avcodec_parameters_alloc())
+    {
+        if(m_raw == nullptr) {
+            throw std::runtime_error(
+                "Failed to allocate memory for AVCodecParameters");
+        }
+    }
+    ScopedAvCodecParameters(const ScopedAvCodecParameters&) = delete;
+    ScopedAvCodecParameters(ScopedAvCodecParameters&& rhs) noexcept
+    {
+        swap(rhs);
+    }
+    ~ScopedAvCodecParameters()
+    {
+        avcodec_parameters_free(&m_raw);
+    }
+    ScopedAvCodecParameters& operator=(const ScopedAvCodecParameters&) = delete;
+    ScopedAvCodecParameters& operator=(ScopedAvCodecParameters&& rhs) noexcept
+    {
+        swap(rhs);
+        return *this;
+    }
+    void swap(ScopedAvCodecParameters& rhs) noexcept
+    {
+        std::swap(m_raw, rhs.m_raw);
+    }
+
+    [[nodiscard]] const AVCodecParameters* raw() const
+    {
+        return m_raw;
+    }
+    AVCodecParameters* raw()
+    {
+        return m_raw;
+    }
+
+    void copy_from(const AVCodecParameters* const src) const
+    {
+        const int errnum = avcodec_parameters_copy(m_raw, src);
+        if(errnum < 0) {
+            throw ErrorWithContext(
+                "avcodec_parameters_copy failed: ",
+                AvError(errnum));
+        }
+    }
+    void copy_from_context(const AVCodecContext* const codec) const
+    {
+        const int errnum = avcodec_parameters_from_context(m_raw, codec);
+        if(errnum < 0) {
+            throw ErrorWithContext(
+                "avcodec_parameters_from_context failed: ",
+                AvError(errnum));
+        }
+    }
+    void copy_to(AVCodecParameters* const dst) const
+    {
+        const int errnum = avcodec_parameters_copy(dst, m_raw);
+        if(errnum < 0) {
+            throw ErrorWithContext(
+                "avcodec_parameters_copy failed: ",
+                AvError(errnum));
+        }
+    }
+};
+} // namespace vehlwn::ffmpeg::detail
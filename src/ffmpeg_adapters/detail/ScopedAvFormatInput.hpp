@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <optional>
 #include <stdexcept>
 #include <string>
@@ -74,6 +75,14 @@ public:
     {
         av_dump_format(m_raw, 0, m_raw->url, 0);
     }
+    // Limits how much data find_stream_info() reads
+    void set_probe_limits(
+        const std::int64_t probesize,
+        const std::int64_t max_analyze_duration_us) const
+    {
+        m_raw->probesize = probesize;
+        m_raw->max_analyze_duration = max_analyze_duration_us;
+    }
     void find_stream_info() const
     {
         const int errnum = avformat_find_stream_info(m_raw, nullptr);
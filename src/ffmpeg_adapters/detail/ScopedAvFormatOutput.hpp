@@ -1,23 +1,31 @@
 #pragma once
 
+#include <memory>
+#include <optional>
 #include <stdexcept>
 #include <string>
 
 extern "C" {
 #include <libavformat/avformat.h>
+#include <libavutil/mem.h>
 }
 #include <boost/core/span.hpp>
 
 #include "../ErrorWithContext.hpp"
 #include "AvError.hpp"
 #include "AvPacketAdapters.hpp"
+#include "ScopedAsyncAvioContext.hpp"
+#include "ScopedAvDictionary.hpp"
 
 namespace vehlwn::ffmpeg::detail {
 class ScopedAvFormatOutput {
     AVFormatContext* m_raw = nullptr;
+    std::unique_ptr<ScopedAsyncAvioContext> m_async_io;
 
 public:
-    explicit ScopedAvFormatOutput(const char* const filename)
+    explicit ScopedAvFormatOutput(
+        const char* const filename,
+        const std::optional<WriteBehindOptions>& write_behind = std::nullopt)
     {
         int errnum
             = avformat_alloc_output_context2(&m_raw, nullptr, nullptr, filename);
@@ -26,7 +34,21 @@ public:
                 "Could not open output file: avformat_alloc_output_context2 failed",
                 AvError(errnum));
         }
-        if((oformat_flags() & static_cast<unsigned>(AVFMT_NOFILE)) == 0) {
+        if((oformat_flags() & static_cast<unsigned>(AVFMT_NOFILE)) != 0) {
+            return;
+        }
+        if(write_behind) {
+            try {
+                m_async_io = std::make_unique<ScopedAsyncAvioContext>(
+                    m_raw->url,
+                    *write_behind);
+            } catch(const std::exception& ex) {
+                avformat_free_context(m_raw);
+                throw ErrorWithContext("Could not open output file", ex);
+            }
+            m_raw->pb = m_async_io->raw();
+            m_raw->flags |= AVFMT_FLAG_CUSTOM_IO;
+        } else {
             errnum = avio_open(&m_raw->pb, m_raw->url, AVIO_FLAG_WRITE);
             if(errnum < 0) {
                 throw ErrorWithContext(
@@ -45,7 +67,9 @@ public:
         if(m_raw == nullptr) {
             return;
         }
-        if((oformat_flags() & static_cast<unsigned>(AVFMT_NOFILE)) == 0) {
+        if(m_async_io) {
+            m_async_io.reset();
+        } else if((oformat_flags() & static_cast<unsigned>(AVFMT_NOFILE)) == 0) {
             avio_close(m_raw->pb);
         }
         avformat_free_context(m_raw);
@@ -59,6 +83,7 @@ public:
     void swap(ScopedAvFormatOutput& rhs) noexcept
     {
         std::swap(m_raw, rhs.m_raw);
+        std::swap(m_async_io, rhs.m_async_io);
     }
 
     [[nodiscard]] unsigned oformat_flags() const
@@ -66,6 +91,20 @@ public:
         return static_cast<unsigned>(m_raw->oformat->flags);
     }
 
+    [[nodiscard]] const char* url() const
+    {
+        return m_raw->url;
+    }
+    void set_url(const char* const url) const
+    {
+        char* const tmp = av_strdup(url);
+        if(tmp == nullptr) {
+            throw std::runtime_error("Failed to allocate memory for url");
+        }
+        av_freep(&m_raw->url);
+        m_raw->url = tmp;
+    }
+
     [[nodiscard]] AVStream* new_stream() const
     {
         AVStream* const ret = avformat_new_stream(m_raw, nullptr);
@@ -86,9 +125,9 @@ public:
         av_dump_format(m_raw, 0, m_raw->url, 1);
     }
 
-    void write_header() const
+    void write_header(ScopedAvDictionary& options) const
     {
-        const int errnum = avformat_write_header(m_raw, nullptr);
+        const int errnum = avformat_write_header(m_raw, options.double_ptr());
         if(errnum < 0) {
             throw ErrorWithContext(
                 "Error occurred when opening output file: ",
@@ -101,6 +140,22 @@ public:
         av_write_trailer(m_raw);
     }
 
+    // Waits until write-behind data is on disk. Later writes are not allowed.
+    void close_async_io() const
+    {
+        if(m_async_io) {
+            m_async_io->close();
+        }
+    }
+
+    [[nodiscard]] std::optional<WriteStats> write_stats() const
+    {
+        if(m_async_io) {
+            return m_async_io->stats();
+        }
+        return std::nullopt;
+    }
+
     void interleaved_write_packet(OwningAvPacket&& packet) const
     {
         const int errnum = av_interleaved_write_frame(m_raw, packet.raw());
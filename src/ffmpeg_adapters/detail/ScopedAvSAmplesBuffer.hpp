@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstdint>
+#include <utility>
 #include <vector>
 
 extern "C" {
@@ -14,6 +15,7 @@ extern "C" {
 namespace vehlwn::ffmpeg::detail {
 class ScopedAvSAmplesBuffer {
     std::vector<std::uint8_t*> m_raw;
+    int m_frame_size = 0;
 
 public:
     ScopedAvSAmplesBuffer(
@@ -32,6 +34,7 @@ public:
         if(errnum < 0) {
             throw ErrorWithContext("av_samples_alloc failed: ", AvError(errnum));
         }
+        m_frame_size = frame_size;
     }
     ScopedAvSAmplesBuffer(const ScopedAvSAmplesBuffer&) = delete;
     ScopedAvSAmplesBuffer(ScopedAvSAmplesBuffer&& rhs) noexcept
@@ -53,11 +56,17 @@ public:
     void swap(ScopedAvSAmplesBuffer& rhs) noexcept
     {
         std::swap(m_raw, rhs.m_raw);
+        std::swap(m_frame_size, rhs.m_frame_size);
     }
 
     std::uint8_t** data()
     {
         return m_raw.data();
     }
+    // Number of samples per channel the buffer can hold
+    [[nodiscard]] int frame_size() const
+    {
+        return m_frame_size;
+    }
 };
 } // namespace vehlwn::ffmpeg::detail
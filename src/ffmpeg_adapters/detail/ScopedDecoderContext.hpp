@@ -85,6 +85,12 @@ public:
         }
     }
 
+    // Drops buffered data, e.g. after skipped packets
+    void flush_buffers() const
+    {
+        avcodec_flush_buffers(m_raw);
+    }
+
     struct Again {};
     using ReceiveFrameResult = std::variant<OwningAvframe, Again>;
     [[nodiscard]] ReceiveFrameResult receive_frame() const
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace vehlwn::ffmpeg::detail {
+// Offsets subtracted from timestamps of every stream so that each segment
+// starts from zero. Streams of a segment start from the video keyframe it
+// begins with, except a stream whose first packet in the segment precedes the
+// keyframe, e.g. audio interleaved ahead of it. That stream starts from its
+// first packet instead, so that none of its timestamps are negative.
+class SegmentOffsets {
+public:
+    explicit SegmentOffsets(const std::size_t stream_count)
+        : m_offsets(stream_count, 0)
+        , m_fixed(stream_count, true)
+    {}
+
+    // key_offsets are timestamps of the keyframe in time bases of all streams
+    void start_segment(std::vector<std::int64_t>&& key_offsets)
+    {
+        m_offsets = std::move(key_offsets);
+        m_fixed.assign(m_offsets.size(), false);
+    }
+
+    // packet_ts is the smaller timestamp of a packet of the stream if it has
+    // any. The first such packet of every stream in a segment fixes its offset.
+    std::int64_t offset(
+        const std::size_t stream_index,
+        const std::optional<std::int64_t> packet_ts)
+    {
+        auto& offset = m_offsets.at(stream_index);
+        if(!m_fixed.at(stream_index) && packet_ts) {
+            offset = std::min(offset, *packet_ts);
+            m_fixed[stream_index] = true;
+        }
+        return offset;
+    }
+
+private:
+    std::vector<std::int64_t> m_offsets;
+    std::vector<bool> m_fixed;
+};
+} // namespace vehlwn::ffmpeg::detail
@@ -16,10 +16,12 @@ namespace vehlwn::ffmpeg::detail {
 class SwsPixelConverter {
     SwsContext* m_raw = nullptr;
     AVPixelFormat m_dst_format = AV_PIX_FMT_NONE;
+    int m_dst_width = 0;
+    int m_dst_height = 0;
 
     auto as_tuple() noexcept
     {
-        return std::tie(m_raw, m_dst_format);
+        return std::tie(m_raw, m_dst_format, m_dst_width, m_dst_height);
     }
 
 public:
@@ -28,14 +30,25 @@ public:
         const int h,
         const AVPixelFormat srcFormat,
         const AVPixelFormat dstFormat)
+        : SwsPixelConverter(w, h, srcFormat, w, h, dstFormat, 0)
+    {}
+    // Converts pixel format and scales in one pass
+    SwsPixelConverter(
+        const int srcW,
+        const int srcH,
+        const AVPixelFormat srcFormat,
+        const int dstW,
+        const int dstH,
+        const AVPixelFormat dstFormat,
+        const int flags)
         : m_raw(sws_getContext(
-            w,
-            h,
+            srcW,
+            srcH,
             srcFormat,
-            w,
-            h,
+            dstW,
+            dstH,
             dstFormat,
-            0,
+            flags,
             nullptr,
             nullptr,
             nullptr))
@@ -44,6 +57,8 @@ public:
             throw std::runtime_error("Failed to create SwsContext");
         }
         m_dst_format = dstFormat;
+        m_dst_width = dstW;
+        m_dst_height = dstH;
     }
     SwsPixelConverter(const SwsPixelConverter&) = delete;
     SwsPixelConverter(SwsPixelConverter&& rhs) noexcept
@@ -73,8 +88,8 @@ public:
         }
         auto ret = VideoAvFrameBuilder()
                        .format(m_dst_format)
-                       .width(frame.width())
-                       .height(frame.height())
+                       .width(m_dst_width)
+                       .height(m_dst_height)
                        .get_buffer();
         scale_impl(
             frame.data(),
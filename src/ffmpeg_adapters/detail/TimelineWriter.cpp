@@ -0,0 +1,96 @@
+#include "TimelineWriter.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <limits>
+#include <string>
+
+#include <boost/log/trivial.hpp>
+
+namespace vehlwn::ffmpeg::detail {
+namespace {
+// About 2 seconds of video at 30 fps
+constexpr std::size_t BATCH_SIZE = 64;
+// Appending blocks only when the disk is this far behind, several minutes of
+// records
+constexpr std::size_t BUFFER_SIZE = 1 << 20;
+
+template<class T>
+T saturate(const std::int64_t value)
+{
+    return static_cast<T>(std::clamp<std::int64_t>(
+        value,
+        0,
+        std::numeric_limits<T>::max()));
+}
+} // namespace
+
+TimelineWriter::TimelineWriter(std::string path, const std::int64_t origin_pts_us)
+    : m_file(
+          path.c_str(),
+          BUFFER_SIZE,
+          AsyncFileWriter::FsyncPolicy::Never,
+          AsyncFileWriter::OpenPolicy::OnThread)
+    , m_origin_pts_us(origin_pts_us)
+{
+    m_buffer.reserve(BATCH_SIZE);
+}
+
+TimelineWriter::~TimelineWriter()
+{
+    try {
+        flush();
+        m_file.close();
+    } catch(const std::exception& ex) {
+        BOOST_LOG_TRIVIAL(error) << "~TimelineWriter: " << ex.what();
+    }
+}
+
+void TimelineWriter::append(const MotionSample& sample)
+{
+    const auto offset_us = sample.pts_us - m_origin_pts_us;
+    if(!m_header_written) {
+        m_header_written = true;
+        auto header = TimelineHeader();
+        header.magic = TIMELINE_MAGIC;
+        header.version = TIMELINE_VERSION;
+        header.record_size = sizeof(TimelineRecord);
+        header.grid_cols = TIMELINE_GRID_COLS;
+        header.grid_rows = TIMELINE_GRID_ROWS;
+        header.reserved = 0;
+        header.reserved2 = 0;
+        // The sample has just been processed, the origin is offset_us earlier
+        header.start_time_us
+            = std::chrono::duration_cast<std::chrono::microseconds>(
+                  std::chrono::system_clock::now().time_since_epoch())
+                  .count()
+            - offset_us;
+        write(&header, sizeof(header));
+    }
+    auto record = TimelineRecord();
+    record.pts_ms = saturate<std::uint32_t>(offset_us / 1000);
+    record.moving_area = saturate<std::uint32_t>(sample.moving_area);
+    record.blob_count = saturate<std::uint16_t>(sample.blob_count);
+    record.reserved = 0;
+    record.heatmap = sample.heatmap;
+    m_buffer.push_back(record);
+    if(m_buffer.size() >= BATCH_SIZE) {
+        flush();
+    }
+}
+
+void TimelineWriter::flush()
+{
+    if(m_buffer.empty()) {
+        return;
+    }
+    write(m_buffer.data(), m_buffer.size() * sizeof(TimelineRecord));
+    m_buffer.clear();
+}
+
+void TimelineWriter::write(const void* const data, const std::size_t size)
+{
+    m_file.write({static_cast<const std::uint8_t*>(data), size});
+}
+} // namespace vehlwn::ffmpeg::detail
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../Timeline.hpp"
+#include "AsyncFileWriter.hpp"
+
+namespace vehlwn::ffmpeg::detail {
+// Writes a motion timeline sidecar file. Records are buffered and handed over
+// in batches because one is appended for every video frame. The file is opened
+// and written by an I/O thread, so appending never waits for the disk.
+class TimelineWriter {
+public:
+    // Sample times are relative to origin_pts_us, the input timestamp of the
+    // first video packet of the recording
+    TimelineWriter(std::string path, std::int64_t origin_pts_us);
+    TimelineWriter(const TimelineWriter&) = delete;
+    TimelineWriter(TimelineWriter&&) = delete;
+    ~TimelineWriter();
+    TimelineWriter& operator=(const TimelineWriter&) = delete;
+    TimelineWriter& operator=(TimelineWriter&&) = delete;
+
+    // Throws if earlier writes have failed
+    void append(const MotionSample& sample);
+    void flush();
+
+private:
+    AsyncFileWriter m_file;
+    std::int64_t m_origin_pts_us;
+    bool m_header_written = false;
+    std::vector<TimelineRecord> m_buffer;
+
+    void write(const void* data, std::size_t size);
+};
+} // namespace vehlwn::ffmpeg::detail
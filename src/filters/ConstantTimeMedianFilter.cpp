@@ -0,0 +1,194 @@
+#include "ConstantTimeMedianFilter.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include <opencv2/core/utility.hpp>
+#include <opencv2/imgproc.hpp>
+
+namespace vehlwn {
+namespace {
+// Number of coarse bins and fine bins in one coarse bin
+constexpr int BINS = 16;
+
+// Bins are copied to local arrays which do not alias, then fixed size loops over
+// them are vectorized by the compiler
+using Bins = std::array<std::uint16_t, BINS>;
+
+Bins load_bins(const std::uint16_t* const p)
+{
+    auto ret = Bins();
+    std::memcpy(ret.data(), p, sizeof(Bins));
+    return ret;
+}
+
+void add_bins(std::uint16_t* const dst, const std::uint16_t* const src)
+{
+    auto d = load_bins(dst);
+    const auto s = load_bins(src);
+    for(int i = 0; i < BINS; i++) {
+        d[i] = static_cast<std::uint16_t>(d[i] + s[i]);
+    }
+    std::memcpy(dst, d.data(), sizeof(Bins));
+}
+
+void update_bins(
+    std::uint16_t* const dst,
+    const std::uint16_t* const entering,
+    const std::uint16_t* const leaving)
+{
+    auto d = load_bins(dst);
+    const auto e = load_bins(entering);
+    const auto l = load_bins(leaving);
+    for(int i = 0; i < BINS; i++) {
+        d[i] = static_cast<std::uint16_t>(d[i] + e[i] - l[i]);
+    }
+    std::memcpy(dst, d.data(), sizeof(Bins));
+}
+
+// Returns index of the bin containing element of the given rank and subtracts
+// counts of the previous bins from rank
+int find_bin(const std::uint16_t* const bins, int& rank)
+{
+    int i = 0;
+    while(rank >= bins[i]) {
+        rank -= bins[i];
+        i++;
+    }
+    return i;
+}
+} // namespace
+
+ConstantTimeMedianFilter::ConstantTimeMedianFilter(const int kernel_size)
+    : m_kernel_size{kernel_size}
+{
+    if(kernel_size <= 0 || kernel_size % 2 == 0
+       || kernel_size > MAX_KERNEL_SIZE) {
+        throw std::invalid_argument(
+            "ConstantTimeMedianFilter: kernel_size must be odd and in [1, "
+            + std::to_string(MAX_KERNEL_SIZE) + "]");
+    }
+}
+
+CvMatRaiiAdapter ConstantTimeMedianFilter::apply(CvMatRaiiAdapter&& input)
+{
+    auto ret = cv::Mat();
+    apply(input.get(), ret);
+    return CvMatRaiiAdapter(std::move(ret));
+}
+
+void ConstantTimeMedianFilter::apply(const cv::Mat& src, cv::Mat& dst)
+{
+    // Sorting networks of cv::medianBlur are much faster for small kernels
+    if(src.type() != CV_8UC1 || m_kernel_size <= 5) {
+        cv::medianBlur(src, dst, m_kernel_size);
+        return;
+    }
+    dst.create(src.size(), src.type());
+    // Every band fills column histograms with kernel_size rows first, bands much
+    // higher than the kernel keep this overhead small
+    const int min_band_rows = std::max(32, 4 * m_kernel_size);
+    const int bands
+        = std::clamp(src.rows / min_band_rows, 1, cv::getNumThreads());
+    if(m_bands.size() < static_cast<std::size_t>(bands)) {
+        m_bands.resize(static_cast<std::size_t>(bands));
+    }
+    cv::parallel_for_(cv::Range(0, bands), [&](const cv::Range& range) {
+        for(int i = range.start; i < range.end; i++) {
+            const int y0 = src.rows * i / bands;
+            const int y1 = src.rows * (i + 1) / bands;
+            filter_band(src, y0, y1, m_bands[static_cast<std::size_t>(i)], dst);
+        }
+    });
+}
+
+void ConstantTimeMedianFilter::filter_band(
+    const cv::Mat& src,
+    const int y0,
+    const int y1,
+    Histograms& hist,
+    cv::Mat& dst) const
+{
+    const int cols = src.cols;
+    const int radius = m_kernel_size / 2;
+    const auto ucols = static_cast<std::size_t>(cols);
+    hist.coarse.assign(ucols * BINS, 0);
+    hist.fine.assign(ucols * BINS * BINS, 0);
+    // Borders are replicated like in cv::medianBlur
+    const auto src_row = [&](const int y) {
+        return src.ptr<std::uint8_t>(std::clamp(y, 0, src.rows - 1));
+    };
+    const auto coarse = [&](const int x) {
+        const auto c = static_cast<std::size_t>(std::clamp(x, 0, cols - 1));
+        return hist.coarse.data() + c * BINS;
+    };
+    const auto fine = [&](const int x, const int bin) {
+        const auto c = static_cast<std::size_t>(std::clamp(x, 0, cols - 1));
+        return hist.fine.data() + (c * BINS + static_cast<std::size_t>(bin)) * BINS;
+    };
+    const auto update_columns = [&](const int y, const int delta) {
+        const auto* const p = src_row(y);
+        for(int x = 0; x < cols; x++) {
+            const auto v = static_cast<std::size_t>(p[x]);
+            const auto c = static_cast<std::size_t>(x);
+            auto& coarse_bin = hist.coarse[c * BINS + v / BINS];
+            auto& fine_bin = hist.fine[c * BINS * BINS + v];
+            coarse_bin = static_cast<std::uint16_t>(coarse_bin + delta);
+            fine_bin = static_cast<std::uint16_t>(fine_bin + delta);
+        }
+    };
+
+    // Columns of output row y contain source rows [y - radius, y + radius]
+    for(int y = y0 - radius; y < y0 + radius; y++) {
+        update_columns(y, 1);
+    }
+    const int median_rank = m_kernel_size * m_kernel_size / 2;
+    auto kernel_coarse = std::array<std::uint16_t, BINS>();
+    auto kernel_fine = std::array<std::uint16_t, BINS * BINS>();
+    // Column at which every fine bin of the kernel histogram was last updated
+    auto last_update = std::array<int, BINS>();
+    for(int y = y0; y < y1; y++) {
+        update_columns(y + radius, 1);
+        kernel_coarse.fill(0);
+        for(int j = -radius; j <= radius; j++) {
+            add_bins(kernel_coarse.data(), coarse(j));
+        }
+        // Forces the first fine update to sum all columns
+        last_update.fill(-m_kernel_size);
+        auto* const out = dst.ptr<std::uint8_t>(y);
+        for(int x = 0; x < cols; x++) {
+            if(x > 0) {
+                update_bins(
+                    kernel_coarse.data(),
+                    coarse(x + radius),
+                    coarse(x - radius - 1));
+            }
+            int rank = median_rank;
+            const int bin = find_bin(kernel_coarse.data(), rank);
+            auto* const bins = kernel_fine.data() + bin * BINS;
+            // Sliding over skipped columns costs two updates per column, summing
+            // the whole kernel costs kernel_size updates
+            auto& last = last_update[static_cast<std::size_t>(bin)];
+            if(x - last > radius) {
+                std::fill_n(bins, BINS, std::uint16_t{0});
+                for(int j = -radius; j <= radius; j++) {
+                    add_bins(bins, fine(x + j, bin));
+                }
+            } else {
+                for(int c = last + 1; c <= x; c++) {
+                    update_bins(
+                        bins,
+                        fine(c + radius, bin),
+                        fine(c - radius - 1, bin));
+                }
+            }
+            last = x;
+            out[x] = static_cast<std::uint8_t>(bin * BINS + find_bin(bins, rank));
+        }
+        update_columns(y - radius, -1);
+    }
+}
+} // namespace vehlwn
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <opencv2/core/mat.hpp>
+
+#include "IImageFilter.hpp"
+
+namespace vehlwn {
+// Median filter of Perreault and Hebert with constant time per pixel for any
+// kernel size. Every column keeps a histogram of the pixels in the kernel rows
+// and the kernel histogram slides over them. Histograms are two level: 16 coarse
+// bins of the high 4 bits and 256 fine bins, only coarse bins are updated for
+// every pixel. Row bands are processed in parallel with cv::parallel_for_.
+// Results are identical to cv::medianBlur. Only 8-bit single channel images and
+// kernels larger than 5 are handled, others are passed to cv::medianBlur.
+class ConstantTimeMedianFilter : public IImageFilter {
+public:
+    // Larger kernels overflow 16-bit histogram bins
+    static constexpr int MAX_KERNEL_SIZE = 255;
+
+    explicit ConstantTimeMedianFilter(int kernel_size);
+    CvMatRaiiAdapter apply(CvMatRaiiAdapter&& input) override;
+    // dst must not share memory with src
+    void apply(const cv::Mat& src, cv::Mat& dst);
+
+private:
+    // Column histograms of one band
+    struct Histograms {
+        std::vector<std::uint16_t> coarse;
+        std::vector<std::uint16_t> fine;
+    };
+
+    const int m_kernel_size;
+    // Reused between frames, one for every band
+    std::vector<Histograms> m_bands;
+
+    // Writes rows [y0, y1) of dst
+    void filter_band(
+        const cv::Mat& src,
+        int y0,
+        int y1,
+        Histograms& hist,
+        cv::Mat& dst) const;
+};
+} // namespace vehlwn
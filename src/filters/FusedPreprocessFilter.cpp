@@ -0,0 +1,269 @@
+#include "FusedPreprocessFilter.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include <opencv2/imgproc.hpp>
+
+namespace vehlwn {
+namespace {
+// Source rows of a strip and their gray copy stay in L2 cache
+constexpr std::size_t STRIP_BYTES = 256 * 1024;
+
+// Rows [y0, y1) as an image without a parent. OpenCV functions look at pixels
+// outside of a ROI and may choose a different code path for it. A plain header
+// over the same memory is processed exactly like a whole frame.
+cv::Mat band(const cv::Mat& image, const int y0, const int y1)
+{
+    return {
+        y1 - y0,
+        image.cols,
+        image.type(),
+        const_cast<uchar*>(image.ptr(y0)),
+        image.step};
+}
+} // namespace
+
+FusedPreprocessFilter::FusedPreprocessFilter(
+    const bool convert_to_gray,
+    const std::optional<double> resize_factor,
+    Smoothing smoothing,
+    std::shared_ptr<ThreadPool> thread_pool)
+    : m_convert_to_gray(convert_to_gray)
+    , m_resize_factor(resize_factor)
+    , m_smoothing(std::move(smoothing))
+    , m_thread_pool(std::move(thread_pool))
+{
+    if(m_resize_factor) {
+        const auto f = *m_resize_factor;
+        m_downscale = std::max(1, cvRound(1. / f));
+        m_fused = 1. / m_downscale == f;
+    }
+    m_bands.push_back(make_band_state());
+}
+
+CvMatRaiiAdapter FusedPreprocessFilter::apply(CvMatRaiiAdapter&& input)
+{
+    if(!m_fused) {
+        apply_sequential(input.get());
+        return std::move(input);
+    }
+    return CvMatRaiiAdapter(apply_fused(input.get()));
+}
+
+bool FusedPreprocessFilter::is_fused() const
+{
+    return m_fused;
+}
+
+cv::Mat FusedPreprocessFilter::apply_fused(const cv::Mat& input)
+{
+    const bool smoothing = !std::holds_alternative<std::monostate>(m_smoothing);
+    if(!m_convert_to_gray && !m_resize_factor && !smoothing) {
+        return input;
+    }
+    const auto out_size = [&] {
+        if(!m_resize_factor) {
+            return input.size();
+        }
+        // The same rounding as in cv::resize
+        return cv::Size(
+            cv::saturate_cast<int>(input.cols * *m_resize_factor),
+            cv::saturate_cast<int>(input.rows * *m_resize_factor));
+    }();
+    const auto out_type
+        = m_convert_to_gray ? CV_MAKETYPE(input.depth(), 1) : input.type();
+    auto ret = cv::Mat(out_size, out_type);
+    const int rows = out_size.height;
+    const int bands = band_count(rows);
+    while(m_bands.size() < static_cast<std::size_t>(bands)) {
+        m_bands.push_back(make_band_state());
+    }
+    if(bands == 1) {
+        process_rows(input, 0, rows, ret, m_bands.front());
+        return ret;
+    }
+    m_thread_pool->parallel_for(bands, [&](const int i) {
+        process_rows(
+            input,
+            rows * i / bands,
+            rows * (i + 1) / bands,
+            ret,
+            m_bands[static_cast<std::size_t>(i)]);
+    });
+    return ret;
+}
+
+void FusedPreprocessFilter::apply_sequential(cv::Mat& image)
+{
+    if(m_convert_to_gray) {
+        cv::cvtColor(image, image, cv::COLOR_BGR2GRAY);
+    }
+    if(m_resize_factor) {
+        const auto f = *m_resize_factor;
+        cv::resize(image, image, cv::Size{0, 0}, f, f);
+    }
+    smooth(image, image, m_bands.front());
+}
+
+int FusedPreprocessFilter::band_count(const int rows) const
+{
+    if(!m_thread_pool) {
+        return 1;
+    }
+    // Every band produces and smooths 2 * halo extra rows
+    const int min_band_rows = std::max(32, 8 * smoothing_halo());
+    return std::clamp(rows / min_band_rows, 1, m_thread_pool->size());
+}
+
+FusedPreprocessFilter::BandState FusedPreprocessFilter::make_band_state() const
+{
+    auto ret = BandState();
+    if(const auto* const median = std::get_if<ConstantTimeMedian>(&m_smoothing)) {
+        ret.median.emplace(median->kernel_size);
+    }
+    return ret;
+}
+
+void FusedPreprocessFilter::process_rows(
+    const cv::Mat& input,
+    const int r0,
+    const int r1,
+    cv::Mat& dst,
+    BandState& state)
+{
+    const bool smoothing = !std::holds_alternative<std::monostate>(m_smoothing);
+    const int halo = smoothing_halo();
+    // Rows of the band with halo rows of the neighbours. Only rows [r0, r1) of
+    // dst are written, the other bands may be writing the rest.
+    const int a0 = std::max(0, r0 - halo);
+    const int a1 = std::min(dst.rows, r1 + halo);
+    auto dst_band = band(dst, a0, a1);
+    if(!m_convert_to_gray && !m_resize_factor) {
+        smooth_rows(band(input, a0, a1), r0 - a0, r1 - a0, dst_band, state);
+        return;
+    }
+    // Smoothing of a row needs resized rows of the next strip so the whole band
+    // is kept. It is small compared to the input.
+    auto& resized = smoothing ? state.resized : dst_band;
+    resized.create(a1 - a0, dst.cols, dst.type());
+
+    const int strip_rows = std::max<int>(
+        1,
+        static_cast<int>(STRIP_BYTES / (input.step * m_downscale)));
+    // Every smoothed part recomputes 2 * halo rows, large parts make it cheap
+    const int min_part_rows = std::max(32, 16 * halo);
+    int smoothed_rows = r0;
+    for(int d0 = a0; d0 < a1; d0 += strip_rows) {
+        const int d1 = std::min(a1, d0 + strip_rows);
+        produce_rows(input, d0, d1, band(resized, d0 - a0, d1 - a0), state);
+        if(!smoothing) {
+            continue;
+        }
+        const int ready = d1 == a1 ? r1 : std::min(r1, d1 - halo);
+        if(ready - smoothed_rows >= min_part_rows || ready == r1) {
+            smooth_rows(resized, smoothed_rows - a0, ready - a0, dst_band, state);
+            smoothed_rows = ready;
+        }
+    }
+}
+
+void FusedPreprocessFilter::produce_rows(
+    const cv::Mat& input,
+    const int d0,
+    const int d1,
+    cv::Mat dst,
+    BandState& state) const
+{
+    if(!m_resize_factor) {
+        cv::cvtColor(band(input, d0, d1), dst, cv::COLOR_BGR2GRAY);
+        return;
+    }
+    const auto f = *m_resize_factor;
+    const int k = m_downscale;
+    // Output row d is interpolated from source rows [d * k, d * k + k]. Near the
+    // bottom the number of output rows of a short band may be rounded down, then
+    // the band is started a few output rows earlier.
+    for(int skip = 0; skip <= d0; skip++) {
+        const int s0 = (d0 - skip) * k;
+        const int s1 = std::min(input.rows, d1 * k + k + 1);
+        if(cv::saturate_cast<int>((s1 - s0) * f) < skip + d1 - d0) {
+            continue;
+        }
+        auto& strip = state.resized_strip;
+        if(m_convert_to_gray) {
+            cv::cvtColor(band(input, s0, s1), state.gray_strip, cv::COLOR_BGR2GRAY);
+            cv::resize(state.gray_strip, strip, cv::Size{0, 0}, f, f);
+        } else {
+            cv::resize(band(input, s0, s1), strip, cv::Size{0, 0}, f, f);
+        }
+        strip.rowRange(skip, skip + d1 - d0).copyTo(dst);
+        return;
+    }
+    throw std::logic_error("FusedPreprocessFilter: failed to resize a strip");
+}
+
+void FusedPreprocessFilter::smooth_rows(
+    const cv::Mat& src,
+    const int b0,
+    const int b1,
+    cv::Mat& dst,
+    BandState& state) const
+{
+    if(b0 >= b1) {
+        return;
+    }
+    const int halo = smoothing_halo();
+    const int a0 = std::max(0, b0 - halo);
+    const int a1 = std::min(src.rows, b1 + halo);
+    auto dst_band = band(dst, b0, b1);
+    // Without halo rows the result is written directly
+    if(a0 == b0 && a1 == b1) {
+        smooth(band(src, a0, a1), dst_band, state);
+        return;
+    }
+    smooth(band(src, a0, a1), state.smoothed_band, state);
+    state.smoothed_band.rowRange(b0 - a0, b1 - a0).copyTo(dst_band);
+}
+
+void FusedPreprocessFilter::smooth(
+    const cv::Mat& src,
+    cv::Mat& dst,
+    BandState& state) const
+{
+    if(const auto* const box = std::get_if<NormalizedBox>(&m_smoothing)) {
+        cv::blur(src, dst, {box->kernel_size, box->kernel_size});
+    } else if(const auto* const gaus = std::get_if<Gaussian>(&m_smoothing)) {
+        cv::GaussianBlur(
+            src,
+            dst,
+            cv::Size{gaus->kernel_size, gaus->kernel_size},
+            gaus->sigma,
+            gaus->sigma);
+    } else if(state.median) {
+        if(&src == &dst) {
+            state.median->apply(src.clone(), dst);
+        } else {
+            state.median->apply(src, dst);
+        }
+    } else if(&src != &dst) {
+        src.copyTo(dst);
+    }
+}
+
+int FusedPreprocessFilter::smoothing_halo() const
+{
+    return std::visit(
+        [](const auto& s) {
+            if constexpr(std::is_same_v<std::decay_t<decltype(s)>, std::monostate>) {
+                return 0;
+            } else {
+                return s.kernel_size / 2 + 1;
+            }
+        },
+        m_smoothing);
+}
+} // namespace vehlwn
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <memory>
+#include <optional>
+#include <variant>
+#include <vector>
+
+#include <opencv2/core/mat.hpp>
+
+#include "ConstantTimeMedianFilter.hpp"
+#include "IImageFilter.hpp"
+#include "ThreadPool.hpp"
+
+namespace vehlwn {
+// Gray conversion, resizing and smoothing in one pass. A frame is processed in
+// strips of rows which fit into cache: a strip is converted to gray, resized and
+// smoothed before the next one is read, so full resolution intermediate images
+// are never written to memory. The result is identical to ImageFilterChain with
+// ConvertToGrayFilter, ResizeFilter and NormalizedBoxFilter, GaussianBlurFilter
+// or ConstantTimeMedianFilter.
+//
+// With a thread pool the output rows are split into bands which are processed in
+// parallel. Every band produces and smooths halo rows of its neighbours again so
+// the result does not change.
+//
+// Strips need an integer downscale factor, i.e. resize_factor = 1 / k. With any
+// other factor stages are applied to whole frames one after another.
+class FusedPreprocessFilter : public IImageFilter {
+public:
+    struct NormalizedBox {
+        int kernel_size;
+    };
+    struct Gaussian {
+        int kernel_size;
+        double sigma;
+    };
+    struct ConstantTimeMedian {
+        int kernel_size;
+    };
+    using Smoothing = std::variant<
+        std::monostate,
+        NormalizedBox,
+        Gaussian,
+        ConstantTimeMedian>;
+
+    // thread_pool can be null to process frames on the calling thread
+    FusedPreprocessFilter(
+        bool convert_to_gray,
+        std::optional<double> resize_factor,
+        Smoothing smoothing,
+        std::shared_ptr<ThreadPool> thread_pool = nullptr);
+    CvMatRaiiAdapter apply(CvMatRaiiAdapter&& input) override;
+    [[nodiscard]] bool is_fused() const;
+
+private:
+    // Buffers and filters of one band reused between frames
+    struct BandState {
+        cv::Mat gray_strip;
+        cv::Mat resized_strip;
+        cv::Mat resized;
+        cv::Mat smoothed_band;
+        std::optional<ConstantTimeMedianFilter> median;
+    };
+
+    const bool m_convert_to_gray;
+    const std::optional<double> m_resize_factor;
+    const Smoothing m_smoothing;
+    const std::shared_ptr<ThreadPool> m_thread_pool;
+    // Inverse of resize_factor, 1 without resizing
+    int m_downscale = 1;
+    bool m_fused = true;
+    std::vector<BandState> m_bands;
+
+    cv::Mat apply_fused(const cv::Mat& input);
+    void apply_sequential(cv::Mat& image);
+    [[nodiscard]] int band_count(int rows) const;
+    [[nodiscard]] BandState make_band_state() const;
+    // Writes rows [r0, r1) of the result into dst
+    void process_rows(
+        const cv::Mat& input,
+        int r0,
+        int r1,
+        cv::Mat& dst,
+        BandState& state);
+    // Writes rows [d0, d1) of the gray resized image into dst of d1 - d0 rows
+    void produce_rows(
+        const cv::Mat& input,
+        int d0,
+        int d1,
+        cv::Mat dst,
+        BandState& state) const;
+    // Writes smoothed rows [b0, b1) of src into dst
+    void smooth_rows(
+        const cv::Mat& src,
+        int b0,
+        int b1,
+        cv::Mat& dst,
+        BandState& state) const;
+    void smooth(const cv::Mat& src, cv::Mat& dst, BandState& state) const;
+    [[nodiscard]] int smoothing_halo() const;
+};
+} // namespace vehlwn
@@ -1,6 +1,8 @@
 #include "init_logging.hpp"
 #include "ApplicationSettings.hpp"
 
+#include <cstddef>
+#include <cstdlib>
 #include <iostream>
 
 #include <boost/core/null_deleter.hpp>
@@ -8,9 +10,14 @@
 #include <boost/log/attributes/named_scope.hpp>
 #include <boost/log/core/core.hpp>
 #include <boost/log/expressions.hpp>
+#include <boost/log/expressions/formatter.hpp>
 #include <boost/log/expressions/formatters/date_time.hpp>
 #include <boost/log/expressions/formatters/named_scope.hpp>
 #include <boost/log/expressions/formatters/stream.hpp>
+#include <boost/log/sinks/async_frontend.hpp>
+#include <boost/log/sinks/block_on_overflow.hpp>
+#include <boost/log/sinks/bounded_fifo_queue.hpp>
+#include <boost/log/sinks/drop_on_overflow.hpp>
 #include <boost/log/sinks/sync_frontend.hpp>
 #include <boost/log/sinks/text_ostream_backend.hpp>
 #include <boost/log/support/date_time.hpp>
@@ -23,18 +30,43 @@ extern "C" {
 
 namespace vehlwn {
 namespace {
+// Maximum number of records waiting in the asynchronous sink queue
+constexpr std::size_t ASYNC_QUEUE_SIZE = 4096;
+
+using TextBackend = boost::log::sinks::text_ostream_backend;
+
+template<class OverflowStrategy>
+using AsyncSink = boost::log::sinks::asynchronous_sink<
+    TextBackend,
+    boost::log::sinks::bounded_fifo_queue<ASYNC_QUEUE_SIZE, OverflowStrategy>>;
+
+template<class OverflowStrategy>
+void add_async_sink(
+    const boost::shared_ptr<TextBackend>& backend,
+    const boost::log::formatter& formatter)
+{
+    // Records still in the queue must be written before the process exits, also
+    // after std::exit() in fatal error handlers.
+    static boost::shared_ptr<AsyncSink<OverflowStrategy>> sink;
+    sink = boost::make_shared<AsyncSink<OverflowStrategy>>(backend);
+    sink->set_formatter(formatter);
+    boost::log::core::get()->add_sink(sink);
+    std::atexit([] {
+        boost::log::core::get()->remove_sink(sink);
+        sink->stop();
+        sink->flush();
+        sink.reset();
+    });
+}
+
 void init_boost_log(const ApplicationSettings::Logging& logging)
 {
     auto core = boost::log::core::get();
-    auto backend = boost::make_shared<boost::log::sinks::text_ostream_backend>();
+    auto backend = boost::make_shared<TextBackend>();
     backend->add_stream(
         boost::shared_ptr<std::ostream>(&std::clog, boost::null_deleter{}));
     backend->auto_flush(true);
 
-    auto sink = boost::make_shared<boost::log::sinks::synchronous_sink<
-        boost::log::sinks::text_ostream_backend>>(backend);
-    core->add_sink(sink);
-
     namespace expr = boost::log::expressions;
     namespace attrs = boost::log::attributes;
     namespace keywords = boost::log::keywords;
@@ -47,18 +79,31 @@ void init_boost_log(const ApplicationSettings::Logging& logging)
                                          keywords::depth = 1,                       \
                                          keywords::incomplete_marker = "")          \
                                   << "] " << expr::smessage
+    auto formatter = boost::log::formatter();
     if(logging.show_timestamp) {
-        sink->set_formatter(
-            expr::stream << "["
-                         << expr::format_date_time<attrs::local_clock::value_type>(
-                                "TimeStamp",
-                                "%Y-%m-%d %H:%M:%S.%f")
-                         << " " << COMMON_FORMAT);
+        formatter = expr::stream
+            << "["
+            << expr::format_date_time<attrs::local_clock::value_type>(
+                   "TimeStamp",
+                   "%Y-%m-%d %H:%M:%S.%f")
+            << " " << COMMON_FORMAT;
     } else {
-        sink->set_formatter(expr::stream << "[" << COMMON_FORMAT);
+        formatter = expr::stream << "[" << COMMON_FORMAT;
     }
 #undef COMMON_FORMAT
 
+    if(!logging.async) {
+        auto sink
+            = boost::make_shared<boost::log::sinks::synchronous_sink<TextBackend>>(
+                backend);
+        sink->set_formatter(formatter);
+        core->add_sink(sink);
+    } else if(logging.overflow == ApplicationSettings::Logging::Overflow::Block) {
+        add_async_sink<boost::log::sinks::block_on_overflow>(backend, formatter);
+    } else {
+        add_async_sink<boost::log::sinks::drop_on_overflow>(backend, formatter);
+    }
+
     if(logging.show_timestamp) {
         core->add_global_attribute("TimeStamp", attrs::local_clock());
     }
@@ -12,25 +12,65 @@
 #include "Api.hpp"
 #include "ApplicationSettings.hpp"
 #include "Config.hpp"
+#include "ConfigReloader.hpp"
 #include "MotionDataWorker.hpp"
+#include "RecordingIndex.hpp"
+#include "RetentionSweeper.hpp"
+#include "ThreadPool.hpp"
+#include "WorkQueue.hpp"
+#include "ffmpeg_adapters/JpegEncoder.hpp"
 #include "init_logging.hpp"
 
 int main()
 try {
     BOOST_LOG_FUNCTION();
+    // Before logging and capture threads are started, they inherit the mask
+    vehlwn::ConfigReloader::block_signals();
     auto application_settings = std::make_shared<const vehlwn::ApplicationSettings>(
         vehlwn::read_settings());
     vehlwn::init_logging(application_settings->logging);
 
+    auto recording_index = std::make_shared<vehlwn::RecordingIndex>(
+        application_settings->output_files.prefix);
+    auto retention_sweeper = std::shared_ptr<vehlwn::RetentionSweeper>();
+    if(const auto& retention = application_settings->retention) {
+        retention_sweeper = std::make_shared<vehlwn::RetentionSweeper>(
+            *retention,
+            application_settings->output_files.prefix,
+            recording_index);
+    }
+    // Shared by preprocessing of all frames. OpenCV functions may still use their
+    // own threads, see cv::setNumThreads.
+    auto preprocess_pool = std::shared_ptr<vehlwn::ThreadPool>();
+    if(const int threads = application_settings->preprocess.threads; threads > 1) {
+        preprocess_pool = std::make_shared<vehlwn::ThreadPool>(threads);
+    }
+    // Image and timeline endpoints do heavy work here instead of on drogon
+    // event loop threads
+    auto image_workers = std::make_shared<vehlwn::WorkQueue>(
+        application_settings->api.workers,
+        application_settings->api.queue_size);
+    // Encoders of image endpoints and recording thumbnails
+    auto jpeg_encoders = std::make_shared<vehlwn::ffmpeg::JpegEncoderPool>();
     auto motion_data_worker = std::make_shared<vehlwn::MotionDataWorker>(
-        std::move(application_settings));
+        std::move(application_settings),
+        recording_index,
+        std::move(retention_sweeper),
+        std::move(preprocess_pool),
+        std::shared_ptr(jpeg_encoders));
     motion_data_worker->start();
+    auto config_reloader
+        = std::make_shared<vehlwn::ConfigReloader>(motion_data_worker);
 
     drogon::app()
         .loadConfigFile(std::string(CONFIG_DIR) + "/drogon.json")
         .setDocumentRoot(std::string(DATA_DIR) + "/front")
-        .registerController(
-            std::make_shared<vehlwn::api::Controller>(std::move(motion_data_worker)))
+        .registerController(std::make_shared<vehlwn::api::Controller>(
+            std::shared_ptr(motion_data_worker),
+            std::move(recording_index),
+            std::move(config_reloader),
+            std::move(image_workers),
+            std::move(jpeg_encoders)))
         .registerBeginningAdvice([] {
             const auto gen_list = [] {
                 auto ret = std::vector<std::string>();
@@ -43,6 +83,9 @@ try {
             BOOST_LOG_TRIVIAL(info) << "Server listening " << gen_list();
         })
         .run();
+    // The controller may outlive main, stop explicitly to save the background
+    // snapshot
+    motion_data_worker->stop();
     return 0;
 } catch(const std::exception& ex) {
     BOOST_LOG_TRIVIAL(fatal) << ex.what();
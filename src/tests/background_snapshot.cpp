@@ -0,0 +1,121 @@
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+#include <unistd.h>
+
+#include <opencv2/core.hpp>
+#define BOOST_TEST_MODULE background_snapshot
+#include <boost/test/included/unit_test.hpp>
+
+#include "../BackgroundModelSnapshot.hpp"
+#include "../BackgroundSubtractorFactory.hpp"
+#include "../ffmpeg_adapters/SyntheticScene.hpp"
+
+using vehlwn::ApplicationSettings;
+using vehlwn::BackgroundModelSnapshot;
+using vehlwn::CvMatRaiiAdapter;
+using vehlwn::ffmpeg::SyntheticScene;
+
+namespace {
+// Removed with its content at the end of a test
+struct TempDir {
+    std::filesystem::path path = std::filesystem::temp_directory_path()
+        / ("background_snapshot_" + std::to_string(::getpid()));
+    TempDir()
+    {
+        std::filesystem::create_directories(path);
+    }
+    TempDir(const TempDir&) = delete;
+    TempDir(TempDir&&) = delete;
+    ~TempDir()
+    {
+        std::filesystem::remove_all(path);
+    }
+    TempDir& operator=(const TempDir&) = delete;
+    TempDir& operator=(TempDir&&) = delete;
+};
+
+ApplicationSettings::Segmentation::BackgroundSubtractor
+    mog2_settings(const std::filesystem::path& snapshot_path)
+{
+    using BackgroundSubtractor
+        = ApplicationSettings::Segmentation::BackgroundSubtractor;
+    auto ret = BackgroundSubtractor();
+    ret.algorithm = BackgroundSubtractor::Mog2{500, 16., false};
+    ret.snapshot = BackgroundSubtractor::Snapshot{snapshot_path.string(), 3600.};
+    return ret;
+}
+
+cv::Mat ground_truth_mask(const SyntheticScene& scene, const std::int64_t n)
+{
+    const auto& params = scene.params();
+    auto ret = cv::Mat(params.height, params.width, CV_8UC1, cv::Scalar(0));
+    for(const auto& box : scene.boxes_at(n)) {
+        ret(box).setTo(255);
+    }
+    return ret;
+}
+} // namespace
+
+BOOST_AUTO_TEST_CASE(RoundTrip)
+{
+    const auto dir = TempDir();
+    const auto snapshot = BackgroundModelSnapshot(dir.path / "nested" / "bg.png");
+    BOOST_TEST(!snapshot.load().has_value());
+
+    auto rng = cv::RNG(42);
+    for(const int type : {CV_8UC1, CV_8UC3}) {
+        auto image = cv::Mat(48, 64, type);
+        rng.fill(image, cv::RNG::UNIFORM, 0, 256);
+        snapshot.save(image);
+        const auto loaded = snapshot.load();
+        BOOST_TEST_REQUIRE(loaded.has_value());
+        BOOST_TEST(loaded->type() == type);
+        BOOST_TEST(loaded->size() == image.size());
+        BOOST_TEST(cv::norm(*loaded, image, cv::NORM_INF) == 0.);
+    }
+    BOOST_TEST(!std::filesystem::exists(dir.path / "nested" / "bg.png.tmp"));
+}
+
+BOOST_AUTO_TEST_CASE(RejectsCorruptFile)
+{
+    const auto dir = TempDir();
+    const auto path = dir.path / "bg.png";
+    std::ofstream(path) << "not a png";
+    BOOST_CHECK_THROW(BackgroundModelSnapshot(path).load(), std::runtime_error);
+    BOOST_CHECK_THROW(
+        BackgroundModelSnapshot(path).save(cv::Mat()),
+        std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(WarmStartDetectsFromFirstFrame)
+{
+    const auto dir = TempDir();
+    const auto settings = mog2_settings(dir.path / "bg.png");
+    const auto scene = SyntheticScene::from_url(
+        "synthetic://moving_box?w=320&h=240&objects=3");
+    auto frame = cv::Mat();
+    {
+        const auto trained = vehlwn::BackgroundSubtractorFactory(settings).create();
+        for(std::int64_t n = 0; n < 200; n++) {
+            scene->render(n, frame);
+            trained->apply(CvMatRaiiAdapter(frame.clone()));
+        }
+        trained->save_snapshot();
+    }
+    BOOST_TEST_REQUIRE(std::filesystem::exists(dir.path / "bg.png"));
+
+    // A cold model takes the first frame as background and misses the boxes,
+    // a warm started one finds them in the first frame already
+    const auto warm = vehlwn::BackgroundSubtractorFactory(settings).create();
+    scene->render(200, frame);
+    const auto fgmask = warm->apply(CvMatRaiiAdapter(frame.clone()));
+    const auto truth = ground_truth_mask(*scene, 200);
+    const double true_positives = cv::countNonZero(fgmask.get() & truth);
+    const double false_positives = cv::countNonZero(fgmask.get() & ~truth);
+    BOOST_TEST(true_positives / cv::countNonZero(truth) > 0.8);
+    BOOST_TEST(false_positives / static_cast<double>(frame.total()) < 0.01);
+}
@@ -0,0 +1,134 @@
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#define BOOST_TEST_MODULE blob_extractor
+#include <boost/test/included/unit_test.hpp>
+
+#include "../BlobExtractor.hpp"
+
+using vehlwn::Blob;
+using vehlwn::BlobExtractor;
+using vehlwn::RleMask;
+
+namespace {
+// Without morphology so that labels of exact shapes can be checked
+vehlwn::ApplicationSettings::Segmentation::Blobs make_config(const double scale)
+{
+    return {.scale = scale, .morphology_kernel_size = 0, .min_blob_area = 0};
+}
+
+cv::Mat make_mask(const int rows, const int cols)
+{
+    return {rows, cols, CV_8UC1, cv::Scalar(0)};
+}
+
+void fill(cv::Mat& mask, const cv::Rect& rect, const int value = 255)
+{
+    mask(rect).setTo(cv::Scalar(value));
+}
+
+std::vector<Blob>
+    label(const cv::Mat& mask, const double fx = 1., const double fy = 1.)
+{
+    auto extractor = BlobExtractor(make_config(1.));
+    return extractor.label(RleMask(mask), fx, fy);
+}
+} // namespace
+
+BOOST_AUTO_TEST_CASE(LabelsSeparateRegions)
+{
+    auto mask = make_mask(20, 30);
+    fill(mask, cv::Rect(2, 3, 4, 2));
+    fill(mask, cv::Rect(10, 8, 6, 5));
+    const auto blobs = label(mask);
+    BOOST_TEST_REQUIRE(blobs.size() == 2U);
+    // Sorted by area
+    BOOST_TEST(blobs[0].area == 30);
+    BOOST_TEST((blobs[0].bbox == cv::Rect(10, 8, 6, 5)));
+    BOOST_TEST(blobs[0].centroid.x == 12.5);
+    BOOST_TEST(blobs[0].centroid.y == 10.);
+    BOOST_TEST(blobs[1].area == 8);
+    BOOST_TEST((blobs[1].bbox == cv::Rect(2, 3, 4, 2)));
+    BOOST_TEST(blobs[1].centroid.x == 3.5);
+    BOOST_TEST(blobs[1].centroid.y == 3.5);
+    BOOST_TEST(label(make_mask(20, 30)).empty());
+}
+
+BOOST_AUTO_TEST_CASE(DiagonalRunsAreConnected)
+{
+    auto mask = make_mask(12, 20);
+    // Staircase of single pixels touching only by corners
+    for(int i = 0; i < 5; i++) {
+        fill(mask, cv::Rect(i, i, 1, 1));
+    }
+    // Two bars labeled apart until the bottom row joins them
+    fill(mask, cv::Rect(10, 0, 1, 5));
+    fill(mask, cv::Rect(14, 0, 1, 5));
+    fill(mask, cv::Rect(10, 5, 5, 1));
+    // One pixel apart diagonally, so not connected
+    fill(mask, cv::Rect(0, 8, 2, 1));
+    fill(mask, cv::Rect(3, 9, 2, 1));
+    const auto blobs = label(mask);
+    BOOST_TEST_REQUIRE(blobs.size() == 4U);
+    BOOST_TEST(blobs[0].area == 15);
+    BOOST_TEST((blobs[0].bbox == cv::Rect(10, 0, 5, 6)));
+    BOOST_TEST(blobs[1].area == 5);
+    BOOST_TEST((blobs[1].bbox == cv::Rect(0, 0, 5, 5)));
+    BOOST_TEST(blobs[1].centroid.x == 2.);
+    BOOST_TEST(blobs[1].centroid.y == 2.);
+    BOOST_TEST(blobs[2].area == 2);
+    BOOST_TEST(blobs[3].area == 2);
+}
+
+BOOST_AUTO_TEST_CASE(LabelsBitPackedMask)
+{
+    // Alternating pixels are stored bit-packed and all touch by corners
+    auto mask = make_mask(16, 21);
+    for(int y = 0; y < mask.rows; y++) {
+        for(int x = y % 2; x < mask.cols; x += 2) {
+            fill(mask, cv::Rect(x, y, 1, 1));
+        }
+    }
+    // Apart from the rest
+    fill(mask, cv::Rect(0, 15, 21, 1), 0);
+    fill(mask, cv::Rect(18, 14, 3, 1), 0);
+    fill(mask, cv::Rect(20, 15, 1, 1));
+    const auto rle = RleMask(mask);
+    BOOST_TEST_REQUIRE(rle.packed());
+    auto extractor = BlobExtractor(make_config(1.));
+    const auto blobs = extractor.label(rle, 1., 1.);
+    BOOST_TEST_REQUIRE(blobs.size() == 2U);
+    BOOST_TEST(blobs[0].area == cv::countNonZero(mask) - 1);
+    BOOST_TEST((blobs[0].bbox == cv::Rect(0, 0, 21, 15)));
+    BOOST_TEST(blobs[1].area == 1);
+    BOOST_TEST((blobs[1].bbox == cv::Rect(20, 15, 1, 1)));
+}
+
+BOOST_AUTO_TEST_CASE(ScalesCoordinates)
+{
+    auto mask = make_mask(10, 10);
+    fill(mask, cv::Rect(1, 2, 3, 2));
+    const auto blobs = label(mask, 2., 4.);
+    BOOST_TEST_REQUIRE(blobs.size() == 1U);
+    // The same as a blob of the mask upscaled by 2 and 4
+    BOOST_TEST((blobs[0].bbox == cv::Rect(2, 8, 6, 8)));
+    BOOST_TEST(blobs[0].area == 48);
+    BOOST_TEST(blobs[0].centroid.x == 4.5);
+    BOOST_TEST(blobs[0].centroid.y == 11.5);
+}
+
+BOOST_AUTO_TEST_CASE(ApplyDownscalesAndDropsShadows)
+{
+    auto mask = make_mask(40, 40);
+    fill(mask, cv::Rect(8, 8, 16, 16));
+    fill(mask, cv::Rect(30, 30, 6, 6), 127);
+    auto extractor = BlobExtractor(make_config(0.5));
+    const auto blobs = extractor.apply(mask);
+    BOOST_TEST_REQUIRE(blobs.size() == 1U);
+    BOOST_TEST((blobs[0].bbox == cv::Rect(8, 8, 16, 16)));
+    BOOST_TEST(blobs[0].area == 256);
+    BOOST_TEST(blobs[0].centroid.x == 15.5);
+    BOOST_TEST(blobs[0].centroid.y == 15.5);
+    BOOST_TEST(extractor.apply(cv::Mat()).empty());
+}
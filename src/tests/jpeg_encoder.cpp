@@ -0,0 +1,118 @@
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+#include <opencv2/imgcodecs.hpp>
+
+#define BOOST_TEST_MODULE jpeg_encoder
+#include <boost/test/included/unit_test.hpp>
+
+#include "../ffmpeg_adapters/JpegEncoder.hpp"
+
+using vehlwn::ffmpeg::JpegEncoder;
+using vehlwn::ffmpeg::JpegEncoderPool;
+using vehlwn::ffmpeg::JpegOptions;
+
+namespace {
+// Noise compresses badly, so quality makes a visible difference in size
+cv::Mat make_image()
+{
+    auto ret = cv::Mat(120, 160, CV_8UC3);
+    cv::randu(ret, cv::Scalar::all(0), cv::Scalar::all(256));
+    // Left half is dark, right half is bright
+    auto dark = ret(cv::Rect(0, 0, 80, 120));
+    dark /= 4;
+    auto bright = ret(cv::Rect(80, 0, 80, 120));
+    bright = bright / 4 + 192;
+    return ret;
+}
+
+cv::Mat decode(const std::string& jpeg)
+{
+    const auto buf = std::vector<unsigned char>(jpeg.begin(), jpeg.end());
+    return cv::imdecode(buf, cv::IMREAD_COLOR);
+}
+} // namespace
+
+BOOST_AUTO_TEST_CASE(EncodesFullImage)
+{
+    const auto image = make_image();
+    auto encoder = JpegEncoder();
+    auto out = std::string();
+    encoder.encode(image, JpegOptions(), out);
+    const auto decoded = decode(out);
+    BOOST_TEST(decoded.cols == 160);
+    BOOST_TEST(decoded.rows == 120);
+}
+
+BOOST_AUTO_TEST_CASE(LowerQualityIsSmaller)
+{
+    const auto image = make_image();
+    auto encoder = JpegEncoder();
+    auto high = std::string();
+    encoder.encode(image, JpegOptions{.quality = 95}, high);
+    auto low = std::string();
+    encoder.encode(image, JpegOptions{.quality = 20}, low);
+    BOOST_TEST(low.size() < high.size());
+}
+
+BOOST_AUTO_TEST_CASE(CropsAndScales)
+{
+    const auto image = make_image();
+    auto encoder = JpegEncoder();
+    auto out = std::string();
+    encoder.encode(
+        image,
+        JpegOptions{.crop = cv::Rect(80, 20, 80, 60), .width = 40},
+        out);
+    const auto decoded = decode(out);
+    BOOST_TEST(decoded.cols == 40);
+    BOOST_TEST(decoded.rows == 30);
+    // Only the bright half is left
+    BOOST_TEST(cv::mean(decoded)[0] > 160);
+
+    // Never upscaled
+    encoder.encode(image, JpegOptions{.width = 1000}, out);
+    BOOST_TEST(decode(out).cols == 160);
+}
+
+BOOST_AUTO_TEST_CASE(RejectsInvalidOptions)
+{
+    const auto image = make_image();
+    auto encoder = JpegEncoder();
+    auto out = std::string();
+    BOOST_CHECK_THROW(
+        encoder.encode(image, JpegOptions{.quality = 0}, out),
+        std::invalid_argument);
+    BOOST_CHECK_THROW(
+        encoder.encode(image, JpegOptions{.quality = 101}, out),
+        std::invalid_argument);
+    BOOST_CHECK_THROW(
+        encoder.encode(image, JpegOptions{.width = 0}, out),
+        std::invalid_argument);
+    BOOST_CHECK_THROW(
+        encoder.encode(image, JpegOptions{.crop = cv::Rect(100, 0, 100, 10)}, out),
+        std::invalid_argument);
+    BOOST_CHECK_THROW(
+        encoder.encode(cv::Mat(), JpegOptions(), out),
+        std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(PoolReusesEncoders)
+{
+    auto pool = JpegEncoderPool();
+    const JpegEncoder* first = nullptr;
+    {
+        auto a = pool.acquire();
+        auto b = pool.acquire();
+        BOOST_TEST(a.get() != b.get());
+        first = a.get();
+    }
+    BOOST_TEST(pool.idle_count() == 2U);
+    auto c = pool.acquire();
+    BOOST_TEST(pool.idle_count() == 1U);
+    // Idle encoders are taken from the back, a was returned last
+    BOOST_TEST(c.get() == first);
+}
@@ -0,0 +1,111 @@
+#include <chrono>
+#include <sstream>
+#include <string>
+#define BOOST_TEST_MODULE latency_tracer
+#include <boost/test/included/unit_test.hpp>
+
+#include "../ffmpeg_adapters/LatencyTracer.hpp"
+
+using vehlwn::ffmpeg::LatencyHistogram;
+using vehlwn::ffmpeg::LatencyTracer;
+using namespace std::chrono_literals;
+
+namespace {
+int count(const std::string& s, const std::string& what)
+{
+    int ret = 0;
+    for(auto pos = s.find(what); pos != std::string::npos;
+        pos = s.find(what, pos + 1)) {
+        ret++;
+    }
+    return ret;
+}
+} // namespace
+
+BOOST_AUTO_TEST_CASE(EmptyHistogram)
+{
+    const auto summary = LatencyHistogram().summary();
+    BOOST_TEST(summary.count == 0U);
+    BOOST_TEST(summary.p99.count() == 0);
+    BOOST_TEST(summary.max.count() == 0);
+}
+
+BOOST_AUTO_TEST_CASE(PercentilesAreUpperBounds)
+{
+    // 10 us, 20 us, ..., 10 ms
+    auto histogram = LatencyHistogram();
+    for(int i = 1; i <= 1000; i++) {
+        histogram.record(std::chrono::microseconds(i * 10));
+    }
+    const auto summary = histogram.summary();
+    BOOST_TEST(summary.count == 1000U);
+    BOOST_TEST(summary.mean == 5005us);
+    BOOST_TEST(summary.max == 10ms);
+    const auto check = [](const std::chrono::nanoseconds actual,
+                          const std::chrono::nanoseconds expected) {
+        BOOST_TEST(actual >= expected);
+        BOOST_TEST(actual.count() < expected.count() * 1.19);
+    };
+    check(summary.p50, 5ms);
+    check(summary.p90, 9ms);
+    check(summary.p99, 9900us);
+}
+
+BOOST_AUTO_TEST_CASE(ClampsOutliers)
+{
+    auto histogram = LatencyHistogram();
+    histogram.record(-5ns);
+    histogram.record(500ns);
+    histogram.record(1h);
+    const auto summary = histogram.summary();
+    BOOST_TEST(summary.count == 3U);
+    BOOST_TEST(summary.p50 == 1us);
+    BOOST_TEST(summary.max == 1h);
+    BOOST_TEST(summary.p99 == 1h);
+}
+
+BOOST_AUTO_TEST_CASE(RecordsWithoutTracing)
+{
+    auto tracer = LatencyTracer(std::nullopt);
+    BOOST_TEST(!tracer.tracing_enabled());
+    const auto now = LatencyTracer::Clock::now();
+    tracer.trace("decode", "decode", now, now + 1ms, 0);
+    tracer.record_publish(now, now + 20ms, 0);
+    tracer.record_disk(now, now + 30ms);
+    tracer.record_disk(now, now + 40ms);
+    BOOST_TEST(tracer.glass_to_publish().count == 1U);
+    BOOST_TEST(tracer.glass_to_disk().count == 2U);
+    BOOST_TEST(tracer.glass_to_disk().max == 40ms);
+
+    auto os = std::ostringstream();
+    tracer.write_chrome_trace(os);
+    BOOST_TEST(count(os.str(), R"("ph":"X")") == 0);
+}
+
+BOOST_AUTO_TEST_CASE(WritesChromeTrace)
+{
+    auto tracer = LatencyTracer(10s);
+    const auto now = LatencyTracer::Clock::now();
+    // Spans older than the window are dropped
+    tracer.trace("decode", "decode", now - 60s, now - 59s, 1);
+    for(int i = 0; i < 3; i++) {
+        const auto arrival = now + i * 40ms;
+        tracer.trace("decode", "decode", arrival, arrival + 3ms, i * 40'000);
+        tracer.trace("segment", "segment", arrival + 3ms, arrival + 9ms, i * 40'000);
+        tracer.record_publish(arrival, arrival + 10ms, i * 40'000);
+        tracer.record_disk(arrival, arrival + 30ms);
+    }
+    auto os = std::ostringstream();
+    os << 1.23456789 << ' ';
+    tracer.write_chrome_trace(os);
+    const auto json = os.str();
+    // Format of the stream is restored
+    BOOST_TEST(json.starts_with("1.23457 {\"displayTimeUnit\":\"ms\""));
+    BOOST_TEST(json.ends_with("]}"));
+    BOOST_TEST(count(json, R"("ph":"X")") == 6);
+    BOOST_TEST(count(json, R"("name":"glass_to_publish","ph":"b")") == 3);
+    BOOST_TEST(count(json, R"("name":"glass_to_disk","ph":"e")") == 3);
+    BOOST_TEST(count(json, R"("name":"thread_name")") == 3);
+    BOOST_TEST(count(json, R"("pts_us":40000)") == 4);
+    BOOST_TEST(count(json, R"("pts_us":1})") == 0);
+}
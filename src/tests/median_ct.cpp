@@ -0,0 +1,75 @@
+#include <initializer_list>
+#include <stdexcept>
+#define BOOST_TEST_MODULE median_ct
+#include <boost/test/included/unit_test.hpp>
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+
+#include "filters/ConstantTimeMedianFilter.hpp"
+
+namespace {
+cv::Mat random_image(const int rows, const int cols, const int type)
+{
+    auto ret = cv::Mat(rows, cols, type);
+    cv::randu(ret, cv::Scalar::all(0), cv::Scalar::all(256));
+    return ret;
+}
+
+// Noise moves the median between histogram bins all the time, a smooth image
+// keeps it in one bin for long runs of pixels
+cv::Mat smooth_image(const int rows, const int cols)
+{
+    auto ret = random_image(rows, cols, CV_8UC1);
+    cv::GaussianBlur(ret, ret, {0, 0}, 8.);
+    return ret;
+}
+
+// The filter is applied twice to every image to check reused buffers
+void check_same_as_median_blur(const cv::Mat& src, const int kernel_size)
+{
+    auto filter = vehlwn::ConstantTimeMedianFilter(kernel_size);
+    auto expected = cv::Mat();
+    cv::medianBlur(src, expected, kernel_size);
+    for(int i = 0; i < 2; i++) {
+        auto actual = cv::Mat();
+        filter.apply(src, actual);
+        BOOST_TEST_REQUIRE(actual.rows == expected.rows);
+        BOOST_TEST_REQUIRE(actual.cols == expected.cols);
+        BOOST_TEST(cv::norm(actual, expected, cv::NORM_INF) == 0.);
+    }
+}
+} // namespace
+
+BOOST_AUTO_TEST_CASE(SameAsMedianBlur)
+{
+    for(const int kernel_size : {3, 5, 7, 9, 11, 15, 21, 31, 51}) {
+        BOOST_TEST_INFO("kernel_size " << kernel_size);
+        check_same_as_median_blur(random_image(540, 960, CV_8UC1), kernel_size);
+        check_same_as_median_blur(smooth_image(540, 960), kernel_size);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(SmallImages)
+{
+    for(const int kernel_size : {7, 31, 255}) {
+        BOOST_TEST_INFO("kernel_size " << kernel_size);
+        check_same_as_median_blur(random_image(1, 1, CV_8UC1), kernel_size);
+        check_same_as_median_blur(random_image(3, 5, CV_8UC1), kernel_size);
+        check_same_as_median_blur(random_image(33, 47, CV_8UC1), kernel_size);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(OtherTypesArePassedToMedianBlur)
+{
+    check_same_as_median_blur(random_image(33, 47, CV_8UC3), 7);
+}
+
+BOOST_AUTO_TEST_CASE(InvalidKernelSize)
+{
+    using vehlwn::ConstantTimeMedianFilter;
+    BOOST_CHECK_THROW(ConstantTimeMedianFilter(0), std::invalid_argument);
+    BOOST_CHECK_THROW(ConstantTimeMedianFilter(4), std::invalid_argument);
+    BOOST_CHECK_THROW(
+        ConstantTimeMedianFilter(ConstantTimeMedianFilter::MAX_KERNEL_SIZE + 2),
+        std::invalid_argument);
+}
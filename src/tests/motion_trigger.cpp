@@ -0,0 +1,154 @@
+#include <algorithm>
+#include <chrono>
+#include <vector>
+#define BOOST_TEST_MODULE motion_trigger
+#include <boost/test/included/unit_test.hpp>
+
+#include "../MotionTrigger.hpp"
+
+namespace {
+using vehlwn::MotionTrigger;
+using Event = MotionTrigger::Event;
+
+// 10 frames per second
+constexpr auto FRAME = std::chrono::milliseconds(100);
+
+vehlwn::ApplicationSettings::Segmentation make_config()
+{
+    auto ret = vehlwn::ApplicationSettings::Segmentation();
+    ret.min_moving_area = 100;
+    ret.delta_without_motion = 1.;
+    ret.trigger.stop_moving_area = 100;
+    ret.trigger.smoothing_factor = 1.;
+    ret.trigger.start_frames = 1;
+    ret.trigger.window_frames = 1;
+    ret.trigger.min_clip_duration = 0.;
+    return ret;
+}
+
+// Feeds areas one per frame and returns events in the same order
+std::vector<Event> run(MotionTrigger& trigger, const std::vector<int>& areas)
+{
+    // Time keeps going between calls like in a real capture
+    static auto now = MotionTrigger::Clock::time_point();
+    auto ret = std::vector<Event>();
+    for(const auto area : areas) {
+        now += FRAME;
+        ret.push_back(trigger.update(now, area));
+    }
+    return ret;
+}
+
+int count(const std::vector<Event>& events, const Event e)
+{
+    return static_cast<int>(std::count(events.begin(), events.end(), e));
+}
+} // namespace
+
+BOOST_AUTO_TEST_CASE(SingleThresholdStartsOnFirstFrame)
+{
+    auto trigger = MotionTrigger(make_config());
+    const auto events = run(trigger, {0, 50, 100});
+    BOOST_TEST((events == std::vector{Event::None, Event::None, Event::Start}));
+    BOOST_TEST(trigger.is_active());
+}
+
+BOOST_AUTO_TEST_CASE(StopsAfterDeltaWithoutMotion)
+{
+    auto trigger = MotionTrigger(make_config());
+    run(trigger, {200});
+    // Stop happens 1 s = 10 frames after the last moving frame
+    const auto events = run(trigger, std::vector(10, 0));
+    BOOST_TEST(count(events, Event::Stop) == 1);
+    BOOST_TEST((events.back() == Event::Stop));
+    BOOST_TEST(!trigger.is_active());
+}
+
+BOOST_AUTO_TEST_CASE(NOfMIgnoresSingleFrameSpikes)
+{
+    auto config = make_config();
+    config.trigger.start_frames = 3;
+    config.trigger.window_frames = 5;
+    auto trigger = MotionTrigger(config);
+    // Isolated spikes never have 3 hits in 5 frames
+    auto events = run(trigger, {500, 0, 0, 0, 500, 0, 0, 0, 500, 0, 0});
+    BOOST_TEST(count(events, Event::Start) == 0);
+    // Hits do not have to be consecutive
+    events = run(trigger, {500, 0, 500, 0, 500});
+    BOOST_TEST((events.back() == Event::Start));
+    BOOST_TEST(count(events, Event::Start) == 1);
+}
+
+BOOST_AUTO_TEST_CASE(HysteresisPreventsFlapping)
+{
+    auto config = make_config();
+    config.delta_without_motion = 0.;
+    auto areas = std::vector<int>();
+    for(int i = 0; i < 100; i++) {
+        areas.push_back(i % 2 == 0 ? 110 : 60);
+    }
+    {
+        // Area oscillating around a single threshold makes a file per crossing
+        auto trigger = MotionTrigger(config);
+        const auto events = run(trigger, areas);
+        BOOST_TEST(count(events, Event::Start) == 50);
+    }
+    {
+        // With a lower stop threshold it is one recording
+        config.trigger.stop_moving_area = 50;
+        auto trigger = MotionTrigger(config);
+        const auto events = run(trigger, areas);
+        BOOST_TEST(count(events, Event::Start) == 1);
+        BOOST_TEST(count(events, Event::Stop) == 0);
+        // Area between thresholds does not start a new recording
+        run(trigger, {0});
+        BOOST_TEST(!trigger.is_active());
+        BOOST_TEST(count(run(trigger, {60, 60, 60}), Event::Start) == 0);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(SmoothingDelaysStartAndStop)
+{
+    auto config = make_config();
+    config.trigger.smoothing_factor = 0.5;
+    auto trigger = MotionTrigger(config);
+    // Average: 0, 75, 37.5, 93.75, 121.875
+    auto events = run(trigger, {0, 150, 0, 150, 150});
+    BOOST_TEST((events.back() == Event::Start));
+    BOOST_TEST(count(events, Event::Start) == 1);
+    BOOST_TEST(trigger.smoothed_area() == 121.875);
+    // Average drops below the threshold on the next quiet frame but the
+    // recording waits for delta_without_motion
+    run(trigger, {0});
+    BOOST_TEST(trigger.smoothed_area() < 100.);
+    BOOST_TEST(trigger.is_active());
+}
+
+BOOST_AUTO_TEST_CASE(MinClipDurationExtendsShortRecordings)
+{
+    auto config = make_config();
+    config.delta_without_motion = 0.;
+    config.trigger.min_clip_duration = 2.;
+    auto trigger = MotionTrigger(config);
+    run(trigger, {200});
+    // Without motion the clip still lasts 2 s = 20 frames from the start
+    const auto events = run(trigger, std::vector(25, 0));
+    BOOST_TEST(count(events, Event::Stop) == 1);
+    BOOST_TEST((events[19] == Event::Stop));
+}
+
+BOOST_AUTO_TEST_CASE(ReconfigureKeepsRecording)
+{
+    auto trigger = MotionTrigger(make_config());
+    BOOST_TEST(count(run(trigger, {200}), Event::Start) == 1);
+    auto config = make_config();
+    config.min_moving_area = 500;
+    config.trigger.stop_moving_area = 300;
+    trigger.reconfigure(config);
+    BOOST_TEST(trigger.is_active());
+    // The new stop threshold applies to the running recording
+    const auto events = run(trigger, std::vector(15, 200));
+    BOOST_TEST(count(events, Event::Stop) == 1);
+    BOOST_TEST(count(run(trigger, {400}), Event::Start) == 0);
+    BOOST_TEST(count(run(trigger, {600}), Event::Start) == 1);
+}
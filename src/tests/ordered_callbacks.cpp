@@ -0,0 +1,75 @@
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#define BOOST_TEST_MODULE ordered_callbacks
+#include <boost/test/included/unit_test.hpp>
+
+#include "../ffmpeg_adapters/detail/OrderedCallbacks.hpp"
+
+using vehlwn::ffmpeg::detail::OrderedCallbacks;
+
+BOOST_AUTO_TEST_CASE(LaterCloseWaitsForEarlier)
+{
+    const auto callbacks = std::make_shared<OrderedCallbacks>();
+    auto calls = std::vector<int>();
+    auto first = callbacks->take();
+    auto second = callbacks->take();
+    // The second close finishes first
+    second.complete([&] { calls.push_back(2); });
+    BOOST_TEST(calls.empty());
+    first.complete([&] { calls.push_back(1); });
+    const auto expected = std::vector<int>{1, 2};
+    BOOST_TEST(calls == expected, boost::test_tools::per_element());
+}
+
+BOOST_AUTO_TEST_CASE(DestroyedTicketIsSkipped)
+{
+    const auto callbacks = std::make_shared<OrderedCallbacks>();
+    auto calls = std::vector<int>();
+    auto failed = std::optional(callbacks->take());
+    auto second = callbacks->take();
+    auto third = callbacks->take();
+    third.complete([&] { calls.push_back(3); });
+    second.complete([&] { calls.push_back(2); });
+    BOOST_TEST(calls.empty());
+    // Close failed without a callback
+    failed.reset();
+    const auto expected = std::vector<int>{2, 3};
+    BOOST_TEST(calls == expected, boost::test_tools::per_element());
+}
+
+BOOST_AUTO_TEST_CASE(ClosesFinishedOnOtherThreads)
+{
+    constexpr int count = 8;
+    const auto callbacks = std::make_shared<OrderedCallbacks>();
+    auto mutex = std::mutex();
+    auto calls = std::vector<int>();
+    auto tickets = std::vector<OrderedCallbacks::Ticket>();
+    for(int i = 0; i < count; i++) {
+        tickets.push_back(callbacks->take());
+    }
+    // Completed from the last one
+    auto tasks = std::vector<std::future<void>>();
+    for(int i = count - 1; i >= 0; i--) {
+        tasks.push_back(std::async(
+            std::launch::async,
+            [&, i, ticket = std::move(tickets[i])]() mutable {
+                ticket.complete([&, i] {
+                    const auto lock = std::lock_guard(mutex);
+                    calls.push_back(i);
+                });
+            }));
+    }
+    for(auto& task : tasks) {
+        task.get();
+    }
+    auto expected = std::vector<int>();
+    for(int i = 0; i < count; i++) {
+        expected.push_back(i);
+    }
+    BOOST_TEST(calls == expected, boost::test_tools::per_element());
+}
@@ -0,0 +1,236 @@
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#define BOOST_TEST_MODULE pipeline
+#include <boost/test/included/unit_test.hpp>
+
+#include "../BoundedQueue.hpp"
+#include "../Pipeline.hpp"
+
+namespace {
+struct Item {
+    int index = -1;
+    std::vector<std::string> visited;
+};
+
+// Collects items of the last stage until the expected number is reached
+class Sink {
+public:
+    explicit Sink(const std::size_t expected)
+        : m_expected{expected}
+    {}
+
+    void push(Item& item)
+    {
+        {
+            const auto lock = std::lock_guard(m_mutex);
+            m_items.push_back(std::move(item));
+        }
+        m_cv.notify_all();
+    }
+
+    std::vector<Item> wait()
+    {
+        auto lock = std::unique_lock(m_mutex);
+        m_cv.wait(lock, [&] { return m_items.size() >= m_expected; });
+        return m_items;
+    }
+
+private:
+    const std::size_t m_expected;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::vector<Item> m_items;
+};
+} // namespace
+
+BOOST_AUTO_TEST_CASE(QueueIsFifo)
+{
+    auto queue = vehlwn::BoundedQueue<int>(3);
+    BOOST_TEST(queue.capacity() == 3);
+    BOOST_TEST(queue.push(1));
+    BOOST_TEST(queue.push(2));
+    BOOST_TEST(queue.size() == 2);
+    BOOST_TEST(*queue.pop() == 1);
+    BOOST_TEST(*queue.pop() == 2);
+    BOOST_TEST(queue.size() == 0);
+    BOOST_CHECK_THROW(vehlwn::BoundedQueue<int>(0), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(QueueBlocksWhenFull)
+{
+    auto queue = vehlwn::BoundedQueue<int>(1);
+    BOOST_TEST(queue.push(1));
+    // Boost.Test is not thread safe, results are checked on the main thread
+    auto pushed = std::atomic_bool(false);
+    auto producer = std::thread([&] { pushed = queue.push(2); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    BOOST_TEST(!pushed);
+    BOOST_TEST(*queue.pop() == 1);
+    producer.join();
+    BOOST_TEST(pushed);
+    BOOST_TEST(*queue.pop() == 2);
+}
+
+BOOST_AUTO_TEST_CASE(TryPushDropsWhenFull)
+{
+    auto queue = vehlwn::BoundedQueue<int>(1);
+    BOOST_TEST(queue.try_push(1));
+    BOOST_TEST(!queue.try_push(2));
+    BOOST_TEST(*queue.pop() == 1);
+    BOOST_TEST(queue.try_push(3));
+    queue.close();
+    BOOST_TEST(!queue.try_push(4));
+}
+
+BOOST_AUTO_TEST_CASE(CloseWakesWaiters)
+{
+    auto queue = vehlwn::BoundedQueue<int>(1);
+    auto popped = std::atomic_bool(true);
+    auto consumer = std::thread([&] { popped = queue.pop().has_value(); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    queue.close();
+    consumer.join();
+    BOOST_TEST(!popped);
+    BOOST_TEST(!queue.push(1));
+}
+
+BOOST_AUTO_TEST_CASE(PreservesOrder)
+{
+    constexpr std::size_t count = 200;
+    auto sink = Sink(count);
+    auto next_index = 0;
+    auto errors = std::atomic<int>(0);
+    auto pipeline = vehlwn::Pipeline<Item>(
+        2,
+        [&](const std::exception& /*ex*/) { errors++; });
+    pipeline.add_stage("source", [&](Item& item) {
+        item.index = next_index++;
+        item.visited.emplace_back("source");
+    });
+    for(const auto* name : {"a", "b", "c"}) {
+        pipeline.add_stage(name, [name](Item& item) {
+            // Uneven delays shuffle items if stages run out of order
+            if(item.index % 7 == 0) {
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+            }
+            item.visited.emplace_back(name);
+        });
+    }
+    pipeline.add_stage("sink", [&](Item& item) { sink.push(item); });
+    pipeline.start();
+    const auto items = sink.wait();
+    pipeline.stop();
+    BOOST_TEST(errors == 0);
+
+    for(std::size_t i = 0; i < count; i++) {
+        BOOST_TEST(items[i].index == static_cast<int>(i));
+        const auto expected = std::vector<std::string>{"source", "a", "b", "c"};
+        BOOST_TEST(items[i].visited == expected, boost::test_tools::per_element());
+    }
+    const auto stats = pipeline.stats();
+    BOOST_TEST(stats.size() == 5);
+    BOOST_TEST(stats.front().name == "source");
+    BOOST_TEST(stats.front().queue_capacity == 0);
+    BOOST_TEST(stats.back().queue_capacity == 2);
+    for(const auto& s : stats) {
+        BOOST_TEST(s.items >= count);
+        BOOST_TEST(s.queued <= s.queue_capacity);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(StagesOverlap)
+{
+    // The second stage waits inside the first item and the first stage inside
+    // the second item until the other stage is inside an item too, which never
+    // happens if stages run one after another
+    auto mutex = std::mutex();
+    auto cv = std::condition_variable();
+    auto active = std::vector<bool>(2, false);
+    auto first_items = 0;
+    auto overlapped = false;
+    auto errors = std::atomic<int>(0);
+    auto pipeline = vehlwn::Pipeline<Item>(
+        1,
+        [&](const std::exception& /*ex*/) { errors++; });
+    for(const std::size_t k : {0, 1}) {
+        pipeline.add_stage(std::to_string(k), [&, k](Item& /*item*/) {
+            auto lock = std::unique_lock(mutex);
+            active[k] = true;
+            if(active[1 - k]) {
+                overlapped = true;
+            }
+            cv.notify_all();
+            if(k == 1 || first_items++ > 0) {
+                cv.wait(lock, [&] { return overlapped; });
+            }
+            active[k] = false;
+        });
+    }
+    pipeline.start();
+    {
+        auto lock = std::unique_lock(mutex);
+        cv.wait(lock, [&] { return overlapped; });
+    }
+    pipeline.stop();
+    BOOST_TEST(overlapped);
+    BOOST_TEST(errors == 0);
+}
+
+BOOST_AUTO_TEST_CASE(ReportsErrors)
+{
+    auto error = std::string();
+    auto failed = std::atomic_bool(false);
+    auto pipeline = vehlwn::Pipeline<Item>(1, [&](const std::exception& ex) {
+        error = ex.what();
+        failed = true;
+        failed.notify_all();
+    });
+    pipeline.add_stage("source", [](Item& /*item*/) {});
+    pipeline.add_stage("fail", [](Item& /*item*/) {
+        throw std::runtime_error("test");
+    });
+    pipeline.start();
+    failed.wait(false);
+    pipeline.stop();
+    BOOST_TEST(error == "test");
+}
+
+BOOST_AUTO_TEST_CASE(ObservesStages)
+{
+    constexpr std::size_t count = 10;
+    auto sink = Sink(count);
+    auto next_index = 0;
+    auto observed = std::atomic<int>(0);
+    auto bad_spans = std::atomic<int>(0);
+    auto pipeline = vehlwn::Pipeline<Item>(2, [](const std::exception& /*ex*/) {});
+    pipeline.add_stage("source", [&](Item& item) { item.index = next_index++; });
+    pipeline.add_stage("sink", [&](Item& item) { sink.push(item); });
+    using TimePoint = vehlwn::Pipeline<Item>::Clock::time_point;
+    pipeline.set_stage_observer([&](const std::string_view stage_name,
+                                    const Item& item,
+                                    const TimePoint begin,
+                                    const TimePoint end) {
+        // The source stage has filled the item already
+        if(item.index < 0 || end < begin
+           || (stage_name != "source" && stage_name != "sink")) {
+            bad_spans++;
+        }
+        observed++;
+    });
+    pipeline.start();
+    sink.wait();
+    pipeline.stop();
+    BOOST_TEST(observed >= static_cast<int>(2 * count));
+    BOOST_TEST(bad_spans == 0);
+    BOOST_CHECK_THROW(
+        pipeline.set_stage_observer(vehlwn::Pipeline<Item>::StageObserver()),
+        std::logic_error);
+}
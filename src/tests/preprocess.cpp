@@ -0,0 +1,123 @@
+#include <initializer_list>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+#define BOOST_TEST_MODULE preprocess
+#include <boost/test/included/unit_test.hpp>
+#include <opencv2/core.hpp>
+
+#include "filters/ConvertToGrayFilter.hpp"
+#include "filters/FusedPreprocessFilter.hpp"
+#include "filters/GaussianBlurFilter.hpp"
+#include "filters/ImageFilterChain.hpp"
+#include "filters/NormalizedBoxFilter.hpp"
+#include "filters/ResizeFilter.hpp"
+#include "ThreadPool.hpp"
+
+namespace {
+using vehlwn::FusedPreprocessFilter;
+
+struct Config {
+    bool convert_to_gray;
+    std::optional<double> resize_factor;
+    FusedPreprocessFilter::Smoothing smoothing;
+};
+
+std::shared_ptr<vehlwn::IImageFilter> make_chain(const Config& config)
+{
+    auto ret = std::make_shared<vehlwn::ImageFilterChain>();
+    if(config.convert_to_gray) {
+        ret->add_filter(std::make_shared<vehlwn::ConvertToGrayFilter>());
+    }
+    if(config.resize_factor) {
+        ret->add_filter(
+            std::make_shared<vehlwn::ResizeFilter>(*config.resize_factor));
+    }
+    if(const auto* const box
+       = std::get_if<FusedPreprocessFilter::NormalizedBox>(&config.smoothing)) {
+        ret->add_filter(
+            std::make_shared<vehlwn::NormalizedBoxFilter>(box->kernel_size));
+    } else if(const auto* const gaus
+              = std::get_if<FusedPreprocessFilter::Gaussian>(&config.smoothing)) {
+        ret->add_filter(std::make_shared<vehlwn::GaussianBlurFilter>(
+            gaus->kernel_size,
+            gaus->sigma));
+    }
+    return ret;
+}
+
+cv::Mat random_frame(const int rows, const int cols)
+{
+    auto ret = cv::Mat(rows, cols, CV_8UC3);
+    cv::randu(ret, cv::Scalar::all(0), cv::Scalar::all(256));
+    return ret;
+}
+
+// Runs both chains on the same frame several times to check reused buffers
+void check_equal(
+    const Config& config,
+    const bool expect_fused,
+    std::shared_ptr<vehlwn::ThreadPool> thread_pool = nullptr)
+{
+    auto chain = make_chain(config);
+    auto fused = FusedPreprocessFilter(
+        config.convert_to_gray,
+        config.resize_factor,
+        config.smoothing,
+        std::move(thread_pool));
+    BOOST_TEST(fused.is_fused() == expect_fused);
+    const auto sizes = {cv::Size(1280, 720), cv::Size(641, 479), cv::Size(47, 33)};
+    for(const auto& size : sizes) {
+        for(int i = 0; i < 2; i++) {
+            const auto frame = random_frame(size.height, size.width);
+            const auto expected
+                = chain->apply(vehlwn::CvMatRaiiAdapter(frame.clone()));
+            const auto actual = fused.apply(vehlwn::CvMatRaiiAdapter(frame.clone()));
+            BOOST_TEST_REQUIRE(actual.get().rows == expected.get().rows);
+            BOOST_TEST_REQUIRE(actual.get().cols == expected.get().cols);
+            BOOST_TEST_REQUIRE(actual.get().type() == expected.get().type());
+            BOOST_TEST(cv::norm(actual.get(), expected.get(), cv::NORM_INF) == 0.);
+        }
+    }
+}
+} // namespace
+
+BOOST_AUTO_TEST_CASE(DefaultConfig)
+{
+    check_equal({true, 0.5, FusedPreprocessFilter::NormalizedBox{11}}, true);
+}
+
+BOOST_AUTO_TEST_CASE(Gaussian)
+{
+    check_equal({true, 0.5, FusedPreprocessFilter::Gaussian{11, 0.}}, true);
+    check_equal({true, 0.25, FusedPreprocessFilter::Gaussian{5, 1.5}}, true);
+}
+
+BOOST_AUTO_TEST_CASE(PartialChains)
+{
+    check_equal({true, std::nullopt, FusedPreprocessFilter::NormalizedBox{4}}, true);
+    check_equal({true, 0.5, std::monostate()}, true);
+    check_equal({false, 0.5, FusedPreprocessFilter::NormalizedBox{5}}, true);
+    check_equal({true, std::nullopt, std::monostate()}, true);
+}
+
+BOOST_AUTO_TEST_CASE(NonIntegerDownscale)
+{
+    check_equal({true, 0.4, FusedPreprocessFilter::NormalizedBox{11}}, false);
+    check_equal({true, 1.5, FusedPreprocessFilter::NormalizedBox{3}}, false);
+}
+
+BOOST_AUTO_TEST_CASE(RowBands)
+{
+    // Frames are split into 5 bands even on a single core machine
+    const auto pool = std::make_shared<vehlwn::ThreadPool>(5);
+    check_equal({true, 0.5, FusedPreprocessFilter::NormalizedBox{11}}, true, pool);
+    check_equal({true, 0.25, FusedPreprocessFilter::Gaussian{5, 1.5}}, true, pool);
+    check_equal({true, std::nullopt, std::monostate()}, true, pool);
+    check_equal(
+        {false, std::nullopt, FusedPreprocessFilter::Gaussian{7, 0.}},
+        true,
+        pool);
+    check_equal({true, 0.4, FusedPreprocessFilter::NormalizedBox{11}}, false, pool);
+}
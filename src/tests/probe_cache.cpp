@@ -0,0 +1,127 @@
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#define BOOST_TEST_MODULE probe_cache
+#include <boost/test/included/unit_test.hpp>
+
+#include "../ffmpeg_adapters/ProbeCache.hpp"
+
+using vehlwn::ffmpeg::ProbeCache;
+using vehlwn::ffmpeg::ProbedStream;
+
+namespace {
+// Removed with its content at the end of a test
+struct TempDir {
+    std::filesystem::path path = std::filesystem::temp_directory_path()
+        / ("probe_cache_" + std::to_string(::getpid()));
+    TempDir() = default;
+    TempDir(const TempDir&) = delete;
+    TempDir(TempDir&&) = delete;
+    ~TempDir()
+    {
+        std::filesystem::remove_all(path);
+    }
+    TempDir& operator=(const TempDir&) = delete;
+    TempDir& operator=(TempDir&&) = delete;
+};
+
+std::vector<ProbedStream> make_streams()
+{
+    auto video = ProbedStream();
+    video.codec_type = 0;
+    video.codec_id = 27;
+    video.time_base = {1, 90000};
+    video.r_frame_rate = {30, 1};
+    video.avg_frame_rate = {30000, 1001};
+    video.width = 1280;
+    video.height = 720;
+    video.format = 0;
+    auto audio = ProbedStream();
+    audio.codec_type = 1;
+    audio.codec_id = 86018;
+    audio.time_base = {1, 48000};
+    audio.format = 8;
+    audio.sample_rate = 48000;
+    audio.channels = 2;
+    return {video, audio};
+}
+} // namespace
+
+BOOST_AUTO_TEST_CASE(MakeKey)
+{
+    BOOST_TEST(
+        ProbeCache::make_key("/dev/video0", std::nullopt, {}) == "-i /dev/video0");
+    const auto options = std::map<std::string, std::string>{
+        {"video_size", "1280x720"},
+        {"framerate", "30"}};
+    BOOST_TEST(
+        ProbeCache::make_key("/dev/video0", "v4l2", options)
+        == "-f v4l2 -framerate 30 -video_size 1280x720 -i /dev/video0");
+}
+
+BOOST_AUTO_TEST_CASE(RoundTrip)
+{
+    const auto dir = TempDir();
+    const auto cache = ProbeCache(dir.path / "probe");
+    const auto key = ProbeCache::make_key("rtsp://camera/", "rtsp", {});
+    BOOST_TEST(!cache.load(key).has_value());
+
+    const auto streams = make_streams();
+    cache.save(key, streams);
+    const auto loaded = cache.load(key);
+    BOOST_TEST_REQUIRE(loaded.has_value());
+    BOOST_TEST((*loaded == streams));
+    BOOST_TEST(!cache.load("-i rtsp://other/").has_value());
+
+    cache.remove(key);
+    BOOST_TEST(!cache.load(key).has_value());
+    BOOST_TEST(std::filesystem::is_empty(dir.path / "probe"));
+}
+
+BOOST_AUTO_TEST_CASE(RejectsMismatchedOrCorruptEntry)
+{
+    const auto dir = TempDir();
+    const auto cache = ProbeCache(dir.path);
+    const auto key = ProbeCache::make_key("/dev/video0", "v4l2", {});
+    cache.save(key, make_streams());
+
+    // Another key with the same file name
+    auto text = std::string();
+    {
+        auto file = std::ifstream(cache.path_of(key));
+        text.assign(
+            std::istreambuf_iterator<char>(file),
+            std::istreambuf_iterator<char>());
+    }
+    const auto key_pos = text.find("key ");
+    std::ofstream(cache.path_of(key))
+        << text.substr(0, key_pos) << "key -i /dev/video1\n"
+        << text.substr(text.find('\n', key_pos) + 1);
+    BOOST_TEST(!cache.load(key).has_value());
+
+    std::ofstream(cache.path_of(key)) << text.substr(0, text.rfind("channels"));
+    BOOST_TEST(!cache.load(key).has_value());
+
+    std::ofstream(cache.path_of(key)) << text;
+    BOOST_TEST(cache.load(key).has_value());
+}
+
+BOOST_AUTO_TEST_CASE(Complete)
+{
+    auto streams = make_streams();
+    BOOST_TEST(streams[0].complete());
+    BOOST_TEST(streams[1].complete());
+    streams[0].format = -1;
+    streams[1].sample_rate = 0;
+    BOOST_TEST(!streams[0].complete());
+    BOOST_TEST(!streams[1].complete());
+    auto data = ProbedStream();
+    data.codec_type = 2;
+    BOOST_TEST(data.complete());
+}
@@ -0,0 +1,125 @@
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+
+#include <unistd.h>
+
+#include <opencv2/core.hpp>
+#include <opencv2/imgcodecs.hpp>
+
+#define BOOST_TEST_MODULE recording_images
+#include <boost/test/included/unit_test.hpp>
+
+#include "../ffmpeg_adapters/RecordingImages.hpp"
+
+using vehlwn::ffmpeg::JpegEncoderPool;
+using vehlwn::ffmpeg::MotionSample;
+using vehlwn::ffmpeg::RecordingImages;
+using vehlwn::ffmpeg::RecordingInfo;
+
+namespace {
+// Removed with its content at the end of a test
+struct TempDir {
+    std::filesystem::path path = std::filesystem::temp_directory_path()
+        / ("recording_images_" + std::to_string(::getpid()));
+    TempDir()
+    {
+        std::filesystem::create_directories(path);
+    }
+    TempDir(const TempDir&) = delete;
+    TempDir(TempDir&&) = delete;
+    ~TempDir()
+    {
+        std::filesystem::remove_all(path);
+    }
+    TempDir& operator=(const TempDir&) = delete;
+    TempDir& operator=(TempDir&&) = delete;
+};
+
+vehlwn::ApplicationSettings::OutputFiles::Thumbnails make_settings()
+{
+    return {
+        .width = 32,
+        .sprite_tile_width = 16,
+        .sprite_columns = 3,
+        .sprite_max_tiles = 4,
+        .sprite_interval = 1.0,
+        .jpeg_quality = 90,
+    };
+}
+
+RecordingImages make_images()
+{
+    return {make_settings(), std::make_shared<JpegEncoderPool>()};
+}
+
+// Solid frame with the given gray value
+cv::Mat make_frame(const int value)
+{
+    return {48, 64, CV_8UC3, cv::Scalar::all(value)};
+}
+
+MotionSample make_sample(const std::int64_t seconds, const int moving_area)
+{
+    return {.pts_us = seconds * 1'000'000, .moving_area = moving_area};
+}
+} // namespace
+
+BOOST_AUTO_TEST_CASE(ThumbnailIsThePeakFrame)
+{
+    const auto dir = TempDir();
+    auto images = make_images();
+    images.add(make_sample(0, 10), make_frame(0));
+    images.add(make_sample(1, 500), make_frame(200));
+    images.add(make_sample(2, 20), make_frame(50));
+
+    const auto path = (dir.path / "clip.mp4").string();
+    auto info = RecordingInfo();
+    images.write(path, info);
+    BOOST_TEST(info.has_thumbnail);
+    const auto thumbnail
+        = cv::imread(path + vehlwn::ffmpeg::THUMBNAIL_EXTENSION, cv::IMREAD_COLOR);
+    BOOST_TEST(thumbnail.cols == 32);
+    BOOST_TEST(thumbnail.rows == 24);
+    BOOST_TEST(std::abs(cv::mean(thumbnail)[0] - 200) < 5);
+}
+
+BOOST_AUTO_TEST_CASE(SpriteKeepsAtMostMaxTiles)
+{
+    const auto dir = TempDir();
+    auto images = make_images();
+    for(int i = 0; i <= 10; i++) {
+        images.add(make_sample(i, i), make_frame(i * 20));
+    }
+    // 11 seconds of one second tiles halved twice
+    BOOST_TEST(images.tile_count() <= 4U);
+    BOOST_TEST(images.interval_us() == 4'000'000);
+
+    const auto path = (dir.path / "clip.mp4").string();
+    auto info = RecordingInfo();
+    images.write(path, info);
+    BOOST_REQUIRE(info.sprite.has_value());
+    BOOST_TEST(info.sprite->tile_width == 16);
+    BOOST_TEST(info.sprite->tile_height == 12);
+    BOOST_TEST(info.sprite->columns == 3);
+    BOOST_TEST(info.sprite->count == static_cast<int>(images.tile_count()));
+    BOOST_TEST(info.sprite->interval.count() == 4000);
+    const auto sheet
+        = cv::imread(path + vehlwn::ffmpeg::SPRITE_EXTENSION, cv::IMREAD_COLOR);
+    BOOST_TEST(sheet.cols == 3 * 16);
+    BOOST_TEST(sheet.rows == 12);
+}
+
+BOOST_AUTO_TEST_CASE(NothingWrittenWithoutFrames)
+{
+    const auto dir = TempDir();
+    auto images = make_images();
+    const auto path = (dir.path / "clip.mp4").string();
+    auto info = RecordingInfo();
+    images.write(path, info);
+    BOOST_TEST(!info.has_thumbnail);
+    BOOST_TEST(!info.sprite.has_value());
+    BOOST_TEST(!std::filesystem::exists(path + vehlwn::ffmpeg::THUMBNAIL_EXTENSION));
+}
@@ -0,0 +1,200 @@
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#define BOOST_TEST_MODULE recording_index
+#include <boost/test/included/unit_test.hpp>
+
+#include "../RecordingIndex.hpp"
+
+using vehlwn::RecordingIndex;
+using vehlwn::ffmpeg::RecordingInfo;
+using vehlwn::ffmpeg::SpriteSheet;
+
+namespace {
+constexpr std::size_t RECORD_SIZE = 256;
+
+// Removed with its content at the end of a test
+struct TempDir {
+    std::filesystem::path path = std::filesystem::temp_directory_path()
+        / ("recording_index_" + std::to_string(::getpid()));
+    TempDir() = default;
+    TempDir(const TempDir&) = delete;
+    TempDir(TempDir&&) = delete;
+    ~TempDir()
+    {
+        std::filesystem::remove_all(path);
+    }
+    TempDir& operator=(const TempDir&) = delete;
+    TempDir& operator=(TempDir&&) = delete;
+};
+
+std::chrono::system_clock::time_point from_seconds(const std::int64_t seconds)
+{
+    return std::chrono::system_clock::time_point(std::chrono::seconds(seconds));
+}
+
+// Recording i lasts from 100 * i to 100 * i + 60 seconds
+RecordingInfo make_info(const std::filesystem::path& prefix, const int i)
+{
+    auto ret = RecordingInfo();
+    ret.path = (prefix / "2024-01-01" / ("clip" + std::to_string(i) + ".mkv"))
+                   .string();
+    ret.start_time = from_seconds(100 * i);
+    ret.end_time = from_seconds(100 * i + 60);
+    ret.size = 1000U * static_cast<std::uintmax_t>(i + 1);
+    ret.peak_moving_area = 10 * i;
+    ret.peak_offset = std::chrono::microseconds(1'500'000);
+    return ret;
+}
+
+std::vector<char> read_file(const std::filesystem::path& path)
+{
+    auto file = std::ifstream(path, std::ios::binary);
+    return {std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+}
+
+template<class T>
+T read_at(const std::vector<char>& bytes, const std::size_t offset)
+{
+    auto ret = T();
+    std::memcpy(&ret, bytes.data() + offset, sizeof(ret));
+    return ret;
+}
+} // namespace
+
+BOOST_AUTO_TEST_CASE(RecordLayout)
+{
+    const auto dir = TempDir();
+    auto info = make_info(dir.path, 1);
+    info.has_thumbnail = true;
+    info.sprite = SpriteSheet{
+        .tile_width = 160,
+        .tile_height = 90,
+        .columns = 10,
+        .count = 25,
+        .interval = std::chrono::milliseconds(2000),
+    };
+    {
+        auto index = RecordingIndex(dir.path);
+        index.append(info);
+        index.append(make_info(dir.path, 2));
+    }
+    const auto bytes = read_file(dir.path / "recordings.idx");
+    BOOST_TEST_REQUIRE(bytes.size() == 2 * RECORD_SIZE);
+    BOOST_TEST(read_at<std::int64_t>(bytes, 0) == 100'000'000);
+    BOOST_TEST(read_at<std::int64_t>(bytes, 8) == 160'000'000);
+    BOOST_TEST(read_at<std::uint64_t>(bytes, 16) == 2000U);
+    BOOST_TEST(read_at<std::int64_t>(bytes, 24) == 1'500'000);
+    BOOST_TEST(read_at<std::int32_t>(bytes, 32) == 10);
+    // HAS_THUMBNAIL | HAS_SPRITE
+    BOOST_TEST(read_at<std::uint32_t>(bytes, 36) == 3U);
+    BOOST_TEST(read_at<std::uint16_t>(bytes, 40) == 160U);
+    BOOST_TEST(read_at<std::uint16_t>(bytes, 42) == 90U);
+    BOOST_TEST(read_at<std::uint16_t>(bytes, 44) == 10U);
+    BOOST_TEST(read_at<std::uint16_t>(bytes, 46) == 25U);
+    BOOST_TEST(read_at<std::uint32_t>(bytes, 48) == 2000U);
+    // Path is relative to the prefix and zero padded
+    BOOST_TEST(std::string(bytes.data() + 56) == "2024-01-01/clip1.mkv");
+    BOOST_TEST(read_at<std::uint32_t>(bytes, RECORD_SIZE + 36) == 0U);
+
+    const auto index = RecordingIndex(dir.path);
+    const auto entry = index.get(0);
+    BOOST_TEST_REQUIRE(entry.has_value());
+    BOOST_TEST((entry->start_time == info.start_time));
+    BOOST_TEST((entry->end_time == info.end_time));
+    BOOST_TEST(entry->size == 2000U);
+    BOOST_TEST(entry->peak_moving_area == 10);
+    BOOST_TEST(entry->thumbnail_offset.count() == 1'500'000);
+    BOOST_TEST(entry->has_thumbnail);
+    BOOST_TEST_REQUIRE(entry->sprite.has_value());
+    BOOST_TEST(entry->sprite->tile_height == 90);
+    BOOST_TEST(entry->sprite->count == 25);
+    BOOST_TEST(entry->sprite->interval.count() == 2000);
+    BOOST_TEST((index.absolute_path(*entry) == info.path));
+    BOOST_TEST(!index.get(1)->sprite.has_value());
+    BOOST_TEST(index.total_bytes() == 5000U);
+}
+
+BOOST_AUTO_TEST_CASE(TornRecordIsTruncated)
+{
+    const auto dir = TempDir();
+    {
+        auto index = RecordingIndex(dir.path);
+        index.append(make_info(dir.path, 0));
+        index.append(make_info(dir.path, 1));
+    }
+    {
+        // Crash in the middle of the next append
+        auto file = std::ofstream(
+            dir.path / "recordings.idx",
+            std::ios::binary | std::ios::app);
+        const auto partial = std::string(100, 'x');
+        file.write(partial.data(), static_cast<std::streamsize>(partial.size()));
+    }
+    {
+        auto index = RecordingIndex(dir.path);
+        BOOST_TEST(
+            std::filesystem::file_size(dir.path / "recordings.idx")
+            == 2 * RECORD_SIZE);
+        BOOST_TEST(index.find(from_seconds(0), from_seconds(1000), 10).size() == 2U);
+        index.append(make_info(dir.path, 2));
+    }
+    const auto index = RecordingIndex(dir.path);
+    const auto entries = index.find(from_seconds(0), from_seconds(1000), 10);
+    BOOST_TEST_REQUIRE(entries.size() == 3U);
+    BOOST_TEST(entries[2].id == 2U);
+    BOOST_TEST(entries[2].path == "2024-01-01/clip2.mkv");
+}
+
+BOOST_AUTO_TEST_CASE(EvictionIsPersisted)
+{
+    const auto dir = TempDir();
+    {
+        auto index = RecordingIndex(dir.path);
+        for(int i = 0; i < 4; i++) {
+            index.append(make_info(dir.path, i));
+        }
+        index.remove_oldest(0);
+        // Not the oldest one
+        index.remove_oldest(2);
+        index.remove_oldest(1);
+        BOOST_TEST(index.oldest()->id == 2U);
+        BOOST_TEST(index.total_bytes() == 7000U);
+    }
+    auto index = RecordingIndex(dir.path);
+    BOOST_TEST_REQUIRE(index.oldest().has_value());
+    BOOST_TEST(index.oldest()->id == 2U);
+    BOOST_TEST(!index.get(1).has_value());
+    BOOST_TEST(index.get(3)->path == "2024-01-01/clip3.mkv");
+    BOOST_TEST(index.total_bytes() == 7000U);
+    // Ids keep counting records of the file, evicted ones included
+    index.append(make_info(dir.path, 4));
+    BOOST_TEST(index.get(4)->path == "2024-01-01/clip4.mkv");
+    const auto entries = index.find(from_seconds(0), from_seconds(250), 10);
+    BOOST_TEST_REQUIRE(entries.size() == 1U);
+    BOOST_TEST(entries[0].id == 2U);
+}
+
+BOOST_AUTO_TEST_CASE(FindReturnsOverlappingRecordings)
+{
+    const auto dir = TempDir();
+    auto index = RecordingIndex(dir.path);
+    for(int i = 0; i < 5; i++) {
+        index.append(make_info(dir.path, i));
+    }
+    // After the end of recording 1 and during recording 3
+    const auto entries = index.find(from_seconds(165), from_seconds(330), 10);
+    BOOST_TEST_REQUIRE(entries.size() == 2U);
+    BOOST_TEST(entries[0].id == 2U);
+    BOOST_TEST(entries[1].id == 3U);
+    BOOST_TEST(index.find(from_seconds(0), from_seconds(1000), 3).size() == 3U);
+    BOOST_TEST(index.find(from_seconds(61), from_seconds(99), 10).empty());
+}
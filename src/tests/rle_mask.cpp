@@ -0,0 +1,180 @@
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#define BOOST_TEST_MODULE rle_mask
+#include <boost/test/included/unit_test.hpp>
+
+#include "../RleMask.hpp"
+
+using vehlwn::RleMask;
+
+namespace {
+cv::Mat make_mask(const int rows, const int cols)
+{
+    return {rows, cols, CV_8UC1, cv::Scalar(0)};
+}
+
+void fill(cv::Mat& mask, const cv::Rect& rect, const int value = 255)
+{
+    mask(rect).setTo(cv::Scalar(value));
+}
+
+// Width is not a multiple of the 8 pixels skipped at once
+void fill_pattern(cv::Mat& mask, const int value)
+{
+    // Runs at both edges of a row
+    fill(mask, cv::Rect(0, 0, 3, 1), value);
+    fill(mask, cv::Rect(17, 0, 4, 1), value);
+    // Full row
+    fill(mask, cv::Rect(0, 2, 21, 1), value);
+    // Single pixels after long background
+    fill(mask, cv::Rect(9, 3, 1, 1), value);
+    fill(mask, cv::Rect(20, 4, 1, 1), value);
+    fill(mask, cv::Rect(5, 5, 10, 2), value);
+}
+} // namespace
+
+BOOST_AUTO_TEST_CASE(RoundTrip)
+{
+    auto input = make_mask(7, 21);
+    // Any nonzero value is foreground
+    fill_pattern(input, 1);
+    auto expected = make_mask(7, 21);
+    fill_pattern(expected, 255);
+
+    const auto rle = RleMask(input);
+    BOOST_TEST(rle.width() == 21);
+    BOOST_TEST(rle.height() == 7);
+    BOOST_TEST(rle.area() == cv::countNonZero(expected));
+    BOOST_TEST(rle.run_count() == 7U);
+    auto buffer = std::vector<RleMask::Run>();
+    BOOST_TEST(rle.row(0, buffer).size() == 2U);
+    BOOST_TEST(rle.row(1, buffer).empty());
+    BOOST_TEST(rle.row(2, buffer).size() == 1U);
+    BOOST_TEST(rle.row(4, buffer)[0].begin == 20);
+    BOOST_TEST(rle.row(4, buffer)[0].end == 21);
+    BOOST_TEST(cv::norm(rle.to_mat(), expected, cv::NORM_INF) == 0.);
+}
+
+BOOST_AUTO_TEST_CASE(AssignReplacesContent)
+{
+    auto first = make_mask(7, 21);
+    fill_pattern(first, 255);
+    auto rle = RleMask(first);
+    auto second = make_mask(3, 5);
+    fill(second, cv::Rect(1, 1, 2, 1));
+    rle.assign(second);
+    BOOST_TEST(rle.width() == 5);
+    BOOST_TEST(rle.height() == 3);
+    BOOST_TEST(rle.area() == 2);
+    BOOST_TEST(cv::norm(rle.to_mat(), second, cv::NORM_INF) == 0.);
+
+    BOOST_TEST(RleMask().empty());
+    BOOST_CHECK_THROW(rle.assign(cv::Mat(3, 5, CV_8UC3)), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(SerializeFormat)
+{
+    auto mask = make_mask(3, 10);
+    fill(mask, cv::Rect(2, 0, 3, 1));
+    fill(mask, cv::Rect(0, 2, 1, 1));
+    fill(mask, cv::Rect(7, 2, 3, 1));
+    const auto expected = std::vector<std::uint8_t>{
+        // Width and height
+        10, 0, 0, 0, 3, 0, 0, 0,
+        // Row 0: one run [2, 5)
+        1, 0, 2, 0, 5, 0,
+        // Row 1: no runs
+        0, 0,
+        // Row 2: runs [0, 1) and [7, 10)
+        2, 0, 0, 0, 1, 0, 7, 0, 10, 0};
+    BOOST_TEST(RleMask(mask).serialize() == expected);
+}
+
+BOOST_AUTO_TEST_CASE(CoverageGridEdges)
+{
+    // Column and row edges of a 3x3 grid are 0, 3, 6 and 10
+    auto mask = make_mask(10, 10);
+    fill(mask, cv::Rect(0, 0, 3, 3));
+    fill(mask, cv::Rect(5, 0, 1, 1));
+    // Crosses both column edges
+    fill(mask, cv::Rect(2, 4, 6, 1));
+    fill(mask, cv::Rect(6, 6, 4, 4));
+    auto grid = std::vector<std::uint8_t>(9);
+    RleMask(mask).coverage_grid(3, 3, grid);
+    // Last cells are 4 pixels wide and high
+    const auto expected = std::vector<std::uint8_t>{
+        255, 255 / 9, 0,
+        255 / 9, 3 * 255 / 9, 2 * 255 / 12,
+        0, 0, 255};
+    BOOST_TEST(grid == expected, boost::test_tools::per_element());
+
+    // More cells than pixels leaves empty cells at zero
+    auto row = make_mask(1, 2);
+    fill(row, cv::Rect(0, 0, 2, 1));
+    auto cells = std::vector<std::uint8_t>(4);
+    RleMask(row).coverage_grid(4, 1, cells);
+    const auto expected_cells = std::vector<std::uint8_t>{0, 255, 0, 255};
+    BOOST_TEST(cells == expected_cells, boost::test_tools::per_element());
+
+    auto single = std::vector<std::uint8_t>{7};
+    RleMask().coverage_grid(1, 1, single);
+    BOOST_TEST(single[0] == 0);
+    BOOST_CHECK_THROW(
+        RleMask(mask).coverage_grid(3, 2, grid),
+        std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(AlternatingPixelsArePacked)
+{
+    // Worst case for runs: every foreground pixel is a run of its own
+    auto mask = make_mask(20, 37);
+    for(int y = 0; y < mask.rows; y++) {
+        for(int x = y % 2; x < mask.cols; x += 2) {
+            fill(mask, cv::Rect(x, y, 1, 1));
+        }
+    }
+    auto rle = RleMask(mask);
+    BOOST_TEST(rle.packed());
+    // One bit per pixel, rows padded to whole bytes
+    BOOST_TEST(rle.memory_usage() == 20U * 5U);
+    BOOST_TEST(rle.area() == cv::countNonZero(mask));
+    BOOST_TEST(rle.run_count() == static_cast<std::size_t>(rle.area()));
+    auto buffer = std::vector<RleMask::Run>();
+    const auto row = rle.row(1, buffer);
+    BOOST_TEST_REQUIRE(row.size() == 18U);
+    BOOST_TEST(row[0].begin == 1);
+    BOOST_TEST(row[0].end == 2);
+    BOOST_TEST(row[17].begin == 35);
+    BOOST_TEST(row[17].end == 36);
+    BOOST_TEST(rle.row(0, buffer).size() == 19U);
+    BOOST_TEST(cv::norm(rle.to_mat(), mask, cv::NORM_INF) == 0.);
+
+    // The same runs are serialized
+    auto expected = std::vector<std::uint8_t>{37, 0, 0, 0, 20, 0, 0, 0};
+    for(int y = 0; y < mask.rows; y++) {
+        const auto runs = rle.row(y, buffer);
+        expected.push_back(static_cast<std::uint8_t>(runs.size()));
+        expected.push_back(0);
+        for(const auto& run : runs) {
+            expected.insert(
+                expected.end(),
+                {static_cast<std::uint8_t>(run.begin),
+                 0,
+                 static_cast<std::uint8_t>(run.end),
+                 0});
+        }
+    }
+    BOOST_TEST(rle.serialize() == expected);
+
+    // A sparse mask assigned next is stored as runs again
+    auto sparse = make_mask(20, 37);
+    fill(sparse, cv::Rect(3, 4, 10, 5));
+    rle.assign(sparse);
+    BOOST_TEST(!rle.packed());
+    BOOST_TEST(rle.run_count() == 5U);
+    BOOST_TEST(cv::norm(rle.to_mat(), sparse, cv::NORM_INF) == 0.);
+}
@@ -0,0 +1,55 @@
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#define BOOST_TEST_MODULE segment_offsets
+#include <boost/test/included/unit_test.hpp>
+
+#include "../ffmpeg_adapters/detail/SegmentOffsets.hpp"
+
+using vehlwn::ffmpeg::detail::SegmentOffsets;
+
+namespace {
+// Video in 1/25 and 48 kHz audio in 1/48000 like encoded streams
+constexpr std::size_t VIDEO = 0;
+constexpr std::size_t AUDIO = 1;
+} // namespace
+
+BOOST_AUTO_TEST_CASE(FirstSegmentIsNotShifted)
+{
+    auto offsets = SegmentOffsets(2);
+    // Priming samples of AAC have negative timestamps
+    BOOST_TEST(offsets.offset(AUDIO, -1024) == 0);
+    BOOST_TEST(offsets.offset(VIDEO, 0) == 0);
+}
+
+BOOST_AUTO_TEST_CASE(AudioInterleavedAheadOfKeyframe)
+{
+    auto offsets = SegmentOffsets(2);
+    // Keyframe at 10 s
+    offsets.start_segment({250, 480'000});
+    BOOST_TEST(offsets.offset(VIDEO, 250) == 250);
+    // Audio muxed after the keyframe starts 20 ms before it, so it starts from
+    // zero instead of a negative timestamp
+    const std::int64_t first_audio = 480'000 - 960;
+    BOOST_TEST(offsets.offset(AUDIO, first_audio) == first_audio);
+    // Next packets keep the offset of the first one
+    BOOST_TEST(offsets.offset(AUDIO, first_audio + 1024) == first_audio);
+    BOOST_TEST(offsets.offset(VIDEO, 249) == 250);
+}
+
+BOOST_AUTO_TEST_CASE(LaterStreamsStartFromKeyframe)
+{
+    auto offsets = SegmentOffsets(2);
+    offsets.start_segment({250, 480'000});
+    // Packets without timestamps do not fix the offset
+    BOOST_TEST(offsets.offset(AUDIO, std::nullopt) == 480'000);
+    // Audio after the keyframe stays in sync with video
+    BOOST_TEST(offsets.offset(AUDIO, 480'500) == 480'000);
+    BOOST_TEST(offsets.offset(AUDIO, 479'000) == 480'000);
+
+    // Every segment fixes offsets again
+    offsets.start_segment({500, 960'000});
+    BOOST_TEST(offsets.offset(AUDIO, 959'000) == 959'000);
+    BOOST_TEST(offsets.offset(VIDEO, 500) == 500);
+}
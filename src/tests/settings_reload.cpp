@@ -0,0 +1,92 @@
+#include <sstream>
+#define BOOST_TEST_MODULE settings_reload
+#include <boost/test/included/unit_test.hpp>
+
+#include "../SettingsReload.hpp"
+
+using vehlwn::ApplicationSettings;
+using vehlwn::merge_reloaded_settings;
+
+namespace {
+ApplicationSettings make_settings()
+{
+    auto ret = ApplicationSettings();
+    ret.video_capture.filename = "/dev/video0";
+    ret.output_files.prefix = "/var/lib/recordings";
+    ret.output_files.extension = ".mkv";
+    ret.output_files.video_encoder.codec_name = "libx264";
+    ret.segmentation.background_subtractor.algorithm
+        = ApplicationSettings::Segmentation::BackgroundSubtractor::Mog2{
+            500,
+            16.,
+            false};
+    ret.segmentation.min_moving_area = 100;
+    ret.segmentation.delta_without_motion = 5.;
+    ret.segmentation.trigger.stop_moving_area = 100;
+    ret.segmentation.trigger.smoothing_factor = 1.;
+    ret.segmentation.trigger.start_frames = 1;
+    ret.segmentation.trigger.window_frames = 1;
+    return ret;
+}
+} // namespace
+
+BOOST_AUTO_TEST_CASE(UnchangedSettings)
+{
+    const auto running = make_settings();
+    const auto result = merge_reloaded_settings(running, make_settings());
+    BOOST_TEST(result.applied.empty());
+    BOOST_TEST(result.ignored.empty());
+    BOOST_TEST((result.settings == running));
+    auto os = std::ostringstream();
+    os << result;
+    BOOST_TEST(os.str() == "applied: none; ignored until restart: none");
+}
+
+BOOST_AUTO_TEST_CASE(AppliesHotSettings)
+{
+    const auto running = make_settings();
+    auto reloaded = make_settings();
+    reloaded.segmentation.min_moving_area = 500;
+    reloaded.preprocess.smoothing = ApplicationSettings::Preprocess::Smoothing{
+        ApplicationSettings::Preprocess::Smoothing::Median{5}};
+    reloaded.output_files.video_bitrate = "2M";
+    const auto result = merge_reloaded_settings(running, reloaded);
+    BOOST_TEST(result.ignored.empty());
+    BOOST_TEST(result.applied.size() == 3U);
+    BOOST_TEST((result.settings == reloaded));
+    auto os = std::ostringstream();
+    os << result;
+    BOOST_TEST(
+        os.str()
+        == "applied: output_files, segmentation.min_moving_area, "
+           "preprocess.smoothing; ignored until restart: none");
+}
+
+BOOST_AUTO_TEST_CASE(KeepsRunningInputAndSubtractor)
+{
+    const auto running = make_settings();
+    auto reloaded = make_settings();
+    reloaded.video_capture.filename = "/dev/video1";
+    reloaded.segmentation.background_subtractor.algorithm
+        = ApplicationSettings::Segmentation::BackgroundSubtractor::Knn{
+            500,
+            400.,
+            false};
+    reloaded.output_files.prefix = "/tmp";
+    reloaded.preprocess.threads = 4;
+    reloaded.api.workers = 4;
+    reloaded.segmentation.trigger.start_frames = 3;
+    reloaded.segmentation.trigger.window_frames = 5;
+    const auto result = merge_reloaded_settings(running, reloaded);
+    BOOST_TEST(result.ignored.size() == 5U);
+    BOOST_TEST(result.applied.size() == 1U);
+    BOOST_TEST(result.applied.front() == "segmentation.trigger");
+    BOOST_TEST(result.settings.video_capture.filename == "/dev/video0");
+    BOOST_TEST(result.settings.output_files.prefix == "/var/lib/recordings");
+    BOOST_TEST(result.settings.preprocess.threads == 1);
+    BOOST_TEST(result.settings.api.workers == running.api.workers);
+    BOOST_TEST((
+        result.settings.segmentation.background_subtractor
+        == running.segmentation.background_subtractor));
+    BOOST_TEST(result.settings.segmentation.trigger.start_frames == 3);
+}
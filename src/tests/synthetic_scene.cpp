@@ -0,0 +1,159 @@
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+#include <opencv2/core.hpp>
+#include <opencv2/video/background_segm.hpp>
+#define BOOST_TEST_MODULE synthetic_scene
+#include <boost/test/included/unit_test.hpp>
+
+#include "../ffmpeg_adapters/SyntheticScene.hpp"
+
+using vehlwn::ffmpeg::SyntheticScene;
+
+namespace {
+int count(const std::string& s, const std::string& what)
+{
+    int ret = 0;
+    for(auto pos = s.find(what); pos != std::string::npos;
+        pos = s.find(what, pos + 1)) {
+        ret++;
+    }
+    return ret;
+}
+
+cv::Mat ground_truth_mask(const SyntheticScene& scene, const std::int64_t n)
+{
+    const auto& params = scene.params();
+    auto ret = cv::Mat(params.height, params.width, CV_8UC1, cv::Scalar(0));
+    for(const auto& box : scene.boxes_at(n)) {
+        ret(box).setTo(255);
+    }
+    return ret;
+}
+} // namespace
+
+BOOST_AUTO_TEST_CASE(ParsesUrl)
+{
+    BOOST_TEST(!SyntheticScene::from_url("/dev/video0"));
+    BOOST_TEST(!SyntheticScene::from_url("rtsp://localhost:5000/"));
+
+    const auto defaults = SyntheticScene::from_url("synthetic://moving_box");
+    BOOST_TEST_REQUIRE(defaults.has_value());
+    BOOST_TEST(defaults->params().width == 640);
+    BOOST_TEST(defaults->params().height == 480);
+    BOOST_TEST(defaults->params().fps == 25);
+    BOOST_TEST(defaults->params().objects == 1);
+    BOOST_TEST(defaults->params().realtime);
+
+    const auto scene = SyntheticScene::from_url(
+        "synthetic://moving_box?w=1920&h=1080&fps=60&objects=5&realtime=0");
+    BOOST_TEST_REQUIRE(scene.has_value());
+    BOOST_TEST(scene->params().width == 1920);
+    BOOST_TEST(scene->params().height == 1080);
+    BOOST_TEST(scene->params().fps == 60);
+    BOOST_TEST(scene->params().objects == 5);
+    BOOST_TEST(!scene->params().realtime);
+}
+
+BOOST_AUTO_TEST_CASE(RejectsBadUrl)
+{
+    for(const auto* url : {
+            "synthetic://",
+            "synthetic://noise",
+            "synthetic://moving_box?w",
+            "synthetic://moving_box?w=abc",
+            "synthetic://moving_box?w=640px",
+            "synthetic://moving_box?w=321",
+            "synthetic://moving_box?fps=0",
+            "synthetic://moving_box?objects=1000",
+            "synthetic://moving_box?realtime=2",
+            "synthetic://moving_box?speed=1",
+        }) {
+        BOOST_TEST_CONTEXT(url)
+        {
+            BOOST_CHECK_THROW(SyntheticScene::from_url(url), std::invalid_argument);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(FilterGraph)
+{
+    const auto scene = SyntheticScene::from_url(
+        "synthetic://moving_box?w=320&h=240&fps=30&objects=3");
+    const auto graph = scene->filter_graph();
+    BOOST_TEST(graph.starts_with("color=c=0x202020:s=320x240:r=30[bg0];"));
+    BOOST_TEST(count(graph, "overlay=") == 3);
+    BOOST_TEST(count(graph, "s=40x30:r=30") == 3);
+    BOOST_TEST(graph.ends_with("[bg3]format=yuv420p,realtime[out0]"));
+
+    const auto fast = SyntheticScene::from_url("synthetic://moving_box?realtime=0");
+    BOOST_TEST(fast->filter_graph().ends_with("[bg1]format=yuv420p[out0]"));
+}
+
+BOOST_AUTO_TEST_CASE(BoxesMoveInsideFrame)
+{
+    const auto scene = SyntheticScene::from_url(
+        "synthetic://moving_box?w=320&h=240&fps=25&objects=4");
+    const auto frame = cv::Rect(0, 0, 320, 240);
+    for(std::int64_t n = 0; n < 2000; n++) {
+        const auto boxes = scene->boxes_at(n);
+        BOOST_TEST_REQUIRE(boxes.size() == 4U);
+        for(const auto& box : boxes) {
+            BOOST_TEST((box & frame) == box);
+            BOOST_TEST(box.size() == cv::Size(40, 30));
+        }
+    }
+    const auto first = scene->boxes_at(0);
+    const auto second = scene->boxes_at(1);
+    for(std::size_t i = 0; i < first.size(); i++) {
+        BOOST_TEST(first[i] != second[i]);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(RenderMatchesBoxes)
+{
+    const auto scene = SyntheticScene::from_url(
+        "synthetic://moving_box?w=320&h=240&objects=3");
+    auto frame = cv::Mat();
+    auto gray = cv::Mat();
+    for(const std::int64_t n : {0, 17, 250}) {
+        scene->render(n, frame);
+        BOOST_TEST(frame.type() == CV_8UC3);
+        cv::extractChannel(frame, gray, 1);
+        // Background is 0x20 in every channel, boxes are brighter in green
+        auto diff = cv::Mat();
+        cv::compare(gray > 0x20, ground_truth_mask(*scene, n), diff, cv::CMP_NE);
+        BOOST_TEST(cv::countNonZero(diff) == 0);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(DetectsMotion)
+{
+    // Pixel precision and recall of MOG2 foreground against ground truth
+    const auto scene = SyntheticScene::from_url(
+        "synthetic://moving_box?w=320&h=240&objects=3");
+    const auto subtractor = cv::createBackgroundSubtractorMOG2(500, 16., false);
+    auto frame = cv::Mat();
+    auto fgmask = cv::Mat();
+    double true_positives = 0.;
+    double false_positives = 0.;
+    double false_negatives = 0.;
+    for(std::int64_t n = 0; n < 300; n++) {
+        scene->render(n, frame);
+        subtractor->apply(frame, fgmask);
+        // The background model needs a few frames to settle
+        if(n < 50) {
+            continue;
+        }
+        const auto truth = ground_truth_mask(*scene, n);
+        true_positives += cv::countNonZero(fgmask & truth);
+        false_positives += cv::countNonZero(fgmask & ~truth);
+        false_negatives += cv::countNonZero(~fgmask & truth);
+    }
+    const auto precision = true_positives / (true_positives + false_positives);
+    const auto recall = true_positives / (true_positives + false_negatives);
+    BOOST_TEST(precision > 0.9);
+    BOOST_TEST(recall > 0.8);
+}
@@ -0,0 +1,79 @@
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#define BOOST_TEST_MODULE thread_pool
+#include <boost/test/included/unit_test.hpp>
+
+#include "../ThreadPool.hpp"
+
+BOOST_AUTO_TEST_CASE(CallsEveryIndexOnce)
+{
+    auto pool = vehlwn::ThreadPool(4);
+    BOOST_TEST(pool.size() == 4);
+    for(const int n : {0, 1, 3, 4, 100}) {
+        auto calls = std::vector<std::atomic<int>>(static_cast<std::size_t>(n));
+        pool.parallel_for(n, [&](const int i) {
+            calls[static_cast<std::size_t>(i)]++;
+        });
+        for(const auto& c : calls) {
+            BOOST_TEST(c == 1);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(SingleThread)
+{
+    auto pool = vehlwn::ThreadPool(1);
+    const auto caller = std::this_thread::get_id();
+    int sum = 0;
+    pool.parallel_for(10, [&](const int i) {
+        BOOST_TEST((std::this_thread::get_id() == caller));
+        sum += i;
+    });
+    BOOST_TEST(sum == 45);
+}
+
+BOOST_AUTO_TEST_CASE(RethrowsAfterAllCalls)
+{
+    auto pool = vehlwn::ThreadPool(3);
+    auto calls = std::atomic<int>(0);
+    BOOST_CHECK_THROW(
+        pool.parallel_for(
+            8,
+            [&](const int i) {
+                calls++;
+                if(i % 2 == 0) {
+                    throw std::runtime_error("test");
+                }
+            }),
+        std::runtime_error);
+    BOOST_TEST(calls == 8);
+    // The pool still works
+    auto sum = std::atomic<int>(0);
+    pool.parallel_for(4, [&](const int i) { sum += i; });
+    BOOST_TEST(sum == 6);
+}
+
+BOOST_AUTO_TEST_CASE(SharedByCallers)
+{
+    auto pool = vehlwn::ThreadPool(2);
+    auto total = std::atomic<int>(0);
+    auto callers = std::vector<std::thread>();
+    for(int c = 0; c < 4; c++) {
+        callers.emplace_back([&] {
+            for(int j = 0; j < 100; j++) {
+                pool.parallel_for(5, [&](const int i) { total += i; });
+            }
+        });
+    }
+    for(auto& t : callers) {
+        t.join();
+    }
+    BOOST_TEST(total == 4 * 100 * 10);
+}
+
+BOOST_AUTO_TEST_CASE(InvalidSize)
+{
+    BOOST_CHECK_THROW(vehlwn::ThreadPool(0), std::invalid_argument);
+}
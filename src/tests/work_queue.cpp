@@ -0,0 +1,57 @@
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <stdexcept>
+#include <thread>
+#define BOOST_TEST_MODULE work_queue
+#include <boost/test/included/unit_test.hpp>
+
+#include "../WorkQueue.hpp"
+
+BOOST_AUTO_TEST_CASE(RunsTasksOnWorkers)
+{
+    // Declared before the queue so that workers are joined first
+    auto done = std::promise<std::thread::id>();
+    auto queue = vehlwn::WorkQueue(2, 4);
+    BOOST_TEST(queue.capacity() == 4U);
+    auto future = done.get_future();
+    BOOST_TEST(queue.try_submit(
+        [&] { done.set_value(std::this_thread::get_id()); }));
+    BOOST_TEST((future.get() != std::this_thread::get_id()));
+    BOOST_TEST(queue.rejected() == 0U);
+}
+
+BOOST_AUTO_TEST_CASE(RejectsWhenFull)
+{
+    auto release = std::promise<void>();
+    auto released = release.get_future().share();
+    auto started = std::promise<void>();
+    auto ran = std::atomic<int>(0);
+    auto queue = vehlwn::WorkQueue(1, 1);
+    // Occupies the only worker
+    BOOST_TEST(queue.try_submit([&, released] {
+        started.set_value();
+        released.wait();
+    }));
+    started.get_future().wait();
+    BOOST_TEST(queue.try_submit([&] { ran++; }));
+    BOOST_TEST(queue.queued() == 1U);
+    BOOST_TEST(!queue.try_submit([&] { ran++; }));
+    BOOST_TEST(queue.rejected() == 1U);
+    release.set_value();
+    while(queue.queued() != 0 || ran == 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    BOOST_TEST(ran == 1);
+}
+
+BOOST_AUTO_TEST_CASE(SurvivesThrowingTasks)
+{
+    auto done = std::promise<void>();
+    auto queue = vehlwn::WorkQueue(1, 2);
+    BOOST_TEST(queue.try_submit([] { throw std::runtime_error("test"); }));
+    BOOST_TEST(queue.try_submit([&] { done.set_value(); }));
+    done.get_future().wait();
+    BOOST_CHECK_THROW(vehlwn::WorkQueue(0, 1), std::invalid_argument);
+    BOOST_CHECK_THROW(vehlwn::WorkQueue(1, 0), std::invalid_argument);
+}